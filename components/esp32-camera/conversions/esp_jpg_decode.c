@@ -11,6 +11,7 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <stdlib.h>
 #include "esp_jpg_decode.h"
 
 #include "esp_system.h"
@@ -40,6 +41,11 @@
 static const char* TAG = "esp_jpg_decode";
 #endif
 
+//tables of the decoder hold pointers and longs, hosts with 64-bit ones need bigger work area
+#ifndef JPG_DECODE_WORK_SIZE
+#define JPG_DECODE_WORK_SIZE 3100
+#endif
+
 typedef struct {
         jpg_scale_t scale;
         jpg_reader_cb reader;
@@ -95,10 +101,16 @@ static unsigned int _jpg_read(JDEC *decoder, uint8_t *buf, unsigned int len)
 
 esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg)
 {
-    static uint8_t work[3100];
+    //work area is allocated per call, so decoding can run in several tasks at once
+    uint8_t *work = (uint8_t *)malloc(JPG_DECODE_WORK_SIZE);
     JDEC decoder;
     esp_jpg_decoder_t jpeg;
 
+    if (!work) {
+        ESP_LOGE(TAG, "Work area malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+
     jpeg.len = len;
     jpeg.reader = reader;
     jpeg.writer = writer;
@@ -106,9 +118,10 @@ esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jp
     jpeg.scale = scale;
     jpeg.index = 0;
 
-    JRESULT jres = jd_prepare(&decoder, _jpg_read, work, 3100, &jpeg);
+    JRESULT jres = jd_prepare(&decoder, _jpg_read, work, JPG_DECODE_WORK_SIZE, &jpeg);
     if(jres != JDR_OK){
         ESP_LOGE(TAG, "JPG Header Parse Failed! %s", jd_errors[jres]);
+        free(work);
         return ESP_FAIL;
     }
 
@@ -121,6 +134,7 @@ esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jp
     jres = jd_decomp(&decoder, _jpg_write, (uint8_t)jpeg.scale);
     //output end
     writer(arg, output_width, output_height, output_width, output_height, NULL);
+    free(work);
 
     if (jres != JDR_OK) {
         ESP_LOGE(TAG, "JPG Decompression Failed! %s", jd_errors[jres]);
@@ -123,6 +123,33 @@ bool fmt2rgb888(const uint8_t *src_buf, size_t src_len, pixformat_t format, uint
 
 bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t * out, jpg_scale_t scale);
 
+/**
+ * @brief Convert one line of YUV422 (Y0 U Y1 V) to RGB888 in B,G,R byte order, like fmt2rgb888()
+ *
+ * @param src       Source line, width * 2 bytes. Word aligned source is read with 32 bit loads
+ * @param dst       Output buffer (width * 3)
+ * @param width     Number of pixels, can be a whole frame (width * height)
+ */
+void yuv422_to_rgb888_row(const uint8_t *src, uint8_t *dst, size_t width);
+
+/**
+ * @brief Convert one line of YUV422 (Y0 U Y1 V) to RGB565, high byte first like PIXFORMAT_RGB565 frames
+ *
+ * @param src       Source line, width * 2 bytes. Word aligned source is read with 32 bit loads
+ * @param dst       Output buffer (width * 2)
+ * @param width     Number of pixels, can be a whole frame (width * height)
+ */
+void yuv422_to_rgb565_row(const uint8_t *src, uint8_t *dst, size_t width);
+
+/**
+ * @brief Convert one line of YUV422 (Y0 U Y1 V) to full range grayscale
+ *
+ * @param src       Source line, width * 2 bytes. Word aligned source is read with 32 bit loads
+ * @param dst       Output buffer (width)
+ * @param width     Number of pixels, can be a whole frame (width * height)
+ */
+void yuv422_to_gray_row(const uint8_t *src, uint8_t *dst, size_t width);
+
 #ifdef __cplusplus
 }
 #endif
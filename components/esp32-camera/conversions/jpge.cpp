@@ -72,6 +72,9 @@ namespace jpge {
 
     static int32 m_last_quality = 0;
     static int32 m_quantization_tables[2][64];
+    // Reciprocals of the quantization tables: x / q == (x * recip) >> QUANT_RECIP_BITS for 0 <= x < 2^16, q <= 255
+    enum { QUANT_RECIP_BITS = 31 };
+    static uint32 m_quantization_recip[2][64];
 
     static bool m_huff_initialized = false;
     static uint m_huff_codes[4][256];
@@ -88,7 +91,7 @@ namespace jpge {
         return static_cast<uint8>(i);
     }
 
-    static void RGB_to_YCC(uint8* pDst, const uint8 *pSrc, int num_pixels) {
+    void RGB_to_YCC(uint8* pDst, const uint8 *pSrc, int num_pixels) {
         for ( ; num_pixels; pDst += 3, pSrc += 3, num_pixels--) {
             const int r = pSrc[0], g = pSrc[1], b = pSrc[2];
             pDst[0] = static_cast<uint8>((r * YR + g * YG + b * YB + 32768) >> 16);
@@ -97,6 +100,16 @@ namespace jpge {
         }
     }
 
+    // Same as RGB_to_YCC for BGR ordered source (PIXFORMAT_RGB888 buffers), saves the byte swap pass
+    void BGR_to_YCC(uint8* pDst, const uint8 *pSrc, int num_pixels) {
+        for ( ; num_pixels; pDst += 3, pSrc += 3, num_pixels--) {
+            const int r = pSrc[2], g = pSrc[1], b = pSrc[0];
+            pDst[0] = static_cast<uint8>((r * YR + g * YG + b * YB + 32768) >> 16);
+            pDst[1] = clamp(128 + ((r * CB_R + g * CB_G + b * CB_B + 32768) >> 16));
+            pDst[2] = clamp(128 + ((r * CR_R + g * CR_G + b * CR_B + 32768) >> 16));
+        }
+    }
+
     static void RGB_to_Y(uint8* pDst, const uint8 *pSrc, int num_pixels) {
         for ( ; num_pixels; pDst++, pSrc += 3, num_pixels--) {
             pDst[0] = static_cast<uint8>((pSrc[0] * YR + pSrc[1] * YG + pSrc[2] * YB + 32768) >> 16);
@@ -383,26 +396,16 @@ namespace jpge {
 
     void jpeg_encoder::load_quantized_coefficients(int component_num)
     {
-        int32 *q = m_quantization_tables[component_num > 0];
+        const int32 *q = m_quantization_tables[component_num > 0];
+        const uint32 *r = m_quantization_recip[component_num > 0];
         int16 *pDst = m_coefficient_array;
+        // rounded division by multiplication with reciprocal, no division nor branch per coefficient
         for (int i = 0; i < 64; i++)
         {
             sample_array_t j = m_sample_array[s_zag[i]];
-            if (j < 0)
-            {
-                if ((j = -j + (*q >> 1)) < *q)
-                    *pDst++ = 0;
-                else
-                    *pDst++ = static_cast<int16>(-(j / *q));
-            }
-            else
-            {
-                if ((j = j + (*q >> 1)) < *q)
-                    *pDst++ = 0;
-                else
-                    *pDst++ = static_cast<int16>((j / *q));
-            }
-            q++;
+            uint32 a = static_cast<uint32>((j < 0) ? -j : j) + (q[i] >> 1);
+            int16 v = static_cast<int16>((static_cast<uint64_t>(a) * r[i]) >> QUANT_RECIP_BITS);
+            *pDst++ = (j < 0) ? -v : v;
         }
     }
 
@@ -529,6 +532,12 @@ namespace jpge {
             else
                 Y_to_YCC(pDst, Psrc, m_image_x);
         }
+        finish_mcu_line();
+    }
+
+    void jpeg_encoder::finish_mcu_line()
+    {
+        uint8* pDst = m_mcu_lines[m_mcu_y_ofs];
 
         // Possibly duplicate pixels at end of scanline if not a multiple of 8 or 16
         if (m_num_components == 1)
@@ -565,6 +574,12 @@ namespace jpge {
         }
     }
 
+    static void compute_quant_recip(uint32 *pDst, const int32 *pSrc)
+    {
+        for (int i = 0; i < 64; i++)
+            *pDst++ = static_cast<uint32>((1UL << QUANT_RECIP_BITS) / static_cast<uint32>(*pSrc++)) + 1;
+    }
+
     // Higher-level methods.
     bool jpeg_encoder::jpg_open(int p_x_res, int p_y_res, int src_channels)
     {
@@ -622,6 +637,8 @@ namespace jpge {
             m_last_quality = m_params.m_quality;
             compute_quant_table(m_quantization_tables[0], s_std_lum_quant);
             compute_quant_table(m_quantization_tables[1], s_std_croma_quant);
+            compute_quant_recip(m_quantization_recip[0], m_quantization_tables[0]);
+            compute_quant_recip(m_quantization_recip[1], m_quantization_tables[1]);
         }
 
         if(!m_huff_initialized){
@@ -725,4 +742,20 @@ namespace jpge {
         return m_all_stream_writes_succeeded;
     }
 
+    uint8 *jpeg_encoder::get_scanline_ycc()
+    {
+        return m_mcu_lines[m_mcu_y_ofs];
+    }
+
+    bool jpeg_encoder::process_scanline_ycc()
+    {
+        if ((m_pass_num < 1) || (m_pass_num > 2)) {
+            return false;
+        }
+        if (m_all_stream_writes_succeeded) {
+            finish_mcu_line();
+        }
+        return m_all_stream_writes_succeeded;
+    }
+
 } // namespace jpge
@@ -50,6 +50,10 @@ namespace jpge
             virtual uint get_size() const = 0;
     };
     
+    // Colour conversion of a scanline into interleaved YCbCr (as expected by get_scanline_ycc()).
+    void RGB_to_YCC(uint8* pDst, const uint8 *pSrc, int num_pixels);
+    void BGR_to_YCC(uint8* pDst, const uint8 *pSrc, int num_pixels);
+
     // Lower level jpeg_encoder class - useful if more control is needed than the above helper functions.
     class jpeg_encoder {
         public:
@@ -73,6 +77,12 @@ namespace jpge
             // Deinitializes the compressor, freeing any allocated memory. May be called at any time.
             void deinit();
 
+            // Direct YCbCr input, an alternative to process_scanline() for callers converting colours themselves.
+            // get_scanline_ycc() returns the next scanline inside the current MCU row, fill width * components
+            // bytes (Y or YCbCr) and call process_scanline_ycc(). Saves the line copy and RGB conversion.
+            uint8 *get_scanline_ycc();
+            bool process_scanline_ycc();
+
         private:
             jpeg_encoder(const jpeg_encoder &);
             jpeg_encoder &operator =(const jpeg_encoder &);
@@ -133,6 +143,7 @@ namespace jpge
             void process_mcu_row();
             bool process_end_of_image();
             void load_mcu(const void* src);
+            void finish_mcu_line();
             void clear();
             void init();
     };
@@ -19,7 +19,6 @@
 #include "esp_camera.h"
 #include "img_converters.h"
 #include "jpge.h"
-#include "yuv.h"
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -65,27 +64,79 @@ static IRAM_ATTR void convert_line_format(uint8_t * src, pixformat_t format, uin
             dst[o++] = (src[i+1] & 0x1F) << 3;
         }
     } else if(format == PIXFORMAT_YUV422) {
-        uint8_t y0, y1, u, v;
-        uint8_t r, g, b;
-        l = width * 2;
-        src += l * line;
-        for(i=0; i<l; i+=4) {
-            y0 = src[i];
-            u = src[i+1];
-            y1 = src[i+2];
-            v = src[i+3];
-
-            yuv2rgb(y0, u, v, &r, &g, &b);
-            dst[o++] = r;
-            dst[o++] = g;
-            dst[o++] = b;
-
-            yuv2rgb(y1, u, v, &r, &g, &b);
-            dst[o++] = r;
-            dst[o++] = g;
-            dst[o++] = b;
+        uint8_t t;
+        l = width * 3;
+        yuv422_to_rgb888_row(src + width * 2 * line, dst, width);
+        // row conversion gives B,G,R, encoder wants R,G,B
+        for(i=0; i<l; i+=3) {
+            t = dst[i];
+            dst[i] = dst[i+2];
+            dst[i+2] = t;
+        }
+    }
+}
+
+// Sensor YUV uses studio range (Y 16-235, UV 16-240), JPEG YCbCr is full range.
+// Both are the same colour space, so conversion is a per channel lookup.
+static uint8_t s_ycc_y[256];
+static uint8_t s_ycc_c[256];
+static bool s_ycc_tables_ready = false;
+
+static void init_ycc_tables()
+{
+    if(s_ycc_tables_ready) {
+        return;
+    }
+    for(int i=0; i<256; i++) {
+        int y = (i - 16) * 255, c = (i - 128) * 255;
+        y = (y < 0) ? -((-y + 109) / 219) : (y + 109) / 219;          // round((i-16)*255/219)
+        c = 128 + ((c < 0) ? -((-c + 112) / 224) : (c + 112) / 224);   // 128+round((i-128)*255/224)
+        s_ycc_y[i] = (y < 0) ? 0 : ((y > 255) ? 255 : y);
+        s_ycc_c[i] = (c < 0) ? 0 : ((c > 255) ? 255 : c);
+    }
+    s_ycc_tables_ready = true;
+}
+
+static IRAM_ATTR void yuv422_to_ycc_line(const uint8_t * src, uint8_t * dst, size_t width)
+{
+    // one 32 bit load per pixel pair: Y0 U Y1 V
+    const uint32_t *s = (const uint32_t *)src;
+    for(size_t i=0; i<width; i+=2) {
+        uint32_t yuyv = *s++;
+        uint8_t u = s_ycc_c[(yuyv >> 8) & 0xFF];
+        uint8_t v = s_ycc_c[yuyv >> 24];
+        dst[0] = s_ycc_y[yuyv & 0xFF];
+        dst[1] = u;
+        dst[2] = v;
+        dst[3] = s_ycc_y[(yuyv >> 16) & 0xFF];
+        dst[4] = u;
+        dst[5] = v;
+        dst += 6;
+    }
+}
+
+// Writes scanlines straight into the encoder MCU rows, without the intermediate RGB line
+static bool convert_image_direct(uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, jpge::jpeg_encoder &dst_image)
+{
+    size_t stride = (format == PIXFORMAT_GRAYSCALE) ? width : ((format == PIXFORMAT_RGB888) ? width * 3 : width * 2);
+    if(format == PIXFORMAT_YUV422) {
+        init_ycc_tables();
+    }
+    for (int i = 0; i < height; i++, src += stride) {
+        uint8_t *line = dst_image.get_scanline_ycc();
+        if(format == PIXFORMAT_GRAYSCALE) {
+            memcpy(line, src, width);
+        } else if(format == PIXFORMAT_RGB888) {
+            jpge::BGR_to_YCC(line, src, width);
+        } else {
+            yuv422_to_ycc_line(src, line, width);
+        }
+        if (!dst_image.process_scanline_ycc()) {
+            ESP_LOGE(TAG, "JPG process line %u failed", i);
+            return false;
         }
     }
+    return true;
 }
 
 bool convert_image(uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality, jpge::output_stream *dst_stream)
@@ -115,21 +166,28 @@ bool convert_image(uint8_t *src, uint16_t width, uint16_t height, pixformat_t fo
         return false;
     }
 
-    uint8_t* line = (uint8_t*)_malloc(width * num_channels);
-    if(!line) {
-        ESP_LOGE(TAG, "Scan line malloc failed");
-        return false;
-    }
-
-    for (int i = 0; i < height; i++) {
-        convert_line_format(src, format, line, width, num_channels, i);
-        if (!dst_image.process_scanline(line)) {
-            ESP_LOGE(TAG, "JPG process line %u failed", i);
-            free(line);
+    // YUV422 with odd width has no 32 bit aligned pixel pairs, use generic path
+    if(format == PIXFORMAT_GRAYSCALE || format == PIXFORMAT_RGB888 || (format == PIXFORMAT_YUV422 && !(width & 1))) {
+        if(!convert_image_direct(src, width, height, format, dst_image)) {
             return false;
         }
+    } else {
+        uint8_t* line = (uint8_t*)_malloc(width * num_channels);
+        if(!line) {
+            ESP_LOGE(TAG, "Scan line malloc failed");
+            return false;
+        }
+
+        for (int i = 0; i < height; i++) {
+            convert_line_format(src, format, line, width, num_channels, i);
+            if (!dst_image.process_scanline(line)) {
+                ESP_LOGE(TAG, "JPG process line %u failed", i);
+                free(line);
+                return false;
+            }
+        }
+        free(line);
     }
-    free(line);
 
     if (!dst_image.process_scanline(NULL)) {
         ESP_LOGE(TAG, "JPG image finish failed");
@@ -153,7 +211,7 @@ public:
         index += ocb(oarg, index, data, len);
         return true;
     }
-    virtual size_t get_size() const
+    virtual jpge::uint get_size() const
     {
         return index;
     }
@@ -199,7 +257,7 @@ public:
         return true;
     }
 
-    virtual size_t get_size() const
+    virtual jpge::uint get_size() const
     {
         return index;
     }
@@ -11,7 +11,9 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <stdbool.h>
 #include "yuv.h"
+#include "img_converters.h"
 #include "esp_attr.h"
 
 typedef struct {
@@ -296,3 +298,129 @@ void IRAM_ATTR yuv2rgb(uint8_t y, uint8_t u, uint8_t v, uint8_t *r, uint8_t *g,
     *g = YUYV_CONSTRAIN(gi);
     *b = YUYV_CONSTRAIN(bi);
 }
+
+// Sum of table entries spans -276..534, clamp through a table instead of branching
+#define YUV_CLAMP_OFFSET 384
+#define YUV_CLAMP_SIZE 1024
+
+static uint8_t s_clamp[YUV_CLAMP_SIZE];
+static bool s_clamp_ready = false;
+
+static void init_clamp_table(void)
+{
+    if(s_clamp_ready) {
+        return;
+    }
+    for(int i=0; i<YUV_CLAMP_SIZE; i++) {
+        int v = i - YUV_CLAMP_OFFSET;
+        s_clamp[i] = YUYV_CONSTRAIN(v);
+    }
+    s_clamp_ready = true;
+}
+
+// Y0 U Y1 V pair as one little endian word, single 32 bit load when src is aligned
+#define YUV_PAIR(p, aligned) ((aligned) ? *(const uint32_t *)(p) : \
+        ((p)[0] | ((p)[1] << 8) | ((p)[2] << 16) | ((uint32_t)(p)[3] << 24)))
+
+// odd width: last pixel has no pair, borrow V of the previous pair
+#define YUV_TAIL_V(p, width) (((width) > 1) ? (p)[-1] : 128)
+
+void IRAM_ATTR yuv422_to_rgb888_row(const uint8_t *src, uint8_t *dst, size_t width)
+{
+    const uint8_t *c = s_clamp + YUV_CLAMP_OFFSET;
+    const yuv_table_row *tu, *tv;
+    bool aligned = !((uintptr_t)src & 3);
+    size_t i, pairs = width / 2;
+    uint32_t w;
+    int y, r, g, b;
+
+    init_clamp_table();
+    for(i=0; i<pairs; i++, src+=4, dst+=6) {
+        w = YUV_PAIR(src, aligned);
+        tu = &yuv_table[(w >> 8) & 0xFF];
+        tv = &yuv_table[w >> 24];
+        r = tv->vVr;
+        g = tu->vUg + tv->vVg;
+        b = tu->vUb;
+
+        y = yuv_table[w & 0xFF].vY;
+        dst[0] = c[y + b];
+        dst[1] = c[y + g];
+        dst[2] = c[y + r];
+
+        y = yuv_table[(w >> 16) & 0xFF].vY;
+        dst[3] = c[y + b];
+        dst[4] = c[y + g];
+        dst[5] = c[y + r];
+    }
+    if(width & 1) {
+        tu = &yuv_table[src[1]];
+        tv = &yuv_table[YUV_TAIL_V(src, width)];
+        y = yuv_table[src[0]].vY;
+        dst[0] = c[y + tu->vUb];
+        dst[1] = c[y + tu->vUg + tv->vVg];
+        dst[2] = c[y + tv->vVr];
+    }
+}
+
+static inline uint16_t IRAM_ATTR pack_rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+void IRAM_ATTR yuv422_to_rgb565_row(const uint8_t *src, uint8_t *dst, size_t width)
+{
+    const uint8_t *c = s_clamp + YUV_CLAMP_OFFSET;
+    const yuv_table_row *tu, *tv;
+    bool aligned = !((uintptr_t)src & 3);
+    size_t i, pairs = width / 2;
+    uint32_t w;
+    uint16_t p;
+    int y, r, g, b;
+
+    init_clamp_table();
+    for(i=0; i<pairs; i++, src+=4, dst+=4) {
+        w = YUV_PAIR(src, aligned);
+        tu = &yuv_table[(w >> 8) & 0xFF];
+        tv = &yuv_table[w >> 24];
+        r = tv->vVr;
+        g = tu->vUg + tv->vVg;
+        b = tu->vUb;
+
+        y = yuv_table[w & 0xFF].vY;
+        p = pack_rgb565(c[y + r], c[y + g], c[y + b]);
+        dst[0] = p >> 8;
+        dst[1] = p & 0xFF;
+
+        y = yuv_table[(w >> 16) & 0xFF].vY;
+        p = pack_rgb565(c[y + r], c[y + g], c[y + b]);
+        dst[2] = p >> 8;
+        dst[3] = p & 0xFF;
+    }
+    if(width & 1) {
+        tu = &yuv_table[src[1]];
+        tv = &yuv_table[YUV_TAIL_V(src, width)];
+        y = yuv_table[src[0]].vY;
+        p = pack_rgb565(c[y + tv->vVr], c[y + tu->vUg + tv->vVg], c[y + tu->vUb]);
+        dst[0] = p >> 8;
+        dst[1] = p & 0xFF;
+    }
+}
+
+void IRAM_ATTR yuv422_to_gray_row(const uint8_t *src, uint8_t *dst, size_t width)
+{
+    const uint8_t *c = s_clamp + YUV_CLAMP_OFFSET;
+    bool aligned = !((uintptr_t)src & 3);
+    size_t i, pairs = width / 2;
+    uint32_t w;
+
+    init_clamp_table();
+    for(i=0; i<pairs; i++, src+=4, dst+=2) {
+        w = YUV_PAIR(src, aligned);
+        dst[0] = c[yuv_table[w & 0xFF].vY];
+        dst[1] = c[yuv_table[(w >> 16) & 0xFF].vY];
+    }
+    if(width & 1) {
+        dst[0] = c[yuv_table[src[0]].vY];
+    }
+}
@@ -56,21 +56,6 @@ static int cam_verify_jpeg_soi(const uint8_t *inbuf, uint32_t length)
     return -1;
 }
 
-static int cam_verify_jpeg_eoi(const uint8_t *inbuf, uint32_t length)
-{
-    int offset = -1;
-    uint8_t *dptr = (uint8_t *)inbuf + length - 2;
-    while (dptr > inbuf) {
-        if (memcmp(dptr, &JPEG_EOI_MARKER, 2) == 0) {
-            offset = dptr - inbuf;
-            //ESP_LOGW(TAG, "EOI: %d", length - (offset + 2));
-            return offset;
-        }
-        dptr--;
-    }
-    return -1;
-}
-
 static bool cam_get_next_frame(int * frame_pos)
 {
     if(!cam_obj->frames[*frame_pos].en){
@@ -493,6 +478,14 @@ camera_fb_t *cam_take(TickType_t timeout)
     return NULL;
 }
 
+void cam_flush(void)
+{
+    camera_fb_t *dma_buffer = NULL;
+    while (xQueueReceive(cam_obj->frame_buffer_queue, (void *)&dma_buffer, 0) == pdTRUE) {
+        cam_give(dma_buffer);
+    }
+}
+
 void cam_give(camera_fb_t *dma_buffer)
 {
     for (int x = 0; x < cam_obj->frame_cnt; x++) {
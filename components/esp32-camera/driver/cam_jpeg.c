@@ -0,0 +1,62 @@
+// Copyright 2010-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// JPEG marker search of frames received by cam_hal.c, free of driver dependencies
+// so that it builds in host_test as well
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cam_jpeg.h"
+
+#define CAM_HAS_FF_BYTE(w) ((~(w) - 0x01010101U) & (w) & 0x80808080U)
+
+static inline bool cam_is_jpeg_eoi(const uint8_t *p)
+{
+    return p[0] == 0xFF && p[1] == 0xD9;
+}
+
+int cam_verify_jpeg_eoi(const uint8_t *inbuf, uint32_t length)
+{
+    if (length < 3) {
+        return -1;
+    }
+    //last marker wins, offset 0 is never a valid EOI
+    int32_t i = length - 2;
+    //single bytes until i + 1 is word aligned
+    while (i >= 1 && ((uintptr_t)(inbuf + i + 1) & 3)) {
+        if (cam_is_jpeg_eoi(&inbuf[i])) {
+            return i;
+        }
+        i--;
+    }
+    //words without 0xFF byte can not hold start of the marker - skip them whole
+    while (i >= 4) {
+        uint32_t w = *(const uint32_t *)(inbuf + i - 3);
+        if (CAM_HAS_FF_BYTE(w)) {
+            for (int32_t j = i; j > i - 4; j--) {
+                if (cam_is_jpeg_eoi(&inbuf[j])) {
+                    return j;
+                }
+            }
+        }
+        i -= 4;
+    }
+    while (i >= 1) {
+        if (cam_is_jpeg_eoi(&inbuf[i])) {
+            return i;
+        }
+        i--;
+    }
+    return -1;
+}
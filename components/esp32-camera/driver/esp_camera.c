@@ -82,6 +82,7 @@ static const char *TAG = "camera";
 typedef struct {
     cam_sensor_t sensor;
     camera_fb_t fb;
+    framesize_t max_framesize;  //frame buffers are sized for this one
 } camera_state_t;
 
 static const char *CAMERA_SENSOR_NVS_KEY = "sensor";
@@ -307,6 +308,7 @@ esp_err_t esp_camera_init(const camera_config_t *config)
     }
 
     s_state->sensor.status.framesize = frame_size;
+    s_state->max_framesize = frame_size;
     s_state->sensor.pixformat = pix_format;
 
     ESP_LOGD(TAG, "Setting frame size to %dx%d", resolution[frame_size].width, resolution[frame_size].height);
@@ -390,6 +392,46 @@ cam_sensor_t *esp_camera_sensor_get()
     return &s_state->sensor;
 }
 
+esp_err_t esp_camera_set_framesize(framesize_t frame_size)
+{
+    if (s_state == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_state->sensor.pixformat != PIXFORMAT_JPEG) {
+        //raw frames must fill the buffer exactly
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (frame_size >= FRAMESIZE_INVALID ||
+        resolution[frame_size].width * resolution[frame_size].height >
+        resolution[s_state->max_framesize].width * resolution[s_state->max_framesize].height) {
+        ESP_LOGE(TAG, "Frame size %d exceeds size set at init %d", frame_size, s_state->max_framesize);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (frame_size == s_state->sensor.status.framesize) {
+        return ESP_OK;
+    }
+    if (s_state->sensor.set_framesize(&s_state->sensor, frame_size) != 0) {
+        return ESP_ERR_CAMERA_FAILED_TO_SET_FRAME_SIZE;
+    }
+    //frames already captured have the old size, the one being captured now is mixed
+    cam_flush();
+    camera_fb_t *fb = cam_take(FB_GET_TIMEOUT);
+    if (fb) {
+        cam_give(fb);
+    }
+    return ESP_OK;
+}
+
+void esp_camera_sensor_batch_begin(void)
+{
+    SCCB_Batch_Begin();
+}
+
+esp_err_t esp_camera_sensor_batch_end(void)
+{
+    return SCCB_Batch_End() ? ESP_FAIL : ESP_OK;
+}
+
 esp_err_t esp_camera_save_to_nvs(const char *key)
 {
 #if ESP_IDF_VERSION_MAJOR > 3
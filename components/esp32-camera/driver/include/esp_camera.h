@@ -217,6 +217,37 @@ void esp_camera_fb_return(camera_fb_t * fb);
  */
 cam_sensor_t * esp_camera_sensor_get();
 
+/**
+ * @brief Change frame size without reinitialization of the driver.
+ *        Frame buffers allocated at init are reused, so only JPEG mode
+ *        and sizes not larger than the one given in camera_config_t are allowed.
+ *        Frames captured before the change are discarded.
+ *
+ * @param frame_size new frame size
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if frame_size is larger than the size set at init
+ *      - ESP_ERR_NOT_SUPPORTED if pixel format is not JPEG
+ *      - ESP_ERR_CAMERA_FAILED_TO_SET_FRAME_SIZE if sensor rejected the size
+ */
+esp_err_t esp_camera_set_framesize(framesize_t frame_size);
+
+/**
+ * @brief Start collecting sensor register writes (done by sensor setters)
+ *        to send them later as repeated START transactions.
+ *        Setters that read registers flush writes collected so far,
+ *        other tasks wait for the sensor until esp_camera_sensor_batch_end().
+ */
+void esp_camera_sensor_batch_begin(void);
+
+/**
+ * @brief Send register writes collected since esp_camera_sensor_batch_begin()
+ *
+ * @return ESP_OK on success, ESP_FAIL if any of the writes failed
+ */
+esp_err_t esp_camera_sensor_batch_end(void);
+
 /**
  * @brief Save camera settings to non-volatile-storage (NVS)
  * 
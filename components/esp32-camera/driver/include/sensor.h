@@ -250,6 +250,9 @@ typedef struct _sensor {
     int  (*set_res_raw)         (cam_sensor_t *sensor, int startX, int startY, int endX, int endY, int offsetX, int offsetY, int totalX, int totalY, int outputX, int outputY, bool scale, bool binning);
     int  (*set_pll)             (cam_sensor_t *sensor, int bypass, int mul, int sys, int root, int pre, int seld5, int pclken, int pclk);
     int  (*set_xclk)            (cam_sensor_t *sensor, int timer, int xclk);
+    // Exposure, gain, AE level and AEC2 in one batch with AEC/AGC switched off until
+    // set_exposure_ctrl()/set_gain_ctrl() turn them on again. NULL if not supported.
+    int  (*set_exposure_seed)   (cam_sensor_t *sensor, int aec_value, int agc_gain, int ae_level, int aec2);
 } cam_sensor_t;
 
 camera_sensor_info_t *esp_camera_sensor_get_info(sensor_id_t *id);
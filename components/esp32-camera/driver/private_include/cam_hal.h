@@ -15,6 +15,7 @@
 #pragma once
 
 #include "esp_camera.h"
+#include "cam_jpeg.h"
 
 
 #ifdef __cplusplus
@@ -55,6 +56,11 @@ camera_fb_t *cam_take(TickType_t timeout);
 
 void cam_give(camera_fb_t *dma_buffer);
 
+/**
+ * @brief Return all frames waiting in the queue to the driver
+ */
+void cam_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,35 @@
+// Copyright 2010-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Find JPEG end of image marker
+ *
+ * @param inbuf frame buffer
+ * @param length number of bytes received into the buffer
+ *
+ * @return offset of the last 0xFF 0xD9 in the buffer (offset 0 excluded), -1 if not found
+ */
+int cam_verify_jpeg_eoi(const uint8_t *inbuf, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,7 @@
 #ifndef __SCCB_H__
 #define __SCCB_H__
 #include <stdint.h>
+#include <stddef.h>
 int SCCB_Init(int pin_sda, int pin_scl);
 int SCCB_Use_Port(int sccb_i2c_port);
 int SCCB_Deinit(void);
@@ -19,4 +20,9 @@ uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg);
 int SCCB_Write16(uint8_t slv_addr, uint16_t reg, uint8_t data);
 uint16_t SCCB_Read_Addr16_Val16(uint8_t slv_addr, uint16_t reg);
 int SCCB_Write_Addr16_Val16(uint8_t slv_addr, uint16_t reg, uint16_t data);
+// Writes issued between Begin and End go to the bus in few repeated START transactions (reads flush
+// them first). The calling task owns the bus until End, other tasks wait on their SCCB calls.
+void SCCB_Batch_Begin(void);
+int SCCB_Batch_End(void);
+int SCCB_Write_Batch(uint8_t slv_addr, const uint8_t (*regs)[2], size_t count);
 #endif // __SCCB_H__
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include "sccb.h"
 #include "sensor.h"
 #include <stdio.h>
@@ -46,6 +47,130 @@ const int SCCB_I2C_PORT_DEFAULT = 0;
 static int sccb_i2c_port;
 static bool sccb_owns_i2c_port;
 
+// Register writes queued between SCCB_Batch_Begin() and SCCB_Batch_End().
+// All of it belongs to the task holding sccb_mutex, the link and data are static
+// so queued writes do not touch the heap.
+#define SCCB_BATCH_MAX          16      /*!< writes in one link, more are sent in several links */
+#define SCCB_WRITE_MAX          5       /*!< slave address + 16 bit register + 16 bit value */
+// A write takes two link commands (START, address and data) plus one STOP per link,
+// the driver's recommended size budgets five per transaction
+static uint8_t sccb_batch_link[I2C_LINK_RECOMMENDED_SIZE(SCCB_BATCH_MAX / 2)];
+static uint8_t sccb_batch_data[SCCB_BATCH_MAX][SCCB_WRITE_MAX];
+static i2c_cmd_handle_t sccb_batch_cmd = NULL;
+static int sccb_batch_depth = 0;
+static int sccb_batch_count = 0;
+static esp_err_t sccb_batch_ret = ESP_OK;
+
+// Bus and batch owner, recursive so a batch holder can still read and write
+static StaticSemaphore_t sccb_mutex_buf;
+static SemaphoreHandle_t sccb_mutex = NULL;
+
+static void sccb_mutex_init(void)
+{
+    if (sccb_mutex == NULL) {
+        sccb_mutex = xSemaphoreCreateRecursiveMutexStatic(&sccb_mutex_buf);
+    }
+}
+
+static void sccb_lock(void)
+{
+    sccb_mutex_init();
+    xSemaphoreTakeRecursive(sccb_mutex, portMAX_DELAY);
+}
+
+static void sccb_unlock(void)
+{
+    xSemaphoreGiveRecursive(sccb_mutex);
+}
+
+/**
+ * Sends queued writes. Called with sccb_mutex held.
+ */
+static int sccb_batch_flush(void)
+{
+    if (sccb_batch_count == 0) {
+        return 0;
+    }
+    esp_err_t ret = i2c_master_stop(sccb_batch_cmd);
+    if (ret == ESP_OK) {
+        ret = i2c_master_cmd_begin(sccb_i2c_port, sccb_batch_cmd, 1000 / portTICK_RATE_MS);
+    }
+    i2c_cmd_link_delete_static(sccb_batch_cmd);
+    sccb_batch_cmd = NULL;
+    if (ret != ESP_OK) {
+        if (sccb_batch_depth) {
+            ESP_LOGE(TAG, "SCCB batch of %d writes failed, ret:%d", sccb_batch_count, ret);
+        }
+        sccb_batch_ret = ret;
+    }
+    sccb_batch_count = 0;
+    return ret == ESP_OK ? 0 : -1;
+}
+
+/**
+ * Sends one register write, or queues it while a batch is open.
+ * Writes in a link are separated by repeated STARTs and the link ends
+ * with its only STOP, the driver does not handle STOP in the middle of a link.
+ */
+static int sccb_write_bytes(uint8_t slv_addr, const uint8_t *data, size_t len)
+{
+    esp_err_t ret;
+    sccb_lock();
+    if (sccb_batch_count == SCCB_BATCH_MAX) {
+        sccb_batch_flush();
+    }
+    if (sccb_batch_count == 0) {
+        sccb_batch_cmd = i2c_cmd_link_create_static(sccb_batch_link, sizeof(sccb_batch_link));
+    }
+    // i2c_master_write() keeps the pointer, so data is kept until the link is sent
+    uint8_t *buf = sccb_batch_data[sccb_batch_count++];
+    buf[0] = ( slv_addr << 1 ) | WRITE_BIT;
+    memcpy(buf + 1, data, len);
+    ret = i2c_master_start(sccb_batch_cmd);
+    if (ret == ESP_OK) {
+        ret = i2c_master_write(sccb_batch_cmd, buf, len + 1, ACK_CHECK_EN);
+    }
+    if (ret != ESP_OK) {
+        sccb_batch_ret = ret;
+    }
+    if (sccb_batch_depth == 0 && sccb_batch_flush()) {
+        ret = ESP_FAIL;
+    }
+    sccb_unlock();
+    return ret == ESP_OK ? 0 : -1;
+}
+
+void SCCB_Batch_Begin(void)
+{
+    sccb_lock();
+    if (sccb_batch_depth++ == 0) {
+        sccb_batch_ret = ESP_OK;
+    }
+}
+
+int SCCB_Batch_End(void)
+{
+    if (sccb_batch_depth == 0) {
+        return 0;
+    }
+    int ret = 0;
+    if (--sccb_batch_depth == 0) {
+        sccb_batch_flush();
+        ret = sccb_batch_ret == ESP_OK ? 0 : -1;
+    }
+    sccb_unlock();
+    return ret;
+}
+
+int SCCB_Write_Batch(uint8_t slv_addr, const uint8_t (*regs)[2], size_t count)
+{
+    SCCB_Batch_Begin();
+    for (size_t i = 0; i < count; i++) {
+        sccb_write_bytes(slv_addr, regs[i], 2);
+    }
+    return SCCB_Batch_End();
+}
+
 int SCCB_Init(int pin_sda, int pin_scl)
 {
     ESP_LOGI(TAG, "pin_sda %d pin_scl %d", pin_sda, pin_scl);
@@ -53,6 +178,7 @@ int SCCB_Init(int pin_sda, int pin_scl)
     esp_err_t ret;
 
     memset(&conf, 0, sizeof(i2c_config_t));
+    sccb_mutex_init();
 
     sccb_i2c_port = SCCB_I2C_PORT_DEFAULT;
     sccb_owns_i2c_port = true;
@@ -79,6 +205,7 @@ int SCCB_Use_Port(int i2c_num) { // sccb use an already initialized I2C port
     if (i2c_num < 0 || i2c_num > I2C_NUM_MAX) {
         return ESP_ERR_INVALID_ARG;
     }
+    sccb_mutex_init();
     sccb_i2c_port = i2c_num;
     return ESP_OK;
 }
@@ -96,6 +223,7 @@ uint8_t SCCB_Probe(void)
 {
     uint8_t slave_addr = 0x0;
 
+    sccb_lock();
     for (size_t i = 0; i < CAMERA_MODEL_MAX; i++) {
         if (slave_addr == camera_sensor[i].sccb_addr) {
             continue;
@@ -108,14 +236,18 @@ uint8_t SCCB_Probe(void)
         esp_err_t ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
         i2c_cmd_link_delete(cmd);
         if( ret == ESP_OK) {
+            sccb_unlock();
             return slave_addr;
         }
     }
+    sccb_unlock();
     return 0;
 }
 
 uint8_t SCCB_Read(uint8_t slv_addr, uint8_t reg)
 {
+    sccb_lock();
+    sccb_batch_flush();     // read must see queued writes
     uint8_t data=0;
     esp_err_t ret = ESP_FAIL;
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
@@ -125,7 +257,10 @@ uint8_t SCCB_Read(uint8_t slv_addr, uint8_t reg)
     i2c_master_stop(cmd);
     ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
     i2c_cmd_link_delete(cmd);
-    if(ret != ESP_OK) return -1;
+    if(ret != ESP_OK) {
+        sccb_unlock();
+        return -1;
+    }
     cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, ( slv_addr << 1 ) | READ_BIT, ACK_CHECK_EN);
@@ -136,28 +271,24 @@ uint8_t SCCB_Read(uint8_t slv_addr, uint8_t reg)
     if(ret != ESP_OK) {
         ESP_LOGE(TAG, "SCCB_Read Failed addr:0x%02x, reg:0x%02x, data:0x%02x, ret:%d", slv_addr, reg, data, ret);
     }
+    sccb_unlock();
     return data;
 }
 
 int SCCB_Write(uint8_t slv_addr, uint8_t reg, uint8_t data)
 {
-    esp_err_t ret = ESP_FAIL;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, ( slv_addr << 1 ) | WRITE_BIT, ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, reg, ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data, ACK_CHECK_EN);
-    i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
-    if(ret != ESP_OK) {
-        ESP_LOGE(TAG, "SCCB_Write Failed addr:0x%02x, reg:0x%02x, data:0x%02x, ret:%d", slv_addr, reg, data, ret);
+    const uint8_t buf[2] = {reg, data};
+    int ret = sccb_write_bytes(slv_addr, buf, sizeof(buf));
+    if(ret) {
+        ESP_LOGE(TAG, "SCCB_Write Failed addr:0x%02x, reg:0x%02x, data:0x%02x", slv_addr, reg, data);
     }
-    return ret == ESP_OK ? 0 : -1;
+    return ret;
 }
 
 uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg)
 {
+    sccb_lock();
+    sccb_batch_flush();     // read must see queued writes
     uint8_t data=0;
     esp_err_t ret = ESP_FAIL;
     uint16_t reg_htons = LITTLETOBIG(reg);
@@ -170,7 +301,10 @@ uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg)
     i2c_master_stop(cmd);
     ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
     i2c_cmd_link_delete(cmd);
-    if(ret != ESP_OK) return -1;
+    if(ret != ESP_OK) {
+        sccb_unlock();
+        return -1;
+    }
     cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, ( slv_addr << 1 ) | READ_BIT, ACK_CHECK_EN);
@@ -181,32 +315,25 @@ uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg)
     if(ret != ESP_OK) {
         ESP_LOGE(TAG, "W [%04x]=%02x fail\n", reg, data);
     }
+    sccb_unlock();
     return data;
 }
 
 int SCCB_Write16(uint8_t slv_addr, uint16_t reg, uint8_t data)
 {
     static uint16_t i = 0;
-    esp_err_t ret = ESP_FAIL;
-    uint16_t reg_htons = LITTLETOBIG(reg);
-    uint8_t *reg_u8 = (uint8_t *)&reg_htons;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, ( slv_addr << 1 ) | WRITE_BIT, ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, reg_u8[0], ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, reg_u8[1], ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data, ACK_CHECK_EN);
-    i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
-    if(ret != ESP_OK) {
+    const uint8_t buf[3] = {reg >> 8, reg & 0xFF, data};
+    int ret = sccb_write_bytes(slv_addr, buf, sizeof(buf));
+    if(ret) {
         ESP_LOGE(TAG, "W [%04x]=%02x %d fail\n", reg, data, i++);
     }
-    return ret == ESP_OK ? 0 : -1;
+    return ret;
 }
 
 uint16_t SCCB_Read_Addr16_Val16(uint8_t slv_addr, uint16_t reg)
 {
+    sccb_lock();
+    sccb_batch_flush();     // read must see queued writes
     uint16_t data = 0;
     uint8_t *data_u8 = (uint8_t *)&data;
     esp_err_t ret = ESP_FAIL;
@@ -220,7 +347,10 @@ uint16_t SCCB_Read_Addr16_Val16(uint8_t slv_addr, uint16_t reg)
     i2c_master_stop(cmd);
     ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
     i2c_cmd_link_delete(cmd);
-    if(ret != ESP_OK) return -1;
+    if(ret != ESP_OK) {
+        sccb_unlock();
+        return -1;
+    }
 
     cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
@@ -233,28 +363,16 @@ uint16_t SCCB_Read_Addr16_Val16(uint8_t slv_addr, uint16_t reg)
     if(ret != ESP_OK) {
         ESP_LOGE(TAG, "W [%04x]=%04x fail\n", reg, data);
     }
+    sccb_unlock();
     return data;
 }
 
 int SCCB_Write_Addr16_Val16(uint8_t slv_addr, uint16_t reg, uint16_t data)
 {
-    esp_err_t ret = ESP_FAIL;
-    uint16_t reg_htons = LITTLETOBIG(reg);
-    uint8_t *reg_u8 = (uint8_t *)&reg_htons;
-    uint16_t data_htons = LITTLETOBIG(data);
-    uint8_t *data_u8 = (uint8_t *)&data_htons;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, ( slv_addr << 1 ) | WRITE_BIT, ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, reg_u8[0], ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, reg_u8[1], ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data_u8[0], ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data_u8[1], ACK_CHECK_EN);
-    i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
-    if(ret != ESP_OK) {
+    const uint8_t buf[4] = {reg >> 8, reg & 0xFF, data >> 8, data & 0xFF};
+    int ret = sccb_write_bytes(slv_addr, buf, sizeof(buf));
+    if(ret) {
         ESP_LOGE(TAG, "W [%04x]=%04x fail\n", reg, data);
     }
-    return ret == ESP_OK ? 0 : -1;
+    return ret;
 }
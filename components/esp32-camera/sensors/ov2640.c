@@ -38,6 +38,7 @@ static int set_bank(cam_sensor_t *sensor, ov2640_bank_t bank)
 static int write_regs(cam_sensor_t *sensor, const uint8_t (*regs)[2])
 {
     int i=0, res = 0;
+    SCCB_Batch_Begin();     // whole table in one bus transaction
     while (regs[i][0]) {
         if (regs[i][0] == BANK_SEL) {
             res = set_bank(sensor, regs[i][1]);
@@ -45,11 +46,12 @@ static int write_regs(cam_sensor_t *sensor, const uint8_t (*regs)[2])
             res = SCCB_Write(sensor->slv_addr, regs[i][0], regs[i][1]);
         }
         if (res) {
+            SCCB_Batch_End();
             return res;
         }
         i++;
     }
-    return res;
+    return SCCB_Batch_End();
 }
 
 static int write_reg(cam_sensor_t *sensor, ov2640_bank_t bank, uint8_t reg, uint8_t value)
@@ -325,10 +327,11 @@ static int set_ae_level(cam_sensor_t *sensor, int level)
         return -1;
     }
     sensor->status.ae_level = level-3;
-    for (int i=0; i<3; i++) {
-        WRITE_REG_OR_RETURN(BANK_SENSOR, ae_levels_regs[0][i], ae_levels_regs[level][i]);
+    SCCB_Batch_Begin();
+    for (int i=0; i<3 && !ret; i++) {
+        ret = write_reg(sensor, BANK_SENSOR, ae_levels_regs[0][i], ae_levels_regs[level][i]);
     }
-    return ret;
+    return SCCB_Batch_End() || ret;
 }
 
 static int set_quality(cam_sensor_t *sensor, int quality)
@@ -379,6 +382,47 @@ static int set_aec2(cam_sensor_t *sensor, int enable)
     return set_reg_bits(sensor, BANK_DSP, CTRL0, 6, 1, enable?0:1);
 }
 
+static int set_exposure_seed(cam_sensor_t *sensor, int aec_value, int agc_gain, int ae_level, int aec2)
+{
+    int ret = 0;
+    ae_level += 3;
+    if (ae_level <= 0 || ae_level > NUM_AE_LEVELS) {
+        return -1;
+    }
+    aec_value = aec_value < 0 ? 0 : aec_value > 1200 ? 1200 : aec_value;
+    agc_gain = agc_gain < 0 ? 0 : agc_gain > 30 ? 30 : agc_gain;
+    // registers shared with other settings are read before the batch, so it only writes
+    uint8_t com8 = read_reg(sensor, BANK_SENSOR, COM8);
+    uint8_t reg04 = read_reg(sensor, BANK_SENSOR, REG04);
+    uint8_t reg45 = read_reg(sensor, BANK_SENSOR, REG45);
+    uint8_t ctrl0 = read_reg(sensor, BANK_DSP, CTRL0);
+    // AEC/AGC keep their own values while enabled, status still holds the requested state
+    const uint8_t regs[][3] = {
+        {BANK_SENSOR, COM8, com8 & ~(COM8_AEC_EN | COM8_AGC_EN)},
+        {BANK_SENSOR, REG04, (reg04 & ~0x03) | (aec_value & 0x03)},
+        {BANK_SENSOR, AEC, (aec_value >> 2) & 0xFF},
+        {BANK_SENSOR, REG45, (reg45 & ~0x3F) | ((aec_value >> 10) & 0x3F)},
+        {BANK_SENSOR, GAIN, agc_gain_tbl[agc_gain]},
+        {BANK_SENSOR, ae_levels_regs[0][0], ae_levels_regs[ae_level][0]},
+        {BANK_SENSOR, ae_levels_regs[0][1], ae_levels_regs[ae_level][1]},
+        {BANK_SENSOR, ae_levels_regs[0][2], ae_levels_regs[ae_level][2]},
+        {BANK_DSP, CTRL0, (ctrl0 & ~0x40) | (aec2 ? 0 : 0x40)},
+    };
+    SCCB_Batch_Begin();
+    for (size_t i = 0; i < sizeof(regs) / sizeof(regs[0]) && !ret; i++) {
+        ret = write_reg(sensor, regs[i][0], regs[i][1], regs[i][2]);
+    }
+    if (SCCB_Batch_End() || ret) {
+        reg_bank = BANK_MAX;    // bank select may not have reached the sensor
+        return -1;
+    }
+    sensor->status.aec_value = aec_value;
+    sensor->status.agc_gain = agc_gain;
+    sensor->status.ae_level = ae_level - 3;
+    sensor->status.aec2 = aec2;
+    return 0;
+}
+
 static int set_colorbar(cam_sensor_t *sensor, int enable)
 {
     sensor->status.colorbar = enable;
@@ -607,6 +651,7 @@ int ov2640_init(cam_sensor_t *sensor)
     sensor->set_res_raw = set_res_raw;
     sensor->set_pll = _set_pll;
     sensor->set_xclk = set_xclk;
+    sensor->set_exposure_seed = set_exposure_seed;
     ESP_LOGD(TAG, "OV2640 Attached");
     return 0;
 }
@@ -9,6 +9,8 @@
 #include "driver/i2c.h"
 
 #include "esp_camera.h"
+#include "img_converters.h"
+#include "test_frame.h"
 
 #ifdef CONFIG_IDF_TARGET_ESP32
 #define BOARD_WROVER_KIT 1
@@ -338,6 +340,33 @@ TEST_CASE("Camera driver take JPEG picture test", "[camera]")
     TEST_ASSERT_NOT_NULL(pic);
 }
 
+TEST_CASE("Camera driver JPEG frame size switch test", "[camera]")
+{
+    float fps;
+    uint32_t size_full, size_small;
+    TEST_ESP_OK(init_camera(20000000, PIXFORMAT_JPEG, FRAMESIZE_SXGA, 2, SIOD_GPIO_NUM, -1));
+    vTaskDelay(500 / portTICK_RATE_MS);
+    TEST_ASSERT_TRUE(camera_test_fps(8, &fps, &size_full));
+    ESP_LOGI(TAG, "SXGA: %.2f fps, %u B", fps, size_full);
+
+    uint64_t t1 = esp_timer_get_time();
+    TEST_ESP_OK(esp_camera_set_framesize(FRAMESIZE_VGA));
+    ESP_LOGI(TAG, "Switch to VGA took %llu ms", (esp_timer_get_time() - t1) / 1000);
+    TEST_ASSERT_TRUE(camera_test_fps(8, &fps, &size_small));
+    ESP_LOGI(TAG, "VGA: %.2f fps, %u B", fps, size_small);
+    TEST_ASSERT_LESS_THAN(size_full, size_small);
+
+    //buffers are sized at init, larger frames can not be taken
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_camera_set_framesize(FRAMESIZE_UXGA));
+    TEST_ESP_OK(esp_camera_set_framesize(FRAMESIZE_SXGA));
+    camera_fb_t *pic = esp_camera_fb_get();
+    TEST_ASSERT_NOT_NULL(pic);
+    TEST_ASSERT_EQUAL(1280, pic->width);
+    esp_camera_fb_return(pic);
+
+    TEST_ESP_OK(esp_camera_deinit());
+}
+
 TEST_CASE("Camera driver performance test", "[camera]")
 {
     camera_performance_test(20 * 1000000, 16);
@@ -533,3 +562,55 @@ TEST_CASE("Camera driver uses an i2c port initialized by other devices test", "[
     TEST_ESP_OK(esp_camera_deinit());
     TEST_ESP_OK(i2c_driver_delete(I2C_MASTER_NUM));
 }
+
+static float jpg_encode_test(uint8_t *src, size_t len, int w, int h, pixformat_t format, size_t *out_len, uint32_t times)
+{
+    uint8_t *out = NULL;
+    uint64_t t_total = 0;
+    for (size_t i = 0; i < times; i++) {
+        uint64_t t1 = esp_timer_get_time();
+        TEST_ASSERT_TRUE(fmt2jpg(src, len, w, h, format, 80, &out, out_len));
+        t_total += esp_timer_get_time() - t1;
+        free(out);
+    }
+    return len * times / (float)t_total; // bytes/us == MB/s
+}
+
+TEST_CASE("Conversions jpeg encode performance test", "[camera]")
+{
+    const int sizes[][2] = {{640, 480}, {800, 600}, {1280, 1024}};
+    printf("Encode Result (quality 80)\n");
+    printf("resolution  , YUV422 MB/s, YUV422 size, via RGB888 MB/s, via RGB888 size, RGB888 MB/s, RGB888 size\n");
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        int w = sizes[k][0], h = sizes[k][1];
+        uint8_t *rgb = heap_caps_malloc(w * h * 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        uint8_t *rgb_ref = heap_caps_malloc(w * h * 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        uint8_t *yuv = heap_caps_malloc(w * h * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        TEST_ASSERT_NOT_NULL(rgb);
+        TEST_ASSERT_NOT_NULL(rgb_ref);
+        TEST_ASSERT_NOT_NULL(yuv);
+        make_test_frame_rgb888(rgb, w, h);
+        rgb888_to_yuv422(rgb, yuv, w, h);
+
+        size_t yuv_size = 0, ref_size = 0, rgb_size = 0;
+        // direct YUV422 -> YCbCr path
+        float yuv_mbs = jpg_encode_test(yuv, w * h * 2, w, h, PIXFORMAT_YUV422, &yuv_size, 4);
+        // previous path: per pixel yuv2rgb, then RGB -> YCbCr inside encoder
+        uint64_t t1 = esp_timer_get_time();
+        TEST_ASSERT_TRUE(fmt2rgb888(yuv, w * h * 2, PIXFORMAT_YUV422, rgb_ref));
+        uint64_t t_conv = esp_timer_get_time() - t1;
+        float ref_mbs = jpg_encode_test(rgb_ref, w * h * 3, w, h, PIXFORMAT_RGB888, &ref_size, 4);
+        ref_mbs = (w * h * 2) / ((w * h * 3) / ref_mbs + t_conv);
+        float rgb_mbs = jpg_encode_test(rgb, w * h * 3, w, h, PIXFORMAT_RGB888, &rgb_size, 4);
+
+        printf("%4d x %4d ,      %6.2f,     %7u,          %6.2f,         %7u,      %6.2f,     %7u\n",
+               w, h, yuv_mbs, yuv_size, ref_mbs, ref_size, rgb_mbs, rgb_size);
+        // same picture, only rounding of the colour conversion differs
+        TEST_ASSERT_INT_WITHIN(ref_size / 20, ref_size, yuv_size);
+
+        heap_caps_free(rgb);
+        heap_caps_free(rgb_ref);
+        heap_caps_free(yuv);
+    }
+    printf("----------------------------------------------------------------------------------------\n");
+}
@@ -0,0 +1,35 @@
+#include "test_frame.h"
+
+// plain C only, builds for the target and in host_test
+
+void make_test_frame_rgb888(uint8_t *p, int w, int h)
+{
+    uint32_t seed = 1;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            seed = seed * 1103515245 + 12345;
+            int n = (seed >> 16) & 15;
+            int r, g, b;
+            if (y < h / 2) {
+                r = 90 + y * 100 / h; g = 140 + y * 60 / h; b = 230 - y * 40 / h;
+                if (((x - w / 3) * (x - w / 3) + (y - h / 5) * (y - h / 5)) < (h / 8) * (h / 8)) {
+                    r = g = b = 245;
+                }
+            } else {
+                r = 60 + ((x / 7 + y / 5) % 40) + n; g = 100 + ((x / 11) % 50) + n; b = 40 + n;
+            }
+            *p++ = b; *p++ = g; *p++ = r;
+        }
+    }
+}
+
+void rgb888_to_yuv422(const uint8_t *s, uint8_t *d, int w, int h)
+{
+    for (int i = 0; i < w * h; i += 2, s += 6, d += 4) {
+        int r = (s[2] + s[5]) / 2, g = (s[1] + s[4]) / 2, b = (s[0] + s[3]) / 2;
+        d[0] = 16 + ((66 * s[2] + 129 * s[1] + 25 * s[0] + 128) >> 8);
+        d[1] = 128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8);
+        d[2] = 16 + ((66 * s[5] + 129 * s[4] + 25 * s[3] + 128) >> 8);
+        d[3] = 128 + ((112 * r - 94 * g - 18 * b + 128) >> 8);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef _TEST_FRAME_H_
+#define _TEST_FRAME_H_
+
+#include <stdint.h>
+
+// Synthetic scene (sky gradient, sun, textured ground) as BGR888, like fmt2rgb888() output
+void make_test_frame_rgb888(uint8_t *p, int w, int h);
+
+// BGR888 to YUYV (BT.601, chroma of pixel pairs averaged)
+void rgb888_to_yuv422(const uint8_t *s, uint8_t *d, int w, int h);
+
+#endif /* _TEST_FRAME_H_ */
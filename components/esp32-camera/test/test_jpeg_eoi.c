@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "esp_heap_caps.h"
+
+// plain C only, builds for the target and in host_test (pictures are linked in by both)
+
+int cam_verify_jpeg_eoi(const uint8_t *inbuf, uint32_t length);
+
+// previous byte by byte implementation of cam_verify_jpeg_eoi()
+static int jpeg_eoi_ref(const uint8_t *inbuf, uint32_t length)
+{
+    const uint16_t eoi = 0xD9FF;
+    const uint8_t *dptr = inbuf + length - 2;
+    while (dptr > inbuf) {
+        if (memcmp(dptr, &eoi, 2) == 0) {
+            return dptr - inbuf;
+        }
+        dptr--;
+    }
+    return -1;
+}
+
+// picture as delivered by DMA: JPEG followed by the rest of the last transfer
+static uint8_t *make_dma_frame(const uint8_t *jpg, size_t len, size_t tail, uint8_t fill)
+{
+    uint8_t *buf = heap_caps_malloc(len + tail + 4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(buf);
+    memcpy(buf, jpg, len);
+    memset(buf + len, fill, tail + 4);
+    return buf;
+}
+
+extern const uint8_t img1_start[] asm("_binary_testimg_jpeg_start");
+extern const uint8_t img1_end[]   asm("_binary_testimg_jpeg_end");
+extern const uint8_t img2_start[] asm("_binary_test_inside_jpeg_start");
+extern const uint8_t img2_end[]   asm("_binary_test_inside_jpeg_end");
+extern const uint8_t img3_start[] asm("_binary_test_outside_jpeg_start");
+extern const uint8_t img3_end[]   asm("_binary_test_outside_jpeg_end");
+
+TEST_CASE("Camera driver JPEG EOI search test", "[camera]")
+{
+    // every alignment, every length near both ends
+    uint8_t buf[64 + 4];
+    srand(35);
+    for (int n = 0; n < 2000; n++) {
+        for (size_t i = 0; i < sizeof(buf); i++) {
+            int r = rand() & 3;
+            buf[i] = r == 0 ? 0xFF : r == 1 ? 0xD9 : rand();
+        }
+        for (uint32_t off = 0; off < 4; off++) {
+            for (uint32_t l = 0; l <= 64; l++) {
+                TEST_ASSERT_EQUAL_INT(jpeg_eoi_ref(buf + off, l), cam_verify_jpeg_eoi(buf + off, l));
+            }
+        }
+    }
+
+    const size_t len = img3_end - img3_start;
+    const uint8_t fills[] = {0x00, 0xFF, 0xD9, 0x55};
+    for (size_t f = 0; f < sizeof(fills); f++) {
+        uint8_t *frame = make_dma_frame(img3_start, len, 4096, fills[f]);
+        for (uint32_t l = len - 8; l < len + 4096; l += 7) {
+            TEST_ASSERT_EQUAL_INT(jpeg_eoi_ref(frame, l), cam_verify_jpeg_eoi(frame, l));
+        }
+        heap_caps_free(frame);
+    }
+}
+
+TEST_CASE("Camera driver JPEG EOI search performance test", "[camera]")
+{
+    const struct {
+        const uint8_t *buf;
+        size_t len;
+    } imgs[] = {
+        {img1_start, img1_end - img1_start},
+        {img2_start, img2_end - img2_start},
+        {img3_start, img3_end - img3_start},
+    };
+    // about one DMA half buffer of padding after EOI
+    const size_t tail = 16 * 1024;
+    const uint32_t times = 100;
+
+    printf("JPEG EOI search, %u B after EOI (us per frame)\n", (unsigned)tail);
+    printf("    size, byte by byte, word at a time\n");
+    for (size_t i = 0; i < sizeof(imgs) / sizeof(imgs[0]); i++) {
+        uint8_t *frame = make_dma_frame(imgs[i].buf, imgs[i].len, tail, 0);
+        uint32_t l = imgs[i].len + tail;
+        volatile int r1 = 0, r2 = 0;
+        clock_t t1 = clock();
+        for (uint32_t n = 0; n < times; n++) {
+            r1 = jpeg_eoi_ref(frame, l);
+        }
+        clock_t t_ref = clock() - t1;
+        t1 = clock();
+        for (uint32_t n = 0; n < times; n++) {
+            r2 = cam_verify_jpeg_eoi(frame, l);
+        }
+        clock_t t_word = clock() - t1;
+        printf("%8u, %12.1f, %14.1f\n", (unsigned)imgs[i].len,
+               (double)t_ref * 1000000 / CLOCKS_PER_SEC / times, (double)t_word * 1000000 / CLOCKS_PER_SEC / times);
+        TEST_ASSERT_EQUAL_INT(r1, r2);
+        TEST_ASSERT_LESS_THAN(t_ref, t_word);
+        heap_caps_free(frame);
+    }
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "esp_heap_caps.h"
+
+#include "img_converters.h"
+#include "test_frame.h"
+
+// plain C only, builds for the target and in host_test
+
+// reference per pixel conversion, private to conversions
+void yuv2rgb(uint8_t y, uint8_t u, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b);
+
+static void yuv422_row_check(const uint8_t *yuv, size_t width)
+{
+    uint8_t rgb[256 * 3], rgb565[256 * 2], gray[256];
+    uint8_t r, g, b;
+    yuv422_to_rgb888_row(yuv, rgb, width);
+    yuv422_to_rgb565_row(yuv, rgb565, width);
+    yuv422_to_gray_row(yuv, gray, width);
+    for (size_t x = 0; x < width; x++) {
+        const uint8_t *p = yuv + (x & ~1) * 2;
+        yuv2rgb(p[(x & 1) * 2], p[1], p[3], &r, &g, &b);
+        TEST_ASSERT_EQUAL_UINT8(b, rgb[x * 3]);
+        TEST_ASSERT_EQUAL_UINT8(g, rgb[x * 3 + 1]);
+        TEST_ASSERT_EQUAL_UINT8(r, rgb[x * 3 + 2]);
+        uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+        TEST_ASSERT_EQUAL_UINT8(c >> 8, rgb565[x * 2]);
+        TEST_ASSERT_EQUAL_UINT8(c & 0xFF, rgb565[x * 2 + 1]);
+        // neutral chroma leaves only luma
+        yuv2rgb(p[(x & 1) * 2], 128, 128, &r, &g, &b);
+        TEST_ASSERT_EQUAL_UINT8(r, gray[x]);
+    }
+}
+
+TEST_CASE("Conversions YUV422 row conversion test", "[camera]")
+{
+    // +2 keeps pixel pairs but breaks word alignment
+    uint32_t buf[(256 * 2 + 4) / 4];
+    uint8_t *aligned = (uint8_t *)buf, *unaligned = aligned + 2;
+    for (int u = 0; u < 256; u += 5) {
+        for (int v = 0; v < 256; v += 5) {
+            for (int i = 0; i < 256; i++) {
+                aligned[i * 2] = i;
+                aligned[i * 2 + 1] = (i & 1) ? v : u;
+            }
+            yuv422_row_check(aligned, 256);
+            memmove(unaligned, aligned, 256 * 2);
+            yuv422_row_check(unaligned, 256);
+        }
+    }
+
+    // whole frame goes through the same rows
+    const int w = 64, h = 48;
+    uint8_t frame[64 * 48 * 2], rgb[64 * 48 * 3], row[64 * 3];
+    make_test_frame_rgb888(rgb, w, h);
+    rgb888_to_yuv422(rgb, frame, w, h);
+    TEST_ASSERT_TRUE(fmt2rgb888(frame, sizeof(frame), PIXFORMAT_YUV422, rgb));
+    for (int y = 0; y < h; y++) {
+        yuv422_to_rgb888_row(frame + y * w * 2, row, w);
+        TEST_ASSERT_EQUAL(0, memcmp(row, rgb + y * w * 3, w * 3));
+    }
+}
+
+TEST_CASE("Conversions YUV422 row conversion performance test", "[camera]")
+{
+    const int w = 640, h = 480;
+    uint8_t *rgb = heap_caps_malloc(w * h * 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *yuv = heap_caps_malloc(w * h * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *line_in = heap_caps_malloc(w * 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *line_out = heap_caps_malloc(w * 3, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(rgb);
+    TEST_ASSERT_NOT_NULL(yuv);
+    TEST_ASSERT_NOT_NULL(line_in);
+    TEST_ASSERT_NOT_NULL(line_out);
+    make_test_frame_rgb888(rgb, w, h);
+    rgb888_to_yuv422(rgb, yuv, w, h);
+    memcpy(line_in, yuv, w * 2);
+
+    const uint32_t times = 2000;
+    uint8_t r, g, b;
+    clock_t t1 = clock();
+    for (uint32_t n = 0; n < times; n++) {
+        uint8_t *o = line_out;
+        for (int i = 0; i < w * 2; i += 4, o += 6) {
+            yuv2rgb(line_in[i], line_in[i + 1], line_in[i + 3], &r, &g, &b);
+            o[0] = b; o[1] = g; o[2] = r;
+            yuv2rgb(line_in[i + 2], line_in[i + 1], line_in[i + 3], &r, &g, &b);
+            o[3] = b; o[4] = g; o[5] = r;
+        }
+    }
+    clock_t t_ref = clock() - t1;
+    t1 = clock();
+    for (uint32_t n = 0; n < times; n++) {
+        yuv422_to_rgb888_row(line_in, line_out, w);
+    }
+    clock_t t_rgb888 = clock() - t1;
+    t1 = clock();
+    for (uint32_t n = 0; n < times; n++) {
+        yuv422_to_rgb565_row(line_in, line_out, w);
+    }
+    clock_t t_rgb565 = clock() - t1;
+    t1 = clock();
+    for (uint32_t n = 0; n < times; n++) {
+        yuv422_to_gray_row(line_in, line_out, w);
+    }
+    clock_t t_gray = clock() - t1;
+    t1 = clock();
+    TEST_ASSERT_TRUE(fmt2rgb888(yuv, w * h * 2, PIXFORMAT_YUV422, rgb));
+    clock_t t_frame = clock() - t1;
+
+    // Mpx/s from clock ticks
+    double mpix = (double)w * times * CLOCKS_PER_SEC / 1000000;
+    printf("YUV422 row conversion, %d px line in internal RAM (Mpx/s)\n", w);
+    printf("yuv2rgb per pixel, rgb888 row, rgb565 row, gray row\n");
+    printf("           %6.2f,     %6.2f,     %6.2f,   %6.2f\n",
+           mpix / t_ref, mpix / t_rgb888, mpix / t_rgb565, mpix / t_gray);
+    printf("fmt2rgb888 %dx%d from PSRAM: %.0f us\n", w, h, (double)t_frame * 1000000 / CLOCKS_PER_SEC);
+    TEST_ASSERT_LESS_THAN(t_ref, t_rgb888);
+
+    heap_caps_free(rgb);
+    heap_caps_free(yuv);
+    heap_caps_free(line_in);
+    heap_caps_free(line_out);
+}
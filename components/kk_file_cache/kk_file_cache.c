@@ -0,0 +1,166 @@
+/*
+ * kk_file_cache.c
+ *
+ *  Entries are kept in doubly linked list in order of use. Every entry is one allocation
+ *  holding data and path, if allocation fails (fragmented heap) least recently used
+ *  entries are dropped till it succeeds. Lookup is linear, cache holds tens of files.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <string.h>
+#include "kk_file_cache.h"
+
+/**
+ * FNV-1a hash of the path, compared before the path itself
+ */
+static uint32_t path_hash(const char *path){
+  uint32_t h = 2166136261u;
+  for(; *path; path++){
+    h = (h ^ (uint8_t)*path) * 16777619u;
+  }
+  return h;
+}
+
+static void unlink_entry(file_cache_t *c, file_cache_entry_t *e){
+  if(e->prev){
+    e->prev->next = e->next;
+  }else{
+    c->head = e->next;
+  }
+  if(e->next){
+    e->next->prev = e->prev;
+  }else{
+    c->tail = e->prev;
+  }
+  e->prev = e->next = NULL;
+}
+
+static void push_front(file_cache_t *c, file_cache_entry_t *e){
+  e->prev = NULL;
+  e->next = c->head;
+  if(c->head){
+    c->head->prev = e;
+  }else{
+    c->tail = e;
+  }
+  c->head = e;
+}
+
+static file_cache_entry_t *find(file_cache_t *c, const char *path){
+  uint32_t hash = path_hash(path);
+  for(file_cache_entry_t *e = c->head; e; e = e->next){
+    if(e->hash == hash && strcmp(e->path, path) == 0){
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Initializes empty cache
+ * @param c cache
+ * @param capacity max bytes of cached files, 0 disables the cache
+ * @param max_file largest file to be cached
+ * @param alloc allocator of entries (e.g. from PSRAM)
+ * @param free release of entries
+ */
+void file_cache_init(file_cache_t *c, size_t capacity, size_t max_file, file_cache_alloc_fn alloc, file_cache_free_fn free){
+  memset(c, 0, sizeof(*c));
+  c->max_file = max_file < capacity ? max_file : capacity;
+  c->alloc = alloc;
+  c->free = free;
+  c->stats.capacity = capacity;
+}
+
+/**
+ * @brief Looks up the file. Entry of different size or mtime (file changed) is dropped.
+ *        Hit makes the entry most recently used and counts its size as saved.
+ * @param c cache
+ * @param path path of the file
+ * @param size current size of the file
+ * @param mtime current modification time of the file
+ * @return entry, NULL if not cached
+ */
+file_cache_entry_t *file_cache_get(file_cache_t *c, const char *path, size_t size, time_t mtime){
+  if(size > c->max_file){
+    return NULL;
+  }
+  file_cache_entry_t *e = find(c, path);
+  if(e && (e->size != size || e->mtime != mtime)){
+    file_cache_remove(c, e);
+    e = NULL;
+  }
+  if(!e){
+    c->stats.misses++;
+    return NULL;
+  }
+  if(e != c->head){
+    unlink_entry(c, e);
+    push_front(c, e);
+  }
+  c->stats.hits++;
+  c->stats.bytes_saved += size;
+  return e;
+}
+
+/**
+ * @brief Adds entry for the file, least recently used entries are evicted to make room.
+ *        Caller fills data of the entry (and removes the entry if it fails to).
+ * @param c cache
+ * @param path path of the file
+ * @param size size of the file
+ * @param mtime modification time of the file
+ * @return entry with uninitialized data, NULL if file is too large or there is no memory
+ */
+file_cache_entry_t *file_cache_insert(file_cache_t *c, const char *path, size_t size, time_t mtime){
+  if(size > c->max_file){
+    return NULL;
+  }
+  file_cache_entry_t *e = find(c, path);
+  if(e){
+    file_cache_remove(c, e);
+  }
+  while(c->tail && c->stats.used + size > c->stats.capacity){
+    file_cache_remove(c, c->tail);
+  }
+  size_t path_len = strlen(path) + 1;
+  while(!(e = (file_cache_entry_t *)c->alloc(sizeof(file_cache_entry_t) + size + path_len))){
+    if(!c->tail){
+      return NULL;
+    }
+    file_cache_remove(c, c->tail);
+  }
+  e->hash = path_hash(path);
+  e->size = size;
+  e->mtime = mtime;
+  e->path = (char *)e->data + size;
+  memcpy(e->path, path, path_len);
+  push_front(c, e);
+  c->stats.entries++;
+  c->stats.used += size;
+  return e;
+}
+
+/**
+ * @brief Drops entry from the cache
+ * @param c cache
+ * @param e entry
+ */
+void file_cache_remove(file_cache_t *c, file_cache_entry_t *e){
+  unlink_entry(c, e);
+  c->stats.entries--;
+  c->stats.used -= e->size;
+  c->free(e);
+}
+
+/**
+ * @brief Drops all entries, statistics are kept
+ * @param c cache
+ */
+void file_cache_clear(file_cache_t *c){
+  while(c->head){
+    file_cache_remove(c, c->head);
+  }
+}
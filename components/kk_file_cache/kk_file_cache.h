@@ -0,0 +1,64 @@
+/*
+ * kk_file_cache.h
+ *
+ *  Size bounded LRU cache of whole files in memory. Entries are valid for given size
+ *  and mtime of the file, so changed file is read again. Not thread safe, it is meant
+ *  to be used by one task (web server).
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_FILE_CACHE_KK_FILE_CACHE_H_
+#define COMPONENTS_KK_FILE_CACHE_KK_FILE_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef void *(*file_cache_alloc_fn)(size_t size);
+typedef void (*file_cache_free_fn)(void *ptr);
+
+typedef struct file_cache_entry {
+  struct file_cache_entry *prev;      //more recently used
+  struct file_cache_entry *next;      //less recently used
+  uint32_t hash;                      //hash of the path
+  size_t size;
+  time_t mtime;
+  char *path;                         //stored behind data
+  uint8_t data[];
+} file_cache_entry_t;
+
+typedef struct {
+  uint32_t hits;
+  uint32_t misses;                    //lookups of cacheable files not found (or stale)
+  uint64_t bytes_saved;               //bytes served from cache
+  uint32_t entries;
+  size_t used;                        //bytes of cached files
+  size_t capacity;
+} file_cache_stats_t;
+
+typedef struct {
+  file_cache_entry_t *head;           //most recently used
+  file_cache_entry_t *tail;           //least recently used
+  size_t max_file;                    //largest file to be cached
+  file_cache_alloc_fn alloc;
+  file_cache_free_fn free;
+  file_cache_stats_t stats;
+} file_cache_t;
+
+void file_cache_init(file_cache_t *c, size_t capacity, size_t max_file, file_cache_alloc_fn alloc, file_cache_free_fn free);
+file_cache_entry_t *file_cache_get(file_cache_t *c, const char *path, size_t size, time_t mtime);
+file_cache_entry_t *file_cache_insert(file_cache_t *c, const char *path, size_t size, time_t mtime);
+void file_cache_remove(file_cache_t *c, file_cache_entry_t *e);
+void file_cache_clear(file_cache_t *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_FILE_CACHE_KK_FILE_CACHE_H_ */
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#include "kk_file_cache.h"
+
+static int s_allocs;
+static int s_alloc_limit;      //allocations allowed at a time, simulates fragmented heap
+
+static void *test_alloc(size_t size)
+{
+    if (s_allocs >= s_alloc_limit) {
+        return NULL;
+    }
+    s_allocs++;
+    return malloc(size);
+}
+
+static void test_free(void *ptr)
+{
+    s_allocs--;
+    free(ptr);
+}
+
+static file_cache_entry_t *put(file_cache_t *c, const char *path, size_t size, time_t mtime)
+{
+    file_cache_entry_t *e = file_cache_insert(c, path, size, mtime);
+    if (e) {
+        memset(e->data, path[1], size);
+    }
+    return e;
+}
+
+TEST_CASE("File cache hit, miss and validation", "[kk_file_cache]")
+{
+    file_cache_t c;
+    s_allocs = 0;
+    s_alloc_limit = 100;
+    file_cache_init(&c, 1000, 500, test_alloc, test_free);
+
+    TEST_ASSERT_NULL(file_cache_get(&c, "/index.htm", 100, 1));
+    TEST_ASSERT_NOT_NULL(put(&c, "/index.htm", 100, 1));
+    file_cache_entry_t *e = file_cache_get(&c, "/index.htm", 100, 1);
+    TEST_ASSERT_NOT_NULL(e);
+    TEST_ASSERT_EQUAL('i', e->data[99]);
+    TEST_ASSERT_EQUAL_STRING("/index.htm", e->path);
+    TEST_ASSERT_EQUAL(1, c.stats.hits);
+    TEST_ASSERT_EQUAL(1, c.stats.misses);
+    TEST_ASSERT_EQUAL(100, (int)c.stats.bytes_saved);
+
+    // changed file (mtime or size) is not served and its entry is dropped
+    TEST_ASSERT_NULL(file_cache_get(&c, "/index.htm", 100, 2));
+    TEST_ASSERT_EQUAL(0, c.stats.entries);
+    TEST_ASSERT_EQUAL(0, (int)c.stats.used);
+    TEST_ASSERT_EQUAL(0, s_allocs);
+    TEST_ASSERT_NOT_NULL(put(&c, "/index.htm", 100, 2));
+    TEST_ASSERT_NULL(file_cache_get(&c, "/index.htm", 120, 2));
+
+    // file above the limit is neither cached nor counted
+    TEST_ASSERT_NULL(put(&c, "/big.js", 501, 1));
+    TEST_ASSERT_NULL(file_cache_get(&c, "/big.js", 501, 1));
+    TEST_ASSERT_EQUAL(3, c.stats.misses);
+    file_cache_clear(&c);
+    TEST_ASSERT_EQUAL(0, s_allocs);
+}
+
+TEST_CASE("File cache evicts least recently used", "[kk_file_cache]")
+{
+    file_cache_t c;
+    s_allocs = 0;
+    s_alloc_limit = 100;
+    file_cache_init(&c, 1000, 500, test_alloc, test_free);
+
+    put(&c, "/a.js", 400, 1);
+    put(&c, "/b.js", 400, 1);
+    TEST_ASSERT_NOT_NULL(file_cache_get(&c, "/a.js", 400, 1));  // b becomes least recently used
+    put(&c, "/c.js", 400, 1);
+    TEST_ASSERT_NOT_NULL(file_cache_get(&c, "/a.js", 400, 1));
+    TEST_ASSERT_NULL(file_cache_get(&c, "/b.js", 400, 1));
+    TEST_ASSERT_NOT_NULL(file_cache_get(&c, "/c.js", 400, 1));
+    TEST_ASSERT_EQUAL(2, c.stats.entries);
+    TEST_ASSERT_EQUAL(800, (int)c.stats.used);
+
+    // no memory: entries are dropped till allocation succeeds
+    s_alloc_limit = 2;
+    TEST_ASSERT_NOT_NULL(put(&c, "/d.js", 100, 1));
+    TEST_ASSERT_NULL(file_cache_get(&c, "/a.js", 400, 1));
+    TEST_ASSERT_NOT_NULL(file_cache_get(&c, "/c.js", 400, 1));
+    s_alloc_limit = 0;
+    file_cache_clear(&c);
+    TEST_ASSERT_NULL(put(&c, "/d.js", 100, 1));
+    TEST_ASSERT_EQUAL(0, c.stats.entries);
+}
+
+TEST_CASE("Disabled file cache", "[kk_file_cache]")
+{
+    file_cache_t c;
+    s_allocs = 0;
+    s_alloc_limit = 100;
+    file_cache_init(&c, 0, 500, test_alloc, test_free);
+    TEST_ASSERT_NULL(put(&c, "/a.js", 10, 1));
+    TEST_ASSERT_NULL(file_cache_get(&c, "/a.js", 10, 1));
+    TEST_ASSERT_EQUAL(0, c.stats.misses);
+}
@@ -0,0 +1,342 @@
+/*
+ * kk_http_util.c
+ *
+ *  Plain C without any ESP-IDF dependency.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "kk_http_util.h"
+
+static const char *s_wdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char *s_months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+/**
+ * @brief Makes strong entity tag of a file out of its size and modification time.
+ *        Files are replaced as a whole on SD card, so this changes with every new version.
+ * @param size file size
+ * @param mtime modification time
+ * @param out output buffer (HTTP_ETAG_LEN)
+ * @param len size of output buffer
+ */
+void http_make_etag(uint32_t size, uint32_t mtime, char *out, size_t len){
+  snprintf(out, len, "\"%x-%x\"", (unsigned)size, (unsigned)mtime);
+}
+
+/**
+ * @brief Formats time as IMF-fixdate (RFC 7231), i.e. Sun, 06 Nov 1994 08:49:37 GMT
+ * @param t unix time
+ * @param out output buffer (HTTP_DATE_LEN)
+ * @param len size of output buffer
+ * @return length of the date, 0 if it does not fit
+ */
+size_t http_format_date(time_t t, char *out, size_t len){
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  int cx = snprintf(out, len, "%s, %02d %s %04d %02d:%02d:%02d GMT", s_wdays[tm.tm_wday], tm.tm_mday,
+                    s_months[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+  return (cx > 0 && (size_t)cx < len) ? (size_t)cx : 0;
+}
+
+/**
+ * @brief Days since 1970-01-01 of a civil date (proleptic Gregorian calendar)
+ */
+static int64_t days_from_civil(int y, int m, int d){
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief Parses IMF-fixdate as sent by browsers in If-Modified-Since.
+ *        Obsolete RFC 850 and asctime formats are not accepted.
+ * @param s date string
+ * @param t parsed unix time
+ * @return true on success
+ */
+bool http_parse_date(const char *s, time_t *t){
+  char wday[4], mon[4];
+  int d, y, hh, mm, ss, m;
+  if(s == NULL || sscanf(s, "%3s, %d %3s %d %d:%d:%d GMT", wday, &d, mon, &y, &hh, &mm, &ss) != 7){
+    return false;
+  }
+  for(m = 0; m < 12 && strcmp(mon, s_months[m]) != 0; m++);
+  if(m == 12 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss > 60){
+    return false;
+  }
+  *t = (time_t)(days_from_civil(y, m + 1, d) * 86400 + hh * 3600 + mm * 60 + ss);
+  return true;
+}
+
+/**
+ * @brief Weak comparison of entity tag against If-None-Match value (list of tags or *)
+ * @param if_none_match header value
+ * @param etag entity tag of the file (with quotes)
+ * @return true if any of the tags matches
+ */
+bool http_etag_matches(const char *if_none_match, const char *etag){
+  size_t etag_len = strlen(etag);
+  const char *p = if_none_match;
+  while(p != NULL && *p){
+    while(*p == ' ' || *p == '\t' || *p == ','){
+      p++;
+    }
+    if(*p == '*'){
+      return true;
+    }
+    if(strncmp(p, "W/", 2) == 0){
+      p += 2;
+    }
+    if(strncmp(p, etag, etag_len) == 0 && (p[etag_len] == '\0' || p[etag_len] == ',' || p[etag_len] == ' ')){
+      return true;
+    }
+    p = strchr(p, ',');
+  }
+  return false;
+}
+
+/**
+ * @brief Evaluates conditional GET (RFC 7232): If-None-Match takes precedence,
+ *        If-Modified-Since is only used without it.
+ * @param if_none_match If-None-Match header value, NULL if not sent
+ * @param if_modified_since If-Modified-Since header value, NULL if not sent
+ * @param etag entity tag of the file
+ * @param mtime modification time of the file
+ * @return true if 304 Not Modified should be sent
+ */
+bool http_not_modified(const char *if_none_match, const char *if_modified_since, const char *etag, time_t mtime){
+  time_t since;
+  if(if_none_match != NULL){
+    return http_etag_matches(if_none_match, etag);
+  }
+  return http_parse_date(if_modified_since, &since) && mtime <= since;
+}
+
+/**
+ * @brief Checks Accept-Encoding for gzip (or *) coding which is not refused with q=0
+ * @param accept_encoding header value, NULL if not sent
+ * @return true if gzip encoded content may be sent
+ */
+bool http_accepts_gzip(const char *accept_encoding){
+  bool any = false;
+  const char *p = accept_encoding;
+  while(p != NULL && *p){
+    while(*p == ' ' || *p == '\t' || *p == ','){
+      p++;
+    }
+    size_t len = strcspn(p, ";, \t");
+    bool gzip = len == 4 && strncasecmp(p, "gzip", 4) == 0;
+    if(gzip || (len == 1 && *p == '*')){
+      //q=0, q=0.0, q=0.000 refuse the coding, any other weight accepts it
+      const char *next = strchr(p, ',');
+      const char *q = strstr(p + len, "q=");
+      bool accepted = q == NULL || (next != NULL && q > next) || strtod(q + 2, NULL) > 0;
+      if(gzip){
+        return accepted;    //explicit gzip wins over *
+      }
+      any = accepted;
+    }
+    p = strchr(p, ',');
+  }
+  return any;
+}
+
+/**
+ * @brief Parses decimal byte position of Range header
+ * @return pointer past the number, NULL if there are no digits
+ */
+static const char *parse_pos(const char *p, uint64_t *pos){
+  const char *start = p;
+  *pos = 0;
+  while(*p >= '0' && *p <= '9'){
+    if(*pos < UINT32_MAX){
+      *pos = *pos * 10 + (uint64_t)(*p - '0');
+    }
+    p++;
+  }
+  return p == start ? NULL : p;
+}
+
+/**
+ * @brief Parses single range of Range header (RFC 7233): bytes=first-last, bytes=first- or bytes=-suffix.
+ *        Multiple ranges, other units and syntax errors are ignored (whole file is sent as allowed by RFC).
+ * @param range header value, NULL if not sent
+ * @param size file size
+ * @param r resulting range, last is clipped to the end of file
+ * @return HTTP_RANGE_NONE, HTTP_RANGE_PARTIAL or HTTP_RANGE_UNSATISFIABLE
+ */
+int http_parse_range(const char *range, uint32_t size, http_range_t *r){
+  uint64_t first, last = UINT64_MAX;
+  const char *p = range;
+  if(p == NULL || strncasecmp(p, "bytes=", 6) != 0){
+    return HTTP_RANGE_NONE;
+  }
+  p += 6;
+  while(*p == ' ' || *p == '\t'){
+    p++;
+  }
+  if(*p == '-'){                                  //suffix: last n bytes
+    if((p = parse_pos(p + 1, &last)) == NULL){
+      return HTTP_RANGE_NONE;
+    }
+    first = UINT64_MAX;
+  }else{
+    if((p = parse_pos(p, &first)) == NULL || *p++ != '-'){
+      return HTTP_RANGE_NONE;
+    }
+    if(*p >= '0' && *p <= '9'){
+      p = parse_pos(p, &last);
+      if(last < first){
+        return HTTP_RANGE_NONE;
+      }
+    }
+  }
+  while(*p == ' ' || *p == '\t'){
+    p++;
+  }
+  if(*p != '\0'){                                //multiple ranges or garbage
+    return HTTP_RANGE_NONE;
+  }
+  if(first == UINT64_MAX){
+    if(last == 0 || size == 0){
+      return HTTP_RANGE_UNSATISFIABLE;
+    }
+    r->first = last >= size ? 0 : size - (uint32_t)last;
+    r->last = size - 1;
+    return HTTP_RANGE_PARTIAL;
+  }
+  if(first >= size){
+    return HTTP_RANGE_UNSATISFIABLE;
+  }
+  r->first = (uint32_t)first;
+  r->last = last >= size ? size - 1 : (uint32_t)last;
+  return HTTP_RANGE_PARTIAL;
+}
+
+/**
+ * @brief Evaluates Range together with If-Range. Range is used only if If-Range is not sent
+ *        or it still matches the file (strong ETag or Last-Modified date).
+ * @param range Range header value, NULL if not sent
+ * @param if_range If-Range header value, NULL if not sent
+ * @param etag entity tag of the file
+ * @param mtime modification time of the file
+ * @param size file size
+ * @param r resulting range
+ * @return HTTP_RANGE_NONE, HTTP_RANGE_PARTIAL or HTTP_RANGE_UNSATISFIABLE
+ */
+int http_eval_range(const char *range, const char *if_range, const char *etag, time_t mtime, uint32_t size, http_range_t *r){
+  time_t date;
+  if(if_range != NULL){
+    if(*if_range == '"' ? strcmp(if_range, etag) != 0 : (!http_parse_date(if_range, &date) || mtime > date)){
+      return HTTP_RANGE_NONE;
+    }
+  }
+  return http_parse_range(range, size, r);
+}
+
+/**
+ * @param pattern glob, '*' matches any (also empty) sequence of characters
+ * @param str string to match
+ * @return true if whole str matches pattern
+ */
+bool http_glob_match(const char *pattern, const char *str){
+  const char *star = NULL, *retry = NULL;
+  while(*str){
+    if(*pattern == '*'){
+      star = pattern++;
+      retry = str;
+    }else if(*pattern == *str){
+      pattern++;
+      str++;
+    }else if(star){
+      pattern = star + 1;
+      str = ++retry;
+    }else{
+      return false;
+    }
+  }
+  while(*pattern == '*'){
+    pattern++;
+  }
+  return *pattern == '\0';
+}
+
+/**
+ * @brief Chooses Cache-Control policy of a file. Rules are checked in order, first match wins.
+ * @param path file path as requested (i.e. /js/chartlg.js)
+ * @param rules policies
+ * @param n number of rules
+ * @return Cache-Control value, NULL if no rule matches
+ */
+const char *http_cache_control(const char *path, const http_cache_rule_t *rules, size_t n){
+  const char *name = strrchr(path, '/');
+  name = name ? name + 1 : path;
+  for(size_t i = 0; i < n; i++){
+    const char *subject = strchr(rules[i].pattern, '/') ? path : name;
+    if(http_glob_match(rules[i].pattern, subject)){
+      return rules[i].cache_control;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Stores new body of pre-serialised response and makes its strong ETag.
+ *        Stamp (e.g. time of data) keeps ETags unique across reboots, when version starts over.
+ * @param s snapshot
+ * @param stamp time (or other id) of the data
+ * @param body response body
+ * @param len length of the body
+ * @return false if body does not fit (snapshot is left unchanged)
+ */
+bool http_snapshot_update(http_snapshot_t *s, uint32_t stamp, const char *body, size_t len){
+  if(len > sizeof(s->body)){
+    return false;
+  }
+  memcpy(s->body, body, len);
+  s->len = len;
+  s->version++;
+  http_make_etag(s->version, stamp, s->etag, sizeof(s->etag));
+  return true;
+}
+
+/**
+ * @brief Copies snapshot, only the used part of the body. Short enough to be done
+ *        under a spinlock, snapshot is formatted and its ETag made before.
+ * @param dst copy
+ * @param src snapshot
+ */
+void http_snapshot_copy(http_snapshot_t *dst, const http_snapshot_t *src){
+  dst->version = src->version;
+  dst->len = src->len;
+  memcpy(dst->etag, src->etag, sizeof(dst->etag));
+  memcpy(dst->body, src->body, src->len);
+}
+
+/**
+ * @brief Formats current measurements response, wind is sent in km/h
+ * @param out output buffer
+ * @param len size of output buffer
+ * @param now time of the sample
+ * @param c measurements
+ * @return length of formatted body, 0 if it does not fit
+ */
+size_t http_format_current(char *out, size_t len, time_t now, const http_current_t *c){
+  int cx = snprintf(out, len, "{\"time\":\"%lld\",\"int_t\":%3.2F, \"ext_t\":%3.2F, \"humi\":%d, \"sun\":%5.2F, \"press\":%4.2f, \"wind\":%3.3f}\n",
+                    (long long)(now),
+                    c->int_t,
+                    c->ext_t,
+                    (int)(c->humi),
+                    c->sun,
+                    c->press,
+                    c->wind / 0.278);
+  return (cx > 0 && (size_t)cx < len) ? (size_t)cx : 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * kk_http_util.h
+ *
+ *  HTTP helpers of the station web server which do not depend on the server itself:
+ *  validators (ETag, Last-Modified), conditional requests, Cache-Control policies,
+ *  pre-serialised responses and their bodies.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_HTTP_UTIL_KK_HTTP_UTIL_H_
+#define COMPONENTS_KK_HTTP_UTIL_KK_HTTP_UTIL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define HTTP_DATE_LEN 30   //"Sun, 06 Nov 1994 08:49:37 GMT" with terminating 0
+#define HTTP_ETAG_LEN 20   //"<size hex>-<mtime hex>" in quotes with terminating 0
+
+#define HTTP_SNAPSHOT_MAX 256   //body of pre-serialised response
+
+#define HTTP_RANGE_NONE            0   //no (usable) Range, whole file is sent with 200
+#define HTTP_RANGE_PARTIAL         1   //single byte range, sent with 206
+#define HTTP_RANGE_UNSATISFIABLE  -1   //range outside of file, 416 is sent
+
+//byte range of a file, both ends inclusive
+typedef struct {
+  uint32_t first;
+  uint32_t last;
+} http_range_t;
+
+//Cache-Control policy for paths matching a pattern
+typedef struct {
+  const char *pattern;        //glob with '*', without '/' it is matched against file name only
+  const char *cache_control;  //Cache-Control header value
+} http_cache_rule_t;
+
+//values of current measurements response (/data/current.json)
+typedef struct {
+  float int_t;                  //internal temperature
+  float ext_t;                  //external temperature
+  float humi;                   //humidity, sent as integer
+  float sun;                    //light exposure
+  float press;                  //atm. pressure
+  float wind;                   //wind speed in m/s, sent in km/h
+} http_current_t;
+
+//response body formatted once per data change and sent as is to every request
+typedef struct {
+  uint32_t version;             //number of updates, 0 = no body yet
+  size_t len;
+  char etag[HTTP_ETAG_LEN];     //"<version hex>-<stamp hex>"
+  char body[HTTP_SNAPSHOT_MAX];
+} http_snapshot_t;
+
+void http_make_etag(uint32_t size, uint32_t mtime, char *out, size_t len);
+size_t http_format_date(time_t t, char *out, size_t len);
+bool http_parse_date(const char *s, time_t *t);
+bool http_etag_matches(const char *if_none_match, const char *etag);
+bool http_not_modified(const char *if_none_match, const char *if_modified_since, const char *etag, time_t mtime);
+bool http_accepts_gzip(const char *accept_encoding);
+int http_parse_range(const char *range, uint32_t size, http_range_t *r);
+int http_eval_range(const char *range, const char *if_range, const char *etag, time_t mtime, uint32_t size, http_range_t *r);
+bool http_glob_match(const char *pattern, const char *str);
+const char *http_cache_control(const char *path, const http_cache_rule_t *rules, size_t n);
+bool http_snapshot_update(http_snapshot_t *s, uint32_t stamp, const char *body, size_t len);
+void http_snapshot_copy(http_snapshot_t *dst, const http_snapshot_t *src);
+size_t http_format_current(char *out, size_t len, time_t now, const http_current_t *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_HTTP_UTIL_KK_HTTP_UTIL_H_ */
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+
+#include "kk_http_util.h"
+
+TEST_CASE("ETag of a file", "[kk_http_util]")
+{
+    char etag[HTTP_ETAG_LEN];
+    http_make_etag(0xFFFFFFFF, 0xFFFFFFFF, etag, sizeof(etag));
+    TEST_ASSERT_EQUAL_STRING("\"ffffffff-ffffffff\"", etag);
+    http_make_etag(1234, 1677600000, etag, sizeof(etag));
+    TEST_ASSERT_EQUAL_STRING("\"4d2-63fe2500\"", etag);
+}
+
+TEST_CASE("HTTP date is formatted and parsed back", "[kk_http_util]")
+{
+    char date[HTTP_DATE_LEN];
+    time_t t;
+    TEST_ASSERT_EQUAL(29, http_format_date(784111777, date, sizeof(date)));
+    TEST_ASSERT_EQUAL_STRING("Sun, 06 Nov 1994 08:49:37 GMT", date);
+    TEST_ASSERT_TRUE(http_parse_date(date, &t));
+    TEST_ASSERT_EQUAL(784111777, t);
+
+    TEST_ASSERT_TRUE(http_parse_date("Tue, 28 Feb 2023 16:00:00 GMT", &t));
+    TEST_ASSERT_EQUAL(1677600000, t);
+    TEST_ASSERT_TRUE(http_parse_date("Thu, 29 Feb 2024 00:00:00 GMT", &t));
+    TEST_ASSERT_EQUAL(1709164800, t);
+
+    TEST_ASSERT_FALSE(http_parse_date("Sunday, 06-Nov-94 08:49:37 GMT", &t));
+    TEST_ASSERT_FALSE(http_parse_date("Sun, 06 Xyz 1994 08:49:37 GMT", &t));
+    TEST_ASSERT_FALSE(http_parse_date(NULL, &t));
+    TEST_ASSERT_EQUAL(0, http_format_date(784111777, date, 10));
+}
+
+TEST_CASE("Conditional GET", "[kk_http_util]")
+{
+    const char *etag = "\"4d2-63fe2500\"";
+    TEST_ASSERT_TRUE(http_etag_matches("\"4d2-63fe2500\"", etag));
+    TEST_ASSERT_TRUE(http_etag_matches("W/\"4d2-63fe2500\"", etag));
+    TEST_ASSERT_TRUE(http_etag_matches("\"x\", \"4d2-63fe2500\"", etag));
+    TEST_ASSERT_TRUE(http_etag_matches("*", etag));
+    TEST_ASSERT_FALSE(http_etag_matches("\"4d2-63fe2501\"", etag));
+    TEST_ASSERT_FALSE(http_etag_matches("\"4d2-63fe2500\"x", etag));
+    TEST_ASSERT_FALSE(http_etag_matches("", etag));
+
+    TEST_ASSERT_TRUE(http_not_modified(NULL, "Tue, 28 Feb 2023 16:00:00 GMT", etag, 1677600000));
+    TEST_ASSERT_FALSE(http_not_modified(NULL, "Tue, 28 Feb 2023 16:00:00 GMT", etag, 1677600001));
+    // If-None-Match wins over If-Modified-Since
+    TEST_ASSERT_FALSE(http_not_modified("\"other\"", "Tue, 28 Feb 2023 16:00:00 GMT", etag, 1677600000));
+    TEST_ASSERT_TRUE(http_not_modified(etag, "Tue, 28 Feb 2023 15:00:00 GMT", etag, 1677600000));
+    TEST_ASSERT_FALSE(http_not_modified(NULL, NULL, etag, 1677600000));
+}
+
+TEST_CASE("Accept-Encoding negotiation", "[kk_http_util]")
+{
+    TEST_ASSERT_TRUE(http_accepts_gzip("gzip, deflate, br"));
+    TEST_ASSERT_TRUE(http_accepts_gzip("br;q=1.0, GZIP;q=0.5"));
+    TEST_ASSERT_TRUE(http_accepts_gzip("*"));
+    TEST_ASSERT_FALSE(http_accepts_gzip("gzip;q=0, deflate"));
+    TEST_ASSERT_FALSE(http_accepts_gzip("gzip ; q=0.000"));
+    TEST_ASSERT_FALSE(http_accepts_gzip("deflate, br;q=0.5"));
+    TEST_ASSERT_FALSE(http_accepts_gzip("x-gzipped"));
+    TEST_ASSERT_FALSE(http_accepts_gzip("identity"));
+    TEST_ASSERT_FALSE(http_accepts_gzip("gzip;q=0, *"));
+    TEST_ASSERT_TRUE(http_accepts_gzip("*;q=0, gzip"));
+    TEST_ASSERT_FALSE(http_accepts_gzip(NULL));
+}
+
+// Headers of mock requests for a 1000 B file and expected outcome
+typedef struct {
+    const char *range;
+    const char *if_range;
+    int result;
+    uint32_t first;
+    uint32_t last;
+} range_case_t;
+
+static const range_case_t range_cases[] = {
+    {"bytes=0-499",        NULL, HTTP_RANGE_PARTIAL,         0, 499},
+    {"bytes=500-",         NULL, HTTP_RANGE_PARTIAL,       500, 999},
+    {"bytes=999-",         NULL, HTTP_RANGE_PARTIAL,       999, 999},
+    {"bytes=900-5000",     NULL, HTTP_RANGE_PARTIAL,       900, 999},    // clipped to the end
+    {"bytes=-100",         NULL, HTTP_RANGE_PARTIAL,       900, 999},
+    {"bytes=-5000",        NULL, HTTP_RANGE_PARTIAL,         0, 999},
+    {"Bytes= 10-20 ",      NULL, HTTP_RANGE_PARTIAL,        10,  20},
+    {"bytes=1000-",        NULL, HTTP_RANGE_UNSATISFIABLE,   0,   0},    // nothing appended yet
+    {"bytes=99999999999-", NULL, HTTP_RANGE_UNSATISFIABLE,   0,   0},
+    {"bytes=-0",           NULL, HTTP_RANGE_UNSATISFIABLE,   0,   0},
+    {"bytes=20-10",        NULL, HTTP_RANGE_NONE,            0,   0},
+    {"bytes=0-1,5-6",      NULL, HTTP_RANGE_NONE,            0,   0},    // multiple ranges not supported
+    {"bytes=abc",          NULL, HTTP_RANGE_NONE,            0,   0},
+    {"bytes=-",            NULL, HTTP_RANGE_NONE,            0,   0},
+    {"items=0-10",         NULL, HTTP_RANGE_NONE,            0,   0},
+    {NULL,                 NULL, HTTP_RANGE_NONE,            0,   0},
+    {"bytes=10-",          "\"3e8-63fe2500\"",             HTTP_RANGE_PARTIAL, 10, 999},
+    {"bytes=10-",          "\"3e8-63fe2400\"",             HTTP_RANGE_NONE,     0,   0},  // file changed
+    {"bytes=10-",          "W/\"3e8-63fe2500\"",           HTTP_RANGE_NONE,     0,   0},  // weak tag never matches
+    {"bytes=10-",          "Tue, 28 Feb 2023 16:00:00 GMT", HTTP_RANGE_PARTIAL, 10, 999},
+    {"bytes=10-",          "Tue, 28 Feb 2023 15:59:59 GMT", HTTP_RANGE_NONE,     0,   0},
+};
+
+TEST_CASE("Range requests", "[kk_http_util]")
+{
+    http_range_t r;
+    char msg[64];
+    for (size_t i = 0; i < sizeof(range_cases) / sizeof(range_cases[0]); i++) {
+        const range_case_t *c = &range_cases[i];
+        snprintf(msg, sizeof(msg), "case %u: %s", (unsigned)i, c->range ? c->range : "(none)");
+        r.first = r.last = 0;
+        TEST_ASSERT_EQUAL_MESSAGE(c->result, http_eval_range(c->range, c->if_range, "\"3e8-63fe2500\"", 1677600000, 1000, &r), msg);
+        if (c->result == HTTP_RANGE_PARTIAL) {
+            TEST_ASSERT_EQUAL_MESSAGE(c->first, r.first, msg);
+            TEST_ASSERT_EQUAL_MESSAGE(c->last, r.last, msg);
+        }
+    }
+    // empty file can not satisfy any range
+    TEST_ASSERT_EQUAL(HTTP_RANGE_UNSATISFIABLE, http_parse_range("bytes=0-", 0, &r));
+    TEST_ASSERT_EQUAL(HTTP_RANGE_UNSATISFIABLE, http_parse_range("bytes=-10", 0, &r));
+}
+
+TEST_CASE("Cache-Control rules", "[kk_http_util]")
+{
+    const http_cache_rule_t rules[] = {
+        {"CURRENT.*",   "no-cache"},
+        {"/dcim/0/*",   "no-cache"},
+        {"/dcim/*.jpg", "max-age=31536000, immutable"},
+        {"/dcim/*",     "no-cache"},
+        {"/logs/*",     "no-cache"},
+        {"/js/*.min.js", "max-age=604800"},
+        {"/js/*",       "max-age=3600"},
+    };
+    const size_t n = sizeof(rules) / sizeof(rules[0]);
+    TEST_ASSERT_EQUAL_STRING("no-cache", http_cache_control("/logs/CURRENT.CSV", rules, n));
+    TEST_ASSERT_EQUAL_STRING("no-cache", http_cache_control("/dcim/0/current.jpg", rules, n));
+    TEST_ASSERT_EQUAL_STRING("max-age=31536000, immutable", http_cache_control("/dcim/2023/02/28/001.jpg", rules, n));
+    TEST_ASSERT_EQUAL_STRING("max-age=31536000, immutable", http_cache_control("/dcim/2023/02/28/th/001.jpg", rules, n));
+    TEST_ASSERT_EQUAL_STRING("no-cache", http_cache_control("/dcim/2023/02/28/000.pak", rules, n));
+    TEST_ASSERT_EQUAL_STRING("no-cache", http_cache_control("/logs/2023/02/28.CSV", rules, n));
+    TEST_ASSERT_EQUAL_STRING("max-age=604800", http_cache_control("/js/gauge.min.js", rules, n));
+    TEST_ASSERT_EQUAL_STRING("max-age=3600", http_cache_control("/js/chartlg.js", rules, n));
+    TEST_ASSERT_NULL(http_cache_control("/index.htm", rules, n));
+
+    TEST_ASSERT_TRUE(http_glob_match("*", ""));
+    TEST_ASSERT_TRUE(http_glob_match("a*b*c", "axxbyyc"));
+    TEST_ASSERT_FALSE(http_glob_match("a*b*c", "axxbyy"));
+}
+
+TEST_CASE("Pre-serialised response", "[kk_http_util]")
+{
+    http_snapshot_t snap = {0};
+    char big[HTTP_SNAPSHOT_MAX + 1];
+    TEST_ASSERT_TRUE(http_snapshot_update(&snap, 0x63fe2500, "{\"a\":1}", 7));
+    TEST_ASSERT_EQUAL(1, snap.version);
+    TEST_ASSERT_EQUAL(7, snap.len);
+    TEST_ASSERT_EQUAL_STRING("\"1-63fe2500\"", snap.etag);
+    TEST_ASSERT_TRUE(http_not_modified("\"1-63fe2500\"", NULL, snap.etag, 0));
+    TEST_ASSERT_TRUE(http_snapshot_update(&snap, 0x63fe2501, "{\"a\":2}", 7));
+    TEST_ASSERT_FALSE(http_not_modified("\"1-63fe2500\"", NULL, snap.etag, 0));
+    // too long body leaves previous one
+    memset(big, 'x', sizeof(big));
+    TEST_ASSERT_FALSE(http_snapshot_update(&snap, 0x63fe2502, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(2, snap.version);
+    TEST_ASSERT_EQUAL(0, strncmp("{\"a\":2}", snap.body, snap.len));
+}
+
+static const http_current_t s_current = {23.41f, -2.5f, 61.0f, 18234.5f, 1002.37f, 3.4f};
+
+TEST_CASE("Current measurements response", "[kk_http_util]")
+{
+    char buf[HTTP_SNAPSHOT_MAX];
+    size_t len = http_format_current(buf, sizeof(buf), 1677600000, &s_current);
+    TEST_ASSERT_EQUAL_STRING("{\"time\":\"1677600000\",\"int_t\":23.41, \"ext_t\":-2.50, \"humi\":61, "
+                             "\"sun\":18234.50, \"press\":1002.37, \"wind\":12.230}\n", buf);
+    TEST_ASSERT_EQUAL(strlen(buf), len);
+    TEST_ASSERT_EQUAL(0, http_format_current(buf, 16, 1677600000, &s_current));
+}
+
+// mock of the server request: conditional header in, status and body out
+typedef struct {
+    const char *if_none_match;
+    int status;
+    size_t len;
+    char body[HTTP_SNAPSHOT_MAX];
+} mock_req_t;
+
+// send_current_measurements() before any sample is published: body formatted per request
+static void serve_formatted(mock_req_t *req, time_t now)
+{
+    req->len = http_format_current(req->body, sizeof(req->body), now, &s_current);
+    req->status = 200;
+}
+
+// send_current_measurements(): snapshot copied (under spinlock on the device), 304 or body sent
+static void serve_snapshot(mock_req_t *req, const http_snapshot_t *shared)
+{
+    http_snapshot_t snap;
+    http_snapshot_copy(&snap, shared);
+    if (http_not_modified(req->if_none_match, NULL, snap.etag, 0)) {
+        req->status = 304;
+        req->len = 0;
+        return;
+    }
+    memcpy(req->body, snap.body, snap.len);
+    req->len = snap.len;
+    req->status = 200;
+}
+
+static void print_rate(const char *what, int n, clock_t start)
+{
+    double s = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%s %.0f req/s\n", what, s > 0 ? n / s : -1.0);
+}
+
+TEST_CASE("Pre-serialised response performance", "[kk_http_util]")
+{
+    const int n = 200000;
+    http_snapshot_t snap = {0};
+    mock_req_t req;
+    clock_t start;
+
+    // publish_current_measurements(): formatted and ETag made aside, then copied
+    http_snapshot_t next = {0};
+    serve_formatted(&req, 1677600000);
+    TEST_ASSERT_TRUE(http_snapshot_update(&next, 1677600000, req.body, req.len));
+    http_snapshot_copy(&snap, &next);
+    TEST_ASSERT_EQUAL(1, snap.version);
+    TEST_ASSERT_EQUAL_STRING(next.etag, snap.etag);
+
+    start = clock();
+    for (int i = 0; i < n; i++) {
+        req.if_none_match = NULL;
+        serve_formatted(&req, 1677600000 + i / 1000);
+    }
+    print_rate("formatted per request:", n, start);
+
+    start = clock();
+    for (int i = 0; i < n; i++) {
+        req.if_none_match = NULL;
+        serve_snapshot(&req, &snap);
+    }
+    TEST_ASSERT_EQUAL(200, req.status);
+    print_rate("pre-serialised:       ", n, start);
+
+    // polls repeated within one sample get 304
+    start = clock();
+    for (int i = 0; i < n; i++) {
+        req.if_none_match = snap.etag;
+        serve_snapshot(&req, &snap);
+    }
+    TEST_ASSERT_EQUAL(304, req.status);
+    print_rate("pre-serialised, 304:  ", n, start);
+}
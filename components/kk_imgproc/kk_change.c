@@ -0,0 +1,61 @@
+/*
+ * kk_change.c
+ *
+ *  Scene change detection kernels. Plain C without any ESP-IDF dependency,
+ *  so they can be compiled and checked on the development machine as well.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include "kk_change.h"
+
+/**
+ * @param a first grayscale picture
+ * @param b second grayscale picture (same size)
+ * @param n number of pixels
+ * @return mean absolute difference of pixels in 1/256 of gray level
+ */
+uint32_t gray_mad_q8(const uint8_t *a, const uint8_t *b, size_t n){
+  uint32_t sum = 0;   //fits 16M pixels of max difference
+  size_t i = 0;
+
+  if(n == 0){
+    return 0;
+  }
+  //four independent accumulators let the compiler keep the loop busy
+  uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for(; i + 4 <= n; i += 4){
+    s0 += (a[i]   > b[i])   ? a[i]   - b[i]   : b[i]   - a[i];
+    s1 += (a[i+1] > b[i+1]) ? a[i+1] - b[i+1] : b[i+1] - a[i+1];
+    s2 += (a[i+2] > b[i+2]) ? a[i+2] - b[i+2] : b[i+2] - a[i+2];
+    s3 += (a[i+3] > b[i+3]) ? a[i+3] - b[i+3] : b[i+3] - a[i+3];
+  }
+  sum = s0 + s1 + s2 + s3;
+  for(; i < n; i++){
+    sum += (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+  }
+  return (uint32_t)(((uint64_t)sum << 8) / n);
+}
+
+/**
+ * @brief Maps amount of change to the interval between archived pictures.
+ *        Below low_q8 the scene is considered static (max_s), above high_q8
+ *        it changes fast (min_s), in between interval drops linearly.
+ *
+ * @param mad_q8 mean absolute difference (see gray_mad_q8)
+ * @param low_q8 change treated as noise
+ * @param high_q8 change treated as maximal
+ * @param min_s shortest interval in seconds
+ * @param max_s longest interval in seconds
+ * @return interval in seconds
+ */
+uint32_t change_to_interval(uint32_t mad_q8, uint32_t low_q8, uint32_t high_q8, uint32_t min_s, uint32_t max_s){
+  if(mad_q8 <= low_q8 || high_q8 <= low_q8){
+    return max_s;
+  }
+  if(mad_q8 >= high_q8){
+    return min_s;
+  }
+  return max_s - (uint32_t)((uint64_t)(max_s - min_s) * (mad_q8 - low_q8) / (high_q8 - low_q8));
+}
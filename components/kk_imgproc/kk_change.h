@@ -0,0 +1,27 @@
+/*
+ * kk_change.h
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_IMGPROC_KK_CHANGE_H_
+#define COMPONENTS_KK_IMGPROC_KK_CHANGE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHANGE_Q8(x) ((uint32_t)((x) * 256))  //gray levels to gray_mad_q8() units
+
+uint32_t gray_mad_q8(const uint8_t *a, const uint8_t *b, size_t n);
+uint32_t change_to_interval(uint32_t mad_q8, uint32_t low_q8, uint32_t high_q8, uint32_t min_s, uint32_t max_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_IMGPROC_KK_CHANGE_H_ */
@@ -0,0 +1,74 @@
+/*
+ * kk_imgproc.h
+ *
+ *  Image processing helpers for pictures taken by the station camera.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_IMGPROC_KK_IMGPROC_H_
+#define COMPONENTS_KK_IMGPROC_KK_IMGPROC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_jpg_decode.h"
+#include "kk_change.h"
+#include "kk_jpegmeta.h"
+#include "kk_pack.h"
+#include "kk_picindex.h"
+
+#define THUMB_SCALE     JPG_SCALE_8X  //DCT domain downscale used for thumbnails (SXGA -> 160x128)
+#define THUMB_QUALITY   70            //JPEG quality of thumbnails (1-100)
+#define THUMB_DIR       "th"          //thumbnails subdirectory, next to the originals
+
+/**
+ * @brief Makes small JPEG out of JPEG in memory.
+ *        Picture is decoded already downscaled (tjpgd skips IDCT details) and encoded again.
+ *
+ * @param src JPEG data
+ * @param len JPEG length
+ * @param scale downscale factor
+ * @param quality JPEG quality of the output (1-100)
+ * @param out will point to allocated thumbnail, must be freed by the caller
+ * @param out_len thumbnail length
+ * @return true on success
+ */
+bool jpg2thumb(const uint8_t *src, size_t len, jpg_scale_t scale, uint8_t quality, uint8_t **out, size_t *out_len);
+
+/**
+ * @brief Makes thumbnail of a JPEG file. Source is streamed from the file, so only
+ *        the downscaled picture needs memory.
+ *
+ * @param src_path path of the original picture
+ * @param dst_path path of the thumbnail to create
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if source can not be opened, ESP_FAIL otherwise
+ */
+esp_err_t make_thumbnail_file(const char *src_path, const char *dst_path);
+
+/**
+ * @brief Decodes JPEG in memory into downscaled grayscale picture.
+ *        Used to compare preview frames for change detection (see kk_change.h).
+ *
+ * @param src JPEG data
+ * @param len JPEG length
+ * @param scale downscale factor
+ * @param out output buffer, one byte per pixel
+ * @param out_size size of output buffer
+ * @param width width of decoded picture
+ * @param height height of decoded picture
+ * @return true on success, false on decode error or if picture does not fit out
+ */
+bool jpg2gray(const uint8_t *src, size_t len, jpg_scale_t scale, uint8_t *out, size_t out_size, uint16_t *width, uint16_t *height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_IMGPROC_KK_IMGPROC_H_ */
@@ -0,0 +1,151 @@
+/*
+ * kk_jpegmeta.c
+ *
+ *  Measurement text stored in JPEG comment (COM) segment. Segment is spliced
+ *  into the bitstream while the picture is written, entropy coded data is
+ *  copied untouched. Plain C without any ESP-IDF dependency.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "kk_jpegmeta.h"
+
+#define JPEG_SOI  0xD8
+#define JPEG_EOI  0xD9
+#define JPEG_SOS  0xDA
+#define JPEG_APP0 0xE0
+#define JPEG_COM  0xFE
+
+#define TAG_LEN (sizeof(JPEG_META_TAG) - 1)
+
+/**
+ * @param jpg JPEG data
+ * @param len JPEG length
+ * @return offset where the segment should be inserted: after SOI and JFIF APP0
+ *         (which has to stay first), 0 if data is not a JPEG
+ */
+size_t jpeg_meta_insert_pos(const uint8_t *jpg, size_t len){
+  size_t pos = 2;
+  if(len < 4 || jpg[0] != 0xFF || jpg[1] != JPEG_SOI){
+    return 0;
+  }
+  if(len >= pos + 4 && jpg[pos] == 0xFF && jpg[pos + 1] == JPEG_APP0){
+    pos += 2 + ((jpg[pos + 2] << 8) | jpg[pos + 3]);
+  }
+  return pos <= len ? pos : 0;
+}
+
+/**
+ * @param text measurement text (i.e. JSON), at most JPEG_META_LEN_MAX - 1 characters
+ * @param out buffer for the segment, JPEG_META_SEG_MAX is always enough
+ * @param out_size size of the buffer
+ * @return length of the segment, 0 if it does not fit
+ */
+size_t jpeg_meta_segment(const char *text, uint8_t *out, size_t out_size){
+  size_t text_len = strlen(text);
+  size_t seg_len = 4 + TAG_LEN + text_len;
+  if(text_len >= JPEG_META_LEN_MAX || seg_len > out_size){
+    return 0;
+  }
+  out[0] = 0xFF;
+  out[1] = JPEG_COM;
+  out[2] = (seg_len - 2) >> 8;    //length counts itself, but not the marker
+  out[3] = (seg_len - 2) & 0xFF;
+  memcpy(out + 4, JPEG_META_TAG, TAG_LEN);
+  memcpy(out + 4 + TAG_LEN, text, text_len);
+  return seg_len;
+}
+
+/**
+ * @brief Looks for station COM segment among header segments. Stops at the
+ *        start of scan, entropy coded data is never touched.
+ * @param jpg JPEG data
+ * @param len JPEG length
+ * @param text will point to the text inside jpg (not terminated)
+ * @param text_len length of the text
+ * @return true if found
+ */
+bool jpeg_meta_find(const uint8_t *jpg, size_t len, const char **text, size_t *text_len){
+  size_t pos = 2;
+  if(len < 4 || jpg[0] != 0xFF || jpg[1] != JPEG_SOI){
+    return false;
+  }
+  while(pos + 4 <= len && jpg[pos] == 0xFF){
+    uint8_t marker = jpg[pos + 1];
+    if(marker == 0xFF){   //fill byte
+      pos++;
+      continue;
+    }
+    if(marker == JPEG_SOS || marker == JPEG_EOI){
+      break;
+    }
+    size_t seg_len = (jpg[pos + 2] << 8) | jpg[pos + 3];
+    if(seg_len < 2 || pos + 2 + seg_len > len){
+      break;
+    }
+    if(marker == JPEG_COM && seg_len - 2 >= TAG_LEN && memcmp(jpg + pos + 4, JPEG_META_TAG, TAG_LEN) == 0){
+      *text = (const char *)jpg + pos + 4 + TAG_LEN;
+      *text_len = seg_len - 2 - TAG_LEN;
+      return true;
+    }
+    pos += 2 + seg_len;
+  }
+  return false;
+}
+
+/**
+ * @brief Same as jpeg_meta_find() for a file. Only segment headers are read,
+ *        other segments are skipped with fseek().
+ * @param path picture path
+ * @param out buffer for the text
+ * @param out_size size of the buffer
+ * @return length of the text stored in out (terminated), 0 if not found
+ */
+size_t jpeg_meta_read_file(const char *path, char *out, size_t out_size){
+  uint8_t hdr[4 + TAG_LEN];
+  size_t found = 0;
+
+  if(out_size == 0){
+    return 0;
+  }
+  FILE *f = fopen(path, "rb");
+  if(f == NULL){
+    return 0;
+  }
+  if(fread(hdr, 1, 2, f) != 2 || hdr[0] != 0xFF || hdr[1] != JPEG_SOI){
+    fclose(f);
+    return 0;
+  }
+  while(fread(hdr, 1, 4, f) == 4 && hdr[0] == 0xFF){
+    if(hdr[1] == JPEG_SOS || hdr[1] == JPEG_EOI){
+      break;
+    }
+    long seg_len = (hdr[2] << 8) | hdr[3];
+    if(seg_len < 2){
+      break;
+    }
+    if(hdr[1] == JPEG_COM && seg_len - 2 >= (long)TAG_LEN){
+      if(fread(hdr + 4, 1, TAG_LEN, f) != TAG_LEN){
+        break;
+      }
+      seg_len -= TAG_LEN;
+      if(memcmp(hdr + 4, JPEG_META_TAG, TAG_LEN) == 0){
+        size_t text_len = seg_len - 2;
+        if(text_len >= out_size){
+          text_len = out_size - 1;
+        }
+        found = fread(out, 1, text_len, f);
+        out[found] = 0;
+        break;
+      }
+    }
+    if(fseek(f, seg_len - 2, SEEK_CUR) != 0){
+      break;
+    }
+  }
+  fclose(f);
+  return found;
+}
@@ -0,0 +1,32 @@
+/*
+ * kk_jpegmeta.h
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_IMGPROC_KK_JPEGMETA_H_
+#define COMPONENTS_KK_IMGPROC_KK_JPEGMETA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define JPEG_META_TAG       "KKWS"  //first bytes of COM segment written by the station
+#define JPEG_META_LEN_MAX   256     //max length of text embedded into picture (with terminating 0)
+#define JPEG_META_SEG_MAX   (4 + sizeof(JPEG_META_TAG) - 1 + JPEG_META_LEN_MAX)  //marker, length, tag, text
+
+size_t jpeg_meta_insert_pos(const uint8_t *jpg, size_t len);
+size_t jpeg_meta_segment(const char *text, uint8_t *out, size_t out_size);
+bool jpeg_meta_find(const uint8_t *jpg, size_t len, const char **text, size_t *text_len);
+size_t jpeg_meta_read_file(const char *path, char *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_IMGPROC_KK_JPEGMETA_H_ */
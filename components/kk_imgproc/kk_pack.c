@@ -0,0 +1,162 @@
+/*
+ * kk_pack.c
+ *
+ *  Day pack of pictures: one append-only YYYYMMDD.pak file holding all pictures
+ *  of the day plus YYYYMMDD.idx sidecar with offset/length/time of each of them.
+ *  Replaces ~300 small files per day directory, so FAT has no long directories
+ *  to scan and listing a day is a single read of the index.
+ *  Plain C without any ESP-IDF dependency, tools/picpack.py uses the same format.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include "kk_pack.h"
+
+/**
+ * @brief Builds path of the pack of given day: <dir>/YYYY/MM/DD/YYYYMMDD.pak
+ * @param dir root dcim directory
+ * @param date day as YYYY/MM/DD (leading '/' is allowed)
+ * @param out output buffer
+ * @param len size of output buffer
+ * @return true if date is valid and path fits into the buffer
+ */
+bool pack_day_path(const char *dir, const char *date, char *out, size_t len){
+  if(*date == '/'){
+    date++;
+  }
+  if(strlen(date) != 10 || date[4] != '/' || date[7] != '/'){
+    return false;
+  }
+  int cx = snprintf(out, len, "%s/%s/%.4s%.2s%.2s" PACK_EXT, dir, date, date, date + 5, date + 8);
+  return cx > 0 && (size_t)cx < len;
+}
+
+/**
+ * @param pak_path path of .pak file
+ * @param idx_path output buffer for path of its index
+ * @param len size of output buffer
+ * @return true if path fits into the buffer
+ */
+bool pack_idx_path(const char *pak_path, char *idx_path, size_t len){
+  size_t n = strlen(pak_path);
+  if(n < sizeof(PACK_EXT) - 1 || n >= len){
+    return false;
+  }
+  memcpy(idx_path, pak_path, n - (sizeof(PACK_EXT) - 1));
+  strcpy(idx_path + n - (sizeof(PACK_EXT) - 1), PACK_IDX_EXT);
+  return true;
+}
+
+/**
+ * @brief Appends picture to the pack, then its record to the index.
+ *        Picture is given in parts, so segments can be spliced in without copying.
+ *        If power fails in between, pack keeps unreferenced bytes and a torn
+ *        index record is overwritten by the next append.
+ * @param pak_path path of .pak file (created if missing)
+ * @param parts picture parts
+ * @param part_lens length of every part
+ * @param n number of parts
+ * @param time capture time
+ * @return index of the picture in the pack, -1 on error
+ */
+long pack_append(const char *pak_path, const uint8_t * const *parts, const size_t *part_lens, size_t n, uint32_t time){
+  char idx_path[PACK_PATH_MAX];
+  pack_entry_t entry = {0};
+  bool ok = true;
+
+  if(!pack_idx_path(pak_path, idx_path, sizeof(idx_path))){
+    return -1;
+  }
+  FILE *f = fopen(pak_path, "ab");
+  if(f == NULL){
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  long offset = ftell(f);
+  for(size_t i = 0; i < n && ok; i++){
+    if(part_lens[i] > 0){
+      ok = fwrite(parts[i], part_lens[i], 1, f) == 1;
+      entry.len += part_lens[i];
+    }
+  }
+  ok = (fclose(f) == 0) && ok && offset >= 0;
+  if(!ok){
+    return -1;
+  }
+  entry.offset = (uint32_t)offset;
+  entry.time = time;
+
+  uint32_t count = pack_count(pak_path);
+  FILE *fi = fopen(idx_path, "r+b");
+  if(fi == NULL){
+    fi = fopen(idx_path, "wb");
+  }
+  if(fi == NULL){
+    return -1;
+  }
+  ok = fseek(fi, count * sizeof(entry), SEEK_SET) == 0 && fwrite(&entry, sizeof(entry), 1, fi) == 1;
+  ok = (fclose(fi) == 0) && ok;
+  return ok ? (long)count : -1;
+}
+
+/**
+ * @param pak_path path of .pak file
+ * @return number of pictures in the pack (0 if there is no pack)
+ */
+uint32_t pack_count(const char *pak_path){
+  char idx_path[PACK_PATH_MAX];
+  struct stat st;
+  if(!pack_idx_path(pak_path, idx_path, sizeof(idx_path)) || stat(idx_path, &st) != 0){
+    return 0;
+  }
+  return st.st_size / sizeof(pack_entry_t);
+}
+
+/**
+ * @param pak_path path of .pak file
+ * @param first index of the first record to read
+ * @param entries output records
+ * @param max size of entries
+ * @return number of records read
+ */
+size_t pack_read_index(const char *pak_path, uint32_t first, pack_entry_t *entries, size_t max){
+  char idx_path[PACK_PATH_MAX];
+  size_t n = 0;
+  if(!pack_idx_path(pak_path, idx_path, sizeof(idx_path))){
+    return 0;
+  }
+  FILE *fi = fopen(idx_path, "rb");
+  if(fi == NULL){
+    return 0;
+  }
+  if(fseek(fi, first * sizeof(pack_entry_t), SEEK_SET) == 0){
+    n = fread(entries, sizeof(pack_entry_t), max, fi);
+  }
+  fclose(fi);
+  return n;
+}
+
+/**
+ * @brief Opens the pack positioned at the start of n-th picture.
+ *        Caller reads entry->len bytes and closes the file.
+ * @param pak_path path of .pak file
+ * @param n index of the picture
+ * @param entry index record of the picture
+ * @return open file, NULL if there is no such picture
+ */
+FILE *pack_open_entry(const char *pak_path, uint32_t n, pack_entry_t *entry){
+  struct stat st;
+  if(pack_read_index(pak_path, n, entry, 1) != 1 || stat(pak_path, &st) != 0
+      || (uint64_t)entry->offset + entry->len > (uint64_t)st.st_size){
+    return NULL;
+  }
+  FILE *f = fopen(pak_path, "rb");
+  if(f != NULL && fseek(f, entry->offset, SEEK_SET) != 0){
+    fclose(f);
+    f = NULL;
+  }
+  return f;
+}
@@ -0,0 +1,43 @@
+/*
+ * kk_pack.h
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_IMGPROC_KK_PACK_H_
+#define COMPONENTS_KK_IMGPROC_KK_PACK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACK_EXT      ".pak"  //pictures of one day, appended one after another
+#define PACK_IDX_EXT  ".idx"  //sidecar index, one pack_entry_t per picture
+#define PACK_PATH_MAX 64      //max length of pack path handled by pack functions
+
+//Index record, stored little endian as it is (16 B)
+typedef struct {
+  uint32_t offset;    //picture start in .pak file
+  uint32_t len;       //picture length
+  uint32_t time;      //capture time (unix time)
+  uint32_t reserved;
+} pack_entry_t;
+
+bool pack_day_path(const char *dir, const char *date, char *out, size_t len);
+bool pack_idx_path(const char *pak_path, char *idx_path, size_t len);
+long pack_append(const char *pak_path, const uint8_t * const *parts, const size_t *part_lens, size_t n, uint32_t time);
+uint32_t pack_count(const char *pak_path);
+size_t pack_read_index(const char *pak_path, uint32_t first, pack_entry_t *entries, size_t max);
+FILE *pack_open_entry(const char *pak_path, uint32_t n, pack_entry_t *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_IMGPROC_KK_PACK_H_ */
@@ -0,0 +1,235 @@
+/*
+ * kk_picindex.c
+ *
+ *  Per day index of pictures: pictures.idx in the day directory holds name, time,
+ *  size and flags of every picture stored there, in the order they were added.
+ *  Listing a day is a read of the index instead of readdir() and stat() per picture.
+ *  Days without index (older ones) get it built from the directory listing once.
+ *  Plain C without any ESP-IDF dependency. Functions are not thread safe,
+ *  callers serialize access to an index.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "kk_picindex.h"
+
+/**
+ * @brief Builds path of a file in day directory: <day_dir>/<name>
+ * @param day_dir day directory
+ * @param name file name
+ * @param out output buffer
+ * @param len size of output buffer
+ * @return true if path fits into the buffer
+ */
+bool pic_index_path(const char *day_dir, const char *name, char *out, size_t len){
+  int cx = snprintf(out, len, "%s/%s", day_dir, name);
+  return cx > 0 && (size_t)cx < len;
+}
+
+/**
+ * @param day_dir day directory
+ * @return number of pictures in the index, -1 if day has no index
+ */
+long pic_index_count(const char *day_dir){
+  char idx_path[PIC_INDEX_PATH_MAX];
+  struct stat st;
+  if(!pic_index_path(day_dir, PIC_INDEX_NAME, idx_path, sizeof(idx_path)) || stat(idx_path, &st) != 0){
+    return -1;
+  }
+  return st.st_size / sizeof(pic_index_entry_t);
+}
+
+/**
+ * @brief Writes index of the day made from directory listing (stat of every .jpg and its
+ *        thumbnail) into a side file. Index in use is not touched, see pic_index_install().
+ * @param day_dir day directory
+ * @param thumb_dir thumbnails subdirectory name
+ * @param tmp_name name of the side file in day directory
+ * @return number of pictures indexed, -1 on error (side file is removed)
+ */
+long pic_index_scan(const char *day_dir, const char *thumb_dir, const char *tmp_name){
+  char tmp_path[PIC_INDEX_PATH_MAX];
+  char file_path[PIC_INDEX_PATH_MAX];
+  pic_index_entry_t entry;
+  struct dirent *de;
+  struct stat st;
+  long count = 0;
+  bool ok = true;
+
+  if(!pic_index_path(day_dir, tmp_name, tmp_path, sizeof(tmp_path))){
+    return -1;
+  }
+  DIR *dir = opendir(day_dir);
+  if(dir == NULL){
+    return -1;
+  }
+  FILE *f = fopen(tmp_path, "wb");
+  if(f == NULL){
+    closedir(dir);
+    return -1;
+  }
+  while(ok && (de = readdir(dir)) != NULL){
+    const char *ext = strrchr(de->d_name, '.');
+    if(de->d_type != DT_REG || ext == NULL || strcmp(ext, ".jpg") != 0 || strlen(de->d_name) >= sizeof(entry.name)){
+      continue;
+    }
+    if(!pic_index_path(day_dir, de->d_name, file_path, sizeof(file_path)) || stat(file_path, &st) != 0){
+      continue;
+    }
+    memset(&entry, 0, sizeof(entry));
+    strcpy(entry.name, de->d_name);
+    entry.time = (uint32_t)st.st_mtime;
+    entry.size = (uint32_t)st.st_size;
+    int cx = snprintf(file_path, sizeof(file_path), "%s/%s/%s", day_dir, thumb_dir, de->d_name);
+    if(cx > 0 && (size_t)cx < sizeof(file_path) && stat(file_path, &st) == 0){
+      entry.flags |= PIC_INDEX_THUMB;
+    }
+    ok = fwrite(&entry, sizeof(entry), 1, f) == 1;
+    count++;
+  }
+  closedir(dir);
+  ok = (fclose(f) == 0) && ok;
+  if(!ok){
+    remove(tmp_path);
+    return -1;
+  }
+  return count;
+}
+
+/**
+ * @brief Makes side file written by pic_index_scan() the index of the day.
+ *        Index is renamed in place, so a power loss never leaves it half done.
+ * @param day_dir day directory
+ * @param tmp_name name of the side file in day directory
+ * @return true on success, side file is removed otherwise
+ */
+bool pic_index_install(const char *day_dir, const char *tmp_name){
+  char idx_path[PIC_INDEX_PATH_MAX];
+  char tmp_path[PIC_INDEX_PATH_MAX];
+  struct stat st;
+  if(!pic_index_path(day_dir, PIC_INDEX_NAME, idx_path, sizeof(idx_path))
+      || !pic_index_path(day_dir, tmp_name, tmp_path, sizeof(tmp_path)) || stat(tmp_path, &st) != 0){
+    return false;
+  }
+  //FAT does not rename over existing file
+  remove(idx_path);
+  if(rename(tmp_path, idx_path) != 0){
+    remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Creates index of the day from directory listing (pic_index_scan() and pic_index_install()).
+ * @param day_dir day directory
+ * @param thumb_dir thumbnails subdirectory name
+ * @return number of pictures indexed, -1 on error
+ */
+long pic_index_build(const char *day_dir, const char *thumb_dir){
+  long count = pic_index_scan(day_dir, thumb_dir, PIC_INDEX_TMP_NAME);
+  if(count < 0 || !pic_index_install(day_dir, PIC_INDEX_TMP_NAME)){
+    return -1;
+  }
+  return count;
+}
+
+/**
+ * @brief Adds stored picture to the index of its day. If the day has no index yet,
+ *        it is built from the directory (picture must be stored already).
+ *        A torn record left by power loss is overwritten. Record of the same picture
+ *        as the last one is replaced: index scanned from the directory while the picture
+ *        was being stored may hold it already.
+ * @param day_dir day directory
+ * @param entry record of the picture
+ * @param thumb_dir thumbnails subdirectory name (for building the index)
+ * @return number of pictures in the index, -1 on error
+ */
+long pic_index_append(const char *day_dir, const pic_index_entry_t *entry, const char *thumb_dir){
+  char idx_path[PIC_INDEX_PATH_MAX];
+  pic_index_entry_t last;
+  long count = pic_index_count(day_dir);
+  if(count < 0){
+    return pic_index_build(day_dir, thumb_dir);
+  }
+  if(!pic_index_path(day_dir, PIC_INDEX_NAME, idx_path, sizeof(idx_path))){
+    return -1;
+  }
+  FILE *f = fopen(idx_path, "r+b");
+  if(f == NULL){
+    return -1;
+  }
+  if(count > 0 && fseek(f, (count - 1) * sizeof(last), SEEK_SET) == 0 && fread(&last, sizeof(last), 1, f) == 1
+      && strncmp(last.name, entry->name, sizeof(last.name)) == 0){
+    count--;
+  }
+  bool ok = fseek(f, count * sizeof(*entry), SEEK_SET) == 0 && fwrite(entry, sizeof(*entry), 1, f) == 1;
+  ok = (fclose(f) == 0) && ok;
+  return ok ? count + 1 : -1;
+}
+
+/**
+ * @brief Sets flags of a picture. Index is searched from the end, as flags
+ *        are set shortly after the picture was added.
+ * @param day_dir day directory
+ * @param name file name of the picture
+ * @param flags PIC_INDEX_* flags to set
+ * @return true if picture was found and updated
+ */
+bool pic_index_set_flags(const char *day_dir, const char *name, uint32_t flags){
+  char idx_path[PIC_INDEX_PATH_MAX];
+  pic_index_entry_t entry;
+  bool ok = false;
+  long count = pic_index_count(day_dir);
+  if(count <= 0 || !pic_index_path(day_dir, PIC_INDEX_NAME, idx_path, sizeof(idx_path))){
+    return false;
+  }
+  FILE *f = fopen(idx_path, "r+b");
+  if(f == NULL){
+    return false;
+  }
+  for(long i = count - 1; i >= 0; i--){
+    if(fseek(f, i * sizeof(entry), SEEK_SET) != 0 || fread(&entry, sizeof(entry), 1, f) != 1){
+      break;
+    }
+    if(strncmp(entry.name, name, sizeof(entry.name)) == 0){
+      entry.flags |= flags;
+      ok = fseek(f, i * sizeof(entry), SEEK_SET) == 0 && fwrite(&entry, sizeof(entry), 1, f) == 1;
+      break;
+    }
+  }
+  ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+/**
+ * @param day_dir day directory
+ * @param first index of the first record to read
+ * @param entries output records
+ * @param max size of entries
+ * @return number of records read
+ */
+size_t pic_index_read(const char *day_dir, uint32_t first, pic_index_entry_t *entries, size_t max){
+  char idx_path[PIC_INDEX_PATH_MAX];
+  size_t n = 0;
+  if(!pic_index_path(day_dir, PIC_INDEX_NAME, idx_path, sizeof(idx_path))){
+    return 0;
+  }
+  FILE *f = fopen(idx_path, "rb");
+  if(f == NULL){
+    return 0;
+  }
+  if(fseek(f, first * sizeof(pic_index_entry_t), SEEK_SET) == 0){
+    n = fread(entries, sizeof(pic_index_entry_t), max, f);
+  }
+  fclose(f);
+  for(size_t i = 0; i < n; i++){
+    entries[i].name[sizeof(entries[i].name) - 1] = '\0';
+  }
+  return n;
+}
@@ -0,0 +1,46 @@
+/*
+ * kk_picindex.h
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_IMGPROC_KK_PICINDEX_H_
+#define COMPONENTS_KK_IMGPROC_KK_PICINDEX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PIC_INDEX_NAME      "pictures.idx"  //index of pictures in day directory
+#define PIC_INDEX_TMP_NAME  "pictures.tmp"  //index being rebuilt from directory listing
+#define PIC_INDEX_SCAN_NAME "pictures.scn"  //index being scanned by a reader, outside of writer lock
+#define PIC_INDEX_PATH_MAX  64              //max length of index path handled by index functions
+#define PIC_INDEX_THUMB     0x01            //flag: thumbnail exists
+
+//Index record, stored little endian as it is (24 B)
+typedef struct {
+  char name[12];      //file name in day directory (NNN.jpg)
+  uint32_t time;      //modification time (unix time)
+  uint32_t size;      //file size
+  uint32_t flags;     //PIC_INDEX_*
+} pic_index_entry_t;
+
+bool pic_index_path(const char *day_dir, const char *name, char *out, size_t len);
+long pic_index_count(const char *day_dir);
+long pic_index_scan(const char *day_dir, const char *thumb_dir, const char *tmp_name);
+bool pic_index_install(const char *day_dir, const char *tmp_name);
+long pic_index_build(const char *day_dir, const char *thumb_dir);
+long pic_index_append(const char *day_dir, const pic_index_entry_t *entry, const char *thumb_dir);
+bool pic_index_set_flags(const char *day_dir, const char *name, uint32_t flags);
+size_t pic_index_read(const char *day_dir, uint32_t first, pic_index_entry_t *entries, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_IMGPROC_KK_PICINDEX_H_ */
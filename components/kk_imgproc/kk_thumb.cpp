@@ -0,0 +1,172 @@
+/*
+ * kk_thumb.cpp
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "img_converters.h"
+#include "kk_imgproc.h"
+
+static const char *TAG = "THUMB";
+
+//decoder state shared by readers and writer
+struct thumb_decoder{
+  const uint8_t *input;   //memory source
+  FILE *file;             //file source
+  uint16_t width;
+  uint16_t height;
+  uint8_t *output;        //BGR888 picture as expected by fmt2jpg or grayscale
+  size_t output_size;     //size of caller provided grayscale buffer
+};
+
+static size_t mem_reader(void *arg, size_t index, uint8_t *buf, size_t len){
+  thumb_decoder *dec = (thumb_decoder *)arg;
+  if(buf){
+    memcpy(buf, dec->input + index, len);
+  }
+  return len;
+}
+
+static size_t file_reader(void *arg, size_t index, uint8_t *buf, size_t len){
+  thumb_decoder *dec = (thumb_decoder *)arg;
+  if(!buf){
+    return fseek(dec->file, len, SEEK_CUR) == 0 ? len : 0;
+  }
+  return fread(buf, 1, len, dec->file);
+}
+
+/**
+ * @brief Decoder output: allocates picture on start, stores decoded blocks as BGR888
+ */
+static bool bgr_writer(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data){
+  thumb_decoder *dec = (thumb_decoder *)arg;
+  if(!data){
+    if(x == 0 && y == 0){
+      //write start
+      dec->width = w;
+      dec->height = h;
+      dec->output = (uint8_t *)heap_caps_malloc(w * h * 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+      if(!dec->output){
+        dec->output = (uint8_t *)malloc(w * h * 3);
+      }
+      return dec->output != NULL;
+    }
+    return true;  //write end
+  }
+  if(!dec->output){
+    return false;
+  }
+  //clip blocks to the scaled picture (width/height are rounded down by decoder)
+  uint16_t cw = (x + w > dec->width) ? (x < dec->width ? dec->width - x : 0) : w;
+  uint16_t ch = (y + h > dec->height) ? (y < dec->height ? dec->height - y : 0) : h;
+  for(uint16_t iy = 0; iy < ch; iy++){
+    uint8_t *o = dec->output + ((y + iy) * dec->width + x) * 3;
+    const uint8_t *d = data + iy * w * 3;
+    for(uint16_t ix = 0; ix < cw * 3; ix += 3){
+      o[ix] = d[ix + 2];
+      o[ix + 1] = d[ix + 1];
+      o[ix + 2] = d[ix];
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Decoder output for grayscale: writes luma into caller buffer
+ */
+static bool gray_writer(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data){
+  thumb_decoder *dec = (thumb_decoder *)arg;
+  if(!data){
+    if(x == 0 && y == 0){
+      //write start
+      dec->width = w;
+      dec->height = h;
+      return (size_t)w * h <= dec->output_size;
+    }
+    return true;  //write end
+  }
+  if((size_t)dec->width * dec->height > dec->output_size){
+    return false;
+  }
+  uint16_t cw = (x + w > dec->width) ? (x < dec->width ? dec->width - x : 0) : w;
+  uint16_t ch = (y + h > dec->height) ? (y < dec->height ? dec->height - y : 0) : h;
+  for(uint16_t iy = 0; iy < ch; iy++){
+    uint8_t *o = dec->output + (y + iy) * dec->width + x;
+    const uint8_t *d = data + iy * w * 3;
+    for(uint16_t ix = 0; ix < cw; ix++, d += 3){
+      o[ix] = (d[0] * 77 + d[1] * 150 + d[2] * 29) >> 8;  //decoder gives RGB order
+    }
+  }
+  return true;
+}
+
+static bool encode_thumb(thumb_decoder *dec, uint8_t quality, uint8_t **out, size_t *out_len){
+  bool res = fmt2jpg(dec->output, dec->width * dec->height * 3, dec->width, dec->height,
+                     PIXFORMAT_RGB888, quality, out, out_len);
+  free(dec->output);
+  dec->output = NULL;
+  return res;
+}
+
+bool jpg2thumb(const uint8_t *src, size_t len, jpg_scale_t scale, uint8_t quality, uint8_t **out, size_t *out_len){
+  thumb_decoder dec = {};
+  dec.input = src;
+  if(esp_jpg_decode(len, scale, mem_reader, bgr_writer, &dec) != ESP_OK){
+    free(dec.output);
+    return false;
+  }
+  return encode_thumb(&dec, quality, out, out_len);
+}
+
+esp_err_t make_thumbnail_file(const char *src_path, const char *dst_path){
+  thumb_decoder dec = {};
+  struct stat st;
+  uint8_t *thumb = NULL;
+  size_t thumb_len = 0;
+
+  if(stat(src_path, &st) != 0 || (dec.file = fopen(src_path, "rb")) == NULL){
+    ESP_LOGE(TAG, "Can not open %s", src_path);
+    return ESP_ERR_NOT_FOUND;
+  }
+  esp_err_t res = esp_jpg_decode(st.st_size, THUMB_SCALE, file_reader, bgr_writer, &dec);
+  fclose(dec.file);
+  if(res != ESP_OK){
+    free(dec.output);
+    return ESP_FAIL;
+  }
+  if(!encode_thumb(&dec, THUMB_QUALITY, &thumb, &thumb_len)){
+    ESP_LOGE(TAG, "Can not encode thumbnail of %s", src_path);
+    return ESP_FAIL;
+  }
+
+  FILE *f = fopen(dst_path, "wb");
+  if(f == NULL){
+    ESP_LOGE(TAG, "Can not create %s", dst_path);
+    free(thumb);
+    return ESP_FAIL;
+  }
+  res = (fwrite(thumb, thumb_len, 1, f) == 1) ? ESP_OK : ESP_FAIL;
+  fclose(f);
+  free(thumb);
+  return res;
+}
+
+bool jpg2gray(const uint8_t *src, size_t len, jpg_scale_t scale, uint8_t *out, size_t out_size, uint16_t *width, uint16_t *height){
+  thumb_decoder dec = {};
+  dec.input = src;
+  dec.output = out;
+  dec.output_size = out_size;
+  if(esp_jpg_decode(len, scale, mem_reader, gray_writer, &dec) != ESP_OK){
+    return false;
+  }
+  *width = dec.width;
+  *height = dec.height;
+  return true;
+}
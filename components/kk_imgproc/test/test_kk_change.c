@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+
+#include "kk_change.h"
+
+// plain C only, builds for the target and in host_test
+
+static uint32_t gray_mad_q8_reference(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+    }
+    return (uint32_t)((sum << 8) / n);
+}
+
+TEST_CASE("Change detection kernel matches reference", "[kk_imgproc]")
+{
+    const size_t n = 160 * 128;
+    uint8_t *a = malloc(n);
+    uint8_t *b = malloc(n);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    srand(1);
+    for (size_t len = 1; len < n; len = len * 3 + 1) {
+        for (size_t i = 0; i < len; i++) {
+            a[i] = rand();
+            b[i] = rand();
+        }
+        TEST_ASSERT_EQUAL_UINT32(gray_mad_q8_reference(a, b, len), gray_mad_q8(a, b, len));
+    }
+    memset(b, 0, n);
+    memset(a, 0, n);
+    TEST_ASSERT_EQUAL_UINT32(0, gray_mad_q8(a, b, n));
+
+    TEST_ASSERT_EQUAL_UINT32(900, change_to_interval(CHANGE_Q8(1), CHANGE_Q8(2), CHANGE_Q8(12), 120, 900));
+    TEST_ASSERT_EQUAL_UINT32(120, change_to_interval(CHANGE_Q8(20), CHANGE_Q8(2), CHANGE_Q8(12), 120, 900));
+    TEST_ASSERT_EQUAL_UINT32(510, change_to_interval(CHANGE_Q8(7), CHANGE_Q8(2), CHANGE_Q8(12), 120, 900));
+    free(a);
+    free(b);
+}
+
+TEST_CASE("Change detection kernel performance test", "[kk_imgproc]")
+{
+    // previews at 1/8 scale of VGA, SVGA and SXGA
+    const size_t sizes[][2] = {{80, 60}, {100, 75}, {160, 128}};
+    const size_t times = 1000;
+    uint8_t *a = malloc(160 * 128);
+    uint8_t *b = malloc(160 * 128);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    srand(2);
+    for (size_t i = 0; i < 160 * 128; i++) {
+        a[i] = rand();
+        b[i] = rand();
+    }
+    printf("Change detection kernel Result\n");
+    printf("preview     ,  mad us   , reference us \n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s][0] * sizes[s][1];
+        volatile uint32_t mad = 0, ref = 0;
+        clock_t start = clock();
+        for (size_t i = 0; i < times; i++) {
+            mad = gray_mad_q8(a, b, n);
+        }
+        clock_t mid = clock();
+        for (size_t i = 0; i < times; i++) {
+            ref = gray_mad_q8_reference(a, b, n);
+        }
+        clock_t end = clock();
+        TEST_ASSERT_EQUAL_UINT32(ref, mad);
+        printf("%4u x %4u ,  %8.2f ,  %8.2f \n", (unsigned)sizes[s][0], (unsigned)sizes[s][1],
+               (double)(mid - start) * 1000000 / CLOCKS_PER_SEC / times,
+               (double)(end - mid) * 1000000 / CLOCKS_PER_SEC / times);
+    }
+    printf("----------------------------------------------------------------------------------------\n");
+    free(a);
+    free(b);
+}
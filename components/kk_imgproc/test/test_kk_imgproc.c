@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "img_converters.h"
+#include "kk_imgproc.h"
+
+extern const uint8_t thumb_src_start[] asm("_binary_thumb_src_jpeg_start");
+extern const uint8_t thumb_src_end[]   asm("_binary_thumb_src_jpeg_end");
+
+#define THUMB_SRC_W 480
+#define THUMB_SRC_H 320
+
+TEST_CASE("Change detection preview performance test", "[kk_imgproc]")
+{
+    const size_t times = 16;
+    const size_t buf_size = (THUMB_SRC_W / 8) * (THUMB_SRC_H / 8);
+    uint8_t *ref = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *cur = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(ref);
+    TEST_ASSERT_NOT_NULL(cur);
+    uint16_t w = 0, h = 0;
+    size_t len = thumb_src_end - thumb_src_start;
+
+    uint64_t t_decode = 0, t_mad = 0;
+    uint32_t mad = 0;
+    TEST_ASSERT_TRUE(jpg2gray(thumb_src_start, len, JPG_SCALE_8X, ref, buf_size, &w, &h));
+    for (size_t i = 0; i < times; i++) {
+        uint64_t t1 = esp_timer_get_time();
+        TEST_ASSERT_TRUE(jpg2gray(thumb_src_start, len, JPG_SCALE_8X, cur, buf_size, &w, &h));
+        uint64_t t2 = esp_timer_get_time();
+        mad = gray_mad_q8(cur, ref, w * h);
+        t_decode += t2 - t1;
+        t_mad += esp_timer_get_time() - t2;
+    }
+    //same picture decoded twice must not look like a change
+    TEST_ASSERT_EQUAL_UINT32(0, mad);
+
+    printf("Change detection Result\n");
+    printf("preview     ,  decode ms ,  mad us \n");
+    printf("%4d x %4d ,     %5.2f ,  %6.1f \n", w, h, t_decode / 1000.0f / times, (float)t_mad / times);
+    printf("----------------------------------------------------------------------------------------\n");
+    heap_caps_free(ref);
+    heap_caps_free(cur);
+}
+
+TEST_CASE("Measurement comment is spliced in and read back", "[kk_imgproc]")
+{
+    const char *meta = "{\"time\":\"1792368000\",\"int_t\":21.50, \"ext_t\":-3.25, \"humi\":81, \"sun\":1234.50, \"press\":1013.25, \"wind\":7.200}";
+    size_t len = thumb_src_end - thumb_src_start;
+    const char *text = NULL;
+    size_t text_len = 0;
+    TEST_ASSERT_FALSE(jpeg_meta_find(thumb_src_start, len, &text, &text_len));
+
+    uint8_t seg[JPEG_META_SEG_MAX];
+    size_t pos = jpeg_meta_insert_pos(thumb_src_start, len);
+    size_t seg_len = jpeg_meta_segment(meta, seg, sizeof(seg));
+    TEST_ASSERT_TRUE(pos >= 2);
+    TEST_ASSERT_EQUAL(4 + strlen(JPEG_META_TAG) + strlen(meta), seg_len);
+
+    uint8_t *jpg = heap_caps_malloc(len + seg_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(jpg);
+    memcpy(jpg, thumb_src_start, pos);
+    memcpy(jpg + pos, seg, seg_len);
+    memcpy(jpg + pos + seg_len, thumb_src_start + pos, len - pos);
+    TEST_ASSERT_TRUE(jpeg_meta_find(jpg, len + seg_len, &text, &text_len));
+    TEST_ASSERT_EQUAL(strlen(meta), text_len);
+    TEST_ASSERT_EQUAL_MEMORY(meta, text, text_len);
+
+    //picture itself is untouched
+    const size_t buf_size = (THUMB_SRC_W / 8) * (THUMB_SRC_H / 8);
+    uint8_t *ref = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *cur = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(ref);
+    TEST_ASSERT_NOT_NULL(cur);
+    uint16_t w = 0, h = 0;
+    TEST_ASSERT_TRUE(jpg2gray(thumb_src_start, len, JPG_SCALE_8X, ref, buf_size, &w, &h));
+    TEST_ASSERT_TRUE(jpg2gray(jpg, len + seg_len, JPG_SCALE_8X, cur, buf_size, &w, &h));
+    TEST_ASSERT_EQUAL_UINT32(0, gray_mad_q8(cur, ref, w * h));
+
+    heap_caps_free(ref);
+    heap_caps_free(cur);
+    heap_caps_free(jpg);
+}
+
+TEST_CASE("Day pack paths", "[kk_imgproc]")
+{
+    char pak[PACK_PATH_MAX], idx[PACK_PATH_MAX];
+    TEST_ASSERT_TRUE(pack_day_path("/sd/www/dcim", "/2026/10/19", pak, sizeof(pak)));
+    TEST_ASSERT_EQUAL_STRING("/sd/www/dcim/2026/10/19/20261019.pak", pak);
+    TEST_ASSERT_TRUE(pack_day_path("/sd/www/dcim", "2026/10/19", pak, sizeof(pak)));
+    TEST_ASSERT_EQUAL_STRING("/sd/www/dcim/2026/10/19/20261019.pak", pak);
+    TEST_ASSERT_TRUE(pack_idx_path(pak, idx, sizeof(idx)));
+    TEST_ASSERT_EQUAL_STRING("/sd/www/dcim/2026/10/19/20261019.idx", idx);
+
+    TEST_ASSERT_FALSE(pack_day_path("/sd/www/dcim", "2026/10/1", pak, sizeof(pak)));
+    TEST_ASSERT_FALSE(pack_day_path("/sd/www/dcim", "2026-10-19", pak, sizeof(pak)));
+    TEST_ASSERT_FALSE(pack_day_path("/sd/www/dcim", "2026/10/19", pak, 20));
+    TEST_ASSERT_EQUAL(16, sizeof(pack_entry_t));
+}
+
+TEST_CASE("Picture index paths", "[kk_imgproc]")
+{
+    char path[PIC_INDEX_PATH_MAX];
+    TEST_ASSERT_TRUE(pic_index_path("/sd/www/dcim/2026/10/19", PIC_INDEX_NAME, path, sizeof(path)));
+    TEST_ASSERT_EQUAL_STRING("/sd/www/dcim/2026/10/19/pictures.idx", path);
+    TEST_ASSERT_FALSE(pic_index_path("/sd/www/dcim/2026/10/19", PIC_INDEX_NAME, path, 20));
+    TEST_ASSERT_EQUAL(-1, pic_index_count("/nonexistent/2026/10/19"));
+    TEST_ASSERT_EQUAL(24, sizeof(pic_index_entry_t));
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "unity.h"
+
+#include "kk_picindex.h"
+
+// plain C only, builds for the target and in host_test. Needs a writable file system:
+// on the board the SD card must be mounted, host_test passes a directory of its build.
+#ifndef TEST_FS_ROOT
+#define TEST_FS_ROOT "/sd"
+#endif
+#define TEST_DAY_DIR TEST_FS_ROOT "/pidx"
+
+static void write_file(const char *dir, const char *name, size_t size)
+{
+    char path[PIC_INDEX_PATH_MAX];
+    TEST_ASSERT_TRUE(pic_index_path(dir, name, path, sizeof(path)));
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    for (size_t i = 0; f && i < size; i++) {
+        fputc(i, f);
+    }
+    if (f) {
+        fclose(f);
+    }
+}
+
+static void remove_file(const char *dir, const char *name)
+{
+    char path[PIC_INDEX_PATH_MAX];
+    if (pic_index_path(dir, name, path, sizeof(path))) {
+        remove(path);
+    }
+}
+
+// empty day directory with thumbnails subdirectory
+static void make_day_dir(void)
+{
+    char name[16];
+    mkdir(TEST_FS_ROOT, 0777);
+    mkdir(TEST_DAY_DIR, 0777);
+    mkdir(TEST_DAY_DIR "/th", 0777);
+    for (int i = 0; i < 16; i++) {
+        snprintf(name, sizeof(name), "%03d.jpg", i);
+        remove_file(TEST_DAY_DIR, name);
+        remove_file(TEST_DAY_DIR "/th", name);
+    }
+    remove_file(TEST_DAY_DIR, "notes.txt");
+    remove_file(TEST_DAY_DIR, "very_long_name.jpg");
+    remove_file(TEST_DAY_DIR, PIC_INDEX_NAME);
+    remove_file(TEST_DAY_DIR, PIC_INDEX_TMP_NAME);
+    remove_file(TEST_DAY_DIR, PIC_INDEX_SCAN_NAME);
+}
+
+static pic_index_entry_t make_entry(int no)
+{
+    pic_index_entry_t e;
+    memset(&e, 0, sizeof(e));
+    snprintf(e.name, sizeof(e.name), "%03d.jpg", no);
+    e.time = 1792368000 + no * 60;
+    e.size = 100000 + no;
+    return e;
+}
+
+TEST_CASE("Picture index records are appended and read back", "[kk_imgproc]")
+{
+    pic_index_entry_t e, out[4];
+    make_day_dir();
+    TEST_ASSERT_EQUAL(24, sizeof(pic_index_entry_t));
+    TEST_ASSERT_EQUAL(-1, pic_index_count(TEST_DAY_DIR));
+
+    // first append of a day without index builds it from the directory
+    write_file(TEST_DAY_DIR, "000.jpg", 10);
+    e = make_entry(0);
+    TEST_ASSERT_EQUAL(1, pic_index_append(TEST_DAY_DIR, &e, "th"));
+    TEST_ASSERT_EQUAL(1, pic_index_count(TEST_DAY_DIR));
+    for (int i = 1; i < 10; i++) {
+        e = make_entry(i);
+        TEST_ASSERT_EQUAL(i + 1, pic_index_append(TEST_DAY_DIR, &e, "th"));
+    }
+    // picture already in the index (scanned while it was stored) is not listed twice
+    e = make_entry(9);
+    e.size = 7;
+    TEST_ASSERT_EQUAL(10, pic_index_append(TEST_DAY_DIR, &e, "th"));
+
+    TEST_ASSERT_EQUAL(4, pic_index_read(TEST_DAY_DIR, 1, out, 4));
+    for (int i = 0; i < 4; i++) {
+        e = make_entry(i + 1);
+        TEST_ASSERT_EQUAL_STRING(e.name, out[i].name);
+        TEST_ASSERT_EQUAL_UINT32(e.time, out[i].time);
+        TEST_ASSERT_EQUAL_UINT32(e.size, out[i].size);
+        TEST_ASSERT_EQUAL_UINT32(0, out[i].flags);
+    }
+    TEST_ASSERT_EQUAL(1, pic_index_read(TEST_DAY_DIR, 9, out, 4));
+    TEST_ASSERT_EQUAL_STRING("009.jpg", out[0].name);
+    TEST_ASSERT_EQUAL_UINT32(7, out[0].size);
+
+    TEST_ASSERT_TRUE(pic_index_set_flags(TEST_DAY_DIR, "003.jpg", PIC_INDEX_THUMB));
+    TEST_ASSERT_FALSE(pic_index_set_flags(TEST_DAY_DIR, "042.jpg", PIC_INDEX_THUMB));
+    TEST_ASSERT_EQUAL(1, pic_index_read(TEST_DAY_DIR, 3, out, 1));
+    TEST_ASSERT_EQUAL_UINT32(PIC_INDEX_THUMB, out[0].flags);
+
+    // torn record left by power loss is not counted and gets overwritten
+    char path[PIC_INDEX_PATH_MAX];
+    TEST_ASSERT_TRUE(pic_index_path(TEST_DAY_DIR, PIC_INDEX_NAME, path, sizeof(path)));
+    FILE *f = fopen(path, "ab");
+    TEST_ASSERT_NOT_NULL(f);
+    fwrite("torn", 1, 4, f);
+    fclose(f);
+    TEST_ASSERT_EQUAL(10, pic_index_count(TEST_DAY_DIR));
+    e = make_entry(10);
+    TEST_ASSERT_EQUAL(11, pic_index_append(TEST_DAY_DIR, &e, "th"));
+    TEST_ASSERT_EQUAL(1, pic_index_read(TEST_DAY_DIR, 10, out, 4));
+    TEST_ASSERT_EQUAL_STRING("010.jpg", out[0].name);
+}
+
+TEST_CASE("Picture index pages", "[kk_imgproc]")
+{
+    pic_index_entry_t e, out[4];
+    make_day_dir();
+    write_file(TEST_DAY_DIR, "000.jpg", 10);
+    for (int i = 0; i < 10; i++) {
+        e = make_entry(i);
+        pic_index_append(TEST_DAY_DIR, &e, "th");
+    }
+    // pages of 4 as send_picture_index() reads them
+    uint32_t cursor = 0;
+    int pages = 0;
+    size_t n;
+    while ((n = pic_index_read(TEST_DAY_DIR, cursor, out, 4)) > 0) {
+        e = make_entry(cursor);
+        TEST_ASSERT_EQUAL_STRING(e.name, out[0].name);
+        cursor += n;
+        pages++;
+    }
+    TEST_ASSERT_EQUAL(10, cursor);
+    TEST_ASSERT_EQUAL(3, pages);
+    TEST_ASSERT_EQUAL(0, pic_index_read(TEST_DAY_DIR, 100, out, 4));
+    TEST_ASSERT_EQUAL(0, pic_index_read(TEST_FS_ROOT "/nonexistent", 0, out, 4));
+}
+
+TEST_CASE("Picture index is rebuilt from directory", "[kk_imgproc]")
+{
+    pic_index_entry_t out[8];
+    make_day_dir();
+    write_file(TEST_DAY_DIR, "000.jpg", 100);
+    write_file(TEST_DAY_DIR, "001.jpg", 200);
+    write_file(TEST_DAY_DIR, "002.jpg", 300);
+    write_file(TEST_DAY_DIR "/th", "001.jpg", 10);
+    write_file(TEST_DAY_DIR, "notes.txt", 10);
+    write_file(TEST_DAY_DIR, "very_long_name.jpg", 10);
+
+    // scan goes aside, index in use is replaced only by install
+    TEST_ASSERT_EQUAL(3, pic_index_scan(TEST_DAY_DIR, "th", PIC_INDEX_SCAN_NAME));
+    TEST_ASSERT_EQUAL(-1, pic_index_count(TEST_DAY_DIR));
+    TEST_ASSERT_TRUE(pic_index_install(TEST_DAY_DIR, PIC_INDEX_SCAN_NAME));
+    TEST_ASSERT_EQUAL(3, pic_index_count(TEST_DAY_DIR));
+    TEST_ASSERT_FALSE(pic_index_install(TEST_DAY_DIR, PIC_INDEX_SCAN_NAME));
+    TEST_ASSERT_EQUAL(3, pic_index_count(TEST_DAY_DIR));
+
+    write_file(TEST_DAY_DIR, "003.jpg", 400);
+    TEST_ASSERT_EQUAL(4, pic_index_build(TEST_DAY_DIR, "th"));
+    TEST_ASSERT_EQUAL(4, pic_index_read(TEST_DAY_DIR, 0, out, 8));
+    // directory order is not defined, every picture is there once
+    int seen = 0;
+    for (int i = 0; i < 4; i++) {
+        int no = atoi(out[i].name);
+        TEST_ASSERT_TRUE(no >= 0 && no < 4);
+        seen |= 1 << no;
+        TEST_ASSERT_EQUAL_UINT32((no + 1) * 100, out[i].size);
+        TEST_ASSERT_EQUAL_UINT32(no == 1 ? PIC_INDEX_THUMB : 0, out[i].flags);
+        TEST_ASSERT_TRUE(out[i].time > 0);
+    }
+    TEST_ASSERT_EQUAL(0xF, seen);
+    TEST_ASSERT_EQUAL(-1, pic_index_build(TEST_FS_ROOT "/nonexistent", "th"));
+}
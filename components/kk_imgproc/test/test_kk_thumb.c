@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+
+#include "kk_imgproc.h"
+
+// plain C only, builds for the target and in host_test (picture is linked in by both)
+
+extern const uint8_t thumb_src_start[] asm("_binary_thumb_src_jpeg_start");
+extern const uint8_t thumb_src_end[]   asm("_binary_thumb_src_jpeg_end");
+
+#define THUMB_SRC_W 480
+#define THUMB_SRC_H 320
+
+TEST_CASE("Thumbnail has scaled size and decodes back", "[kk_imgproc]")
+{
+    const size_t n = (THUMB_SRC_W / 8) * (THUMB_SRC_H / 8);
+    size_t len = thumb_src_end - thumb_src_start;
+    uint8_t *thumb = NULL;
+    size_t thumb_len = 0;
+    TEST_ASSERT_TRUE(jpg2thumb(thumb_src_start, len, JPG_SCALE_8X, THUMB_QUALITY, &thumb, &thumb_len));
+    TEST_ASSERT_NOT_NULL(thumb);
+    TEST_ASSERT_TRUE(thumb_len > 0);
+    TEST_ASSERT_TRUE(thumb_len < len);
+
+    // thumbnail looks like the source decoded at the same scale, up to loss of re-encoding
+    // (about 6 gray levels on average at THUMB_QUALITY)
+    uint8_t *ref = malloc(n);
+    uint8_t *cur = malloc(n);
+    TEST_ASSERT_NOT_NULL(ref);
+    TEST_ASSERT_NOT_NULL(cur);
+    uint16_t w = 0, h = 0;
+    TEST_ASSERT_TRUE(jpg2gray(thumb_src_start, len, JPG_SCALE_8X, ref, n, &w, &h));
+    TEST_ASSERT_TRUE(jpg2gray(thumb, thumb_len, JPG_SCALE_NONE, cur, n, &w, &h));
+    TEST_ASSERT_EQUAL(THUMB_SRC_W / 8, w);
+    TEST_ASSERT_EQUAL(THUMB_SRC_H / 8, h);
+    TEST_ASSERT_TRUE(gray_mad_q8(cur, ref, n) < CHANGE_Q8(8));
+    printf("thumbnail: %d x %d, %u B\n", w, h, (unsigned)thumb_len);
+    free(ref);
+    free(cur);
+    free(thumb);
+}
+
+TEST_CASE("Thumbnail decode-scale-encode performance test", "[kk_imgproc]")
+{
+    const jpg_scale_t scales[] = {JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X};
+    const size_t times = 8;
+    size_t len = thumb_src_end - thumb_src_start;
+
+    printf("Thumbnail Result (source %d x %d, %u B)\n", THUMB_SRC_W, THUMB_SRC_H, (unsigned)len);
+    printf("scale ,  thumbnail ,  size B ,  t ms \n");
+    for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+        uint8_t *thumb = NULL;
+        size_t thumb_len = 0;
+        clock_t t_total = 0;
+        for (size_t i = 0; i < times; i++) {
+            clock_t start = clock();
+            TEST_ASSERT_TRUE(jpg2thumb(thumb_src_start, len, scales[s], THUMB_QUALITY, &thumb, &thumb_len));
+            t_total += clock() - start;
+            free(thumb);
+        }
+        printf(" 1/%d  , %4d x %4d , %7u , %5.2f \n", 1 << scales[s],
+               THUMB_SRC_W >> scales[s], THUMB_SRC_H >> scales[s], (unsigned)thumb_len,
+               (double)t_total * 1000 / CLOCKS_PER_SEC / times);
+    }
+    printf("----------------------------------------------------------------------------------------\n");
+}
@@ -0,0 +1,158 @@
+/*
+ * kk_metrics.c
+ *
+ *  Hot path (metric_add, metric_observe_us) is a couple of relaxed atomic adds, there are
+ *  no locks. Histogram buckets are kept non-cumulative and summed up by the writer, so
+ *  +Inf bucket always equals _count even if scrape interleaves with observations.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "kk_metrics.h"
+
+/**
+ * @brief Counts one observation
+ * @param h histogram
+ * @param us observed time in microseconds
+ */
+void metric_observe_us(metric_histogram_t *h, uint32_t us){
+  uint8_t i = 0;
+  while(i < h->n && us > h->bounds[i]){
+    i++;
+  }
+  __atomic_fetch_add(&h->buckets[i], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&h->sum_us, us, __ATOMIC_RELAXED);
+}
+
+static void flush_buf(metrics_writer_t *w){
+  if(w->len > 0 && !w->failed && !w->flush(w->ctx, w->buf, w->len)){
+    w->failed = true;
+  }
+  w->len = 0;
+}
+
+/**
+ * @brief Initializes writer
+ * @param w writer
+ * @param buf buffer for formatting, must hold the longest line
+ * @param size size of the buffer
+ * @param flush called with full buffer (and the rest by metrics_finish()), returns false on error
+ * @param ctx context passed to flush
+ */
+void metrics_writer_init(metrics_writer_t *w, char *buf, size_t size, metrics_flush_fn flush, void *ctx){
+  w->buf = buf;
+  w->size = size;
+  w->len = 0;
+  w->flush = flush;
+  w->ctx = ctx;
+  w->failed = false;
+}
+
+/**
+ * @brief Appends formatted text, buffer is flushed first if the text does not fit
+ *        Text longer than the whole buffer fails the writer.
+ * @param w writer
+ * @param fmt printf format
+ */
+void metrics_printf(metrics_writer_t *w, const char *fmt, ...){
+  va_list ap;
+  for(int attempt = 0; attempt < 2 && !w->failed; attempt++){
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, ap);
+    va_end(ap);
+    if(n < 0){
+      break;
+    }
+    if((size_t)n < w->size - w->len){
+      w->len += n;
+      return;
+    }
+    flush_buf(w);
+  }
+  w->failed = true;
+}
+
+/**
+ * @brief Writes HELP and TYPE lines of metric family, they precede its samples
+ * @param w writer
+ * @param name name of the metric (counters end with _total)
+ * @param type counter, gauge or histogram
+ * @param help description
+ */
+void metrics_family(metrics_writer_t *w, const char *name, const char *type, const char *help){
+  metrics_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * @brief Writes sample with floating point value
+ * @param w writer
+ * @param name name of the metric
+ * @param labels label set without braces, e.g. task="IDLE0", NULL for none
+ * @param value value
+ */
+void metrics_value(metrics_writer_t *w, const char *name, const char *labels, double value){
+  if(labels){
+    metrics_printf(w, "%s{%s} %.6g\n", name, labels, value);
+  }else{
+    metrics_printf(w, "%s %.6g\n", name, value);
+  }
+}
+
+/**
+ * @brief Writes sample with integer value (counters, bytes)
+ * @param w writer
+ * @param name name of the metric
+ * @param labels label set without braces, NULL for none
+ * @param value value
+ */
+void metrics_uint(metrics_writer_t *w, const char *name, const char *labels, uint64_t value){
+  if(labels){
+    metrics_printf(w, "%s{%s} %llu\n", name, labels, (unsigned long long)value);
+  }else{
+    metrics_printf(w, "%s %llu\n", name, (unsigned long long)value);
+  }
+}
+
+/**
+ * @brief Writes buckets (cumulative, bounds in seconds), sum and count of the histogram
+ * @param w writer
+ * @param name name of the metric (without _bucket suffix)
+ * @param labels label set without braces, NULL for none
+ * @param h histogram
+ */
+void metrics_histogram(metrics_writer_t *w, const char *name, const char *labels, const metric_histogram_t *h){
+  const char *sep = labels ? "," : "";
+  uint32_t count = 0;
+  if(!labels){
+    labels = "";
+  }
+  for(uint8_t i = 0; i <= h->n; i++){
+    count += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    if(i < h->n){
+      metrics_printf(w, "%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, sep, h->bounds[i] / 1e6, (unsigned)count);
+    }else{
+      metrics_printf(w, "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep, (unsigned)count);
+    }
+  }
+  uint32_t sum_us = __atomic_load_n(&h->sum_us, __ATOMIC_RELAXED);
+  if(*labels){
+    metrics_printf(w, "%s_sum{%s} %u.%06u\n%s_count{%s} %u\n", name, labels, (unsigned)(sum_us / 1000000),
+                   (unsigned)(sum_us % 1000000), name, labels, (unsigned)count);
+  }else{
+    metrics_printf(w, "%s_sum %u.%06u\n%s_count %u\n", name, (unsigned)(sum_us / 1000000),
+                   (unsigned)(sum_us % 1000000), name, (unsigned)count);
+  }
+}
+
+/**
+ * @brief Flushes the rest of the output
+ * @param w writer
+ * @return true if whole output was flushed
+ */
+bool metrics_finish(metrics_writer_t *w){
+  flush_buf(w);
+  return !w->failed;
+}
@@ -0,0 +1,75 @@
+/*
+ * kk_metrics.h
+ *
+ *  Counters and latency histograms updated lock-free (relaxed atomics) from any task,
+ *  and writer of Prometheus text exposition format. Writer formats into a small buffer
+ *  and hands full buffers to flush callback (e.g. chunk of HTTP response), so whole
+ *  output never has to fit in memory.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_METRICS_KK_METRICS_H_
+#define COMPONENTS_KK_METRICS_KK_METRICS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define METRICS_HIST_MAX_BOUNDS  12
+
+typedef uint32_t metric_counter_t;
+
+typedef struct {
+  const uint32_t *bounds;             //ascending upper bounds of buckets in microseconds
+  uint8_t n;                          //number of bounds (at most METRICS_HIST_MAX_BOUNDS)
+  uint32_t buckets[METRICS_HIST_MAX_BOUNDS + 1];  //observations per bucket (not cumulative), last one is +Inf
+  uint32_t sum_us;                    //wraps after ~71 minutes of total observed time, taken as counter reset
+} metric_histogram_t;
+
+//Static initializer of histogram with given array of bounds
+#define METRIC_HISTOGRAM_INIT(b) { (b), (uint8_t)(sizeof(b) / sizeof((b)[0])), {0}, 0 }
+
+typedef bool (*metrics_flush_fn)(void *ctx, const char *buf, size_t len);
+
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t len;                         //bytes waiting in buf
+  metrics_flush_fn flush;
+  void *ctx;
+  bool failed;                        //flush failed, rest of output is dropped
+} metrics_writer_t;
+
+static inline void metric_add(metric_counter_t *c, uint32_t n){
+  __atomic_fetch_add(c, n, __ATOMIC_RELAXED);
+}
+
+static inline void metric_inc(metric_counter_t *c){
+  __atomic_fetch_add(c, 1, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t metric_get(const metric_counter_t *c){
+  return __atomic_load_n(c, __ATOMIC_RELAXED);
+}
+
+void metric_observe_us(metric_histogram_t *h, uint32_t us);
+
+void metrics_writer_init(metrics_writer_t *w, char *buf, size_t size, metrics_flush_fn flush, void *ctx);
+void metrics_printf(metrics_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void metrics_family(metrics_writer_t *w, const char *name, const char *type, const char *help);
+void metrics_value(metrics_writer_t *w, const char *name, const char *labels, double value);
+void metrics_uint(metrics_writer_t *w, const char *name, const char *labels, uint64_t value);
+void metrics_histogram(metrics_writer_t *w, const char *name, const char *labels, const metric_histogram_t *h);
+bool metrics_finish(metrics_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_METRICS_KK_METRICS_H_ */
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#include "kk_metrics.h"
+
+static char s_out[1024];
+static size_t s_out_len;
+static int s_flushes;
+static int s_flush_limit;      //flushes allowed, simulates closed connection
+
+static bool test_flush(void *ctx, const char *buf, size_t len)
+{
+    if (s_flushes >= s_flush_limit) {
+        return false;
+    }
+    s_flushes++;
+    memcpy(s_out + s_out_len, buf, len);
+    s_out_len += len;
+    s_out[s_out_len] = 0;
+    return true;
+}
+
+static void reset_output(int flush_limit)
+{
+    s_out[0] = 0;
+    s_out_len = 0;
+    s_flushes = 0;
+    s_flush_limit = flush_limit;
+}
+
+static const uint32_t s_bounds[] = {1000, 10000, 100000};
+
+TEST_CASE("Histogram observations land in buckets", "[kk_metrics]")
+{
+    metric_histogram_t h = METRIC_HISTOGRAM_INIT(s_bounds);
+    TEST_ASSERT_EQUAL(3, h.n);
+    metric_observe_us(&h, 0);
+    metric_observe_us(&h, 1000);     // bounds are inclusive
+    metric_observe_us(&h, 1001);
+    metric_observe_us(&h, 100000);
+    metric_observe_us(&h, 2000000);
+    TEST_ASSERT_EQUAL(2, h.buckets[0]);
+    TEST_ASSERT_EQUAL(1, h.buckets[1]);
+    TEST_ASSERT_EQUAL(1, h.buckets[2]);
+    TEST_ASSERT_EQUAL(1, h.buckets[3]);
+    TEST_ASSERT_EQUAL(2102001, h.sum_us);
+
+    metric_counter_t c = 0;
+    metric_inc(&c);
+    metric_add(&c, 4);
+    TEST_ASSERT_EQUAL(5, metric_get(&c));
+}
+
+TEST_CASE("Metrics are written in Prometheus text format", "[kk_metrics]")
+{
+    char buf[128];
+    metrics_writer_t w;
+    metric_histogram_t h = METRIC_HISTOGRAM_INIT(s_bounds);
+    metric_observe_us(&h, 500);
+    metric_observe_us(&h, 50000);
+    reset_output(100);
+    metrics_writer_init(&w, buf, sizeof(buf), test_flush, NULL);
+
+    metrics_family(&w, "kk_requests_total", "counter", "Requests handled.");
+    metrics_uint(&w, "kk_requests_total", "route=\"data\"", 7);
+    metrics_value(&w, "kk_rssi_dbm", NULL, -67);
+    metrics_histogram(&w, "kk_read_seconds", "sensor=\"bh1750\"", &h);
+    metrics_histogram(&w, "kk_idle_seconds", NULL, &h);
+    TEST_ASSERT_TRUE(metrics_finish(&w));
+    TEST_ASSERT_TRUE(s_flushes > 1);     // output is larger than the buffer
+    TEST_ASSERT_EQUAL_STRING(
+        "# HELP kk_requests_total Requests handled.\n"
+        "# TYPE kk_requests_total counter\n"
+        "kk_requests_total{route=\"data\"} 7\n"
+        "kk_rssi_dbm -67\n"
+        "kk_read_seconds_bucket{sensor=\"bh1750\",le=\"0.001\"} 1\n"
+        "kk_read_seconds_bucket{sensor=\"bh1750\",le=\"0.01\"} 1\n"
+        "kk_read_seconds_bucket{sensor=\"bh1750\",le=\"0.1\"} 2\n"
+        "kk_read_seconds_bucket{sensor=\"bh1750\",le=\"+Inf\"} 2\n"
+        "kk_read_seconds_sum{sensor=\"bh1750\"} 0.050500\n"
+        "kk_read_seconds_count{sensor=\"bh1750\"} 2\n"
+        "kk_idle_seconds_bucket{le=\"0.001\"} 1\n"
+        "kk_idle_seconds_bucket{le=\"0.01\"} 1\n"
+        "kk_idle_seconds_bucket{le=\"0.1\"} 2\n"
+        "kk_idle_seconds_bucket{le=\"+Inf\"} 2\n"
+        "kk_idle_seconds_sum 0.050500\n"
+        "kk_idle_seconds_count 2\n", s_out);
+}
+
+TEST_CASE("Metrics writer stops on failed flush or too long line", "[kk_metrics]")
+{
+    char buf[64];
+    metrics_writer_t w;
+    reset_output(1);
+    metrics_writer_init(&w, buf, sizeof(buf), test_flush, NULL);
+    for (int i = 0; i < 10; i++) {
+        metrics_uint(&w, "kk_some_long_metric_name_total", NULL, i);
+    }
+    TEST_ASSERT_FALSE(metrics_finish(&w));
+    TEST_ASSERT_EQUAL(1, s_flushes);
+
+    reset_output(100);
+    metrics_writer_init(&w, buf, 16, test_flush, NULL);
+    metrics_uint(&w, "kk_a", NULL, 1);
+    metrics_uint(&w, "kk_some_long_metric_name_total", NULL, 2);
+    metrics_uint(&w, "kk_b", NULL, 3);
+    TEST_ASSERT_FALSE(metrics_finish(&w));
+    TEST_ASSERT_EQUAL_STRING("kk_a 1\n", s_out);
+}
@@ -0,0 +1,177 @@
+/*
+ * kk_series.c
+ *
+ *  Decimation keeps minimum and maximum of every field in fixed time buckets, so peaks
+ *  survive downsampling and samples are processed one by one, as read from the log
+ *  (LTTB would need to keep whole bucket of samples in memory).
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include "kk_series.h"
+
+static const char *s_field_names[SERIES_MAX_FIELDS] = {"int_t", "ext_t", "humi", "sun", "press", "wind"};
+
+/**
+ * @param name field name as in log header (time column excluded)
+ * @return index of the field in parsed line, -1 if unknown
+ */
+int series_field_index(const char *name){
+  for(int i = 0; i < SERIES_MAX_FIELDS; i++){
+    if(strcmp(name, s_field_names[i]) == 0){
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @param index index of the field in parsed line
+ * @return field name, "" for invalid index
+ */
+const char *series_field_name(int index){
+  return (index >= 0 && index < SERIES_MAX_FIELDS) ? s_field_names[index] : "";
+}
+
+/**
+ * @brief Parses decimal number as written by logger (%3.2F) without strtod, which is
+ *        several times slower. Anything else (NAN, INF, garbage) gives NAN.
+ * @param p number start
+ * @param end set to the first character after the field
+ * @return parsed value
+ */
+static float parse_value(const char *p, const char **end){
+  int32_t ip = 0, fp = 0, scale = 1;
+  bool neg = false, digits = false;
+  if(*p == '-'){
+    neg = true;
+    p++;
+  }
+  for(; *p >= '0' && *p <= '9'; p++, digits = true){
+    ip = ip * 10 + (*p - '0');
+  }
+  if(*p == '.'){
+    for(p++; *p >= '0' && *p <= '9'; p++, digits = true){
+      if(scale < 1000000){
+        fp = fp * 10 + (*p - '0');
+        scale *= 10;
+      }
+    }
+  }
+  bool clean = digits && (*p == ',' || *p == '\n' || *p == '\r' || *p == '\0');
+  while(*p != ',' && *p != '\n' && *p != '\0'){
+    p++;
+  }
+  *end = p;
+  if(!clean){
+    return NAN;
+  }
+  float v = (float)ip + (float)fp / (float)scale;
+  return neg ? -v : v;
+}
+
+/**
+ * @brief Parses log line: time,int_t,ext_t,humi,sun,press,wind
+ * @param line log line
+ * @param t time of the sample
+ * @param values parsed values (NAN for fields which can not be parsed)
+ * @param n max number of values to parse
+ * @return number of values parsed, -1 if line has no valid time (i.e. header)
+ */
+int series_parse_line(const char *line, uint32_t *t, float *values, int n){
+  const char *p = line;
+  uint32_t ts = 0;
+  int i;
+  if(*p < '0' || *p > '9'){
+    return -1;
+  }
+  for(; *p >= '0' && *p <= '9'; p++){
+    ts = ts * 10 + (uint32_t)(*p - '0');
+  }
+  if(*p != ','){
+    return -1;
+  }
+  for(i = 0; i < n && *p == ','; i++){
+    values[i] = parse_value(p + 1, &p);
+  }
+  *t = ts;
+  return i;
+}
+
+/**
+ * @brief Prepares decimation of [from, to] into buckets of equal width
+ * @param d decimator
+ * @param from start time
+ * @param to end time (inclusive)
+ * @param points max number of points per series, two of them (min and max) are made of each bucket
+ * @param fields indices of fields to keep (see series_field_index())
+ * @param n number of fields
+ * @param emit called for every non empty bucket
+ * @param ctx passed to emit
+ */
+void series_decim_init(series_decim_t *d, uint32_t from, uint32_t to, uint32_t points,
+                       const uint8_t *fields, uint8_t n, series_emit_fn emit, void *ctx){
+  uint32_t buckets = points / 2 > 0 ? points / 2 : 1;
+  uint64_t span = (uint64_t)(to >= from ? to - from : 0) + 1;
+  memset(d, 0, sizeof(*d));
+  d->from = from;
+  d->to = to;
+  d->step = (uint32_t)((span + buckets - 1) / buckets);
+  d->n = n > SERIES_MAX_FIELDS ? SERIES_MAX_FIELDS : n;
+  memcpy(d->fields, fields, d->n);
+  d->cur = -1;
+  d->emit = emit;
+  d->ctx = ctx;
+}
+
+/**
+ * @brief Takes sample into its bucket. Samples are expected in time order, older one
+ *        arriving late is counted into current bucket. Samples outside of range are skipped.
+ * @param d decimator
+ * @param t time of the sample
+ * @param values all values of parsed line
+ */
+void series_decim_add(series_decim_t *d, uint32_t t, const float *values){
+  if(t < d->from || t > d->to){
+    return;
+  }
+  int32_t bucket = (int32_t)((t - d->from) / d->step);
+  if(bucket > d->cur){
+    series_decim_flush(d);
+    d->cur = bucket;
+    for(uint8_t i = 0; i < d->n; i++){
+      d->min[i] = NAN;
+      d->max[i] = NAN;
+    }
+  }
+  for(uint8_t i = 0; i < d->n; i++){
+    float v = values[d->fields[i]];
+    if(isnan(v)){
+      continue;
+    }
+    if(isnan(d->min[i]) || v < d->min[i]){
+      d->min[i] = v;
+    }
+    if(isnan(d->max[i]) || v > d->max[i]){
+      d->max[i] = v;
+    }
+  }
+  d->samples++;
+}
+
+/**
+ * @brief Emits bucket being collected. Call after the last sample.
+ * @param d decimator
+ */
+void series_decim_flush(series_decim_t *d){
+  if(d->cur < 0){
+    return;
+  }
+  d->emit(d->ctx, d->from + (uint32_t)d->cur * d->step, d->min, d->max, d->n);
+  d->rows++;
+  d->cur = -1;
+}
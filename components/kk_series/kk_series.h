@@ -0,0 +1,53 @@
+/*
+ * kk_series.h
+ *
+ *  Time series of measurement logs: CSV line parsing and min/max bucket decimation
+ *  with constant memory, for serving history charts straight from SD card logs.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_SERIES_KK_SERIES_H_
+#define COMPONENTS_KK_SERIES_KK_SERIES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SERIES_MAX_FIELDS  6     //values in log line after time: int_t,ext_t,humi,sun,press,wind
+
+//called for every non empty bucket, in time order
+typedef void (*series_emit_fn)(void *ctx, uint32_t t, const float *min, const float *max, uint8_t n);
+
+typedef struct {
+  uint32_t from;                      //start of the first bucket
+  uint32_t to;                        //end of the last bucket (inclusive)
+  uint32_t step;                      //bucket width in seconds
+  uint8_t n;                          //number of selected fields
+  uint8_t fields[SERIES_MAX_FIELDS];  //indices of selected fields in parsed line
+  int32_t cur;                        //bucket being collected, -1 if none
+  float min[SERIES_MAX_FIELDS];
+  float max[SERIES_MAX_FIELDS];
+  uint32_t rows;                      //number of emitted buckets
+  uint32_t samples;                   //number of samples taken into buckets
+  series_emit_fn emit;
+  void *ctx;
+} series_decim_t;
+
+int series_field_index(const char *name);
+const char *series_field_name(int index);
+int series_parse_line(const char *line, uint32_t *t, float *values, int n);
+void series_decim_init(series_decim_t *d, uint32_t from, uint32_t to, uint32_t points,
+                       const uint8_t *fields, uint8_t n, series_emit_fn emit, void *ctx);
+void series_decim_add(series_decim_t *d, uint32_t t, const float *values);
+void series_decim_flush(series_decim_t *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_SERIES_KK_SERIES_H_ */
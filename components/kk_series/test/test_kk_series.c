@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "unity.h"
+
+#include "kk_series.h"
+
+typedef struct {
+    uint32_t rows;
+    uint32_t t[8];
+    float min[8];
+    float max[8];
+} emit_log_t;
+
+static void collect(void *ctx, uint32_t t, const float *min, const float *max, uint8_t n)
+{
+    emit_log_t *log = (emit_log_t *)ctx;
+    if (log->rows < 8) {
+        log->t[log->rows] = t;
+        log->min[log->rows] = min[0];
+        log->max[log->rows] = max[0];
+    }
+    log->rows++;
+}
+
+static void count_only(void *ctx, uint32_t t, const float *min, const float *max, uint8_t n)
+{
+    (*(uint32_t *)ctx)++;
+}
+
+TEST_CASE("Log line parsing", "[kk_series]")
+{
+    uint32_t t;
+    float v[SERIES_MAX_FIELDS];
+    TEST_ASSERT_EQUAL(6, series_parse_line("1677600000,24.27,-3.50,34,182.50,998.54,1.250\n", &t, v, SERIES_MAX_FIELDS));
+    TEST_ASSERT_EQUAL(1677600000, t);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 24.27, v[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -3.5, v[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 34, v[2]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 998.54, v[4]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.25, v[5]);
+    TEST_ASSERT_EQUAL(6, series_parse_line("1677600000,NAN,-0.50,0,,998.54,1\r\n", &t, v, SERIES_MAX_FIELDS));
+    TEST_ASSERT_TRUE(isnan(v[0]));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -0.5, v[1]);
+    TEST_ASSERT_TRUE(isnan(v[3]));
+    TEST_ASSERT_EQUAL(2, series_parse_line("1677600000,1.5,2.5", &t, v, SERIES_MAX_FIELDS));
+    TEST_ASSERT_EQUAL(-1, series_parse_line("time,int_t,ext_t,humi,sun,press,wind\n", &t, v, SERIES_MAX_FIELDS));
+    TEST_ASSERT_EQUAL(-1, series_parse_line("", &t, v, SERIES_MAX_FIELDS));
+    TEST_ASSERT_EQUAL(1, series_field_index("ext_t"));
+    TEST_ASSERT_EQUAL(-1, series_field_index("time"));
+    TEST_ASSERT_EQUAL_STRING("wind", series_field_name(5));
+}
+
+TEST_CASE("Min/max bucket decimation", "[kk_series]")
+{
+    series_decim_t d;
+    emit_log_t log = {0};
+    const uint8_t fields[] = {1};
+    float v[SERIES_MAX_FIELDS] = {0};
+
+    // 100 s into 4 points = 2 buckets of 50 s
+    series_decim_init(&d, 1000, 1099, 4, fields, 1, collect, &log);
+    TEST_ASSERT_EQUAL(50, d.step);
+    v[1] = 5;    series_decim_add(&d, 999, v);     // before range
+    v[1] = 3;    series_decim_add(&d, 1000, v);
+    v[1] = -2;   series_decim_add(&d, 1020, v);
+    v[1] = NAN;  series_decim_add(&d, 1030, v);    // unparsable value does not spoil the bucket
+    v[1] = 7;    series_decim_add(&d, 1049, v);
+    v[1] = 1;    series_decim_add(&d, 1050, v);
+    v[1] = 9;    series_decim_add(&d, 1040, v);    // late sample goes to current bucket
+    v[1] = 100;  series_decim_add(&d, 1100, v);    // after range
+    series_decim_flush(&d);
+
+    TEST_ASSERT_EQUAL(2, log.rows);
+    TEST_ASSERT_EQUAL(1000, log.t[0]);
+    TEST_ASSERT_EQUAL(-2, log.min[0]);
+    TEST_ASSERT_EQUAL(7, log.max[0]);
+    TEST_ASSERT_EQUAL(1050, log.t[1]);
+    TEST_ASSERT_EQUAL(1, log.min[1]);
+    TEST_ASSERT_EQUAL(9, log.max[1]);
+    TEST_ASSERT_EQUAL(6, d.samples);
+
+    // gap in data makes no rows, range shorter than points makes 1 s buckets
+    memset(&log, 0, sizeof(log));
+    series_decim_init(&d, 0, 9, 1000, fields, 1, collect, &log);
+    TEST_ASSERT_EQUAL(1, d.step);
+    series_decim_add(&d, 2, v);
+    series_decim_add(&d, 8, v);
+    series_decim_flush(&d);
+    TEST_ASSERT_EQUAL(2, log.rows);
+}
+
+/**
+ * Log of `lines` samples `step` seconds apart, as written by the logger
+ */
+static char *make_log(uint32_t lines, uint32_t step, size_t *len)
+{
+    char *log = (char *)malloc(lines * 48 + 1);
+    size_t pos = 0;
+    TEST_ASSERT_NOT_NULL(log);
+    for (uint32_t i = 0; i < lines; i++) {
+        pos += sprintf(log + pos, "%u,%3.2F,%3.2F,%d,%5.2F,%4.2f,%3.3f\n", 1677600000 + i * step,
+                       20.0 + (i % 500) / 100.0, -5.0 + (i % 900) / 50.0, (int)(30 + i % 40),
+                       (i % 7000) * 1.5, 990.0 + (i % 300) / 10.0, (i % 100) / 20.0);
+    }
+    *len = pos;
+    return log;
+}
+
+/**
+ * Parses and decimates the log `repeat` times (as consecutive blocks of time)
+ * @return number of samples taken
+ */
+static uint32_t decimate_log(const char *log, uint32_t block_s, uint32_t repeat, uint32_t span_s, uint32_t *rows)
+{
+    series_decim_t d;
+    const uint8_t fields[] = {0, 1, 2, 3, 4, 5};
+    float v[SERIES_MAX_FIELDS];
+    uint32_t t;
+    series_decim_init(&d, 1677600000, 1677600000 + span_s - 1, 500, fields, 6, count_only, rows);
+    for (uint32_t r = 0; r < repeat; r++) {
+        for (const char *p = log; *p; p = strchr(p, '\n') + 1) {
+            if (series_parse_line(p, &t, v, SERIES_MAX_FIELDS) > 0) {
+                series_decim_add(&d, t + r * block_s, v);
+            }
+        }
+    }
+    series_decim_flush(&d);
+    return d.samples;
+}
+
+TEST_CASE("Series decimation performance", "[kk_series]")
+{
+    size_t len;
+    uint32_t rows;
+    clock_t start;
+
+    // raw log, one sample per second, replayed in one hour blocks
+    char *log = make_log(3600, 1, &len);
+    rows = 0;
+    start = clock();
+    TEST_ASSERT_EQUAL(86400, decimate_log(log, 3600, 24, 86400, &rows));
+    printf("raw day:  86400 samples (%u kB) -> %u rows in %ld ms\n", (unsigned)(len * 24 / 1024), rows,
+           (long)((clock() - start) * 1000 / CLOCKS_PER_SEC));
+    TEST_ASSERT_EQUAL(250, rows);
+    rows = 0;
+    start = clock();
+    TEST_ASSERT_EQUAL(604800, decimate_log(log, 3600, 24 * 7, 7 * 86400, &rows));
+    printf("raw week: 604800 samples (%u kB) -> %u rows in %ld ms\n", (unsigned)(len * 24 * 7 / 1024), rows,
+           (long)((clock() - start) * 1000 / CLOCKS_PER_SEC));
+    TEST_ASSERT_EQUAL(250, rows);
+    free(log);
+
+    // averaged log (rollup), one sample per minute
+    log = make_log(1440, 60, &len);
+    rows = 0;
+    start = clock();
+    TEST_ASSERT_EQUAL(10080, decimate_log(log, 86400, 7, 7 * 86400, &rows));
+    printf("avg week: 10080 samples (%u kB) -> %u rows in %ld ms\n", (unsigned)(len * 7 / 1024), rows,
+           (long)((clock() - start) * 1000 / CLOCKS_PER_SEC));
+    TEST_ASSERT_EQUAL(250, rows);
+    free(log);
+}
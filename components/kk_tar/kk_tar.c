@@ -0,0 +1,75 @@
+/*
+ * kk_tar.c
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "kk_tar.h"
+
+#define TAR_NAME_LEN    100
+#define TAR_PREFIX_LEN  155
+
+/**
+ * Writes zero terminated octal number filling the field
+ */
+static void put_octal(uint8_t *field, size_t len, uint32_t value){
+  snprintf((char *)field, len, "%0*o", (int)(len - 1), (unsigned)value);
+}
+
+/**
+ * @brief Fills header block of an entry. Names longer than 100 characters are split
+ *        at a slash into prefix and name fields.
+ * @param block output, TAR_BLOCK_SIZE bytes
+ * @param name path of the entry in archive (relative, directories end with slash)
+ * @param size size of file data, 0 for directories
+ * @param mtime modification time (unix time)
+ * @param type TAR_TYPE_FILE or TAR_TYPE_DIR
+ * @return false if the name does not fit the header
+ */
+bool tar_header(uint8_t *block, const char *name, uint32_t size, uint32_t mtime, char type){
+  size_t len = strlen(name);
+  const char *base = name;
+  memset(block, 0, TAR_BLOCK_SIZE);
+  if(len > TAR_NAME_LEN){
+    //split at the first slash leaving name part that fits, prefix is everything before it
+    base = NULL;
+    for(const char *s = strchr(name, '/'); s != NULL; s = strchr(s + 1, '/')){
+      if(len - (size_t)(s + 1 - name) <= TAR_NAME_LEN && s[1] != '\0'){
+        base = s + 1;
+        break;
+      }
+    }
+    if(base == NULL || (size_t)(base - 1 - name) > TAR_PREFIX_LEN){
+      return false;
+    }
+    memcpy(block + 345, name, base - 1 - name);
+  }
+  memcpy(block, base, strlen(base));
+  put_octal(block + 100, 8, type == TAR_TYPE_DIR ? 0755 : 0644);   //mode
+  put_octal(block + 108, 8, 0);                                    //uid
+  put_octal(block + 116, 8, 0);                                    //gid
+  put_octal(block + 124, 12, size);
+  put_octal(block + 136, 12, mtime);
+  block[156] = type;
+  memcpy(block + 257, "ustar", 6);
+  memcpy(block + 263, "00", 2);
+  //checksum is counted with its own field filled with spaces
+  memset(block + 148, ' ', 8);
+  uint32_t sum = 0;
+  for(int i = 0; i < TAR_BLOCK_SIZE; i++){
+    sum += block[i];
+  }
+  put_octal(block + 148, 7, sum);
+  return true;
+}
+
+/**
+ * @param size size of file data
+ * @return number of zero bytes following the data up to block size
+ */
+size_t tar_padding(uint32_t size){
+  return (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+}
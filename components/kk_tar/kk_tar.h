@@ -0,0 +1,35 @@
+/*
+ * kk_tar.h
+ *
+ *  Headers of ustar archive entries, for tar streams built on the fly (no archive is
+ *  ever stored). Entry is header block, data and zero padding to block size, archive
+ *  ends with TAR_END_BLOCKS zero blocks.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef COMPONENTS_KK_TAR_KK_TAR_H_
+#define COMPONENTS_KK_TAR_KK_TAR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TAR_BLOCK_SIZE  512
+#define TAR_END_BLOCKS  2
+#define TAR_TYPE_FILE   '0'
+#define TAR_TYPE_DIR    '5'
+
+bool tar_header(uint8_t *block, const char *name, uint32_t size, uint32_t mtime, char type);
+size_t tar_padding(uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_KK_TAR_KK_TAR_H_ */
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#include "kk_tar.h"
+
+static uint32_t checksum(const uint8_t *block)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : block[i];
+    }
+    return sum;
+}
+
+TEST_CASE("Tar header fields and checksum", "[kk_tar]")
+{
+    uint8_t block[TAR_BLOCK_SIZE];
+    TEST_ASSERT_TRUE(tar_header(block, "www/logs/191026.CSV", 1234, 1792454400, TAR_TYPE_FILE));
+    TEST_ASSERT_EQUAL_STRING("www/logs/191026.CSV", (char *)block);
+    TEST_ASSERT_EQUAL_STRING("0000644", (char *)block + 100);
+    TEST_ASSERT_EQUAL_STRING("00000002322", (char *)block + 124);
+    TEST_ASSERT_EQUAL(1792454400, strtoul((char *)block + 136, NULL, 8));
+    TEST_ASSERT_EQUAL(TAR_TYPE_FILE, block[156]);
+    TEST_ASSERT_EQUAL_STRING("ustar", (char *)block + 257);
+    TEST_ASSERT_EQUAL('0', block[263]);
+    TEST_ASSERT_EQUAL(0, block[345]);
+    TEST_ASSERT_EQUAL(checksum(block), strtoul((char *)block + 148, NULL, 8));
+    TEST_ASSERT_EQUAL(' ', block[155]);
+
+    TEST_ASSERT_TRUE(tar_header(block, "www/", 0, 0, TAR_TYPE_DIR));
+    TEST_ASSERT_EQUAL_STRING("0000755", (char *)block + 100);
+    TEST_ASSERT_EQUAL(TAR_TYPE_DIR, block[156]);
+    TEST_ASSERT_EQUAL(checksum(block), strtoul((char *)block + 148, NULL, 8));
+}
+
+TEST_CASE("Tar header splits long names", "[kk_tar]")
+{
+    uint8_t block[TAR_BLOCK_SIZE];
+    char name[300];
+    // 120 characters: directory of 100, slash, file of 19
+    memset(name, 'd', 100);
+    strcpy(name + 100, "/www/logs/191026.CSV");
+    TEST_ASSERT_TRUE(tar_header(block, name, 1, 0, TAR_TYPE_FILE));
+    TEST_ASSERT_EQUAL_STRING("www/logs/191026.CSV", (char *)block);
+    TEST_ASSERT_EQUAL(100, strlen((char *)block + 345));
+
+    // no slash leaves name part short enough
+    memset(name, 'f', 120);
+    name[120] = 0;
+    TEST_ASSERT_FALSE(tar_header(block, name, 1, 0, TAR_TYPE_FILE));
+
+    TEST_ASSERT_EQUAL(0, tar_padding(0));
+    TEST_ASSERT_EQUAL(511, tar_padding(1));
+    TEST_ASSERT_EQUAL(0, tar_padding(1024));
+}
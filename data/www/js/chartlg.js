@@ -35,7 +35,12 @@ function fetch_logs_date_callback(){
 	var date, filename;
 	date = $('#datepicker').val();
 	filename= date.split('-').join('')+'.CSV';
-	FetchCSVLog(filename);
+	if ($('#precise_logs').is(":checked")){
+		var parts = date.split("-");
+		FetchDaySeries(new Date(2000 + parseInt(parts[2]), parts[1] - 1, parts[0]));
+	}else{
+		FetchCSVLog(filename);
+	}
 	addLoader();
 	closeError();
 }
@@ -52,7 +57,7 @@ function fetch_picture_list_callback(){
 }
 
 function fetch_picture_list_for(date){
-	FetchPicList('pic_list/?'+ format_date(date));
+	FetchPicList(format_date(date), 0);
 }
 
 
@@ -328,9 +333,14 @@ function resolve_path(){
 }
 
 //Fething CSV Log by index
+//high resolution day is decimated on the station instead of downloading whole raw log
 function SwitchCSVLog(log_index){
 	log_name = resolve_log_name_by(log_index, 'CSV')
-	FetchCSVLog(log_name);
+	if ($('#precise_logs').is(":checked")){
+		FetchDaySeries(new Date((new Date()).valueOf() - a_day * log_index));
+	}else{
+		FetchCSVLog(log_name);
+	}
 	$(".btn").attr("disabled", false);
 	$("#button"+log_index).attr("disabled", true);
 	var date = log_index == 0 ? new Date : yesterdayDate();
@@ -344,6 +354,16 @@ function yesterdayDate(){
 	return new Date(date.setDate(date.getDate()-1));
 }
 
+//Fetching last week, decimated on the station
+function SwitchWeek(){
+	var to = Math.floor(Date.now() / 1000);
+	FetchSeries(to - 7 * 86400 + 1, to, 1000, "auto");
+	$(".btn").attr("disabled", false);
+	$("#button7").attr("disabled", true);
+	addLoader();
+	closeError();
+}
+
 //Fething JS Log by index
 function SwitchJSLog(log_index){
 	log_name = resolve_log_name_by(log_index, 'JSO')
@@ -369,18 +389,32 @@ var config = {
 	dynamicTyping: true
 }
 
-//fetch log from weather station
-function FetchPicList(path){
-  var xmlhttp, path;
+//fetch list of pictures of the day from weather station, page by page
+function FetchPicList(date, cursor){
+  var xmlhttp;
   if (window.XMLHttpRequest){ xmlhttp = new XMLHttpRequest();  }
   else { xmlhttp = new ActiveXObject("Microsoft.XMLHTTP"); }
   xmlhttp.onreadystatechange = function() {
     if (xmlhttp.readyState == 4 && xmlhttp.status == 200){
-		newPicList = document.createElement('ol');
-		newPicList.innerHTML = xmlhttp.responseText;
-		oldPicList = document.getElementById("pic_list");
-		oldPicList.parentNode.replaceChild(newPicList, oldPicList);
+		var page = JSON.parse(xmlhttp.responseText);
+		var picList = document.getElementById("pic_list");
+		if (cursor == 0){
+			newPicList = document.createElement('ol');
+			newPicList.id = "pic_list";
+			picList.parentNode.replaceChild(newPicList, picList);
+			newPicList.addEventListener("mouseover", FetchPicMeta);
+			picList = newPicList;
+		}
+		page.pictures.forEach(function(pic){ picList.appendChild(PicListItem(pic)); });
+		if (page.next !== null){
+			FetchPicList(date, page.next);
+			return;
+		}
 		removeLoader();
+		if (page.total == 0){
+			displayError("Can not find any pictures.");
+			return;
+		}
 		displaySuccess("Picture list loaded successfully!");
 		displayLogErrors();
 		setTimeout('closeBar()',5000);
@@ -389,18 +423,72 @@ function FetchPicList(path){
       displayError("Can not find any pictures.");
     }
   }
-  xmlhttp.open("GET", myIPaddress + path, true);
+  xmlhttp.open("GET", myIPaddress + "data/pictures?date=" + date + "&cursor=" + cursor, true);
+  xmlhttp.send();
+}
+//list item with link to the picture (thumbnail if there is one) and its time
+function PicListItem(pic){
+  var item = document.createElement('li');
+  var link = document.createElement('a');
+  link.href = pic.url;
+  if (pic.thumb){
+    var img = document.createElement('img');
+    img.src = pic.thumb;
+    img.loading = "lazy";
+    img.alt = pic.name;
+    link.appendChild(img);
+  }else{
+    link.textContent = pic.name;
+  }
+  item.appendChild(link);
+  var t = new Date(pic.mtime * 1000);
+  item.appendChild(document.createTextNode(" - " + t.toLocaleString()));
+  return item;
+}
+//show measurements stored in the picture as tooltip of its link
+function FetchPicMeta(event){
+  var link = event.target.closest("a");
+  if (!link || link.title || link.getAttribute("href").indexOf("dcim/") != 0) { return; }
+  link.title = "...";
+  var xmlhttp = new XMLHttpRequest();
+  xmlhttp.onreadystatechange = function() {
+    if (xmlhttp.readyState == 4 && xmlhttp.status == 200){
+      var m = JSON.parse(xmlhttp.responseText);
+      link.title = "Int: " + m.int_t + " °C, Ext: " + m.ext_t + " °C, Humi: " + m.humi + " %, Press: "
+                 + m.press + " hPa, Sun: " + m.sun + " lx, Wind: " + m.wind + " km/h";
+    }else if(xmlhttp.readyState == 4){
+      link.title = "No measurements stored";
+    }
+  }
+  xmlhttp.open("GET", myIPaddress + "data/picture_meta.json?" + link.getAttribute("href").replace(/^dcim\//, ""), true);
   xmlhttp.send();
 }
+
 var result;
+//today's log as fetched so far (complete lines only); refresh asks only for bytes appended since
+var csvTail = {url: null, text: ""};
 //fetch log from weather station
 function FetchCSVLog(log_fname){
-  var xmlhttp, path;
+  var xmlhttp, path, url, offset;
   if (window.XMLHttpRequest){ xmlhttp = new XMLHttpRequest();  }
   else { xmlhttp = new ActiveXObject("Microsoft.XMLHTTP"); }
+  path = resolve_path();
+  url = myIPaddress + path + log_fname;
+  //logs are plain ASCII, so string length equals byte count
+  offset = (log_fname.indexOf('CURRENT') == 0 && csvTail.url == url) ? csvTail.text.length : 0;
   xmlhttp.onreadystatechange = function() {
-    if (xmlhttp.readyState == 4 && xmlhttp.status == 200){
-		response = xmlhttp.responseText;
+    if (xmlhttp.readyState == 4 && (xmlhttp.status == 200 || xmlhttp.status == 206 || xmlhttp.status == 416)){
+		if (xmlhttp.status == 200){
+			response = xmlhttp.responseText;
+		}else if (xmlhttp.status == 206 && xmlhttp.responseText[0] == '\n'){
+			response = csvTail.text + xmlhttp.responseText.slice(1);   //first byte overlaps last one we have
+		}else{
+			csvTail.url = null;                                          //log rotated (416 or no overlap), fetch it whole
+			FetchCSVLog(log_fname);
+			return;
+		}
+		csvTail.url = url;
+		csvTail.text = response.slice(0, response.lastIndexOf('\n') + 1);
 		dataSet = Papa.parse(response, config).data;
 		addDataPoints(dataSet);
 		chart1.render();
@@ -418,8 +506,48 @@ function FetchCSVLog(log_fname){
       displayError("Can not find that log file. Choose another one.");
     }
   }
-  path = resolve_path();
-  xmlhttp.open("GET", myIPaddress + path + log_fname, true);
+  xmlhttp.open("GET", url, true);
+  if (offset > 0){
+    xmlhttp.setRequestHeader("Range", "bytes=" + (offset - 1) + "-");
+  }
+  xmlhttp.send();
+}
+
+//fetch whole day of raw measurements, decimated to chart resolution
+function FetchDaySeries(date){
+  var day = new Date(date.getFullYear(), date.getMonth(), date.getDate());
+  var from = Math.floor(day.valueOf() / 1000);
+  FetchSeries(from, from + 86399, 2000, "raw");
+}
+
+//fetch measurements of time range from weather station (/data/series)
+//every row holds min and max of all fields in a bucket of 'step' seconds, both are plotted
+function FetchSeries(from, to, points, source){
+  var xmlhttp = new XMLHttpRequest();
+  xmlhttp.onreadystatechange = function() {
+    if (xmlhttp.readyState == 4 && xmlhttp.status == 200){
+		var series = JSON.parse(xmlhttp.responseText);
+		dataSet = [];
+		series.rows.forEach(function(row){
+			var lo = {time: row[0]}, hi = {time: row[0] + series.step / 2};
+			series.fields.forEach(function(field, i){ lo[field] = row[1 + 2 * i]; hi[field] = row[2 + 2 * i]; });
+			dataSet.push(lo, hi);
+		});
+		addDataPoints(dataSet);
+		chart1.render();
+		chart2.render();
+		chart3.render();
+		chart4.render();
+		chart5.render();
+		removeLoader();
+		displaySuccess("Data loaded successfully!");
+		setTimeout('closeBar()',5000);
+    }else if(xmlhttp.readyState == 4){
+      removeLoader();
+      displayError("Can not load measurements of that time.");
+    }
+  }
+  xmlhttp.open("GET", myIPaddress + "data/series?from=" + from + "&to=" + to + "&points=" + points + "&source=" + source, true);
   xmlhttp.send();
 }
 
@@ -20,9 +20,12 @@ var pressure = 0;
 var wind     = 0;
 var timestamp = 0;
 
-//Every 5sek get measurements
-setInterval(function () { GetMeasurements() ; }, 5000);
-setInterval(function () { updateImage() ; }, 4999);
+var stream = null;
+var pollTimers = [];
+
+//Live measurements are pushed by the station (Server-Sent Events),
+//polling every 5sek is used only if stream is not available
+StartStream();
 
 
 function DoCommand(command, targetElement, value) {
@@ -60,27 +63,61 @@ function requestReset(){
   }
 }
 
+function StartStream(){
+	if (!window.EventSource){
+		StartPolling();
+		return;
+	}
+	stream = new EventSource(myIPaddress + data_prefix + "stream");
+	stream.onmessage = function(event){ showMeasurements(JSON.parse(event.data)); };
+	stream.addEventListener("picture", function(){ updateImage(); });
+	stream.onopen = function(){ StopPolling(); updateImage(); };
+	stream.onerror = function(){
+		//browser reconnects by itself unless station refused the stream (too many clients)
+		if (stream.readyState == EventSource.CLOSED){
+			stream = null;
+			StartPolling();
+			setTimeout(StartStream, 60000);
+		}
+	};
+}
+
+function StartPolling(){
+	if (pollTimers.length == 0){
+		pollTimers.push(setInterval(function () { GetMeasurements() ; }, 5000));
+		pollTimers.push(setInterval(function () { updateImage() ; }, 4999));
+	}
+}
+
+function StopPolling(){
+	pollTimers.forEach(clearInterval);
+	pollTimers = [];
+}
+
 function updateMeasurements(xmlhttp){
 	if (xmlhttp.readyState == 4 && xmlhttp.status == 200){
-		var jsonObj = JSON.parse(xmlhttp.responseText);
-		//   {"time":"1671120839","int_t":24.27, "ext_t":23.00, "humi":34, "sun":182.50, "press":998.54}
-		extern_t = jsonObj.ext_t;
-		intern_t = jsonObj.int_t;
-		humidity = jsonObj.humi;
-		illuminance = jsonObj.sun;
-		pressure = jsonObj.press;
-		wind = jsonObj.wind ? jsonObj.wind : 0;
-		timestamp = Date(jsonObj.time * 1000);
-		document.getElementById("current_datetime").innerHTML = timestamp;
-		document.getElementById("ext_t_display").innerHTML = extern_t + " °C";
-		document.getElementById("int_t_display").innerHTML = intern_t + " °C";
-		document.getElementById("humi_display").innerHTML = humidity + " %";
-		document.getElementById("press_display").innerHTML = pressure + " hPa";
-		document.getElementById("sun_display").innerHTML = illuminance + " lx";
-		document.getElementById("wind_display").innerHTML = wind + " km/h";
+		showMeasurements(JSON.parse(xmlhttp.responseText));
 	}
 }
 
+function showMeasurements(jsonObj){
+	//   {"time":"1671120839","int_t":24.27, "ext_t":23.00, "humi":34, "sun":182.50, "press":998.54}
+	extern_t = jsonObj.ext_t;
+	intern_t = jsonObj.int_t;
+	humidity = jsonObj.humi;
+	illuminance = jsonObj.sun;
+	pressure = jsonObj.press;
+	wind = jsonObj.wind ? jsonObj.wind : 0;
+	timestamp = Date(jsonObj.time * 1000);
+	document.getElementById("current_datetime").innerHTML = timestamp;
+	document.getElementById("ext_t_display").innerHTML = extern_t + " °C";
+	document.getElementById("int_t_display").innerHTML = intern_t + " °C";
+	document.getElementById("humi_display").innerHTML = humidity + " %";
+	document.getElementById("press_display").innerHTML = pressure + " hPa";
+	document.getElementById("sun_display").innerHTML = illuminance + " lx";
+	document.getElementById("wind_display").innerHTML = wind + " km/h";
+}
+
 function GetMeasurements(){
 	var xmlhttp;
 	if (window.XMLHttpRequest){ 
@@ -0,0 +1,121 @@
+/*
+ * bench_jpge.cpp
+ *
+ *  Host benchmark of JPEG encoding of raw frames (fmt2jpg) at VGA, SVGA and SXGA,
+ *  from YUV422 and RGB888 of a synthetic scene: sky gradient with the sun and
+ *  textured ground with noise. Prints throughput and size, optionally writes the
+ *  pictures to compare them with output of other version of the encoder.
+ *
+ *    build/bench_jpge [prefix]   writes prefix_<width>_<format>.jpg
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "img_converters.h"
+
+static double now_s(void){
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * Fills frame in camera RGB888 byte order (BGR)
+ */
+static void make_scene(uint8_t *p, int w, int h){
+  unsigned seed = 1;
+  for(int y = 0; y < h; y++){
+    for(int x = 0; x < w; x++){
+      seed = seed * 1103515245 + 12345;
+      int n = (seed >> 16) & 15;
+      int r, g, b;
+      if(y < h / 2){
+        r = 90 + y * 100 / h;
+        g = 140 + y * 60 / h;
+        b = 230 - y * 40 / h;
+        if((x - w / 3) * (x - w / 3) + (y - h / 5) * (y - h / 5) < (h / 8) * (h / 8)){
+          r = g = b = 245;
+        }
+      }else{
+        r = 60 + ((x / 7 + y / 5) % 40) + n;
+        g = 100 + ((x / 11) % 50) + n;
+        b = 40 + n;
+      }
+      *p++ = b;
+      *p++ = g;
+      *p++ = r;
+    }
+  }
+}
+
+/**
+ * Converts BGR frame to YUYV (BT.601, chroma of pixel pairs averaged)
+ */
+static void bgr_to_yuyv(const uint8_t *s, uint8_t *d, int w, int h){
+  for(int i = 0; i < w * h; i += 2, s += 6, d += 4){
+    int b0 = s[0], g0 = s[1], r0 = s[2], b1 = s[3], g1 = s[4], r1 = s[5];
+    int r = (r0 + r1) / 2, g = (g0 + g1) / 2, b = (b0 + b1) / 2;
+    d[0] = 16 + ((66 * r0 + 129 * g0 + 25 * b0 + 128) >> 8);
+    d[1] = 128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8);
+    d[2] = 16 + ((66 * r1 + 129 * g1 + 25 * b1 + 128) >> 8);
+    d[3] = 128 + ((112 * r - 94 * g - 18 * b + 128) >> 8);
+  }
+}
+
+int main(int argc, char **argv){
+  const int sizes[][2] = {{640, 480}, {800, 600}, {1280, 1024}};
+  const char *prefix = argc > 1 ? argv[1] : NULL;
+
+  printf("resolution  , format ,  MB/s  ,  size B\n");
+  for(int k = 0; k < 3; k++){
+    int w = sizes[k][0], h = sizes[k][1];
+    uint8_t *bgr = (uint8_t *)malloc(w * h * 3);
+    uint8_t *yuv = (uint8_t *)malloc(w * h * 2);
+    make_scene(bgr, w, h);
+    bgr_to_yuyv(bgr, yuv, w, h);
+    struct {
+      pixformat_t format;
+      uint8_t *buf;
+      size_t len;
+      const char *name;
+    } frames[] = {{PIXFORMAT_YUV422, yuv, (size_t)w * h * 2, "YUV422"}, {PIXFORMAT_RGB888, bgr, (size_t)w * h * 3, "RGB888"}};
+
+    for(int f = 0; f < 2; f++){
+      uint8_t *out = NULL;
+      size_t out_len = 0;
+      int reps = k == 2 ? 5 : 10;
+      double start = now_s();
+      for(int i = 0; i < reps; i++){
+        free(out);
+        out = NULL;
+        if(!fmt2jpg(frames[f].buf, frames[f].len, w, h, frames[f].format, 80, &out, &out_len)){
+          printf("%s encoding failed\n", frames[f].name);
+          return 1;
+        }
+      }
+      double t = (now_s() - start) / reps;
+      if(out_len < 4 || out[0] != 0xFF || out[1] != 0xD8 || out[out_len - 2] != 0xFF || out[out_len - 1] != 0xD9){
+        printf("%s output is not a JPEG\n", frames[f].name);
+        return 1;
+      }
+      printf("%4d x %4d , %s , %6.1f , %7u\n", w, h, frames[f].name, frames[f].len / t / 1e6, (unsigned)out_len);
+      if(prefix != NULL){
+        char name[128];
+        snprintf(name, sizeof(name), "%s_%d_%s.jpg", prefix, w, frames[f].name);
+        FILE *file = fopen(name, "wb");
+        if(file != NULL){
+          fwrite(out, 1, out_len, file);
+          fclose(file);
+        }
+      }
+      free(out);
+    }
+    free(bgr);
+    free(yuv);
+  }
+  return 0;
+}
@@ -0,0 +1,2 @@
+/* Host stand-in of Arduino header, see host_test/Makefile (only included) */
+#pragma once
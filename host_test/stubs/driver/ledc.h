@@ -0,0 +1,4 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+typedef int ledc_timer_t;
+typedef int ledc_channel_t;
@@ -0,0 +1,4 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+#define IRAM_ATTR
+#define DRAM_ATTR
@@ -0,0 +1,2 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile (only included) */
+#pragma once
@@ -0,0 +1,13 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+#include <stdlib.h>
+#define MALLOC_CAP_8BIT      (1 << 2)
+#define MALLOC_CAP_DMA       (1 << 3)
+#define MALLOC_CAP_SPIRAM    (1 << 10)
+#define MALLOC_CAP_INTERNAL  (1 << 11)
+/* functions, not macros, so they may be passed as allocators */
+static inline void *heap_caps_malloc(size_t size, unsigned caps){ return malloc(size); }
+static inline void *heap_caps_calloc(size_t n, size_t size, unsigned caps){ return calloc(n, size); }
+static inline void heap_caps_free(void *ptr){ free(ptr); }
+/* host has PSRAM of any size asked for */
+static inline size_t heap_caps_get_total_size(unsigned caps){ return 4 * 1024 * 1024; }
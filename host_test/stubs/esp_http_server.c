@@ -0,0 +1,160 @@
+/* Host stand-in of esp_http_server, request mock (see esp_http_server.h) */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/types.h>
+#include "esp_http_server.h"
+
+static const char *s_err_status[] = {
+  "500 Internal Server Error", "400 Bad Request", "404 Not Found", "408 Request Timeout",
+};
+
+void httpd_mock_init(httpd_req_t *req, httpd_mock_t *m, const char *uri, void *user_ctx){
+  memset(req, 0, sizeof(*req));
+  memset(m, 0, sizeof(*m));
+  snprintf(req->uri, sizeof(req->uri), "%s", uri);
+  req->aux = m;
+  req->user_ctx = user_ctx;
+}
+
+void httpd_mock_add_hdr(httpd_mock_t *m, const char *field, const char *value){
+  for(size_t i = 0; i < HTTPD_MOCK_HDRS - 1; i++){
+    if(m->req_hdrs[i].field == NULL){
+      m->req_hdrs[i].field = field;
+      m->req_hdrs[i].value = value;
+      return;
+    }
+  }
+}
+
+const char *httpd_mock_sent_hdr(const httpd_mock_t *m, const char *field){
+  size_t n = strlen(field);
+  for(size_t i = 0; i < m->sent_hdrs_no; i++){
+    if(strncasecmp(m->sent_hdrs[i], field, n) == 0 && m->sent_hdrs[i][n] == ':'){
+      return m->sent_hdrs[i] + n + 2;
+    }
+  }
+  return NULL;
+}
+
+void httpd_mock_free(httpd_mock_t *m){
+  free(m->body);
+  m->body = NULL;
+  m->len = 0;
+}
+
+static httpd_mock_t *mock(httpd_req_t *r){
+  return (httpd_mock_t *)r->aux;
+}
+
+static const char *req_hdr(httpd_req_t *r, const char *field){
+  httpd_mock_t *m = mock(r);
+  for(size_t i = 0; i < HTTPD_MOCK_HDRS && m->req_hdrs[i].field; i++){
+    if(strcasecmp(m->req_hdrs[i].field, field) == 0){
+      return m->req_hdrs[i].value;
+    }
+  }
+  return NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field){
+  const char *v = req_hdr(r, field);
+  return v ? strlen(v) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size){
+  const char *v = req_hdr(r, field);
+  if(v == NULL){
+    return ESP_ERR_NOT_FOUND;
+  }
+  snprintf(val, val_size, "%s", v);
+  return strlen(v) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status){
+  mock(r)->status = status;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type){
+  mock(r)->type = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value){
+  httpd_mock_t *m = mock(r);
+  if(m->set_hdrs_no == HTTPD_MOCK_HDRS){
+    return ESP_ERR_HTTPD_RESP_HDR;
+  }
+  m->set_hdrs[m->set_hdrs_no].field = field;
+  m->set_hdrs[m->set_hdrs_no++].value = value;
+  return ESP_OK;
+}
+
+/* status line and headers are read when the first part of the response goes out */
+static void send_hdrs(httpd_mock_t *m){
+  if(m->hdrs_sent){
+    return;
+  }
+  m->hdrs_sent = true;
+  snprintf(m->sent_status, sizeof(m->sent_status), "%s", m->status ? m->status : "200 OK");
+  snprintf(m->sent_type, sizeof(m->sent_type), "%s", m->type ? m->type : "text/html");
+  for(size_t i = 0; i < m->set_hdrs_no; i++){
+    snprintf(m->sent_hdrs[i], HTTPD_MOCK_HDR_LEN, "%s: %s", m->set_hdrs[i].field, m->set_hdrs[i].value);
+  }
+  m->sent_hdrs_no = m->set_hdrs_no;
+}
+
+static esp_err_t append(httpd_mock_t *m, const char *buf, size_t len){
+  char *body = (char *)realloc(m->body, m->len + len + 1);
+  if(body == NULL){
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy(body + m->len, buf, len);
+  m->body = body;
+  m->len += len;
+  m->body[m->len] = '\0';
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len){
+  httpd_mock_t *m = mock(r);
+  if(m->hdrs_sent){
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+  send_hdrs(m);
+  m->complete = true;
+  if(buf_len == HTTPD_RESP_USE_STRLEN){
+    buf_len = buf ? strlen(buf) : 0;
+  }
+  return buf_len > 0 ? append(m, buf, buf_len) : append(m, "", 0);
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len){
+  httpd_mock_t *m = mock(r);
+  if(m->complete || (m->hdrs_sent && !m->chunked)){
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+  send_hdrs(m);
+  m->chunked = true;
+  if(buf == NULL){
+    m->complete = true;
+    return ESP_OK;
+  }
+  if(buf_len == HTTPD_RESP_USE_STRLEN){
+    buf_len = strlen(buf);
+  }
+  m->chunks++;
+  return append(m, buf, buf_len);
+}
+
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str){
+  return httpd_resp_send_chunk(r, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg){
+  httpd_resp_set_status(req, s_err_status[error]);
+  httpd_resp_set_type(req, "text/html");
+  return httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+}
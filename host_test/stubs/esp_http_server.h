@@ -0,0 +1,92 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile
+ *
+ * Request is mocked by httpd_mock_t (req->aux): request headers are taken from it and
+ * the response is captured into it. Like the server, header values are kept as pointers
+ * and read when the headers are sent (first send), so values which do not live until
+ * then show up as garbage in the captured response.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTPD_MAX_URI_LEN 512
+#define HTTPD_RESP_USE_STRLEN -1
+#define ESP_ERR_HTTPD_BASE           0xb000
+#define ESP_ERR_HTTPD_RESP_HDR       (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC   (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_INVALID_REQ    (ESP_ERR_HTTPD_BASE + 7)
+#define HTTPD_SOCK_ERR_FAIL -1
+
+typedef void *httpd_handle_t;
+
+typedef enum {
+  HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+  HTTPD_400_BAD_REQUEST,
+  HTTPD_404_NOT_FOUND,
+  HTTPD_408_REQ_TIMEOUT,
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+  httpd_handle_t handle;
+  int method;
+  char uri[HTTPD_MAX_URI_LEN + 1];      /* const in the server, which C++ can not construct */
+  size_t content_len;
+  void *aux;                            /* httpd_mock_t of the request */
+  void *user_ctx;
+  void *sess_ctx;
+} httpd_req_t;
+
+#define HTTPD_MOCK_HDRS 16
+#define HTTPD_MOCK_HDR_LEN 160
+
+typedef struct {
+  const char *field;
+  const char *value;
+} httpd_mock_hdr_t;
+
+typedef struct {
+  httpd_mock_hdr_t req_hdrs[HTTPD_MOCK_HDRS];   /* request headers, up to first NULL field */
+  /* response being built */
+  const char *status;
+  const char *type;
+  httpd_mock_hdr_t set_hdrs[HTTPD_MOCK_HDRS];
+  size_t set_hdrs_no;
+  /* response as sent */
+  bool hdrs_sent;
+  char sent_status[48];
+  char sent_type[48];
+  char sent_hdrs[HTTPD_MOCK_HDRS][HTTPD_MOCK_HDR_LEN];  /* "Field: value" */
+  size_t sent_hdrs_no;
+  bool chunked;
+  bool complete;                        /* whole body sent (or terminating chunk) */
+  unsigned chunks;
+  char *body;                           /* malloc'd, freed by httpd_mock_free() */
+  size_t len;
+} httpd_mock_t;
+
+/* mock API */
+void httpd_mock_init(httpd_req_t *req, httpd_mock_t *m, const char *uri, void *user_ctx);
+void httpd_mock_add_hdr(httpd_mock_t *m, const char *field, const char *value);
+const char *httpd_mock_sent_hdr(const httpd_mock_t *m, const char *field);
+void httpd_mock_free(httpd_mock_t *m);
+
+/* server API used by handlers */
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size);
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg);
+
+#ifdef __cplusplus
+}
+#endif
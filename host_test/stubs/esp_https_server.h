@@ -0,0 +1,3 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+#include "esp_http_server.h"
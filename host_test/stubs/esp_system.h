@@ -0,0 +1,3 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+#define ESP_IDF_VERSION_MAJOR 4
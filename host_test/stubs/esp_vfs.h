@@ -0,0 +1,4 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+#include "sdkconfig.h"
+#define ESP_VFS_PATH_MAX 15
@@ -0,0 +1,6 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile. Host tests run in one thread. */
+#pragma once
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
@@ -0,0 +1,3 @@
+/* Host stand-in of ESP-IDF header, see host_test/Makefile */
+#pragma once
+#define CONFIG_SPIFFS_OBJ_NAME_LEN 32
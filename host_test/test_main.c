@@ -0,0 +1,49 @@
+/*
+ * test_main.c
+ *
+ *  Runs all test cases registered by TEST_CASE (see unity.h), in order of registration.
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdarg.h>
+#include "unity.h"
+
+#define TESTS_MAX 64
+
+static const char *s_names[TESTS_MAX];
+static test_fn_t s_tests[TESTS_MAX];
+static int s_tests_no = 0;
+static int s_failures = 0;
+
+void test_register(const char *name, test_fn_t fn){
+  if(s_tests_no == TESTS_MAX){
+    fprintf(stderr, "Too many test cases, increase TESTS_MAX\n");
+    exit(2);
+  }
+  s_names[s_tests_no] = name;
+  s_tests[s_tests_no++] = fn;
+}
+
+void test_fail(const char *file, int line, const char *fmt, ...){
+  va_list args;
+  fprintf(stderr, "%s:%d: ", file, line);
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+  s_failures++;
+}
+
+int main(void){
+  int failed = 0;
+  for(int i = 0; i < s_tests_no; i++){
+    int before = s_failures;
+    s_tests[i]();
+    failed += (s_failures != before);
+    printf("%s: %s\n", s_failures == before ? "PASS" : "FAIL", s_names[i]);
+  }
+  printf("%d tests, %d failed\n", s_tests_no, failed);
+  return failed != 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * unity.h
+ *
+ *  Minimal stand-in of ESP-IDF Unity for host builds of component tests.
+ *  TEST_CASE registers the test for test_main.c, failed assertion is reported
+ *  and the test goes on (the real Unity stops the test).
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#ifndef HOST_TEST_UNITY_H_
+#define HOST_TEST_UNITY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef void (*test_fn_t)(void);
+void test_register(const char *name, test_fn_t fn);
+void test_fail(const char *file, int line, const char *fmt, ...);
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_CAT_(a, b) a##b
+#define TEST_CAT(a, b) TEST_CAT_(a, b)
+#define TEST_CASE(name, tags) \
+  static void TEST_CAT(test_, __LINE__)(void); \
+  __attribute__((constructor)) static void TEST_CAT(test_reg_, __LINE__)(void){ \
+    test_register(name, TEST_CAT(test_, __LINE__)); \
+  } \
+  static void TEST_CAT(test_, __LINE__)(void)
+
+#define TEST_ASSERT_EQUAL_MESSAGE(e, a, msg) do{ long long e_ = (long long)(e), a_ = (long long)(a); \
+    if(e_ != a_) test_fail(__FILE__, __LINE__, "expected %lld got %lld %s", e_, a_, (msg)); }while(0)
+#define TEST_ASSERT_EQUAL(e, a) TEST_ASSERT_EQUAL_MESSAGE(e, a, "")
+#define TEST_ASSERT_EQUAL_INT(e, a) TEST_ASSERT_EQUAL(e, a)
+#define TEST_ASSERT_EQUAL_UINT32(e, a) TEST_ASSERT_EQUAL((uint32_t)(e), (uint32_t)(a))
+#define TEST_ASSERT_EQUAL_UINT8(e, a) TEST_ASSERT_EQUAL((uint8_t)(e), (uint8_t)(a))
+#define TEST_ASSERT_LESS_THAN(t, a) do{ long long t_ = (long long)(t), a_ = (long long)(a); \
+    if(!(a_ < t_)) test_fail(__FILE__, __LINE__, "expected less than %lld got %lld", t_, a_); }while(0)
+#define TEST_ASSERT_EQUAL_STRING(e, a) do{ const char *e_ = (e), *a_ = (a); \
+    if(a_ == NULL || strcmp(e_, a_)) test_fail(__FILE__, __LINE__, "expected \"%s\" got \"%s\"", e_, a_ ? a_ : "(null)"); }while(0)
+#define TEST_ASSERT_FLOAT_WITHIN(d, e, a) do{ double d_ = (d), e_ = (e), a_ = (a); \
+    if(fabs(e_ - a_) > d_) test_fail(__FILE__, __LINE__, "expected %f got %f", e_, a_); }while(0)
+#define TEST_ASSERT_TRUE(c) do{ if(!(c)) test_fail(__FILE__, __LINE__, "expected true: %s", #c); }while(0)
+#define TEST_ASSERT_FALSE(c) do{ if(c) test_fail(__FILE__, __LINE__, "expected false: %s", #c); }while(0)
+#define TEST_ASSERT_NULL(p) do{ if((p) != NULL) test_fail(__FILE__, __LINE__, "expected NULL: %s", #p); }while(0)
+#define TEST_ASSERT_NOT_NULL(p) do{ if((p) == NULL) test_fail(__FILE__, __LINE__, "expected not NULL: %s", #p); }while(0)
+
+#endif /* HOST_TEST_UNITY_H_ */
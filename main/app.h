@@ -99,6 +99,9 @@ void unmount_sd(void);
 uint8_t init_sd(void);
 uint8_t reinit_sd(void);
 void ensure_card_works(void);
+void log_append_begin(void);
+void log_append_end(void);
+uint32_t log_appends_pending(void);
 char *get_newest_file(char *);
 void get_today_path(char *path_buf);
 /*******************************************************************************
@@ -246,6 +246,32 @@ void ensure_card_works(void){
     reinit_sd();
 }
 
+static volatile uint32_t s_log_appends = 0;
+static portMUX_TYPE s_log_appends_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Marks log append in progress (from opening to closing of the log file),
+ * background card readers (tar export) wait for it to end
+ */
+void log_append_begin(void){
+  portENTER_CRITICAL(&s_log_appends_mux);
+  s_log_appends++;
+  portEXIT_CRITICAL(&s_log_appends_mux);
+}
+
+void log_append_end(void){
+  portENTER_CRITICAL(&s_log_appends_mux);
+  s_log_appends--;
+  portEXIT_CRITICAL(&s_log_appends_mux);
+}
+
+/**
+ * @return number of loggers appending their log files right now
+ */
+uint32_t log_appends_pending(void){
+  return s_log_appends;
+}
+
 /*******************************************************************************
  * File system helpers
  */
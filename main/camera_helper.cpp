@@ -5,11 +5,47 @@
  *      Author: Karol
  */
 
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "ff.h"
 #include "setup.h"
 #include "camera_helper.h"
+#include "metrics_helper.h"
 
 static const char *TAG = "CAMHLP";
 
+//Capture/write pipeline state
+static QueueHandle_t s_free_slots = NULL;   //PSRAM buffers ready to take a new frame
+static QueueHandle_t s_write_jobs = NULL;   //frames waiting for the writer task
+static QueueHandle_t s_thumb_jobs = NULL;   //archived pictures waiting for thumbnail
+static SemaphoreHandle_t s_index_mutex = NULL;  //picture index is updated by writer and thumbnail tasks, read by http server
+static size_t s_slot_size = 0;
+static cam_pipeline_stats s_stats;
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+//Rate control state
+#define RATE_DAY_BUDGET ((uint32_t)JPEG_DAY_BUDGET_MB * 1024 * 1024)
+static cam_rate_stats s_rate = {.quality = 0, .days_until_full = -1};
+static int s_rate_yday = -1;        //day of year counted in s_rate.day_bytes
+static bool s_rate_full_day = false; //false for the day of boot - not counted in daily average
+static void camera_rate_account(size_t bytes);
+
+//Exposure presets by lux band, ascending. Values are only a starting point for AEC/AGC.
+static const cam_exposure_preset s_exposure_presets[] = {
+  //lux_min  aec   agc  ae  aec2
+  {     0.0, 1200,  30,  1,  1},  //night, street lights
+  {    10.0, 1200,  12,  0,  1},  //dusk, dawn
+  {   100.0,  800,   4,  0,  0},  //heavy overcast
+  {  1000.0,  300,   0,  0,  0},  //overcast day
+  { 10000.0,   80,   0,  0,  0},  //daylight
+  { 30000.0,   20,   0, -1,  0},  //direct sun
+};
+
 //Board config for camera
 camera_config_t camera_config = {
   .pin_pwdn = CAM_PIN_PWDN,
@@ -61,37 +97,453 @@ esp_err_t init_camera(int framesize){
   return ESP_OK;
 }
 
-esp_err_t camera_capture(char * FileName, size_t *pictureSize){
-  FILE* f;
+/*******************************************************************************
+ *  Capture/write pipeline
+ */
+
+esp_err_t init_camera_pipeline(void){
+  //Slot is as big as the driver JPEG frame buffer (see cam_config in cam_hal.c),
+  //so every frame the driver can deliver fits into it.
+  s_slot_size = resolution[camera_config.frame_size].width * resolution[camera_config.frame_size].height / 3;
+  s_index_mutex = xSemaphoreCreateMutex();
+  s_free_slots = xQueueCreate(CAM_POOL_SLOTS, sizeof(cam_write_job));
+  s_write_jobs = xQueueCreate(CAM_POOL_SLOTS, sizeof(cam_write_job));
+  s_thumb_jobs = xQueueCreate(THUMB_QUEUE_LEN, FILEPATH_LEN_MAX);
+  if(s_free_slots == NULL || s_write_jobs == NULL || s_thumb_jobs == NULL || s_index_mutex == NULL){
+    ESP_LOGE(TAG, "Can not create pipeline queues!");
+    return ESP_ERR_NO_MEM;
+  }
+  for(int i = 0; i < CAM_POOL_SLOTS; i++){
+    cam_write_job slot = {};
+    slot.buf = (uint8_t *)heap_caps_malloc(s_slot_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if(slot.buf == NULL){
+      ESP_LOGE(TAG, "Can not allocate picture buffer %d (%d B)!", i, s_slot_size);
+      return ESP_ERR_NO_MEM;
+    }
+    xQueueSend(s_free_slots, &slot, 0);
+  }
+  memset(&s_stats, 0, sizeof(s_stats));
+  ESP_LOGI(TAG, "Capture pipeline ready: %d slots x %d B", CAM_POOL_SLOTS, s_slot_size);
+  return ESP_OK;
+}
 
-  //clear internal queue  - Not sure what purpose it has, but it basically takes one more photo for nothing
-//  camera_fb_t * fb = esp_camera_fb_get();
-//  if(fb){
-//      //ESP_LOGI(TAG, "fb->len=%d", fb->len);
-//      esp_camera_fb_return(fb);
-//  }
+esp_err_t camera_grab(cam_write_job *job){
+  if(s_free_slots == NULL){
+    return ESP_ERR_INVALID_STATE;
+  }
+  //writer is behind - drop this frame rather than stall the capture loop
+  if(xQueueReceive(s_free_slots, job, pdMS_TO_TICKS(CAM_SLOT_WAIT_MS)) != pdTRUE){
+    portENTER_CRITICAL(&s_stats_mux);
+    s_stats.dropped++;
+    portEXIT_CRITICAL(&s_stats_mux);
+    ESP_LOGW(TAG, "No free picture buffer, frame dropped");
+    return ESP_ERR_TIMEOUT;
+  }
 
-  //acquire a frame
   camera_fb_t * fb = esp_camera_fb_get();
   if (!fb) {
     ESP_LOGE(TAG, "Camera Capture Failed");
+    xQueueSend(s_free_slots, job, 0);
     return ESP_FAIL;
   }
-  //replace this with your own function
-  //process_image(fb->width, fb->height, fb->format, fb->buf, fb->len);
-  f = fopen(FileName, "wb");
-  if (f == NULL) {
-    ESP_LOGE(TAG, "Failed to open file for writing");
-    ESP_LOGE(TAG, "PATH: %s", FileName);
-    return ESP_FAIL;
+  //cut off JPEG would have no EOI, but still be archived and indexed as a picture
+  if(fb->len > s_slot_size){
+    size_t len = fb->len;
+    esp_camera_fb_return(fb);
+    xQueueSend(s_free_slots, job, 0);
+    portENTER_CRITICAL(&s_stats_mux);
+    s_stats.dropped++;
+    portEXIT_CRITICAL(&s_stats_mux);
+    ESP_LOGW(TAG, "Frame of %d B does not fit picture buffer (%d B), frame dropped", len, s_slot_size);
+    return ESP_ERR_INVALID_SIZE;
   }
-  fwrite(fb->buf, fb->len, 1, f);
-  ESP_LOGI(TAG, "fb->len=%d", fb->len);
-  *pictureSize = (size_t)fb->len;
-  fclose(f);
-
-  //return the frame buffer back to the driver for reuse
+  job->capture_us = esp_timer_get_time();
+  format_picture_meta(job->meta, sizeof(job->meta));
+  job->len = fb->len;
+  memcpy(job->buf, fb->buf, job->len);
+  //driver buffer goes back before any SD card access
   esp_camera_fb_return(fb);
-
   return ESP_OK;
 }
+
+void camera_queue_write(cam_write_job *job, const char * FileName, bool archive){
+  strlcpy(job->path, FileName, sizeof(job->path));
+  job->archive = archive;
+  xQueueSend(s_write_jobs, job, portMAX_DELAY);  //never blocks: queue holds all slots
+
+  UBaseType_t waiting = uxQueueMessagesWaiting(s_write_jobs);
+  portENTER_CRITICAL(&s_stats_mux);
+  if(waiting > s_stats.queue_peak){
+    s_stats.queue_peak = waiting;
+  }
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+esp_err_t camera_capture_async(const char * FileName, bool archive){
+  cam_write_job job;
+  esp_err_t res = camera_grab(&job);
+  if(res == ESP_OK){
+    camera_queue_write(&job, FileName, archive);
+  }
+  return res;
+}
+
+void format_picture_meta(char * meta, size_t len){
+  measurement measurements = get_latest_measurements();
+  snprintf(meta, len, "{\"time\":\"%lld\",\"int_t\":%3.2F, \"ext_t\":%3.2F, \"humi\":%d, \"sun\":%5.2F, \"press\":%4.2f, \"wind\":%3.3f}",
+           (long long)time(NULL),
+           measurements.iTemp,
+           measurements.eTemp,
+           (int)(measurements.humi),
+           measurements.lux,
+           measurements.pres,
+           measurements.wind/ 0.278);
+}
+
+esp_err_t camera_write_next(cam_write_job *done, TickType_t wait){
+  FILE* f;
+  esp_err_t res = ESP_OK;
+  uint8_t seg[JPEG_META_SEG_MAX];
+  size_t seg_len = 0;
+
+  if(s_write_jobs == NULL || xQueueReceive(s_write_jobs, done, wait) != pdTRUE){
+    return ESP_ERR_TIMEOUT;
+  }
+  //measurements go in as COM segment - picture data is written as it is, no re-encoding
+  size_t pos = jpeg_meta_insert_pos(done->buf, done->len);
+  if(pos > 0 && done->meta[0] != 0){
+    seg_len = jpeg_meta_segment(done->meta, seg, sizeof(seg));
+  }
+  if(seg_len == 0){
+    pos = done->len;
+  }
+  const uint8_t *parts[] = {done->buf, seg, done->buf + pos};
+  const size_t part_lens[] = {pos, seg_len, done->len - pos};
+  int64_t write_start_us = esp_timer_get_time();
+
+#ifdef CONFIG_KK_PICTURE_PACK
+  if(done->archive){
+    if(pack_append(done->path, parts, part_lens, 3, (uint32_t)time(NULL)) < 0){
+      res = ESP_FAIL;
+    }
+  }else
+#endif
+  {
+    f = fopen(done->path, "wb");
+    if (f == NULL) {
+      res = ESP_FAIL;
+    }else{
+      for(int i = 0; i < 3 && res == ESP_OK; i++){
+        if(part_lens[i] > 0 && fwrite(parts[i], part_lens[i], 1, f) != 1){
+          res = ESP_FAIL;
+        }
+      }
+      fclose(f);
+    }
+    if(res == ESP_OK && done->archive){
+      picture_index_add(done->path, (uint32_t)time(NULL), done->len + seg_len);
+    }
+  }
+  if(res == ESP_OK){
+    metric_observe_us(&g_sd_op_latency[METRIC_SD_PICTURE_WRITE], metrics_elapsed_us(write_start_us));
+  }
+  uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - done->capture_us) / 1000);
+
+  //slot is free again for the capture stage
+  xQueueSend(s_free_slots, done, 0);
+
+  portENTER_CRITICAL(&s_stats_mux);
+  if(res == ESP_OK){
+    s_stats.written++;
+    s_stats.bytes += done->len + seg_len;
+    s_stats.last_latency_ms = latency_ms;
+    s_stats.total_latency_ms += latency_ms;
+    if(latency_ms > s_stats.max_latency_ms){
+      s_stats.max_latency_ms = latency_ms;
+    }
+  }else{
+    s_stats.failed++;
+  }
+  portEXIT_CRITICAL(&s_stats_mux);
+  if(res == ESP_OK && done->archive){
+    camera_rate_account(done->len + seg_len);
+  }
+  return res;
+}
+
+void camera_release(cam_write_job *job){
+  xQueueSend(s_free_slots, job, 0);
+}
+
+int camera_set_exposure_for_lux(float lux){
+  sensor_t *s = esp_camera_sensor_get();
+  if(s == NULL){
+    return -1;
+  }
+  int band = 0;
+  while(band + 1 < (int)(sizeof(s_exposure_presets) / sizeof(s_exposure_presets[0]))
+        && lux >= s_exposure_presets[band + 1].lux_min){
+    band++;
+  }
+  const cam_exposure_preset *p = &s_exposure_presets[band];
+  if(s->set_exposure_seed == NULL){
+    return -1;
+  }
+  if(s->set_exposure_seed(s, p->aec_value, p->agc_gain, p->ae_level, p->aec2) != 0){
+    ESP_LOGW(TAG, "Exposure preset %d not written", band);
+    camera_resume_auto_exposure();
+    return -1;
+  }
+  return band;
+}
+
+void camera_resume_auto_exposure(void){
+  sensor_t *s = esp_camera_sensor_get();
+  if(s == NULL){
+    return;
+  }
+  s->set_exposure_ctrl(s, s->status.aec);
+  s->set_gain_ctrl(s, s->status.agc);
+}
+
+/**
+ * @brief Rate control feedback: counts stored archived picture into the day
+ *        and moving average of picture size. Starts a new day when date changes.
+ * @param bytes size of the stored picture
+ */
+static void camera_rate_account(size_t bytes){
+  time_t now = time(NULL);
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+
+  portENTER_CRITICAL(&s_stats_mux);
+  if(timeinfo.tm_yday != s_rate_yday){
+    if(s_rate_yday >= 0 && s_rate_full_day){
+      s_rate.daily_bytes_avg = s_rate.daily_bytes_avg == 0 ? s_rate.day_bytes
+                               : (s_rate.daily_bytes_avg * 3 + s_rate.day_bytes) / 4;
+    }
+    s_rate_full_day = s_rate_yday >= 0;
+    s_rate_yday = timeinfo.tm_yday;
+    s_rate.day_bytes = 0;
+    s_rate.day_pictures = 0;
+  }
+  s_rate.day_bytes += bytes;
+  s_rate.day_pictures++;
+  s_rate.frame_bytes_avg = s_rate.frame_bytes_avg == 0 ? bytes
+                           : (uint32_t)(((uint64_t)s_rate.frame_bytes_avg * 3 + bytes) / 4);
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+/**
+ * @return free space on SD card in bytes, 0 if it can not be checked
+ */
+static uint64_t get_card_free_bytes(void){
+  FATFS *fs;
+  DWORD free_clusters;
+  if(f_getfree(SD_FATFS_DRIVE, &free_clusters, &fs) != FR_OK){
+    return 0;
+  }
+#if FF_MAX_SS != FF_MIN_SS
+  uint32_t sector_size = fs->ssize;
+#else
+  uint32_t sector_size = FF_MAX_SS;
+#endif
+  return (uint64_t)free_clusters * fs->csize * sector_size;
+}
+
+int camera_apply_rate_control(time_t interval){
+  //FatFs keeps free cluster count after the first scan, so this is cheap
+  uint64_t free_bytes = get_card_free_bytes();
+  time_t now = time(NULL);
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  uint32_t seconds_left = 24 * 3600 - (timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec);
+  uint32_t pictures_left = seconds_left / (interval > 0 ? interval : 1) + 1;
+
+  portENTER_CRITICAL(&s_stats_mux);
+  if(s_rate.quality == 0){
+    s_rate.quality = camera_config.jpeg_quality;
+  }
+  int quality = s_rate.quality;
+  //pictures of the previous day do not take today's budget
+  uint32_t day_bytes = timeinfo.tm_yday == s_rate_yday ? s_rate.day_bytes : 0;
+  uint32_t remaining = RATE_DAY_BUDGET > day_bytes ? RATE_DAY_BUDGET - day_bytes : 0;
+  s_rate.target_bytes = remaining / pictures_left;
+  if(s_rate.target_bytes == 0){
+    quality = JPEG_QUALITY_WORST;
+  }else if(s_rate.frame_bytes_avg != 0){
+    //picture size is roughly inversely proportional to jpeg_quality
+    int wanted = (int)(((uint64_t)quality * s_rate.frame_bytes_avg + s_rate.target_bytes / 2) / s_rate.target_bytes);
+    if(wanted > quality + JPEG_QUALITY_STEP){
+      wanted = quality + JPEG_QUALITY_STEP;
+    }else if(wanted < quality - JPEG_QUALITY_STEP){
+      wanted = quality - JPEG_QUALITY_STEP;
+    }
+    quality = wanted;
+  }
+  if(quality < JPEG_QUALITY_BEST){
+    quality = JPEG_QUALITY_BEST;
+  }else if(quality > JPEG_QUALITY_WORST){
+    quality = JPEG_QUALITY_WORST;
+  }
+  bool changed = quality != s_rate.quality;
+  if(changed){
+    //expected size at the new quality until real pictures tell otherwise
+    s_rate.frame_bytes_avg = (uint32_t)((uint64_t)s_rate.frame_bytes_avg * s_rate.quality / quality);
+    s_rate.quality = quality;
+  }
+  if(free_bytes != 0){
+    s_rate.card_free_bytes = free_bytes;
+    uint32_t daily = s_rate.daily_bytes_avg != 0 ? s_rate.daily_bytes_avg : RATE_DAY_BUDGET;
+    s_rate.days_until_full = (int32_t)(free_bytes / daily);
+  }
+  portEXIT_CRITICAL(&s_stats_mux);
+
+  if(changed){
+    sensor_t *s = esp_camera_sensor_get();
+    if(s == NULL || s->set_quality(s, quality) != 0){
+      ESP_LOGW(TAG, "Can not set jpeg quality %d", quality);
+    }
+  }
+  return quality;
+}
+
+cam_rate_stats get_cam_rate_stats(void){
+  cam_rate_stats tmp;
+  portENTER_CRITICAL(&s_stats_mux);
+  tmp = s_rate;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return tmp;
+}
+
+void camera_record_settle(uint32_t frames, uint32_t ms){
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.settle_frames_last = frames;
+  s_stats.settle_ms_last = ms;
+  if(ms > s_stats.settle_ms_max){
+    s_stats.settle_ms_max = ms;
+  }
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+UBaseType_t camera_pending_writes(void){
+  return s_write_jobs != NULL ? uxQueueMessagesWaiting(s_write_jobs) : 0;
+}
+
+cam_pipeline_stats get_cam_pipeline_stats(void){
+  cam_pipeline_stats tmp;
+  portENTER_CRITICAL(&s_stats_mux);
+  tmp = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return tmp;
+}
+
+/*******************************************************************************
+ *  Thumbnail stage
+ */
+
+esp_err_t queue_thumbnail(const char * FileName){
+  char path[FILEPATH_LEN_MAX];
+  if(s_thumb_jobs == NULL){
+    return ESP_ERR_INVALID_STATE;
+  }
+  strlcpy(path, FileName, sizeof(path));
+  return xQueueSend(s_thumb_jobs, path, 0) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+bool next_thumbnail_request(char * FileName, TickType_t wait){
+  return s_thumb_jobs != NULL && xQueueReceive(s_thumb_jobs, FileName, wait) == pdTRUE;
+}
+
+bool get_thumb_path(const char * FileName, char * thumb_path, size_t len){
+  const char *name = strrchr(FileName, '/');
+  if(name == NULL){
+    return false;
+  }
+  int cx = snprintf(thumb_path, len, "%.*s/%s%s", (int)(name - FileName), FileName, THUMB_DIR, name);
+  return cx > 0 && (size_t)cx < len;
+}
+
+/*******************************************************************************
+ *  Picture index
+ */
+
+/**
+ * @brief Splits picture path into day directory and file name
+ * @param FileName path of the picture
+ * @param day_dir buffer of FILEPATH_LEN_MAX for directory
+ * @return file name (points into FileName), NULL if path has no directory
+ */
+static const char *split_picture_path(const char * FileName, char * day_dir){
+  const char *name = strrchr(FileName, '/');
+  if(name == NULL || name - FileName >= FILEPATH_LEN_MAX){
+    return NULL;
+  }
+  strlcpy(day_dir, FileName, name - FileName + 1);
+  return name + 1;
+}
+
+void picture_index_add(const char * FileName, uint32_t time, uint32_t size){
+  char day_dir[FILEPATH_LEN_MAX];
+  pic_index_entry_t entry = {};
+  const char *name = split_picture_path(FileName, day_dir);
+  if(name == NULL || s_index_mutex == NULL || strlen(name) >= sizeof(entry.name)){
+    return;
+  }
+  strcpy(entry.name, name);
+  entry.time = time;
+  entry.size = size;
+  xSemaphoreTake(s_index_mutex, portMAX_DELAY);
+  long count = pic_index_append(day_dir, &entry, THUMB_DIR);
+  xSemaphoreGive(s_index_mutex);
+  if(count < 0){
+    ESP_LOGW(TAG, "Can not add %s to picture index", FileName);
+  }
+}
+
+void picture_index_set_thumb(const char * FileName){
+  char day_dir[FILEPATH_LEN_MAX];
+  const char *name = split_picture_path(FileName, day_dir);
+  if(name == NULL || s_index_mutex == NULL){
+    return;
+  }
+  xSemaphoreTake(s_index_mutex, portMAX_DELAY);
+  pic_index_set_flags(day_dir, name, PIC_INDEX_THUMB);
+  xSemaphoreGive(s_index_mutex);
+}
+
+size_t picture_index_read(const char * date, uint32_t first, pic_index_entry_t *entries, size_t max, uint32_t *total){
+  char day_dir[FILEPATH_LEN_MAX];
+  size_t n = 0;
+  *total = 0;
+  int cx = snprintf(day_dir, sizeof(day_dir), "%s/%s", CAM_FILE_PATH, date);
+  if(cx <= 0 || (size_t)cx >= sizeof(day_dir) || s_index_mutex == NULL){
+    return 0;
+  }
+  xSemaphoreTake(s_index_mutex, portMAX_DELAY);
+  long count = pic_index_count(day_dir);
+  if(count < 0){
+    //cold day: readdir and stat of every picture are done without the lock,
+    //so the writer and thumbnail tasks are not held up by the listing
+    //(only the http server task reads the index, there is one scan at a time)
+    xSemaphoreGive(s_index_mutex);
+    long scanned = pic_index_scan(day_dir, THUMB_DIR, PIC_INDEX_SCAN_NAME);
+    xSemaphoreTake(s_index_mutex, portMAX_DELAY);
+    count = pic_index_count(day_dir);
+    if(scanned >= 0 && count < 0 && pic_index_install(day_dir, PIC_INDEX_SCAN_NAME)){
+      count = scanned;
+    }else if(scanned >= 0){
+      //writer built the index meanwhile (first picture of the day)
+      char scan_path[FILEPATH_LEN_MAX];
+      if(pic_index_path(day_dir, PIC_INDEX_SCAN_NAME, scan_path, sizeof(scan_path))){
+        remove(scan_path);
+      }
+    }
+  }
+  if(count > 0){
+    *total = (uint32_t)count;
+    n = pic_index_read(day_dir, first, entries, max);
+  }
+  xSemaphoreGive(s_index_mutex);
+  return n;
+}
@@ -11,6 +11,7 @@
 #include "setup.h"
 #include "app.h"
 #include "sensor.h"
+#include "kk_imgproc.h"
 
 
 #if CONFIG_FRAMESIZE_VGA
@@ -43,12 +44,214 @@ extern camera_config_t camera_config;
  */
 esp_err_t init_camera(int framesize);
 
+//Picture waiting in (or returned from) the writer queue
+struct cam_write_job{
+  uint8_t *buf = NULL;      //PSRAM slot holding a copy of the JPEG
+  size_t len = 0;           //JPEG length in bytes
+  int64_t capture_us = 0;   //esp_timer time the frame was taken
+  char path[FILEPATH_LEN_MAX] = {0};  //target file
+  bool archive = false;     //picture is kept permanently (gets thumbnail)
+  char meta[JPEG_META_LEN_MAX] = {0};  //measurements at capture time, stored in JPEG COM segment
+};
+
+//Capture-to-disk statistics of the pipeline
+struct cam_pipeline_stats{
+  uint32_t written;           //pictures stored on SD card
+  uint32_t failed;            //pictures that could not be stored
+  uint32_t dropped;           //frames skipped because all slots were busy or frame did not fit a slot
+  uint64_t bytes;             //bytes written
+  uint32_t last_latency_ms;   //capture-to-disk time of the last picture
+  uint32_t max_latency_ms;    //worst capture-to-disk time
+  uint64_t total_latency_ms;  //sum for average calculation
+  UBaseType_t queue_peak;     //highest number of pictures waiting for writer
+  uint32_t settle_frames_last;  //frames needed for good exposure before the last archived picture
+  uint32_t settle_ms_last;      //time from exposure preset to good frame of the last archived picture
+  uint32_t settle_ms_max;       //worst time-to-good-frame
+};
+
+//Per-day byte budget rate control of archived pictures
+struct cam_rate_stats{
+  int quality;                //jpeg_quality of archived pictures
+  uint32_t day_bytes;         //bytes of archived pictures stored today
+  uint32_t day_pictures;      //archived pictures stored today
+  uint32_t target_bytes;      //picture size that fits remaining budget of the day
+  uint32_t frame_bytes_avg;   //recent archived picture size (moving average)
+  uint32_t daily_bytes_avg;   //average bytes per day of finished days (0 if none yet)
+  uint64_t card_free_bytes;   //free space on SD card at last check
+  int32_t days_until_full;    //predicted days until card is full (-1 if unknown)
+};
+
+//Sensor exposure preset for a band of BH1750 readings
+struct cam_exposure_preset{
+  float lux_min;    //lowest illuminance of the band
+  int aec_value;    //exposure seed 0-1200
+  int agc_gain;     //gain seed 0-30
+  int ae_level;     //AE target -2..2
+  int aec2;         //night mode (AEC DSP)
+};
+
 /**
- * @param FileName
- * @param pictureSize
- * @return
+ * @brief Allocates CAM_POOL_SLOTS picture buffers in PSRAM and creates pipeline queues.
+ *        Must be called after init_camera().
+ * @return ESP_OK or ESP_ERR_NO_MEM
+ */
+esp_err_t init_camera_pipeline(void);
+
+/**
+ * @brief First half of capture stage: takes a frame and copies it into a free PSRAM slot.
+ *        Current measurements are attached to the slot as JSON (see format_picture_meta()).
+ *        Frame buffer is returned to the driver before return.
+ *        Slot must be passed to camera_queue_write() afterwards.
+ * @param job filled with slot holding the picture
+ * @return ESP_OK, ESP_ERR_TIMEOUT if no slot got free within CAM_SLOT_WAIT_MS,
+ *         ESP_ERR_INVALID_SIZE if frame is bigger than a slot (dropped), ESP_FAIL on capture error
+ */
+esp_err_t camera_grab(cam_write_job *job);
+
+/**
+ * @brief Second half of capture stage: hands grabbed picture over to the writer task.
+ * @param job slot filled by camera_grab()
+ * @param FileName target path of the picture
+ * @param archive true for pictures stored permanently (not current.jpg)
+ */
+void camera_queue_write(cam_write_job *job, const char * FileName, bool archive);
+
+/**
+ * @brief Capture stage: takes a frame, copies it into a free PSRAM slot,
+ *        returns the frame buffer to the driver and queues the slot for the writer.
+ * @param FileName target path of the picture
+ * @param archive true for pictures stored permanently (not current.jpg)
+ * @return ESP_OK if queued, ESP_ERR_TIMEOUT if no slot got free within CAM_SLOT_WAIT_MS
+ */
+esp_err_t camera_capture_async(const char * FileName, bool archive);
+
+/**
+ * @brief Formats measurement snapshot embedded into pictures.
+ *        Same fields and units as /data/current_measurements.json.
+ * @param meta output buffer
+ * @param len size of output buffer (JPEG_META_LEN_MAX)
+ */
+void format_picture_meta(char * meta, size_t len);
+
+/**
+ * @brief Writer stage: waits for the next queued picture, stores it and releases its slot.
+ *        Measurements of the job are written as JPEG COM segment right after SOI/APP0,
+ *        the rest of the picture is copied as it is.
+ *        With CONFIG_KK_PICTURE_PACK archived pictures are appended to the day pack
+ *        given as job path (see kk_pack.h) instead of a file of their own,
+ *        otherwise they are added to picture index of the day.
+ * @param done filled with the processed job (buf is no longer valid after return)
+ * @param wait ticks to wait for a picture
+ * @return ESP_OK if stored, ESP_FAIL on write error, ESP_ERR_TIMEOUT if nothing to write
+ */
+esp_err_t camera_write_next(cam_write_job *done, TickType_t wait);
+
+/**
+ * @brief Gives grabbed slot back to the pool without storing the picture.
+ * @param job slot filled by camera_grab()
+ */
+void camera_release(cam_write_job *job);
+
+/**
+ * @brief Seeds sensor exposure and gain with the preset of the lux band,
+ *        so auto exposure starts close to the scene instead of from the last one.
+ *        Registers go out in one SCCB batch with AEC/AGC switched off, otherwise
+ *        the sensor keeps its own values. Call camera_resume_auto_exposure()
+ *        once a frame was taken with the seed.
+ * @param lux current BH1750 reading
+ * @return index of the preset applied, -1 if sensor is not available or can not be seeded
+ */
+int camera_set_exposure_for_lux(float lux);
+
+/**
+ * @brief Switches AEC/AGC back to the state from camera settings,
+ *        auto exposure continues from the seeded values.
+ */
+void camera_resume_auto_exposure(void);
+
+/**
+ * @brief Rate control: chooses jpeg_quality of the next archived picture, so pictures
+ *        of the day fit into JPEG_DAY_BUDGET_MB, and sets it in the sensor.
+ *        Size of recent archived pictures is the feedback, quality changes by
+ *        JPEG_QUALITY_STEP at most and stays in JPEG_QUALITY_BEST..JPEG_QUALITY_WORST.
+ *        Also refreshes free space of the card.
+ * @param interval current interval between archived pictures in seconds
+ * @return jpeg_quality set
+ */
+int camera_apply_rate_control(time_t interval);
+
+/**
+ * @return copy of rate control state with days until the card is full
+ */
+cam_rate_stats get_cam_rate_stats(void);
+
+/**
+ * @brief Records time-to-good-frame of an archived picture in pipeline statistics.
+ * @param frames number of frames grabbed after exposure preset
+ * @param ms time from exposure preset to the good frame
+ */
+void camera_record_settle(uint32_t frames, uint32_t ms);
+
+/**
+ * @return number of pictures waiting for the writer
+ */
+UBaseType_t camera_pending_writes(void);
+
+/**
+ * @return copy of pipeline statistics
+ */
+cam_pipeline_stats get_cam_pipeline_stats(void);
+
+/**
+ * @brief Queues stored picture for the background thumbnail stage (vThumbTask).
+ *        Never blocks - if the queue is full the picture stays without thumbnail.
+ * @param FileName path of the stored picture
+ * @return ESP_OK if queued
+ */
+esp_err_t queue_thumbnail(const char * FileName);
+
+/**
+ * @brief Adds stored archived picture to the index of its day directory (see kk_picindex.h).
+ * @param FileName path of the picture
+ * @param time time the picture was stored
+ * @param size size of the picture file
+ */
+void picture_index_add(const char * FileName, uint32_t time, uint32_t size);
+
+/**
+ * @brief Marks picture in index of its day as having a thumbnail.
+ * @param FileName path of the picture
+ */
+void picture_index_set_thumb(const char * FileName);
+
+/**
+ * @brief Reads part of picture index of a day. Day without index (archived before
+ *        indexes were introduced) gets it built from directory listing first. Directory
+ *        is scanned without holding the index lock, so archiving is not delayed by it.
+ * @param date day as YYYY/MM/DD
+ * @param first index of the first record to read
+ * @param entries output records
+ * @param max size of entries
+ * @param total filled with number of pictures of the day
+ * @return number of records read
+ */
+size_t picture_index_read(const char * date, uint32_t first, pic_index_entry_t *entries, size_t max, uint32_t *total);
+
+/**
+ * @param FileName buffer of FILEPATH_LEN_MAX for path of the picture
+ * @param wait ticks to wait for request
+ * @return true if FileName holds next picture waiting for thumbnail
+ */
+bool next_thumbnail_request(char * FileName, TickType_t wait);
+
+/**
+ * @brief Builds thumbnail path of the picture: <dir>/THUMB_DIR/<name>
+ * @param FileName path of the picture
+ * @param thumb_path output buffer
+ * @param len size of output buffer
+ * @return true if path fits into the buffer
  */
-esp_err_t camera_capture(char * FileName, size_t *pictureSize);
+bool get_thumb_path(const char * FileName, char * thumb_path, size_t len);
 
 
 #endif /* MAIN_CAMERA_HELPER_H_ */
@@ -9,7 +9,7 @@
  *  Web App Handles for ESP32 Weather Logger
  *
  *  Functions responsible for
- *   - File serving from SD card
+ *   - Sending pictures from day packs
  *   - Responding to Web API calls
  *   - Redirecting / to /index.htm
  *
@@ -17,6 +17,7 @@
 
 #include "esp_wifi.h"
 #include "esp_task_wdt.h"
+#include <math.h>
 #include <time.h>
 #include <app.h>
 
@@ -27,140 +28,97 @@
 
 
 #include "tasks/tasks.h"
+#include "kk_imgproc.h"
+#include "kk_http_util.h"
+#include "kk_series.h"
+#include "camera_helper.h"
 #include "kk_http_app.h"
 #include "kk_http_server_setup.h"
+#include "kk_http_stream.h"
+#include "kk_http_worker.h"
+#include "kk_http_export.h"
+#include "kk_file_cache.h"
+#include "kk_metrics.h"
+#include "metrics_helper.h"
+#include "esp_heap_caps.h"
 
 
 static const char* TAG = "HTTP";
 
+// Large downloads sent by worker tasks (see kk_http_worker.h)
+static worker_lane_t s_pak_lane = {"pak", WORKER_PAK_JOBS, 0};
+
+/**
+ * Current measurements response, pre-serialised for every logged sample (publish_current_measurements())
+ */
+static http_snapshot_t s_measurements_json;
+static portMUX_TYPE s_measurements_json_mux = portMUX_INITIALIZER_UNLOCKED;
+static http_snapshot_t s_measurements_next;    //built by publisher without the lock
+
 
 /*******************************************************************************
  *    Handlers for defined http methods/paths
  *******************************************************************************/
 
 /**
- * Handler to download a file kept on the server
- * @param req Request pointer
- * @return
- *      ESP_OK if success
- *      ESP_FAIL otherwise
+ * \brief Handler to execute HTTP GET /pak/ requests
+ *
+ * Sends N-th picture of day pack for /pak/YYYY/MM/DD/N.jpg (see kk_pack.h).
+ * Only the index record and the picture itself are read from SD card.
  *
+ * @param req Request pointer
+ * @return ESP_OK if success, ESP_FAIL otherwise
  */
-esp_err_t file_get_handler(httpd_req_t *req){
+esp_err_t pak_get_handler(httpd_req_t *req){
+  http_track_request(req);
+  char date[11];
+  char pak_path[FILEPATH_LEN_MAX];
+  unsigned int n = 0;
+  pack_entry_t entry;
   FILE *fd = NULL;
-  char filepath[FILE_PATH_MAX];
-  struct stat file_stat;
-
-  const char *filename = get_path_from_uri(filepath, ((struct file_server_data *)req->user_ctx)->base_path,
-                                           req->uri, sizeof(filepath));
-  if (!filename) {
-      ESP_LOGE(TAG, "Filename is too long");
-      // Respond with 500 Internal Server Error
-      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Filename too long");
-      return ESP_FAIL;
-  }
 
-  ESP_LOGI(TAG, "Resolved filename: %s", filename);
-  // If name has trailing '/', respond with index
-  if (filename[strlen(filename) - 1] == '/') {
-      return index_html_get_handler(req);
+  if(sscanf(req->uri, "/pak/%10[0-9/]/%u.jpg", date, &n) == 2
+      && pack_day_path(CAM_FILE_PATH, date, pak_path, sizeof(pak_path))){
+    fd = pack_open_entry(pak_path, n, &entry);
   }
-
-  if (stat(filepath, &file_stat) == -1) {
-    ESP_LOGE(TAG, "Failed to stat file : %s", filepath);
-    /* Respond with 404 Not Found */
-    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File does not exist");
-    return ESP_FAIL;
-  }
-
-  fd = fopen(filepath, "r");
-  if (!fd) {
-    ESP_LOGE(TAG, "Failed to read existing file : %s", filepath);
-    /* Respond with 500 Internal Server Error */
-    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read existing file");
+  if(!fd){
+    ESP_LOGE(TAG, "Failed to find packed picture: %s", req->uri);
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Picture does not exist");
     return ESP_FAIL;
   }
 
-  ESP_LOGI(TAG, "Sending file : %s (%ld bytes)...", filename, file_stat.st_size);
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  set_content_type_from_file(req, filename);
-
-  // Retrieve the pointer to scratch buffer for temporary storage
+  httpd_resp_set_type(req, "image/jpeg");
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
   char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
-  size_t chunksize;
-  do {
-    // Read file in chunks into the scratch buffer
-    chunksize = fread(chunk, 1, SCRATCH_BUFSIZE, fd);
-    if (chunksize > 0) {
-      // Send the buffer contents as HTTP response chunk
-      if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-        fclose(fd);
-        ESP_LOGE(TAG, "File sending failed!");
-        // Abort sending file
-        httpd_resp_sendstr_chunk(req, NULL);
-        // Respond with 500 Internal Server Error
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-        return ESP_FAIL;
+  size_t left = entry.len;
+  bool offload = true;
+  while(left > 0){
+    // Read no more than this picture from the pack
+    size_t chunksize = fread(chunk, 1, MIN(left, SCRATCH_BUFSIZE), fd);
+    if(chunksize == 0 || httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK){
+      fclose(fd);
+      ESP_LOGE(TAG, "File sending failed!");
+      httpd_resp_sendstr_chunk(req, NULL);
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
+      return ESP_FAIL;
+    }
+    left -= chunksize;
+    // Rest of the picture goes from worker (it closes the pack)
+    if(offload && left > 0){
+      if(worker_submit(req, &s_pak_lane, pak_path, fd, left) == ESP_OK){
+        return ESP_OK;
       }
+      offload = false;
     }
-  // Keep looping till the whole file is sent
-  } while (chunksize != 0);
-
-  // Close file after sending complete
+  }
   fclose(fd);
-  ESP_LOGI(TAG, "File sending complete");
-  // Respond with an empty chunk to signal HTTP response completion
-#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
-  httpd_resp_set_hdr(req, "Connection", "close");
-#endif
   httpd_resp_send_chunk(req, NULL, 0);
   return ESP_OK;
 }
 
-/**
- * \brief Handler to execute HTTP GET /pic_list/ requests
- *
- * Respond with picture list for date given in /pic_list/?DDMMYYY
- *
- * @param req Request pointer
- * @return ESP_OK
- */
-esp_err_t pic_get_handler(httpd_req_t *req){
-  char* list_buf = NULL;
-  char path[MAXNAMLEN+1];
-
-  char* date = strrchr(req->uri, '?'); //get date path from uri which is right after ? sign
-  if(date != NULL) {  //if uri contains parameteters
-    date += 1;
-  }else{              //if not - Respond with 404 Not Found
-    ESP_LOGE(TAG, "Failed to recognize path: %s", req->uri);
-    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Asset does not exist");
-    return ESP_FAIL;
-  }
-
-  list_buf = (char*)malloc(PIC_LIST_BUFFER_SIZE);    //allocate memory
-  if(list_buf == NULL){
-    ESP_LOGE(TAG, "Cannot allocate memory for picture list! Requested size: %i Bytes", PIC_LIST_BUFFER_SIZE);
-    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to allocate memory for file list!");
-    return ESP_FAIL;
-  }
-
-  sprintf(path, "%s/%s", CAM_FILE_PATH, date);
-  ESP_LOGI(TAG, "Generating list of pictures from path %s", path);
-  generate_html_list(path, date, list_buf);
-  ESP_LOGI(TAG, "Zawartosc listy:\n %s", list_buf);
-
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_set_type(req, "text/html");
-#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
-  httpd_resp_set_hdr(req, "Connection", "close");
-#endif
-  httpd_resp_send(req, list_buf, -1);  // Response body can be empty
-  free(list_buf);
-  return ESP_OK;
-}
-
-
 /**
  * \brief Handler to execute HTTP GET /set/ requests
  *
@@ -183,6 +141,7 @@ esp_err_t set_get_handler(httpd_req_t *req){
  * @return ESP_OK
  */
 esp_err_t set_post_handler(httpd_req_t *req){
+  http_track_request(req);
 //  req->uri
   if(strncmp(req->uri, "/set/reset", 10) == 0){
     return reset_send_confirmation(req);
@@ -200,11 +159,22 @@ esp_err_t set_post_handler(httpd_req_t *req){
  * @return ESP_OK
  */
 esp_err_t data_get_handler(httpd_req_t *req){
+  http_track_request(req);
 //  req->uri
   if(strncmp(req->uri + strlen((char*)req->user_ctx), "current_measurements.json", 25) == 0){
     return send_current_measurements(req);
   }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "current_ms.json", 25) == 0){
     return send_current_ms(req);
+  }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "picture_meta.json", 17) == 0){
+    return send_picture_meta(req);
+  }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "pictures", 8) == 0){
+    return send_picture_index(req);
+  }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "series", 6) == 0){
+    return send_series(req);
+  }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "stream", 6) == 0){
+    return stream_get_handler(req);
+  }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "export", 6) == 0){
+    return export_get_handler(req);
 //  }else if(strncmp(req->uri + strlen((char*)req->user_ctx), "history", 7) == 0){
 //    return send_history(req);
   }else{
@@ -225,6 +195,41 @@ esp_err_t index_html_get_handler(httpd_req_t *req){
   return ESP_OK;
 }
 
+/**
+ * Flush callback of metrics writer, sends buffer as a chunk of the response
+ */
+static bool send_metrics_chunk(void *ctx, const char *buf, size_t len){
+  return httpd_resp_send_chunk((httpd_req_t *)ctx, buf, len) == ESP_OK;
+}
+
+/**
+ * \brief Handler of GET /metrics, Prometheus text format scrape
+ *
+ * Tasks (CPU usage since previous scrape, stack), heap, Wi-Fi, sensors, loggers, SD card
+ * and HTTP metrics are formatted straight into scratch buffer and sent chunk by chunk.
+ *
+ * @param req Request pointer
+ * @return ESP_OK, ESP_FAIL on send error
+ */
+esp_err_t metrics_get_handler(httpd_req_t *req){
+  metrics_writer_t w;
+  http_track_request(req);
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
+  metrics_writer_init(&w, ((struct file_server_data *)req->user_ctx)->scratch, SCRATCH_BUFSIZE, send_metrics_chunk, req);
+  write_app_metrics(&w);
+  write_http_metrics(&w);
+  if(!metrics_finish(&w)){
+    ESP_LOGE(TAG, "Metrics sending failed!");
+    return ESP_FAIL;
+  }
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 /*******************************************************************************
  *    Executive methods for specific request uris
  *******************************************************************************/
@@ -236,27 +241,71 @@ esp_err_t index_html_get_handler(httpd_req_t *req){
  * @return ESP_OK
  */
 esp_err_t send_current_measurements(httpd_req_t *req){
-  measurement measurements;
-  time_t now;
+  http_snapshot_t snap;
+  char if_none_match[COND_HDR_MAX_LEN];
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   httpd_resp_set_type(req, "application/x-javascript");
-  char * respond_buf = (char*)malloc(512);
-  now = time(NULL);
-  measurements = get_latest_measurements();
-  sprintf(respond_buf, "{\"time\":\"%lld\",\"int_t\":%3.2F, \"ext_t\":%3.2F, \"humi\":%d, \"sun\":%5.2F, \"press\":%4.2f, \"wind\":%3.3f}\n",
-                (long long)(now),
-                measurements.iTemp,
-                measurements.eTemp,
-                (int)(measurements.humi),
-                measurements.lux,
-                measurements.pres,
-                measurements.wind/ 0.278);
 #ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
   httpd_resp_set_hdr(req, "Connection", "close");
 #endif
-  httpd_resp_send(req, respond_buf, -1);  // Response body can be empty
-  free(respond_buf);
-  return ESP_OK;
+  portENTER_CRITICAL(&s_measurements_json_mux);
+  http_snapshot_copy(&snap, &s_measurements_json);
+  portEXIT_CRITICAL(&s_measurements_json_mux);
+
+  if(snap.version == 0){
+    // No sample published yet (just after start), format current values
+    measurement measurements = get_latest_measurements();
+    snap.len = format_current_measurements(snap.body, sizeof(snap.body), time(NULL), &measurements);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, snap.body, snap.len);
+  }
+  // Polls repeated within one sample are answered with 304
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(req, "ETag", snap.etag);
+  if(http_not_modified(get_req_hdr(req, "If-None-Match", if_none_match, sizeof(if_none_match)), NULL, snap.etag, 0)){
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+  }
+  return httpd_resp_send(req, snap.body, snap.len);
+}
+
+/**
+ * Formats current measurements response (see http_format_current())
+ *
+ * @param out Output buffer
+ * @param len Size of output buffer
+ * @param now Time of the sample
+ * @param measures Measurements
+ * @return Length of formatted body, 0 if it does not fit
+ */
+size_t format_current_measurements(char *out, size_t len, time_t now, const measurement *measures){
+  http_current_t c;
+  c.int_t = measures->iTemp;
+  c.ext_t = measures->eTemp;
+  c.humi = measures->humi;
+  c.sun = measures->lux;
+  c.press = measures->pres;
+  c.wind = measures->wind;
+  return http_format_current(out, len, now, &c);
+}
+
+/**
+ * Formats current measurements response once per logged sample, so requests only copy it.
+ * Body and ETag are made aside, spinlock is held only to copy them.
+ * Called by the logger task only (s_measurements_next has one writer).
+ *
+ * @param now Time of the sample
+ * @param measures Measurements
+ */
+void publish_current_measurements(time_t now, const measurement *measures){
+  char body[HTTP_SNAPSHOT_MAX];
+  size_t len = format_current_measurements(body, sizeof(body), now, measures);
+  if(len == 0 || !http_snapshot_update(&s_measurements_next, (uint32_t)now, body, len)){
+    return;
+  }
+  portENTER_CRITICAL(&s_measurements_json_mux);
+  http_snapshot_copy(&s_measurements_json, &s_measurements_next);
+  portEXIT_CRITICAL(&s_measurements_json_mux);
 }
 
 /**
@@ -280,6 +329,389 @@ esp_err_t send_current_ms(httpd_req_t *req){
   return ESP_OK;
 }
 
+/**
+ * Sends json formatted measurements embedded in a picture at capture time.
+ * Picture is given as /data/picture_meta.json?YYYY/MM/DD/NNN.jpg (path under dcim).
+ * Only JPEG header segments are read from SD card.
+ *
+ * @param req Request pointer
+ * @return ESP_OK, ESP_FAIL if picture has no measurements
+ */
+esp_err_t send_picture_meta(httpd_req_t *req){
+  char path[FILEPATH_LEN_MAX];
+  char meta[JPEG_META_LEN_MAX];
+
+  const char* pic = strchr(req->uri, '?');
+  if(pic == NULL || strstr(pic, "..") != NULL
+      || snprintf(path, sizeof(path), "%s/%s", CAM_FILE_PATH, pic + 1) >= (int)sizeof(path)){
+    ESP_LOGE(TAG, "Failed to recognize path: %s", req->uri);
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Asset does not exist");
+    return ESP_FAIL;
+  }
+  if(jpeg_meta_read_file(path, meta, sizeof(meta)) == 0){
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Picture has no measurements");
+    return ESP_FAIL;
+  }
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_type(req, "application/x-javascript");
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
+  httpd_resp_send(req, meta, -1);
+  return ESP_OK;
+}
+
+#define PIC_LIST_ENTRY_MAX 160  //json of one picture, names up to 11 characters
+
+/**
+ * Streams list of pictures of a day as chunked json:
+ * {"date":"YYYY/MM/DD","total":N,"pictures":[{"name":"001.jpg","url":"dcim/YYYY/MM/DD/001.jpg",
+ *  "thumb":"dcim/YYYY/MM/DD/th/001.jpg","mtime":1677600000,"size":123456},...],"next":K}
+ * "thumb" is null for pictures without thumbnail.
+ * Query: date=YYYY/MM/DD, limit (default PIC_LIST_PAGE), cursor (first picture, default 0).
+ * "next" is the cursor of the following page, null after the last one.
+ * List comes from picture index of the day followed by day pack index (days stored
+ * before packing was enabled have loose pictures too), so there is no stat() per picture
+ * and memory use does not depend on number of pictures.
+ *
+ * @param req Request pointer
+ * @return ESP_OK, ESP_FAIL on invalid query or send error
+ */
+esp_err_t send_picture_index(httpd_req_t *req){
+  char query[64];
+  char date[11] = {0};
+  char param[8];
+  char pak_path[FILEPATH_LEN_MAX];
+  char buf[1024];
+  uint32_t cursor = 0;
+  uint32_t limit = PIC_LIST_PAGE;
+  uint32_t pic_total = 0;
+  uint32_t pack_total = 0;
+  uint32_t total;
+  int len;
+
+  bool valid = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK
+               && httpd_query_key_value(query, "date", date, sizeof(date)) == ESP_OK
+               && strlen(date) == 10 && date[4] == '/' && date[7] == '/'
+               && strspn(date, "0123456789/") == 10;
+  if(!valid){
+    ESP_LOGE(TAG, "Failed to recognize date: %s", req->uri);
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid date, expected YYYY/MM/DD");
+    return ESP_FAIL;
+  }
+  if(httpd_query_key_value(query, "cursor", param, sizeof(param)) == ESP_OK){
+    cursor = strtoul(param, NULL, 10);
+  }
+  if(httpd_query_key_value(query, "limit", param, sizeof(param)) == ESP_OK){
+    limit = MIN(MAX(strtoul(param, NULL, 10), 1UL), 1000UL);
+  }
+
+  pic_index_entry_t entries[4];
+  pack_entry_t pack_entries[4];
+  const size_t batch = sizeof(entries) / sizeof(entries[0]);
+  //loose pictures first, then pictures of the day pack
+  picture_index_read(date, 0, entries, 0, &pic_total);
+  if(pack_day_path(CAM_FILE_PATH, date, pak_path, sizeof(pak_path))){
+    pack_total = pack_count(pak_path);
+  }
+  total = pic_total + pack_total;
+
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_type(req, "application/json");
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
+
+  uint32_t sent = 0;
+  bool first_entry = true;
+  uint32_t unused;
+  len = snprintf(buf, sizeof(buf), "{\"date\":\"%s\",\"total\":%u,\"pictures\":[", date, total);
+  while(sent < limit){
+    uint32_t no = cursor + sent;
+    bool packed = no >= pic_total;
+    size_t want = MIN(limit - sent, batch);
+    size_t n;
+    if(packed){
+      n = pack_total > 0 ? pack_read_index(pak_path, no - pic_total, pack_entries, want) : 0;
+    }else{
+      want = MIN(want, pic_total - no);
+      n = picture_index_read(date, no, entries, want, &unused);
+    }
+    for(size_t i = 0; i < n; i++, no++){
+      if(packed){
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "%s{\"name\":\"%03u.jpg\",\"url\":\"pak/%s/%u.jpg\",\"thumb\":null,\"mtime\":%u,\"size\":%u}",
+                        first_entry ? "" : ",", no - pic_total + 1, date, no - pic_total,
+                        pack_entries[i].time, pack_entries[i].len);
+      }else if(entries[i].flags & PIC_INDEX_THUMB){
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "%s{\"name\":\"%s\",\"url\":\"dcim/%s/%s\",\"thumb\":\"dcim/%s/" THUMB_DIR "/%s\",\"mtime\":%u,\"size\":%u}",
+                        first_entry ? "" : ",", entries[i].name, date, entries[i].name,
+                        date, entries[i].name, entries[i].time, entries[i].size);
+      }else{
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "%s{\"name\":\"%s\",\"url\":\"dcim/%s/%s\",\"thumb\":null,\"mtime\":%u,\"size\":%u}",
+                        first_entry ? "" : ",", entries[i].name, date, entries[i].name,
+                        entries[i].time, entries[i].size);
+      }
+      first_entry = false;
+    }
+    sent += n;
+    //keep room for the next batch (up to PIC_LIST_ENTRY_MAX B per picture) and closing bracket
+    if(n < want || len > (int)sizeof(buf) - (int)batch * PIC_LIST_ENTRY_MAX - 32){
+      if(httpd_resp_send_chunk(req, buf, len) != ESP_OK){
+        ESP_LOGE(TAG, "Picture list sending failed!");
+        httpd_resp_sendstr_chunk(req, NULL);
+        return ESP_FAIL;
+      }
+      len = 0;
+    }
+    if(n < want){
+      break;
+    }
+  }
+  if(cursor + sent < total){
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"next\":%u}\n", cursor + sent);
+  }else{
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"next\":null}\n");
+  }
+  httpd_resp_send_chunk(req, buf, len);
+  httpd_resp_send_chunk(req, NULL, 0);
+  return ESP_OK;
+}
+
+/// Series response state, filled by decimator as log lines are read
+struct series_ctx {
+  httpd_req_t *req;
+  esp_err_t err;
+  bool first;
+  int len;
+  char out[1024];           //json waiting to be sent
+  char read[4096];          //log lines being parsed
+};
+#define SERIES_ROW_MAX 160  //[t,min,max x6] row
+
+static void series_flush(series_ctx *ctx){
+  if(ctx->err == ESP_OK && ctx->len > 0){
+    ctx->err = httpd_resp_send_chunk(ctx->req, ctx->out, ctx->len);
+  }
+  ctx->len = 0;
+}
+
+/**
+ *  Decimator callback, appends bucket as [t,min,max,...] row
+ */
+static void series_emit(void *arg, uint32_t t, const float *min, const float *max, uint8_t n){
+  series_ctx *ctx = (series_ctx *)arg;
+  char *out = ctx->out;
+  const int size = sizeof(ctx->out);
+  ctx->len += snprintf(out + ctx->len, size - ctx->len, "%s[%u", ctx->first ? "" : ",", t);
+  ctx->first = false;
+  for(uint8_t i = 0; i < n; i++){
+    if(isnan(min[i])){
+      ctx->len += snprintf(out + ctx->len, size - ctx->len, ",null,null");
+    }else{
+      ctx->len += snprintf(out + ctx->len, size - ctx->len, ",%.2f,%.2f", min[i], max[i]);
+    }
+  }
+  ctx->len += snprintf(out + ctx->len, size - ctx->len, "]");
+  if(ctx->len > size - SERIES_ROW_MAX){
+    series_flush(ctx);
+  }
+}
+
+/**
+ *  Move log file position close before the first line of given time (lines are in time order)
+ */
+static void series_seek(FILE *f, uint32_t from, char *buf, size_t size){
+  uint32_t t;
+  float v;
+  long lo = 0, hi;
+  fseek(f, 0, SEEK_END);
+  hi = ftell(f);
+  while(hi - lo > (long)size){
+    long mid = lo + (hi - lo) / 2;
+    fseek(f, mid, SEEK_SET);
+    //skip the rest of line mid points into
+    if(fgets(buf, size, f) == NULL || fgets(buf, size, f) == NULL){
+      hi = mid;
+    }else if(series_parse_line(buf, &t, &v, 0) >= 0 && t >= from){
+      hi = mid;
+    }else{
+      lo = mid;
+    }
+  }
+  fseek(f, lo, SEEK_SET);
+}
+
+/**
+ *  Feed decimator with samples of a log file
+ *  @return false if samples past the range were found (no need to read next logs)
+ */
+static bool series_read_log(const char *path, series_decim_t *d, series_ctx *ctx, bool seek){
+  float v[SERIES_MAX_FIELDS];
+  uint32_t t;
+  size_t have = 0;
+  char *buf = ctx->read;
+  const size_t size = sizeof(ctx->read);
+  bool more = true;
+  FILE *f = fopen(path, "r");
+  if(f == NULL){
+    return true;
+  }
+  if(seek){
+    series_seek(f, d->from, buf, size);
+  }
+  while(more && ctx->err == ESP_OK){
+    size_t n = fread(buf + have, 1, size - 1 - have, f);
+    if(n == 0){
+      break;            //unfinished last line is being written by logger
+    }
+    have += n;
+    buf[have] = '\0';
+    char *line = buf, *nl;
+    while(more && (nl = strchr(line, '\n')) != NULL){
+      if(series_parse_line(line, &t, v, SERIES_MAX_FIELDS) > 0){
+        more = t <= d->to;
+        series_decim_add(d, t, v);
+      }
+      line = nl + 1;
+    }
+    have = buf + have - line;
+    if(have == size - 1){
+      have = 0;         //line longer than buffer, not written by logger
+    }
+    memmove(buf, line, have);
+  }
+  fclose(f);
+  return more;
+}
+
+esp_err_t send_series(httpd_req_t *req){
+  char query[128];
+  char param[48];
+  uint8_t fields[SERIES_MAX_FIELDS];
+  uint8_t nfields = 0;
+  uint32_t points = SERIES_POINTS;
+  time_t now = time(NULL);
+  time_t to = now, from;
+  bool raw = false;
+
+  //query is optional, default is last 24 hours of all fields
+  if(httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK){
+    query[0] = '\0';
+  }
+  if(httpd_query_key_value(query, "to", param, sizeof(param)) == ESP_OK){
+    to = MIN((time_t)strtoul(param, NULL, 10), now);
+  }
+  from = to - 86400 + 1;
+  if(httpd_query_key_value(query, "from", param, sizeof(param)) == ESP_OK){
+    from = strtoul(param, NULL, 10);
+  }
+  if(httpd_query_key_value(query, "points", param, sizeof(param)) == ESP_OK){
+    points = MIN(MAX(strtoul(param, NULL, 10), 2UL), (unsigned long)SERIES_POINTS_MAX);
+  }
+  if(httpd_query_key_value(query, "fields", param, sizeof(param)) == ESP_OK){
+    char *save = NULL;
+    for(char *name = strtok_r(param, ",", &save); name != NULL && nfields < SERIES_MAX_FIELDS; name = strtok_r(NULL, ",", &save)){
+      int idx = series_field_index(name);
+      if(idx < 0){
+        nfields = 0;
+        break;
+      }
+      fields[nfields++] = idx;
+    }
+    if(nfields == 0){
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown field");
+      return ESP_FAIL;
+    }
+  }else{
+    for(nfields = 0; nfields < SERIES_MAX_FIELDS; nfields++){
+      fields[nfields] = nfields;
+    }
+  }
+  if(from > to || to - from >= SERIES_MAX_DAYS * 86400){
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid time range");
+    return ESP_FAIL;
+  }
+
+  //handlers run one at a time on the server task, so a single context is reused by all requests,
+  //taken on the first one from PSRAM if there is any
+  static series_ctx *s_series_ctx = NULL;
+  if(s_series_ctx == NULL){
+    s_series_ctx = (series_ctx *)heap_caps_malloc(sizeof(series_ctx), MALLOC_CAP_SPIRAM);
+  }
+  if(s_series_ctx == NULL){
+    s_series_ctx = (series_ctx *)malloc(sizeof(series_ctx));
+  }
+  series_ctx *ctx = s_series_ctx;
+  if(ctx == NULL){
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    return ESP_FAIL;
+  }
+  ctx->req = req;
+  ctx->err = ESP_OK;
+  ctx->first = true;
+  series_decim_t d;
+  series_decim_init(&d, from, to, points, fields, nfields, series_emit, ctx);
+
+  //raw logs only when buckets are shorter than averaging period (or asked for, on short range)
+  if(httpd_query_key_value(query, "source", param, sizeof(param)) == ESP_OK && strcmp(param, "auto") != 0){
+    raw = strcmp(param, "raw") == 0;
+  }else{
+    raw = d.step < (uint32_t)(AVG_MESUREMENTS_NO * LOGGING_INTERVAL_MS / 1000);
+  }
+  raw = raw && to - from < SERIES_RAW_MAX_DAYS * 86400;
+  const char *dir = raw ? SD_MOUNT_POINT LOG_FILE_DIR : SD_MOUNT_POINT AVG_LOG_FILE_DIR;
+
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_type(req, "application/json");
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
+  ctx->len = snprintf(ctx->out, sizeof(ctx->out), "{\"from\":%lld,\"to\":%lld,\"step\":%u,\"source\":\"%s\",\"fields\":[",
+                      (long long)from, (long long)to, d.step, raw ? "raw" : "avg");
+  for(uint8_t i = 0; i < nfields; i++){
+    ctx->len += snprintf(ctx->out + ctx->len, sizeof(ctx->out) - ctx->len, "%s\"%s\"", i ? "," : "",
+                         series_field_name(fields[i]));
+  }
+  ctx->len += snprintf(ctx->out + ctx->len, sizeof(ctx->out) - ctx->len, "],\"rows\":[");
+
+  //one log file a day: archived as DDMMYY.CSV, today's is CURRENT.CSV
+  struct tm day_tm, today_tm;
+  char path[FILEPATH_LEN_MAX];
+  localtime_r(&now, &today_tm);
+  today_tm.tm_hour = today_tm.tm_min = today_tm.tm_sec = 0;
+  time_t today = mktime(&today_tm);
+  localtime_r(&from, &day_tm);
+  day_tm.tm_hour = day_tm.tm_min = day_tm.tm_sec = 0;
+  day_tm.tm_isdst = -1;
+  for(time_t day = mktime(&day_tm); day <= to && ctx->err == ESP_OK; day = mktime(&day_tm)){
+    if(day >= today){
+      snprintf(path, sizeof(path), "%s/CURRENT.CSV", dir);
+    }else{
+      snprintf(path, sizeof(path), "%s/%02d%02d%02d.CSV", dir, day_tm.tm_mday, day_tm.tm_mon + 1, day_tm.tm_year - 100);
+    }
+    if(!series_read_log(path, &d, ctx, day <= from)){
+      break;
+    }
+    day_tm.tm_mday++;
+    day_tm.tm_isdst = -1;
+  }
+  series_decim_flush(&d);
+  ESP_LOGI(TAG, "Series %lld-%lld: %u samples -> %u rows", (long long)from, (long long)to, d.samples, d.rows);
+
+  ctx->len += snprintf(ctx->out + ctx->len, sizeof(ctx->out) - ctx->len, "]}\n");
+  series_flush(ctx);
+  esp_err_t err = ctx->err;
+  if(err != ESP_OK){
+    ESP_LOGE(TAG, "Series sending failed!");
+    httpd_resp_sendstr_chunk(req, NULL);
+    return ESP_FAIL;
+  }
+  httpd_resp_send_chunk(req, NULL, 0);
+  return ESP_OK;
+}
 
 /**
  * Sends confirmation and execute software reset
@@ -314,118 +746,3 @@ esp_err_t reset_send_confirmation(httpd_req_t *req){
 //  for(;;) vTaskDelay(pdMS_TO_TICKS(1000));  //wait forever
   return ESP_OK;
 }
-
-/*******************************************************************************
- *    Helper methods for http app
- *******************************************************************************/
-
-/**
- *  Set HTTP response content type according to file extension
- */
-esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename){
-  if(IS_FILE_EXT(filename, ".pdf")){
-    return httpd_resp_set_type(req, "application/pdf");
-  }else if (IS_FILE_EXT(filename, ".html")){
-    return httpd_resp_set_type(req, "text/html");
-  }else if (IS_FILE_EXT(filename, ".htm")){
-    return httpd_resp_set_type(req, "text/html");
-  }else if (IS_FILE_EXT(filename, ".jpeg")){
-    return httpd_resp_set_type(req, "image/jpeg");
-  }else if (IS_FILE_EXT(filename, ".ico")){
-    return httpd_resp_set_type(req, "image/x-icon");
-  }else if (IS_FILE_EXT(filename, ".css")){
-    return httpd_resp_set_type(req, "text/css");
-  }else if (IS_FILE_EXT(filename, ".js")){
-    return httpd_resp_set_type(req, "application/x-javascript");
-  }else if (IS_FILE_EXT(filename, ".xml")){
-    return httpd_resp_set_type(req, "application/xml");
-  }else if (IS_FILE_EXT(filename, ".gif")){
-    return httpd_resp_set_type(req, "image/gif");
-  }else if (IS_FILE_EXT(filename, ".png")){
-    return httpd_resp_set_type(req, "image/png");
-  }else if (IS_FILE_EXT(filename, ".3gp")){
-    return httpd_resp_set_type(req, "video/mpeg");
-  }else if (IS_FILE_EXT(filename, ".json")){
-    return httpd_resp_set_type(req, "text/json");
-  }else if (IS_FILE_EXT(filename, ".csv")){
-    return httpd_resp_set_type(req, "application/CSV");
-  }// This is a limited set only. For any other type always set as plain text
-  return httpd_resp_set_type(req, "text/plain");
-}
-
-/**
- * Copies the full path into destination buffer and returns
- * pointer to path (skipping the preceding base path)
- */
-const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize){
-  const size_t base_pathlen = strlen(base_path);
-  size_t pathlen = strlen(uri);
-
-  const char *quest = strchr(uri, '?');
-  if (quest) {
-    pathlen = MIN(pathlen, quest - uri);
-  }
-  const char *hash = strchr(uri, '#');
-  if (hash) {
-    pathlen = MIN(pathlen, hash - uri);
-  }
-  if (base_pathlen + pathlen + 1 > destsize) {
-    return NULL;  // Full path string won't fit into destination buffer
-  }
-  // Construct full path (base + path)
-  strcpy(dest, base_path);
-  strlcpy(dest + base_pathlen, uri, pathlen + 1);
-  // Return pointer to path, skipping the base
-  return dest + base_pathlen;
-}
-
-
-/**
- * Generating html numbered list of links to pictures for given path
- * @param path Path to directory for which list is created
- * @param date  Date that files must match
- * @param list_buf pointer to preallocated buffer for generated list
- */
-void generate_html_list(char* path, char* date, char *list_buf) {
-  struct tm tm_file;
-  char time_str[32];
-  int cx = 0;
-  struct dirent* entry;
-  struct stat file_stat;
-  char file_path[FILEPATH_LEN_MAX];
-
-  cx = sprintf(list_buf, "<ol id=\"pic_list\">\n");
-  if(cx > 0) { list_buf += cx; }
-
-  //if directory don't exist - generate empty list and return
-  DIR* dir = opendir(path);
-  if (!dir) {
-    ESP_LOGE(TAG, "Failed to open directory %s", path);
-    sprintf(list_buf, "</ol>\n");
-    return;
-  }
-
-  while ((entry = readdir(dir)) != NULL) {
-    if (entry->d_type == DT_REG) {
-      char* file_ext = strrchr(entry->d_name, '.');
-      if (file_ext && strcmp(file_ext, ".jpg") == 0) {
-
-        #pragma GCC diagnostic push // use compiler specific pragmas to disable the "directive output may be truncated writing" error
-        #pragma GCC diagnostic ignored "-Wformat-truncation"
-        snprintf(file_path, FILEPATH_LEN_MAX, "%s/%s", path, entry->d_name);
-        #pragma GCC diagnostic pop
-
-        if (stat(file_path, &file_stat) == 0) {
-          localtime_r(&file_stat.st_mtime, &tm_file);
-          strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_file);
-          cx = sprintf(list_buf, "<li><a href=\"dcim/%s/%s\">%s</a> - %s</li>\n", date, entry->d_name, entry->d_name, time_str);
-          if(cx > 0) { list_buf += cx; }
-        } else {
-          ESP_LOGE(TAG, "Failed to stat file %s", file_path);
-        }
-      }
-    }
-  }
-  sprintf(list_buf, "</ol>\n");
-  closedir(dir);
-}
@@ -21,6 +21,7 @@
 #include <esp_tls_crypto.h>
 #include <esp_http_server.h>
 #include <esp_https_server.h>
+#include "kk_http_file.h"
 
 #ifndef COMPONENTS_KK_HTTP_APP_
 #define COMPONENTS_KK_HTTP_APP_
@@ -32,27 +33,19 @@
 /// Helper macro for checking file extension
 #define IS_FILE_EXT(filename, ext) (strcasecmp(&filename[strlen(filename) - sizeof(ext) + 1], ext) == 0)
 
-/*#****************************************************************************/
-
+struct measurement;   //app.h
 
-/**
- * Handler to download a file kept on the server
- * @param req Request pointer
- * @return
- *      ESP_OK if success
- *      ESP_FAIL otherwise
- */
-esp_err_t file_get_handler(httpd_req_t *req);
+/*#****************************************************************************/
 
 /**
- * \brief Handler to execute HTTP GET /pic/ requests
+ * \brief Handler to execute HTTP GET /pak/ requests
  *
- * Respond with picture OL list for date given in /pic/?DDMMYYY
+ * Sends N-th picture of day pack for /pak/YYYY/MM/DD/N.jpg
  *
  * @param req Request pointer
- * @return ESP_OK
+ * @return ESP_OK if success, ESP_FAIL otherwise
  */
-esp_err_t pic_get_handler(httpd_req_t *req);
+esp_err_t pak_get_handler(httpd_req_t *req);
 
 /**
  * Handler to redirect incoming GET request for / to /index.html
@@ -89,13 +82,45 @@ esp_err_t set_post_handler(httpd_req_t *req);
 esp_err_t data_get_handler(httpd_req_t *req);
 
 /**
- * Sends json formatted fresh measurements as a http response
+ * \brief Handler of GET /metrics, Prometheus text format scrape
+ *
+ * Tasks (CPU usage since previous scrape, stack), heap, Wi-Fi, sensors, loggers, SD card
+ * and HTTP metrics are formatted straight into scratch buffer and sent chunk by chunk.
+ *
+ * @param req Request pointer
+ * @return ESP_OK, ESP_FAIL on send error
+ */
+esp_err_t metrics_get_handler(httpd_req_t *req);
+
+/**
+ * Sends json formatted current measurements as a http response.
+ * Body is pre-serialised by publish_current_measurements() for every logged sample.
  *
  * @param req Request pointer
  * @return ESP_OK
  */
 esp_err_t send_current_measurements(httpd_req_t *req);
 
+/**
+ * Formats current measurements response, wind is sent in km/h (see http_format_current())
+ *
+ * @param out Output buffer
+ * @param len Size of output buffer
+ * @param now Time of the sample
+ * @param measures Measurements
+ * @return Length of formatted body, 0 if it does not fit
+ */
+size_t format_current_measurements(char *out, size_t len, time_t now, const measurement *measures);
+
+/**
+ * Formats current measurements response once per logged sample, so requests only copy it
+ * (with ETag, unchanged polls get 304). Called by the logger task only.
+ *
+ * @param now Time of the sample
+ * @param measures Measurements
+ */
+void publish_current_measurements(time_t now, const measurement *measures);
+
 /**
  * Sends json formatted up time as a http response
  *
@@ -105,48 +130,42 @@ esp_err_t send_current_measurements(httpd_req_t *req);
 esp_err_t send_current_ms(httpd_req_t *req);
 
 /**
- * Sends confirmation and execute software reset
+ * Sends json formatted measurements embedded in a picture at capture time
+ * (see camera_write_next()). Picture is given as /data/picture_meta.json?YYYY/MM/DD/NNN.jpg
  *
  * @param req Request pointer
- * @return ESP_OK
+ * @return ESP_OK, ESP_FAIL if picture has no measurements
  */
-esp_err_t reset_send_confirmation(httpd_req_t *req);
-
+esp_err_t send_picture_meta(httpd_req_t *req);
 
 /**
- *  Set HTTP response content type according to file extension
- * @param req Request data
- * @param filename Pointer to filename
- * @return Error codes from @see httpd_resp_set_type()
+ * Streams list of pictures of a day as chunked json, page by page.
+ * Day is given as /data/pictures?date=YYYY/MM/DD&limit=N&cursor=K
  *
+ * @param req Request pointer
+ * @return ESP_OK, ESP_FAIL on invalid query or send error
  */
-esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename);
+esp_err_t send_picture_index(httpd_req_t *req);
 
 /**
- * Copies the full path into destination buffer and returns
- * pointer to path (skipping the preceding base path)
- */
-/**
- * Copies the full path into destination buffer and returns
- * pointer to path (skipping the preceding base path)
- *
- * @param dest  Destination buffer pointer
- * @param base_path web server base path (i.e. /sd/www)
- * @param uri   requested uri
- * @param destsize  size of destination buffer
- * @return
- *      NULL when fail
- *      Pointer to path, skipping the base
+ * Streams measurements of a time range read from logs, decimated to min/max buckets (see kk_series.h).
+ * Query: /data/series?from=T&to=T&fields=int_t,ext_t&points=N&source=auto|raw|avg
+ * Response: {"from":T,"to":T,"step":S,"source":"avg","fields":[..],"rows":[[t,min,max,min,max..],..]}
+ *
+ * @param req Request pointer
+ * @return ESP_OK, ESP_FAIL on invalid query or send error
  */
-const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize);
+esp_err_t send_series(httpd_req_t *req);
 
 /**
+ * Sends confirmation and execute software reset
  *
- * @param path Path to directory
- * @param date Date of interest
- * @param list_buf pointer to buffer for generated list. Buffer must be initialized and huge (recommended is 32KB)
+ * @param req Request pointer
+ * @return ESP_OK
  */
-void generate_html_list(char* path, char* date, char *list_buf);
+esp_err_t reset_send_confirmation(httpd_req_t *req);
+
+
 
 
 //#ifdef __cplusplus
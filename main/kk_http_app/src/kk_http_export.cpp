@@ -0,0 +1,398 @@
+/**
+ *  kk_http_export.cpp
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Tar export of logs and pictures of a date range (/data/export)
+ *
+ *  Archive is built on the fly and never stored on the card: every file gets ustar header
+ *  (see kk_tar.h) and is read straight into the chunk buffer, which is sent to the client
+ *  socket as soon as it is full. Memory use is one EXPORT_BUFSIZE buffer whatever the range.
+ *  Names are paths relative to the card (www/logs/..., www/dcim/...), so extracting the
+ *  archive on a card restores the files in place.
+ *
+ *  Like worker jobs (see kk_http_worker.h) the export is built by its own task, server task
+ *  hands the session over after headers and first block and sends the chunks passed to it
+ *  (see kk_http_sock.h). Export task has the lowest priority of SD card users, so loggers
+ *  and camera preempt it, and it holds the card only for one buffer read at a time.
+ *  Reads wait while pictures are queued for the camera writer or a logger appends its log.
+ *  Slow client is back-pressure too: blocked send stops reading.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include <app.h>
+#include "kk_http_export.h"
+#include "kk_http_server_setup.h"
+#include "kk_http_sock.h"
+#include "kk_tar.h"
+#include "camera_helper.h"
+
+
+static const char* TAG = "HTTP_EXP";
+
+#define EXPORT_LOGS  0x01
+#define EXPORT_PICS  0x02
+
+/// Room for chunk size line ("1000\r\n") in front of the data and CRLF behind it
+#define CHUNK_HDR_MAX  8
+#define CHUNK_BUF_SIZE  (CHUNK_HDR_MAX + EXPORT_BUFSIZE + 2)
+
+/// Archive names are paths relative to the card
+#define CARD_PATH(path)  ((path) + sizeof(SD_MOUNT_POINT))
+
+typedef struct {
+  bool busy;              //export is being sent
+  volatile bool aborted;  //socket closed or server stopping
+  int fd;                 //client socket
+  time_t from;
+  time_t to;
+  uint8_t what;           //EXPORT_LOGS | EXPORT_PICS
+} export_job_t;
+
+/// Chunk being filled
+typedef struct {
+  sock_session_t s;       //client session, sends are done by server task
+  char *buf;              //CHUNK_BUF_SIZE, data starts at CHUNK_HDR_MAX
+  size_t len;             //data bytes in buffer
+  uint32_t files;
+  uint64_t bytes;
+} export_out_t;
+
+static export_job_t s_job;
+static httpd_handle_t s_server = NULL;
+static TaskHandle_t s_task = NULL;
+static portMUX_TYPE s_export_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char s_last_chunk[] = "0\r\n\r\n";
+
+
+/*******************************************************************************
+ *    Helpers
+ *******************************************************************************/
+
+/**
+ * Sends data waiting in the buffer as one HTTP chunk
+ */
+static bool out_flush(export_out_t *o){
+  char size_line[CHUNK_HDR_MAX + 1];
+  if(o->len == 0){
+    return !s_job.aborted;
+  }
+  char *data = o->buf + CHUNK_HDR_MAX;
+  int hdr = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)o->len);
+  memcpy(data - hdr, size_line, hdr);
+  data[o->len] = '\r';
+  data[o->len + 1] = '\n';
+  bool ok = sock_send_all(&o->s, data - hdr, hdr + o->len + 2);
+  o->bytes += o->len;
+  o->len = 0;
+  return ok;
+}
+
+/**
+ * Appends data (zeros if data is NULL) to the archive
+ */
+static bool out_put(export_out_t *o, const void *data, size_t len){
+  while(len > 0){
+    size_t n = MIN(len, EXPORT_BUFSIZE - o->len);
+    if(data){
+      memcpy(o->buf + CHUNK_HDR_MAX + o->len, data, n);
+      data = (const uint8_t *)data + n;
+    }else{
+      memset(o->buf + CHUNK_HDR_MAX + o->len, 0, n);
+    }
+    o->len += n;
+    len -= n;
+    if(o->len == EXPORT_BUFSIZE && !out_flush(o)){
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Waits while pictures are queued for the camera writer or loggers append their logs,
+ * they go to the card first
+ */
+static void yield_to_writers(void){
+  while((camera_pending_writes() > 0 || log_appends_pending() > 0) && !s_job.aborted){
+    vTaskDelay(pdMS_TO_TICKS(EXPORT_BACKOFF_MS));
+  }
+}
+
+/**
+ * Appends file to the archive. Size is taken when the file is opened, if file grows
+ * (current log) later lines are left out, if it cannot be read rest of data is zeroed.
+ * @return false on send error
+ */
+static bool export_file(export_out_t *o, const char *path){
+  struct stat st;
+  uint8_t block[TAR_BLOCK_SIZE];
+  if(stat(path, &st) != 0 || !S_ISREG(st.st_mode)){
+    return true;      //no log or picture that day
+  }
+  if(!tar_header(block, CARD_PATH(path), st.st_size, st.st_mtime, TAR_TYPE_FILE)){
+    ESP_LOGW(TAG, "Name too long, skipping: %s", path);
+    return true;
+  }
+  int file = open(path, O_RDONLY);
+  if(file < 0){
+    ESP_LOGW(TAG, "Failed to open, skipping: %s", path);
+    return true;
+  }
+  bool ok = out_put(o, block, sizeof(block));
+  size_t left = st.st_size;
+  while(ok && left > 0){
+    yield_to_writers();
+    ssize_t n = read(file, o->buf + CHUNK_HDR_MAX + o->len, MIN(left, EXPORT_BUFSIZE - o->len));
+    if(n <= 0){
+      ESP_LOGE(TAG, "Failed to read: %s", path);
+      ok = out_put(o, NULL, left);    //keep the archive valid
+      break;
+    }
+    o->len += n;
+    left -= n;
+    if(o->len == EXPORT_BUFSIZE){
+      ok = out_flush(o);
+    }
+  }
+  close(file);
+  o->files++;
+  return ok && out_put(o, NULL, tar_padding(st.st_size));
+}
+
+/**
+ * Appends files of the directory to the archive, subdirectories (thumbnails) up to depth
+ * @return false on send error
+ */
+static bool export_dir(export_out_t *o, const char *dir, int depth){
+  char path[FILE_PATH_MAX];
+  bool ok = true;
+  DIR *d = opendir(dir);
+  if(d == NULL){
+    return true;      //no pictures that day
+  }
+  struct dirent *entry;
+  while(ok && (entry = readdir(d)) != NULL){
+    if(entry->d_name[0] == '.'){
+      continue;
+    }
+    if(snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) >= (int)sizeof(path)){
+      ESP_LOGW(TAG, "Path too long, skipping: %s/%s", dir, entry->d_name);
+      continue;
+    }
+    if(entry->d_type == DT_DIR){
+      ok = depth <= 0 || export_dir(o, path, depth - 1);
+    }else{
+      ok = export_file(o, path);
+    }
+  }
+  closedir(d);
+  return ok;
+}
+
+/**
+ * Streams files of all days of the job, one log file a day (archived as DDMMYY.CSV,
+ * today's is CURRENT.CSV) and pictures directory of the day.
+ * @return false on send error
+ */
+static bool export_days(export_out_t *o){
+  char path[FILE_PATH_MAX];
+  struct tm day_tm, today_tm;
+  bool ok = true;
+  time_t now = time(NULL);
+  localtime_r(&now, &today_tm);
+  today_tm.tm_hour = today_tm.tm_min = today_tm.tm_sec = 0;
+  time_t today = mktime(&today_tm);
+  localtime_r(&s_job.from, &day_tm);
+  day_tm.tm_hour = day_tm.tm_min = day_tm.tm_sec = 0;
+  day_tm.tm_isdst = -1;
+  for(time_t day = mktime(&day_tm); ok && !s_job.aborted && day <= s_job.to; day = mktime(&day_tm)){
+    if(s_job.what & EXPORT_LOGS){
+      static const char *dirs[] = {SD_MOUNT_POINT LOG_FILE_DIR, SD_MOUNT_POINT AVG_LOG_FILE_DIR};
+      for(int i = 0; i < 2 && ok; i++){
+        if(day >= today){
+          snprintf(path, sizeof(path), "%s/CURRENT.CSV", dirs[i]);
+        }else{
+          snprintf(path, sizeof(path), "%s/%02d%02d%02d.CSV", dirs[i], day_tm.tm_mday, day_tm.tm_mon + 1,
+                   day_tm.tm_year - 100);
+        }
+        ok = export_file(o, path);
+      }
+    }
+    if(ok && (s_job.what & EXPORT_PICS)){
+      if(snprintf(path, sizeof(path), "%s/%04d/%02d/%02d", CAM_FILE_PATH, day_tm.tm_year + 1900, day_tm.tm_mon + 1,
+                  day_tm.tm_mday) < (int)sizeof(path)){
+        ok = export_dir(o, path, 1);
+      }
+    }
+    day_tm.tm_mday++;
+    day_tm.tm_isdst = -1;
+  }
+  return ok;
+}
+
+static void vHttpExportTask(void *arg){
+  SemaphoreHandle_t done = xSemaphoreCreateBinary();    //sends done by server task
+  while(1){
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    export_out_t out = {};
+    portENTER_CRITICAL(&s_export_mux);
+    out.s.hd = s_server;
+    portEXIT_CRITICAL(&s_export_mux);
+    out.s.fd = s_job.fd;
+    out.s.aborted = &s_job.aborted;
+    out.s.done = done;
+    //SD host reads by DMA straight into internal RAM, PSRAM would need bounce buffer
+    out.buf = (char *)heap_caps_malloc(CHUNK_BUF_SIZE, MALLOC_CAP_DMA);
+    int64_t start_us = esp_timer_get_time();
+    bool ok = out.s.hd != NULL && out.buf != NULL && export_days(&out)
+              && out_put(&out, NULL, TAR_END_BLOCKS * TAR_BLOCK_SIZE) && out_flush(&out)
+              && sock_send_all(&out.s, s_last_chunk, sizeof(s_last_chunk) - 1);
+    free(out.buf);
+    if(ok){
+      ESP_LOGI(TAG, "Export complete: %u files, %u kB in %u s", out.files, (unsigned)(out.bytes / 1024),
+               (unsigned)((esp_timer_get_time() - start_us) / 1000000));
+    }else if(!s_job.aborted){
+      ESP_LOGE(TAG, "Export failed after %u files", out.files);
+    }
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+    ok = false;     //response had Connection: close
+#endif
+    if(!ok && out.s.hd != NULL){
+      sock_close(&out.s);
+    }
+    portENTER_CRITICAL(&s_export_mux);
+    s_job.busy = false;
+    portEXIT_CRITICAL(&s_export_mux);
+  }
+}
+
+
+/*******************************************************************************
+ *    Export API
+ *******************************************************************************/
+
+void export_start(httpd_handle_t server){
+  if(s_task == NULL){
+    xTaskCreatePinnedToCore(vHttpExportTask, "HTTPEXP", EXPORT_STACK_SIZE, NULL, HTTP_EXPORT_TASK_PRIO, &s_task,
+                            tskNO_AFFINITY);
+  }
+  portENTER_CRITICAL(&s_export_mux);
+  s_server = server;
+  portEXIT_CRITICAL(&s_export_mux);
+}
+
+void export_stop(void){
+  portENTER_CRITICAL(&s_export_mux);
+  s_server = NULL;
+  s_job.aborted = true;
+  portEXIT_CRITICAL(&s_export_mux);
+  //export stops before next chunk or read, blocked send times out at worst
+  for(int t = 0; t < WORKER_STOP_WAIT_MS && s_job.busy; t += 10){
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+esp_err_t export_get_handler(httpd_req_t *req){
+  char query[128];
+  char param[48];
+  char disposition[112];
+  uint8_t block[TAR_BLOCK_SIZE];
+  time_t now = time(NULL);
+  time_t to = now, from;
+  uint8_t what = EXPORT_LOGS | EXPORT_PICS;
+
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  if(httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK){
+    query[0] = '\0';
+  }
+  if(httpd_query_key_value(query, "to", param, sizeof(param)) == ESP_OK){
+    to = MIN((time_t)strtoul(param, NULL, 10), now);
+  }
+  from = to - 7 * 86400 + 1;
+  if(httpd_query_key_value(query, "from", param, sizeof(param)) == ESP_OK){
+    from = strtoul(param, NULL, 10);
+  }
+  if(httpd_query_key_value(query, "what", param, sizeof(param)) == ESP_OK){
+    what = (strstr(param, "logs") ? EXPORT_LOGS : 0) | (strstr(param, "pics") ? EXPORT_PICS : 0);
+  }
+  if(what == 0 || from > to || to - from >= EXPORT_MAX_DAYS * 86400){
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid time range or content");
+    return ESP_FAIL;
+  }
+
+  portENTER_CRITICAL(&s_export_mux);
+  bool refused = s_job.busy || s_server == NULL || s_task == NULL;
+  if(!refused){
+    s_job.busy = true;
+    s_job.aborted = false;
+    s_job.fd = httpd_req_to_sockfd(req);
+    s_job.from = from;
+    s_job.to = to;
+    s_job.what = what;
+  }
+  portEXIT_CRITICAL(&s_export_mux);
+  if(refused){
+    ESP_LOGW(TAG, "Export in progress, refusing %d", httpd_req_to_sockfd(req));
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "60");
+    httpd_resp_sendstr(req, "Export in progress");
+    return ESP_OK;
+  }
+
+  struct tm from_tm, to_tm;
+  localtime_r(&from, &from_tm);
+  localtime_r(&to, &to_tm);
+  snprintf(disposition, sizeof(disposition), "attachment; filename=\"export-%04d%02d%02d-%04d%02d%02d.tar\"",
+           from_tm.tm_year + 1900, from_tm.tm_mon + 1, from_tm.tm_mday, to_tm.tm_year + 1900, to_tm.tm_mon + 1, to_tm.tm_mday);
+  httpd_resp_set_type(req, "application/x-tar");
+  httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
+  //first chunk carries headers and the top directory entry, files follow from export task
+  tar_header(block, CARD_PATH(WWW_BASE_PATH "/"), 0, now, TAR_TYPE_DIR);
+  if(httpd_resp_send_chunk(req, (const char *)block, sizeof(block)) != ESP_OK){
+    portENTER_CRITICAL(&s_export_mux);
+    s_job.busy = false;
+    portEXIT_CRITICAL(&s_export_mux);
+    return ESP_FAIL;
+  }
+  ESP_LOGI(TAG, "Export %lld-%lld (%s%s) started for %d", (long long)from, (long long)to,
+           (what & EXPORT_LOGS) ? "logs " : "", (what & EXPORT_PICS) ? "pics" : "", s_job.fd);
+  xTaskNotifyGive(s_task);
+  return ESP_OK;
+}
+
+void export_on_close(httpd_handle_t hd, int sockfd){
+  portENTER_CRITICAL(&s_export_mux);
+  if(s_job.busy && s_job.fd == sockfd){
+    s_job.aborted = true;
+  }
+  portEXIT_CRITICAL(&s_export_mux);
+}
+
+bool export_holds(int sockfd){
+  portENTER_CRITICAL(&s_export_mux);
+  bool held = s_job.busy && s_job.fd == sockfd;
+  portEXIT_CRITICAL(&s_export_mux);
+  return held;
+}
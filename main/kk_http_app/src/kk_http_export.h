@@ -0,0 +1,56 @@
+/**
+ *  kk_http_export.h
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Tar export of logs and pictures of a date range (/data/export)
+ *
+ */
+
+#include <esp_http_server.h>
+
+#ifndef COMPONENTS_KK_HTTP_EXPORT_
+#define COMPONENTS_KK_HTTP_EXPORT_
+
+/**
+ * Creates export task (first call only) and starts accepting exports. Called by start_webserver().
+ * @param server Server handle
+ */
+void export_start(httpd_handle_t server);
+
+/**
+ * Stops accepting exports and aborts running one. Must be called before the server is stopped.
+ */
+void export_stop(void);
+
+/**
+ * Handler of GET /data/export?from=T&to=T&what=logs,pics
+ * Sends response headers and first block of tar archive, the rest is streamed by export task.
+ * Range defaults to last 7 days (up to now) and both logs and pictures, at most EXPORT_MAX_DAYS.
+ * One export runs at a time, other clients get 503.
+ *
+ * @param req Request pointer
+ * @return
+ *      ESP_OK if export is started (also when client is refused with 400 or 503)
+ *      ESP_FAIL if first block could not be sent
+ */
+esp_err_t export_get_handler(httpd_req_t *req);
+
+/**
+ * Aborts export of closed socket. Called by session close callback of the server.
+ *
+ * @param hd Server handle
+ * @param sockfd Socket being closed
+ */
+void export_on_close(httpd_handle_t hd, int sockfd);
+
+/**
+ * @param sockfd Client socket
+ * @return true if export of the socket is running
+ */
+bool export_holds(int sockfd);
+
+#endif /* COMPONENTS_KK_HTTP_EXPORT_ */
@@ -0,0 +1,472 @@
+/**
+ *  kk_http_file.cpp
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  File serving from SD card (any GET not matched by other handlers)
+ *
+ *  Validators and Cache-Control policy, conditional and single range requests,
+ *  pre-compressed (.gz) siblings of static assets and their cache of PSRAM.
+ *  Files longer than the scratch buffer are finished by worker tasks (see kk_http_worker.h).
+ *
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "kk_http_util.h"
+#include "kk_file_cache.h"
+#include "kk_http_app.h"
+#include "kk_http_file.h"
+#include "kk_http_server_setup.h"
+#include "kk_http_worker.h"
+
+
+static const char* TAG = "HTTP_FILE";
+
+/**
+ * Cache-Control policies of files served from SD card, first match wins.
+ * Stored pictures and thumbnails never change once written, so browsers may keep them for good.
+ * Everything that grows or is rewritten (logs, packs and indexes of current day, current picture)
+ * is always revalidated, which costs only a 304 thanks to ETag / Last-Modified.
+ */
+static const http_cache_rule_t s_cache_rules[] = {
+  {"CURRENT.*",   "no-cache"},                     //logs being written
+  {"*.idx",       "no-cache"},                     //picture and pack indexes of current day grow
+  {"/dcim/0/*",   "no-cache"},                     //current picture
+  {"/dcim/*.jpg", "max-age=31536000, immutable"},  //stored pictures and thumbnails
+  {"/dcim/*",     "no-cache"},                     //packs of current day grow
+  {"/logs/*",     "no-cache"},                     //day logs and averages are appended to
+  {"/fonts/*",    "max-age=2592000"},
+  {"/js/*",       "max-age=86400"},
+  {"/css/*",      "max-age=86400"},
+  {"*.ico",       "max-age=2592000"},
+  {"*.png",       "max-age=2592000"},
+  {"*.jpg",       "max-age=86400"},
+};
+/**
+ * Cache of .gz siblings of static assets, so the existence check costs no stat() per request.
+ * Entries are made for size and mtime of the original, so uploading new version of a file
+ * (together with its regenerated .gz) is noticed on the next request.
+ */
+typedef struct {
+  uint32_t hash;      //FNV-1a of original path, 0 = empty slot
+  off_t size;         //original file the entry is valid for
+  time_t mtime;
+  off_t gz_size;      //.gz sibling, 0 if there is none
+  time_t gz_mtime;
+} gz_cache_entry_t;
+static gz_cache_entry_t s_gz_cache[GZ_CACHE_SIZE];
+static portMUX_TYPE s_gz_cache_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Large files sent by worker tasks (see kk_http_worker.h)
+static worker_lane_t s_file_lane = {"file", WORKER_FILE_JOBS, 0};
+
+/**
+ * Cache of static web assets in PSRAM. Used only by the server task (file_get_handler),
+ * entries are valid for size and mtime of the file.
+ */
+static file_cache_t s_www_cache;
+static bool s_www_cache_ready = false;
+// Copy of cache statistics for other tasks, 64-bit counters can not be read unlocked
+static file_cache_stats_t s_www_cache_stats;
+static portMUX_TYPE s_www_cache_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static file_cache_t *www_cache(void);
+static void publish_www_cache_stats(void);
+
+#define CACHE_CONTROL_DEFAULT "no-cache"           //pages and anything else
+
+
+/*******************************************************************************
+ *    Handler
+ *******************************************************************************/
+
+/**
+ * Handler to download a file kept on the server
+ * @param req Request pointer
+ * @return
+ *      ESP_OK if success
+ *      ESP_FAIL otherwise
+ *
+ */
+esp_err_t file_get_handler(httpd_req_t *req){
+  FILE *fd = NULL;
+  char filepath[FILE_PATH_MAX];
+  struct stat file_stat;
+  http_track_request(req);
+
+  const char *filename = get_path_from_uri(filepath, ((struct file_server_data *)req->user_ctx)->base_path,
+                                           req->uri, sizeof(filepath));
+  if (!filename) {
+      ESP_LOGE(TAG, "Filename is too long");
+      // Respond with 500 Internal Server Error
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Filename too long");
+      return ESP_FAIL;
+  }
+
+  ESP_LOGI(TAG, "Resolved filename: %s", filename);
+  // If name has trailing '/', respond with index
+  if (filename[strlen(filename) - 1] == '/') {
+      return index_html_get_handler(req);
+  }
+
+  if (stat(filepath, &file_stat) == -1) {
+    ESP_LOGE(TAG, "Failed to stat file : %s", filepath);
+    /* Respond with 404 Not Found */
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File does not exist");
+    return ESP_FAIL;
+  }
+
+  // Pre-compressed sibling (foo.js.gz) of static asset is sent to browsers accepting gzip
+  char accept_encoding[COND_HDR_MAX_LEN];
+  char gz_path[FILE_PATH_MAX];
+  const char *send_path = filepath;
+  bool gzipped = false;
+  if(is_gzip_asset(filename)){
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if(http_accepts_gzip(get_req_hdr(req, "Accept-Encoding", accept_encoding, sizeof(accept_encoding)))
+        && find_gz_sibling(filepath, &file_stat, gz_path, sizeof(gz_path))){
+      httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+      send_path = gz_path;
+      gzipped = true;
+    }
+  }
+
+  // Validators and cache policy (header values must live until response is sent)
+  char etag[HTTP_ETAG_LEN];
+  char last_modified[HTTP_DATE_LEN];
+  char if_none_match[COND_HDR_MAX_LEN];
+  char if_modified_since[HTTP_DATE_LEN + 8];
+  const char *cache_control = http_cache_control(filename, s_cache_rules, sizeof(s_cache_rules) / sizeof(s_cache_rules[0]));
+  http_make_etag(file_stat.st_size, file_stat.st_mtime, etag, sizeof(etag));
+  http_format_date(file_stat.st_mtime, last_modified, sizeof(last_modified));
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "ETag", etag);
+  httpd_resp_set_hdr(req, "Last-Modified", last_modified);
+  httpd_resp_set_hdr(req, "Cache-Control", cache_control ? cache_control : CACHE_CONTROL_DEFAULT);
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+  httpd_resp_set_hdr(req, "Connection", "close");
+#endif
+
+  // Conditional request for unchanged file is answered without touching its content
+  if(http_not_modified(get_req_hdr(req, "If-None-Match", if_none_match, sizeof(if_none_match)),
+                       get_req_hdr(req, "If-Modified-Since", if_modified_since, sizeof(if_modified_since)),
+                       etag, file_stat.st_mtime)){
+    ESP_LOGI(TAG, "Not modified : %s", filename);
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+  }
+
+  // Single byte range lets clients follow growing logs and resume broken downloads
+  char range_hdr[COND_HDR_MAX_LEN];
+  char if_range[COND_HDR_MAX_LEN];
+  char content_range[48];
+  http_range_t range;
+  int ranged = http_eval_range(get_req_hdr(req, "Range", range_hdr, sizeof(range_hdr)),
+                               get_req_hdr(req, "If-Range", if_range, sizeof(if_range)),
+                               etag, file_stat.st_mtime, file_stat.st_size, &range);
+  httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+  if(ranged == HTTP_RANGE_UNSATISFIABLE){
+    snprintf(content_range, sizeof(content_range), "bytes */%ld", file_stat.st_size);
+    httpd_resp_set_hdr(req, "Content-Range", content_range);
+    httpd_resp_set_status(req, "416 Range Not Satisfiable");
+    return httpd_resp_send(req, NULL, 0);
+  }
+
+  // Hot static assets are kept in PSRAM, hit costs no read from SD card
+  file_cache_entry_t *cached = NULL;
+  bool cacheable = is_www_cacheable(filename);
+  if(cacheable){
+    cached = file_cache_get(www_cache(), send_path, file_stat.st_size, file_stat.st_mtime);
+  }
+
+  if(!cached){
+    fd = fopen(send_path, "r");
+    if (!fd) {
+      ESP_LOGE(TAG, "Failed to read existing file : %s", send_path);
+      if(gzipped){
+        forget_gz_sibling(filepath);    //.gz removed from card, next request gets the original
+      }
+      /* Respond with 500 Internal Server Error */
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read existing file");
+      return ESP_FAIL;
+    }
+    // Missed asset is read whole into the cache and sent from there
+    if(cacheable && (cached = file_cache_insert(www_cache(), send_path, file_stat.st_size, file_stat.st_mtime))){
+      if(fread(cached->data, 1, cached->size, fd) == cached->size){
+        fclose(fd);
+        fd = NULL;
+      }else{
+        file_cache_remove(www_cache(), cached);   //file changed meanwhile, send it as it is now
+        cached = NULL;
+        rewind(fd);
+      }
+    }
+  }
+  if(cacheable){
+    publish_www_cache_stats();
+  }
+
+  // Whole file is read till EOF (logs may grow meanwhile), range only up to its last byte
+  size_t remaining = SIZE_MAX;
+  if(ranged == HTTP_RANGE_PARTIAL){
+    if(fd && fseek(fd, range.first, SEEK_SET) != 0){
+      fclose(fd);
+      ESP_LOGE(TAG, "Failed to seek file : %s", send_path);
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read existing file");
+      return ESP_FAIL;
+    }
+    remaining = range.last - range.first + 1;
+    snprintf(content_range, sizeof(content_range), "bytes %u-%u/%ld", range.first, range.last, file_stat.st_size);
+    httpd_resp_set_hdr(req, "Content-Range", content_range);
+    httpd_resp_set_status(req, "206 Partial Content");
+    ESP_LOGI(TAG, "Sending file : %s%s (%s)...", filename, gzipped ? ".gz" : "", content_range);
+  }else{
+    ESP_LOGI(TAG, "Sending file : %s%s (%ld bytes)...", filename, gzipped ? ".gz" : "", file_stat.st_size);
+  }
+  set_content_type_from_file(req, filename);
+
+  if(cached){
+    if(ranged == HTTP_RANGE_PARTIAL){
+      return httpd_resp_send(req, (const char *)cached->data + range.first, remaining);
+    }
+    return httpd_resp_send(req, (const char *)cached->data, cached->size);
+  }
+
+  // Retrieve the pointer to scratch buffer for temporary storage
+  char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+  size_t chunksize;
+  // Files longer than one chunk are finished by worker task, so they do not block other requests
+  bool offload = (ranged == HTTP_RANGE_PARTIAL ? remaining : (size_t)file_stat.st_size) > SCRATCH_BUFSIZE;
+  // Reads end at buffer size boundaries of the file, so they are whole SD sectors
+  size_t pos = (ranged == HTTP_RANGE_PARTIAL) ? range.first : 0;
+  do {
+    // Read file in chunks into the scratch buffer
+    chunksize = fread(chunk, 1, MIN(remaining, SCRATCH_BUFSIZE - pos % SCRATCH_BUFSIZE), fd);
+    remaining -= chunksize;
+    pos += chunksize;
+    if (chunksize > 0) {
+      // Send the buffer contents as HTTP response chunk
+      if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
+        fclose(fd);
+        ESP_LOGE(TAG, "File sending failed!");
+        // Abort sending file
+        httpd_resp_sendstr_chunk(req, NULL);
+        // Respond with 500 Internal Server Error
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
+        return ESP_FAIL;
+      }
+      // Headers and first chunk are out, the rest goes from worker (it closes the file)
+      if (offload && remaining != 0) {
+        if (worker_submit(req, &s_file_lane, send_path, fd, remaining) == ESP_OK) {
+          return ESP_OK;
+        }
+        offload = false;    // workers busy, send it here
+      }
+    }
+  // Keep looping till the whole file (or range) is sent
+  } while (chunksize != 0 && remaining != 0);
+
+  // Close file after sending complete
+  fclose(fd);
+  ESP_LOGI(TAG, "File sending complete");
+  // Respond with an empty chunk to signal HTTP response completion
+  httpd_resp_send_chunk(req, NULL, 0);
+  return ESP_OK;
+}
+
+/*******************************************************************************
+ *    Helpers
+ *******************************************************************************/
+
+/**
+ *  Check if file is a static text asset which may have pre-compressed .gz sibling
+ */
+bool is_gzip_asset(const char *filename){
+  return IS_FILE_EXT(filename, ".htm") || IS_FILE_EXT(filename, ".html") || IS_FILE_EXT(filename, ".js")
+      || IS_FILE_EXT(filename, ".css") || IS_FILE_EXT(filename, ".ttf") || IS_FILE_EXT(filename, ".svg");
+}
+
+/**
+ *  Check if file may be kept in web assets cache (pictures and logs are too many to benefit)
+ */
+bool is_www_cacheable(const char *filename){
+  return strncmp(filename, "/dcim/", 6) != 0 && strncmp(filename, "/logs/", 6) != 0;
+}
+
+static void *www_cache_alloc(size_t size){
+  return heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+}
+
+/**
+ * Web assets cache, initialized on first use (disabled if there is no PSRAM)
+ */
+static file_cache_t *www_cache(void){
+  if(!s_www_cache_ready){
+    size_t capacity = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0 ? WWW_CACHE_SIZE : 0;
+    file_cache_init(&s_www_cache, capacity, WWW_CACHE_MAX_FILE, www_cache_alloc, heap_caps_free);
+    s_www_cache_ready = true;
+  }
+  return &s_www_cache;
+}
+
+/**
+ * Publishes statistics of web assets cache, called by the server task after using the cache
+ */
+static void publish_www_cache_stats(void){
+  portENTER_CRITICAL(&s_www_cache_stats_mux);
+  memcpy(&s_www_cache_stats, &s_www_cache.stats, sizeof(s_www_cache_stats));
+  portEXIT_CRITICAL(&s_www_cache_stats_mux);
+}
+
+/**
+ * Returns statistics of web assets cache, safe to call from any task
+ */
+file_cache_stats_t get_www_cache_stats(void){
+  file_cache_stats_t stats;
+  portENTER_CRITICAL(&s_www_cache_stats_mux);
+  memcpy(&stats, &s_www_cache_stats, sizeof(stats));
+  portEXIT_CRITICAL(&s_www_cache_stats_mux);
+  return stats;
+}
+
+static uint32_t path_hash(const char *path){
+  uint32_t h = 2166136261u;
+  while(*path){
+    h = (h ^ (uint8_t)*path++) * 16777619u;
+  }
+  return h ? h : 1;
+}
+
+/**
+ *  Look up .gz sibling of a file in gz cache, stat it on cache miss.
+ *  On success gz_path holds sibling path and file_stat its size and mtime.
+ */
+bool find_gz_sibling(const char *filepath, struct stat *file_stat, char *gz_path, size_t len){
+  uint32_t hash = path_hash(filepath);
+  gz_cache_entry_t *slot = &s_gz_cache[hash % GZ_CACHE_SIZE];
+  gz_cache_entry_t entry;
+  struct stat gz_stat;
+
+  if(snprintf(gz_path, len, "%s.gz", filepath) >= (int)len){
+    return false;
+  }
+  portENTER_CRITICAL(&s_gz_cache_mux);
+  entry = *slot;
+  portEXIT_CRITICAL(&s_gz_cache_mux);
+  if(entry.hash != hash || entry.size != file_stat->st_size || entry.mtime != file_stat->st_mtime){
+    entry.hash = hash;
+    entry.size = file_stat->st_size;
+    entry.mtime = file_stat->st_mtime;
+    entry.gz_size = 0;
+    entry.gz_mtime = 0;
+    if(stat(gz_path, &gz_stat) == 0 && gz_stat.st_size > 0){
+      entry.gz_size = gz_stat.st_size;
+      entry.gz_mtime = gz_stat.st_mtime;
+    }
+    portENTER_CRITICAL(&s_gz_cache_mux);
+    *slot = entry;
+    portEXIT_CRITICAL(&s_gz_cache_mux);
+  }
+  if(entry.gz_size == 0){
+    return false;
+  }
+  file_stat->st_size = entry.gz_size;
+  file_stat->st_mtime = entry.gz_mtime;
+  return true;
+}
+
+/**
+ *  Drop gz cache entry of a file
+ */
+void forget_gz_sibling(const char *filepath){
+  uint32_t hash = path_hash(filepath);
+  gz_cache_entry_t *slot = &s_gz_cache[hash % GZ_CACHE_SIZE];
+  portENTER_CRITICAL(&s_gz_cache_mux);
+  if(slot->hash == hash){
+    slot->hash = 0;
+  }
+  portEXIT_CRITICAL(&s_gz_cache_mux);
+}
+
+/**
+ *  Copy value of request header, NULL if not sent or too long
+ */
+const char *get_req_hdr(httpd_req_t *req, const char *field, char *buf, size_t len){
+  size_t hdr_len = httpd_req_get_hdr_value_len(req, field);
+  if(hdr_len == 0 || hdr_len >= len || httpd_req_get_hdr_value_str(req, field, buf, len) != ESP_OK){
+    return NULL;
+  }
+  return buf;
+}
+
+/**
+ *  Set HTTP response content type according to file extension
+ */
+esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename){
+  if(IS_FILE_EXT(filename, ".pdf")){
+    return httpd_resp_set_type(req, "application/pdf");
+  }else if (IS_FILE_EXT(filename, ".html")){
+    return httpd_resp_set_type(req, "text/html");
+  }else if (IS_FILE_EXT(filename, ".htm")){
+    return httpd_resp_set_type(req, "text/html");
+  }else if (IS_FILE_EXT(filename, ".jpeg")){
+    return httpd_resp_set_type(req, "image/jpeg");
+  }else if (IS_FILE_EXT(filename, ".ico")){
+    return httpd_resp_set_type(req, "image/x-icon");
+  }else if (IS_FILE_EXT(filename, ".css")){
+    return httpd_resp_set_type(req, "text/css");
+  }else if (IS_FILE_EXT(filename, ".js")){
+    return httpd_resp_set_type(req, "application/x-javascript");
+  }else if (IS_FILE_EXT(filename, ".xml")){
+    return httpd_resp_set_type(req, "application/xml");
+  }else if (IS_FILE_EXT(filename, ".gif")){
+    return httpd_resp_set_type(req, "image/gif");
+  }else if (IS_FILE_EXT(filename, ".png")){
+    return httpd_resp_set_type(req, "image/png");
+  }else if (IS_FILE_EXT(filename, ".3gp")){
+    return httpd_resp_set_type(req, "video/mpeg");
+  }else if (IS_FILE_EXT(filename, ".ttf")){
+    return httpd_resp_set_type(req, "font/ttf");
+  }else if (IS_FILE_EXT(filename, ".svg")){
+    return httpd_resp_set_type(req, "image/svg+xml");
+  }else if (IS_FILE_EXT(filename, ".json")){
+    return httpd_resp_set_type(req, "text/json");
+  }else if (IS_FILE_EXT(filename, ".csv")){
+    return httpd_resp_set_type(req, "application/CSV");
+  }// This is a limited set only. For any other type always set as plain text
+  return httpd_resp_set_type(req, "text/plain");
+}
+
+/**
+ * Copies the full path into destination buffer and returns
+ * pointer to path (skipping the preceding base path)
+ */
+const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize){
+  const size_t base_pathlen = strlen(base_path);
+  size_t pathlen = strlen(uri);
+
+  const char *quest = strchr(uri, '?');
+  if (quest) {
+    pathlen = MIN(pathlen, quest - uri);
+  }
+  const char *hash = strchr(uri, '#');
+  if (hash) {
+    pathlen = MIN(pathlen, hash - uri);
+  }
+  if (base_pathlen + pathlen + 1 > destsize) {
+    return NULL;  // Full path string won't fit into destination buffer
+  }
+  // Construct full path (base + path)
+  memcpy(dest, base_path, base_pathlen);
+  memcpy(dest + base_pathlen, uri, pathlen);
+  dest[base_pathlen + pathlen] = '\0';
+  // Return pointer to path, skipping the base
+  return dest + base_pathlen;
+}
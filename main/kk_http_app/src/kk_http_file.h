@@ -0,0 +1,104 @@
+/**
+ *  kk_http_file.h
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  File serving from SD card and helpers of request handlers
+ *
+ */
+
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <esp_http_server.h>
+#include "kk_file_cache.h"
+
+#ifndef COMPONENTS_KK_HTTP_FILE_
+#define COMPONENTS_KK_HTTP_FILE_
+
+/// Longer conditional and range headers are ignored (full response is sent)
+#define COND_HDR_MAX_LEN 128
+
+/**
+ * Handler to download a file kept on the server
+ * @param req Request pointer
+ * @return
+ *      ESP_OK if success
+ *      ESP_FAIL otherwise
+ */
+esp_err_t file_get_handler(httpd_req_t *req);
+
+/**
+ *  Set HTTP response content type according to file extension
+ * @param req Request data
+ * @param filename Pointer to filename
+ * @return Error codes from @see httpd_resp_set_type()
+ *
+ */
+esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename);
+
+/**
+ * Checks if file is a static text asset which may have pre-compressed .gz sibling
+ * @param filename Pointer to filename
+ * @return true for html, js, css, ttf and svg files
+ */
+bool is_gzip_asset(const char *filename);
+
+/**
+ * Checks if file may be kept in web assets cache in PSRAM
+ * @param filename Path of the file relative to server base path
+ * @return false for pictures (/dcim/) and logs (/logs/)
+ */
+bool is_www_cacheable(const char *filename);
+
+/**
+ * Returns statistics of web assets cache (hits, misses, bytes served from PSRAM).
+ * Copy published by the server task after each cached request, safe to call from any task.
+ * @return Cache statistics
+ */
+file_cache_stats_t get_www_cache_stats(void);
+
+/**
+ * Looks up .gz sibling of a file. Result is cached for given size and mtime of the file,
+ * so only first request (or first after file change) costs additional stat().
+ * @param filepath Full path of the file
+ * @param file_stat Stat of the file, replaced with size and mtime of .gz sibling if found
+ * @param gz_path Output buffer for path of .gz sibling
+ * @param len Size of output buffer
+ * @return true if .gz sibling exists
+ */
+bool find_gz_sibling(const char *filepath, struct stat *file_stat, char *gz_path, size_t len);
+
+/**
+ * Drops cached .gz sibling lookup of a file
+ * @param filepath Full path of the file
+ */
+void forget_gz_sibling(const char *filepath);
+
+/**
+ * Copies value of request header into buffer
+ * @param req Request data
+ * @param field Header name
+ * @param buf Output buffer
+ * @param len Size of output buffer
+ * @return buf, NULL if header was not sent or does not fit into buf
+ */
+const char *get_req_hdr(httpd_req_t *req, const char *field, char *buf, size_t len);
+
+/**
+ * Copies the full path into destination buffer and returns
+ * pointer to path (skipping the preceding base path)
+ *
+ * @param dest  Destination buffer pointer
+ * @param base_path web server base path (i.e. /sd/www)
+ * @param uri   requested uri
+ * @param destsize  size of destination buffer
+ * @return
+ *      NULL when fail
+ *      Pointer to path, skipping the base
+ */
+const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize);
+
+#endif /* COMPONENTS_KK_HTTP_FILE_ */
@@ -13,11 +13,131 @@
  *
  */
 
+#include <unistd.h>
+#include "lwip/sockets.h"
 #include "kk_http_server_setup.h"
 #include "kk_http_app.h"
+#include "kk_http_stream.h"
+#include "kk_http_worker.h"
+#include "kk_http_export.h"
+#include "metrics_helper.h"
 
 static const char* TAG = "HTTP";
 
+static http_conn_stats s_conn_stats;
+static portMUX_TYPE s_conn_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/// Last request of sessions by socket (0 no request yet), touched by the server task only
+static uint32_t s_sess_used[CONFIG_LWIP_MAX_SOCKETS];
+static uint32_t s_sess_clock = 0;
+
+enum { ROUTE_DATA, ROUTE_SET_GET, ROUTE_SET_POST, ROUTE_PAK, ROUTE_METRICS, ROUTE_FILE, ROUTES_NO };
+static http_route s_routes[ROUTES_NO] = {
+  {"route=\"data\"",     data_get_handler,    NULL, 0, LATENCY_HISTOGRAM_INIT},
+  {"route=\"set_get\"",  set_get_handler,     NULL, 0, LATENCY_HISTOGRAM_INIT},
+  {"route=\"set_post\"", set_post_handler,    NULL, 0, LATENCY_HISTOGRAM_INIT},
+  {"route=\"pak\"",      pak_get_handler,     NULL, 0, LATENCY_HISTOGRAM_INIT},
+  {"route=\"metrics\"",  metrics_get_handler, NULL, 0, LATENCY_HISTOGRAM_INIT},
+  {"route=\"file\"",     file_get_handler,    NULL, 0, LATENCY_HISTOGRAM_INIT},
+};
+
+/**
+ * Session context is just a number of requests served on the connection, kept in the pointer itself.
+ * Nothing to free.
+ */
+static void free_request_counter(void *ctx){
+}
+
+/**
+ * @return Index of the socket in session tables, -1 if it is not a socket of lwIP
+ */
+static int session_index(int sockfd){
+  int i = sockfd - LWIP_SOCKET_OFFSET;
+  return (i >= 0 && i < CONFIG_LWIP_MAX_SOCKETS) ? i : -1;
+}
+
+/**
+ * Keeps a session free for the next client. When all HTTPD_MAX_OPEN_SOCKETS are open,
+ * least recently used one is closed, apart from the current one and those of streams,
+ * worker jobs and export, which do not send requests while they are busy.
+ * Server's own LRU purge is off, as it would take them first.
+ * Runs on the server task, so none of the sessions can be handed over meanwhile.
+ * @param hd Server handle
+ * @param current Socket of the request being handled
+ */
+static void purge_idle_session(httpd_handle_t hd, int current){
+  size_t fds = HTTPD_MAX_OPEN_SOCKETS;
+  int client_fds[HTTPD_MAX_OPEN_SOCKETS];
+  if(httpd_get_client_list(hd, &fds, client_fds) != ESP_OK || fds < HTTPD_MAX_OPEN_SOCKETS){
+    return;
+  }
+  int victim = -1;
+  uint32_t oldest = UINT32_MAX;
+  for(size_t n = 0; n < fds; n++){
+    int fd = client_fds[n];
+    int i = session_index(fd);
+    if(i < 0 || fd == current || stream_holds(fd) || worker_holds(fd) || export_holds(fd)){
+      continue;
+    }
+    if(s_sess_used[i] == 0){
+      s_sess_used[i] = ++s_sess_clock;    //opened, request not read yet: count it as new one
+    }
+    if(s_sess_used[i] < oldest){
+      oldest = s_sess_used[i];
+      victim = fd;
+    }
+  }
+  if(victim < 0){
+    ESP_LOGW(TAG, "All sessions busy, next client is refused till one ends");
+    return;
+  }
+  ESP_LOGD(TAG, "Closing idle session %d", victim);
+  httpd_sess_trigger_close(hd, victim);
+}
+
+/**
+ * Session close callback of the server (httpd_config_t::close_fn)
+ */
+static void session_on_close(httpd_handle_t hd, int sockfd){
+  int i = session_index(sockfd);
+  if(i >= 0){
+    s_sess_used[i] = 0;
+  }
+  portENTER_CRITICAL(&s_conn_stats_mux);
+  s_conn_stats.closed++;
+  portEXIT_CRITICAL(&s_conn_stats_mux);
+  stream_on_close(hd, sockfd);
+  worker_on_close(hd, sockfd);
+  export_on_close(hd, sockfd);
+  close(sockfd);
+}
+
+/**
+ * Handler of all registered URIs (route is their user context). Calls handler of the route
+ * with its own context and counts its time and errors, counters are updated lock-free.
+ */
+static esp_err_t timed_handler(httpd_req_t *req){
+  http_route *route = (http_route *)req->user_ctx;
+  int64_t start_us = esp_timer_get_time();
+  req->user_ctx = route->user_ctx;
+  esp_err_t ret = route->handler(req);
+  metric_observe_us(&route->latency, metrics_elapsed_us(start_us));
+  if(ret != ESP_OK){
+    metric_inc(&route->errors);
+  }
+  return ret;
+}
+
+/**
+ * Sets context of handler of the route
+ * @param route Route index
+ * @param user_ctx Context of the handler
+ * @return Route, user context of the URI registered with timed_handler
+ */
+static void *route_ctx(int route, void *user_ctx){
+  s_routes[route].user_ctx = user_ctx;
+  return &s_routes[route];
+}
 
 /**
  * \brief Registers appropriate handlers for starting and stopping server depending on
@@ -59,9 +179,20 @@ httpd_handle_t start_webserver(const char *base_path){
 #ifdef CONFIG_KK_USE_HTTP_SSL
   httpd_ssl_config_t conf = HTTPD_SSL_CONFIG_DEFAULT();
   conf.httpd.task_priority = HTTP_TASK_PRIO;
+  conf.httpd.max_resp_headers = HTTPD_MAX_RESP_HEADERS;
+  conf.httpd.max_open_sockets = HTTPD_MAX_OPEN_SOCKETS;
+  conf.httpd.lru_purge_enable = false;  //idle sessions are closed by purge_idle_session()
+  conf.httpd.close_fn = session_on_close;
+#ifdef CONFIG_KK_HTTPS_SESSION_TICKETS
+  conf.session_tickets = true;
+#endif // CONFIG_KK_HTTPS_SESSION_TICKETS
 #else
   httpd_config_t conf = HTTPD_DEFAULT_CONFIG();
   conf.task_priority = HTTP_TASK_PRIO;
+  conf.max_resp_headers = HTTPD_MAX_RESP_HEADERS;
+  conf.max_open_sockets = HTTPD_MAX_OPEN_SOCKETS;
+  conf.lru_purge_enable = false;  //idle sessions are closed by purge_idle_session()
+  conf.close_fn = session_on_close;
 #endif // CONFIG_KK_USE_HTTP_SSL
 
   httpd_handle_t server = NULL;
@@ -131,43 +262,54 @@ httpd_handle_t start_webserver(const char *base_path){
   const httpd_uri_t uri_get_data = {
     .uri      = "/data/*",
     .method   = HTTP_GET,
-    .handler  = data_get_handler,
-    .user_ctx = (void*)"/data/"
+    .handler  = timed_handler,
+    .user_ctx = route_ctx(ROUTE_DATA, (void*)"/data/")
   };
   httpd_register_uri_handler(server, &uri_get_data);  //handles get /data/*
 
   const httpd_uri_t uri_get_set = {
     .uri      = "/set/*",
     .method   = HTTP_GET,
-    .handler  = set_get_handler,
-    .user_ctx = server_data
+    .handler  = timed_handler,
+    .user_ctx = route_ctx(ROUTE_SET_GET, server_data)
   };
   httpd_register_uri_handler(server, &uri_get_set);  //handles GET /set/*
 
   const httpd_uri_t uri_post_set = {
     .uri      = "/set/*",
     .method   = HTTP_POST,
-    .handler  = set_post_handler,
-    .user_ctx = server_data
+    .handler  = timed_handler,
+    .user_ctx = route_ctx(ROUTE_SET_POST, server_data)
   };
   httpd_register_uri_handler(server, &uri_post_set);  //handles POST /set/*
 
-  const httpd_uri_t uri_get_pic_list = {
-    .uri      = "/pic_list/*",
+  const httpd_uri_t uri_get_pak = {
+    .uri      = "/pak/*",
     .method   = HTTP_GET,
-    .handler  = pic_get_handler,
-    .user_ctx = server_data
+    .handler  = timed_handler,
+    .user_ctx = route_ctx(ROUTE_PAK, server_data)
   };
-  httpd_register_uri_handler(server, &uri_get_pic_list);  //handles GET /pic/*
+  httpd_register_uri_handler(server, &uri_get_pak);  //handles GET /pak/* (packed pictures)
+
+  const httpd_uri_t uri_get_metrics = {
+    .uri      = "/metrics",
+    .method   = HTTP_GET,
+    .handler  = timed_handler,
+    .user_ctx = route_ctx(ROUTE_METRICS, server_data)
+  };
+  httpd_register_uri_handler(server, &uri_get_metrics);  //handles GET /metrics (Prometheus scrape)
 
   const httpd_uri_t file_get = {
     .uri      = "/*",
     .method   = HTTP_GET,
-    .handler  = file_get_handler,
-    .user_ctx = server_data
+    .handler  = timed_handler,
+    .user_ctx = route_ctx(ROUTE_FILE, server_data)
   };
   httpd_register_uri_handler(server, &file_get);   //handles GET /* (file serving)
 
+  stream_start(server);
+  worker_start(server);
+  export_start(server);
   return server;
 }
 
@@ -179,10 +321,80 @@ httpd_handle_t start_webserver(const char *base_path){
  */
 void stop_webserver(httpd_handle_t server){
   if (server) {
+    stream_stop();
+    worker_stop();
+    export_stop();
     httpd_stop(server);
   }
 }
 
+/**
+ * Counts request and its connection (first request of a session). Called at the beginning of handlers.
+ * Marks the session as used, first request of a session may close an idle one (see HTTPD_MAX_OPEN_SOCKETS).
+ * @param req Request pointer
+ */
+void http_track_request(httpd_req_t *req){
+  bool first = (req->sess_ctx == NULL);
+  int fd = httpd_req_to_sockfd(req);
+  int i = session_index(fd);
+  req->sess_ctx = (void *)((uintptr_t)req->sess_ctx + 1);
+  req->free_ctx = free_request_counter;
+  if(i >= 0){
+    s_sess_used[i] = ++s_sess_clock;
+  }
+  if(first){
+    purge_idle_session(req->handle, fd);
+  }
+  portENTER_CRITICAL(&s_conn_stats_mux);
+  if(first){
+    s_conn_stats.connections++;
+  }
+  s_conn_stats.requests++;
+  portEXIT_CRITICAL(&s_conn_stats_mux);
+}
+
+/**
+ * Returns copy of connection statistics
+ * @return Connection statistics since start
+ */
+http_conn_stats get_http_conn_stats(void){
+  http_conn_stats stats;
+  portENTER_CRITICAL(&s_conn_stats_mux);
+  stats = s_conn_stats;
+  portEXIT_CRITICAL(&s_conn_stats_mux);
+  return stats;
+}
+
+/**
+ * Writes request counts and latencies of routes, connection and web assets cache counters
+ * @param w Writer
+ */
+void write_http_metrics(metrics_writer_t *w){
+  http_conn_stats stats = get_http_conn_stats();
+  metrics_family(w, "kk_http_request_seconds", "histogram", "Time spent in request handlers.");
+  for(int i = 0; i < ROUTES_NO; i++){
+    metrics_histogram(w, "kk_http_request_seconds", s_routes[i].labels, &s_routes[i].latency);
+  }
+  metrics_family(w, "kk_http_request_errors_total", "counter", "Requests failed by handlers.");
+  for(int i = 0; i < ROUTES_NO; i++){
+    metrics_uint(w, "kk_http_request_errors_total", s_routes[i].labels, metric_get(&s_routes[i].errors));
+  }
+  metrics_family(w, "kk_http_requests_total", "counter", "Requests handled.");
+  metrics_uint(w, "kk_http_requests_total", NULL, stats.requests);
+  metrics_family(w, "kk_http_connections_total", "counter", "Connections which sent a request.");
+  metrics_uint(w, "kk_http_connections_total", NULL, stats.connections);
+  metrics_family(w, "kk_http_connections_closed_total", "counter", "Connections closed.");
+  metrics_uint(w, "kk_http_connections_closed_total", NULL, stats.closed);
+
+  file_cache_stats_t www = get_www_cache_stats();
+  metrics_family(w, "kk_www_cache_hits_total", "counter", "Static assets served from PSRAM cache.");
+  metrics_uint(w, "kk_www_cache_hits_total", NULL, www.hits);
+  metrics_family(w, "kk_www_cache_misses_total", "counter", "Cacheable static assets read from SD card.");
+  metrics_uint(w, "kk_www_cache_misses_total", NULL, www.misses);
+  metrics_family(w, "kk_www_cache_used_bytes", "gauge", "Bytes of cached static assets.");
+  metrics_uint(w, "kk_www_cache_used_bytes", NULL, www.used);
+}
+
 /**
  * Handler function for network disconnected event
  * @see https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-guides/event-handling.html
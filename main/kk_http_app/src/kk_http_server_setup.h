@@ -30,6 +30,7 @@
 #include <esp_http_server.h>
 #include <esp_https_server.h>
 #include <setup.h>
+#include "kk_metrics.h"
 
 
 #ifndef COMPONENTS_KK_HTTP_SERVER_SETUP_
@@ -52,6 +53,60 @@
 /// Scratch buffer size for temporary storage during file transfer
 #define SCRATCH_BUFSIZE  8192
 
+/// Max number of connections kept open (LWIP_MAX_SOCKETS - 3 at most). When a new one takes the last of them,
+/// least recently used one which is not a stream, worker job or export is closed for the next client
+#ifdef CONFIG_KK_USE_HTTP_SSL
+#define HTTPD_MAX_OPEN_SOCKETS  5   //every TLS session holds its own record buffers
+#else
+#define HTTPD_MAX_OPEN_SOCKETS  7
+#endif
+
+/// Max number of additional response headers (validators, cache policy, encoding and range)
+#define HTTPD_MAX_RESP_HEADERS  12
+
+/// Max number of /data/stream (Server-Sent Events) clients, keep it below max open sockets,
+/// with worker jobs and export they are sessions which are never closed for a new client
+#define STREAM_MAX_CLIENTS  2
+/// Idle stream gets a comment line after this time, which also detects dead clients
+#define STREAM_HEARTBEAT_MS  15000
+/// Longest time a send to stream client may block the server task (TLS sessions ignore MSG_DONTWAIT)
+#define STREAM_SEND_TIMEOUT_MS  50
+/// Reconnection delay suggested to EventSource
+#define STREAM_RETRY_MS  5000
+/// Max length of a single stream event and number of events waiting for the server task
+#define STREAM_EVENT_MAX  192
+#define STREAM_EVENT_SLOTS  4
+
+/// Worker tasks sending rest of large files (see kk_http_worker.h), their buffers (two per worker) and stack.
+/// Internal RAM taken at server start: WORKER_TASKS * 2 * (WORKER_BUFSIZE + 10) of DMA buffers (16.4 kB),
+/// worker, reader and export stacks (15.4 kB). Export buffer (4.1 kB) is taken only while export runs.
+/// TLS record buffers of sessions are in PSRAM (CONFIG_MBEDTLS_EXTERNAL_MEM_ALLOC).
+/// Free internal heap after start is logged and reported by /metrics.
+#define WORKER_TASKS  2
+#define WORKER_BUFSIZE  4096      //whole SD sectors, divides SCRATCH_BUFSIZE
+#define WORKER_STACK_SIZE  4096
+#define WORKER_READER_STACK_SIZE  3072
+/// Max number of jobs waiting or running and limits of handlers, handler sends the file itself above its limit
+#define WORKER_JOBS  6
+#define WORKER_FILE_JOBS  4
+#define WORKER_PAK_JOBS  2
+/// Time given to running jobs when server stops, longer than send timeout of the server,
+/// so their last send (done by server task) is over before the server is stopped
+#define WORKER_STOP_WAIT_MS  6000
+
+/// Tar export (see kk_http_export.h): chunk buffer, stack, longest range and pause while pictures wait for writer
+#define EXPORT_BUFSIZE  4096
+#define EXPORT_STACK_SIZE  4096
+#define EXPORT_MAX_DAYS  31
+#define EXPORT_BACKOFF_MS  100
+
+/// Bytes of static web assets kept in PSRAM and the largest cached file (pictures and logs are not cached)
+#define WWW_CACHE_SIZE  (256 * 1024)
+#define WWW_CACHE_MAX_FILE  (64 * 1024)
+
+/// Number of files remembered in cache of pre-compressed (.gz) asset lookups
+#define GZ_CACHE_SIZE  32
+
 /// Struct for serving file contents
 struct file_server_data {
   /// Base path of file storage
@@ -60,6 +115,22 @@ struct file_server_data {
   char scratch[SCRATCH_BUFSIZE];
 };
 
+/// Registered URI handler with its request metrics, handler is called through timed_handler()
+struct http_route{
+  const char *labels;                       ///< Label set of its metrics
+  esp_err_t (*handler)(httpd_req_t *req);   ///< Handler of the URI
+  void *user_ctx;                           ///< Context passed to the handler
+  metric_counter_t errors;                  ///< Requests which handler returned error for
+  metric_histogram_t latency;               ///< Time spent in the handler (worker jobs continue after it)
+};
+
+/// Connection statistics (keep-alive efficiency: requests per connection)
+struct http_conn_stats{
+  uint32_t connections; ///< Sessions which sent at least one request
+  uint32_t requests;    ///< Requests handled
+  uint32_t closed;      ///< Sessions closed (by any side, idle purge or failed handshake)
+};
+
 
 /**
  * \brief Registers appropriate handlers for starting and stopping server depending on
@@ -91,6 +162,25 @@ httpd_handle_t start_webserver(const char *base_path);
  */
 void stop_webserver(httpd_handle_t server);
 
+/**
+ * Counts request and its connection (first request of a session). Called at the beginning of handlers.
+ * Marks the session as used, first request of a session may close an idle one (see HTTPD_MAX_OPEN_SOCKETS).
+ * @param req Request pointer
+ */
+void http_track_request(httpd_req_t *req);
+
+/**
+ * Returns copy of connection statistics
+ * @return Connection statistics since start
+ */
+http_conn_stats get_http_conn_stats(void);
+
+/**
+ * Writes request counts and latencies of routes, connection and web assets cache counters
+ * @param w Writer
+ */
+void write_http_metrics(metrics_writer_t *w);
+
 /**
  * Handler function for network disconnected event
  * @see https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-guides/event-handling.html
@@ -0,0 +1,69 @@
+/**
+ *  kk_http_sock.cpp
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Socket access of tasks sending responses on behalf of the server task (worker jobs, export)
+ *
+ *  Sends and close are queued to the server task, which also runs session close callback.
+ *  So abort flag checked by the work cannot change before the work ends, and socket number
+ *  of a closed session, which accept may give to a new client, is never used.
+ *  Server task is busy for the network part of every send only, reads are done by the caller
+ *  and overlap with sending of the previous chunk.
+ *
+ */
+
+#include "esp_log.h"
+
+#include "kk_http_sock.h"
+
+
+static const char* TAG = "HTTP_SOCK";
+
+static void send_work(void *arg){
+  sock_session_t *s = (sock_session_t *)arg;
+  s->ret = *s->aborted ? HTTPD_SOCK_ERR_FAIL : httpd_socket_send(s->hd, s->fd, s->buf, s->len, 0);
+  xSemaphoreGive(s->done);
+}
+
+static void close_work(void *arg){
+  sock_session_t *s = (sock_session_t *)arg;
+  s->ret = *s->aborted ? ESP_OK : httpd_sess_trigger_close(s->hd, s->fd);
+  xSemaphoreGive(s->done);
+}
+
+/**
+ * Runs the work on the server task and waits for it. Work queued before the server is stopped
+ * is run before the server task ends (httpd_stop() is queued behind it).
+ * @return false if work could not be queued
+ */
+static bool run_on_server(sock_session_t *s, httpd_work_fn_t work){
+  if(httpd_queue_work(s->hd, work, s) != ESP_OK){
+    ESP_LOGW(TAG, "Server does not take work for socket %d", s->fd);
+    return false;
+  }
+  xSemaphoreTake(s->done, portMAX_DELAY);
+  return true;
+}
+
+bool sock_send_all(sock_session_t *s, const char *buf, size_t len){
+  s->buf = buf;
+  s->len = len;
+  while(s->len > 0){
+    if(*s->aborted || !run_on_server(s, send_work) || s->ret <= 0){
+      return false;
+    }
+    s->buf += s->ret;
+    s->len -= s->ret;
+  }
+  return true;
+}
+
+void sock_close(sock_session_t *s){
+  if(!*s->aborted){
+    run_on_server(s, close_work);
+  }
+}
@@ -0,0 +1,54 @@
+/**
+ *  kk_http_sock.h
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Socket access of tasks sending responses on behalf of the server task (worker jobs, export)
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <esp_http_server.h>
+
+#ifndef COMPONENTS_KK_HTTP_SOCK_
+#define COMPONENTS_KK_HTTP_SOCK_
+
+/// Session handed over by a handler to another task
+typedef struct {
+  httpd_handle_t hd;          ///< Server handle
+  int fd;                     ///< Client socket
+  volatile bool *aborted;     ///< Set by session close callback (on the server task) before the socket is closed
+  SemaphoreHandle_t done;     ///< Binary semaphore of the sending task, given when server task did the work
+  const char *buf;            ///< Data being sent
+  size_t len;                 ///< Bytes to send
+  int ret;                    ///< Result of the work
+} sock_session_t;
+
+/**
+ * Sends whole buffer to the client socket. Send is done by the server task (httpd_queue_work),
+ * the caller waits for it: TLS session is not safe to use by two tasks, and socket
+ * of aborted session is not touched, as its number may be already reused by other client.
+ *
+ * @param s Session, its done semaphore must be owned by the calling task
+ * @param buf Data
+ * @param len Number of bytes
+ * @return false if session was aborted, send failed (socket has send timeout of the server)
+ *         or server is stopped
+ */
+bool sock_send_all(sock_session_t *s, const char *buf, size_t len);
+
+/**
+ * Closes session from the server task, unless it was aborted (closed) meanwhile.
+ * Waits for it, like sock_send_all().
+ *
+ * @param s Session
+ */
+void sock_close(sock_session_t *s);
+
+#endif /* COMPONENTS_KK_HTTP_SOCK_ */
@@ -0,0 +1,287 @@
+/**
+ *  kk_http_stream.cpp
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Server-Sent Events stream of live measurements (/data/stream)
+ *
+ *  Web page keeps one connection open instead of polling current_measurements.json
+ *  and current.jpg. After the handler returns, the chunked response stays unfinished
+ *  and every new sample is written to client sockets as next chunk. All socket writes
+ *  are done from the server task (httpd_queue_work), so they never interleave with
+ *  responses of regular requests. Client which does not keep up (socket is not writable,
+ *  or send does not complete) or is gone (send fails) is disconnected, EventSource in the
+ *  browser reconnects. TLS sessions ignore MSG_DONTWAIT, so stream sockets also get a short
+ *  send timeout (STREAM_SEND_TIMEOUT_MS), which bounds the time a stalled client may hold
+ *  the server task.
+ *
+ */
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <app.h>
+
+#include "kk_http_stream.h"
+#include "kk_http_server_setup.h"
+
+
+static const char* TAG = "HTTP_SSE";
+
+typedef struct {
+  int fd;             //client socket, -1 for free slot
+  int64_t last_us;    //time of last chunk sent to the client
+} stream_client_t;
+
+static stream_client_t s_clients[STREAM_MAX_CLIENTS];
+static int s_client_cnt = 0;       //also read by publishing tasks, changed under s_stream_mux
+static httpd_handle_t s_server = NULL;
+static esp_timer_handle_t s_heartbeat_timer = NULL;
+//events waiting for the server task, already framed as HTTP chunks
+static char s_events[STREAM_EVENT_SLOTS][STREAM_EVENT_MAX];
+static size_t s_event_lens[STREAM_EVENT_SLOTS];
+static unsigned s_event_next = 0;
+static portMUX_TYPE s_stream_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char s_heartbeat[] = "3\r\n:\n\n\r\n";   //SSE comment line as HTTP chunk
+
+
+/*******************************************************************************
+ *    Helpers (server task only)
+ *******************************************************************************/
+
+/**
+ * Frames SSE event as HTTP chunk
+ * @return length of the chunk, 0 if it does not fit
+ */
+static size_t frame_chunk(char *out, size_t len, const char *event, size_t event_len){
+  int cx = snprintf(out, len, "%x\r\n%.*s\r\n", (unsigned)event_len, (int)event_len, event);
+  return (cx > 0 && (size_t)cx < len) ? (size_t)cx : 0;
+}
+
+/**
+ * Formats measurements as SSE event
+ * @return length of the event, 0 if it does not fit
+ */
+static size_t format_measurements(char *out, size_t len, time_t now, const measurement *measures){
+  int cx = snprintf(out, len, "data:{\"time\":%lld,\"int_t\":%.2f,\"ext_t\":%.2f,\"humi\":%d,\"sun\":%.2f,\"press\":%.2f,\"wind\":%.3f}\n\n",
+                    (long long)now, measures->iTemp, measures->eTemp, (int)measures->humi,
+                    measures->lux, measures->pres, measures->wind / 0.278);
+  return (cx > 0 && (size_t)cx < len) ? (size_t)cx : 0;
+}
+
+static void drop_client(int i){
+  s_clients[i].fd = -1;
+  portENTER_CRITICAL(&s_stream_mux);
+  s_client_cnt--;
+  portEXIT_CRITICAL(&s_stream_mux);
+}
+
+static int client_count(void){
+  portENTER_CRITICAL(&s_stream_mux);
+  int cnt = s_client_cnt;
+  portEXIT_CRITICAL(&s_stream_mux);
+  return cnt;
+}
+
+/**
+ * @return true if socket takes data without blocking (select() with zero timeout)
+ */
+static bool writable(int fd){
+  fd_set wfds;
+  struct timeval tv = {0, 0};
+  FD_ZERO(&wfds);
+  FD_SET(fd, &wfds);
+  return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+/**
+ * Sends chunk to all clients (or only to those idle for heartbeat interval)
+ */
+static void send_to_clients(const char *chunk, size_t len, bool idle_only){
+  int64_t now = esp_timer_get_time();
+  for(int i = 0; i < STREAM_MAX_CLIENTS; i++){
+    int fd = s_clients[i].fd;
+    if(fd < 0 || (idle_only && now - s_clients[i].last_us < STREAM_HEARTBEAT_MS * 1000LL)){
+      continue;
+    }
+    if(!writable(fd) || httpd_socket_send(s_server, fd, chunk, len, MSG_DONTWAIT) != (int)len){
+      ESP_LOGW(TAG, "Stream client %d does not keep up, disconnecting", fd);
+      drop_client(i);
+      httpd_sess_trigger_close(s_server, fd);
+    }else{
+      s_clients[i].last_us = now;
+    }
+  }
+}
+
+static void broadcast_work(void *arg){
+  char chunk[STREAM_EVENT_MAX];
+  unsigned slot = (unsigned)(uintptr_t)arg;
+  size_t len;
+  portENTER_CRITICAL(&s_stream_mux);
+  len = s_event_lens[slot];
+  memcpy(chunk, s_events[slot], len);
+  portEXIT_CRITICAL(&s_stream_mux);
+  if(s_server != NULL && len > 0){
+    send_to_clients(chunk, len, false);
+  }
+}
+
+static void heartbeat_work(void *arg){
+  if(s_server != NULL){
+    send_to_clients(s_heartbeat, sizeof(s_heartbeat) - 1, true);
+  }
+}
+
+/**
+ * esp_timer callback, keeps idle connections open through proxies and detects dead clients
+ */
+static void heartbeat_timer_cb(void *arg){
+  portENTER_CRITICAL(&s_stream_mux);
+  httpd_handle_t server = s_client_cnt > 0 ? s_server : NULL;
+  portEXIT_CRITICAL(&s_stream_mux);
+  if(server != NULL){
+    httpd_queue_work(server, heartbeat_work, NULL);
+  }
+}
+
+/**
+ * Stores framed event for the server task and queues its sending
+ */
+static void publish(const char *event, size_t event_len){
+  char chunk[STREAM_EVENT_MAX];
+  size_t len = frame_chunk(chunk, sizeof(chunk), event, event_len);
+  if(len == 0){
+    return;
+  }
+  portENTER_CRITICAL(&s_stream_mux);
+  httpd_handle_t server = s_server;
+  unsigned slot = s_event_next++ % STREAM_EVENT_SLOTS;
+  memcpy(s_events[slot], chunk, len);
+  s_event_lens[slot] = len;
+  portEXIT_CRITICAL(&s_stream_mux);
+  if(server != NULL){
+    httpd_queue_work(server, broadcast_work, (void *)(uintptr_t)slot);
+  }
+}
+
+
+/*******************************************************************************
+ *    Stream API
+ *******************************************************************************/
+
+void stream_start(httpd_handle_t server){
+  for(int i = 0; i < STREAM_MAX_CLIENTS; i++){
+    s_clients[i].fd = -1;
+  }
+  portENTER_CRITICAL(&s_stream_mux);
+  s_client_cnt = 0;
+  s_server = server;
+  portEXIT_CRITICAL(&s_stream_mux);
+  if(s_heartbeat_timer == NULL){
+    const esp_timer_create_args_t args = {
+      .callback = heartbeat_timer_cb,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "sse_hb",
+      .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_heartbeat_timer));
+  }
+  esp_timer_start_periodic(s_heartbeat_timer, STREAM_HEARTBEAT_MS * 1000LL / 2);
+}
+
+void stream_stop(void){
+  if(s_heartbeat_timer != NULL){
+    esp_timer_stop(s_heartbeat_timer);
+  }
+  portENTER_CRITICAL(&s_stream_mux);
+  s_server = NULL;
+  portEXIT_CRITICAL(&s_stream_mux);
+}
+
+esp_err_t stream_get_handler(httpd_req_t *req){
+  char event[STREAM_EVENT_MAX];
+  int slot = -1;
+  for(int i = 0; i < STREAM_MAX_CLIENTS && slot < 0; i++){
+    if(s_clients[i].fd < 0){
+      slot = i;
+    }
+  }
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  if(slot < 0){
+    //keep sockets for regular requests, page falls back to polling
+    ESP_LOGW(TAG, "Too many stream clients, refusing %d", httpd_req_to_sockfd(req));
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "60");
+    httpd_resp_sendstr(req, "Too many live streams");
+    return ESP_OK;
+  }
+  httpd_resp_set_type(req, "text/event-stream");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+  //first chunk carries headers, reconnection delay and current values
+  measurement measurements = get_latest_measurements();
+  size_t len = snprintf(event, sizeof(event), "retry:%d\n", STREAM_RETRY_MS);
+  len += format_measurements(event + len, sizeof(event) - len, time(NULL), &measurements);
+  if(httpd_resp_send_chunk(req, event, len) != ESP_OK){
+    return ESP_FAIL;
+  }
+  int fd = httpd_req_to_sockfd(req);
+  struct timeval tv = {0, STREAM_SEND_TIMEOUT_MS * 1000};
+  if(setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0){
+    ESP_LOGW(TAG, "Send timeout of stream client %d not set", fd);
+  }
+  s_clients[slot].fd = fd;
+  s_clients[slot].last_us = esp_timer_get_time();
+  portENTER_CRITICAL(&s_stream_mux);
+  int cnt = ++s_client_cnt;
+  portEXIT_CRITICAL(&s_stream_mux);
+  ESP_LOGI(TAG, "Stream client %d connected (%d/%d)", fd, cnt, STREAM_MAX_CLIENTS);
+  return ESP_OK;      //response stays open
+}
+
+void stream_on_close(httpd_handle_t hd, int sockfd){
+  for(int i = 0; i < STREAM_MAX_CLIENTS; i++){
+    if(s_clients[i].fd == sockfd){
+      drop_client(i);
+      ESP_LOGI(TAG, "Stream client %d disconnected", sockfd);
+    }
+  }
+}
+
+bool stream_holds(int sockfd){
+  for(int i = 0; i < STREAM_MAX_CLIENTS; i++){
+    if(s_clients[i].fd == sockfd){
+      return true;
+    }
+  }
+  return false;
+}
+
+void stream_publish_measurements(time_t now, const measurement *measures){
+  char event[STREAM_EVENT_MAX];
+  if(client_count() == 0){
+    return;
+  }
+  size_t len = format_measurements(event, sizeof(event) - 8, now, measures);
+  if(len > 0){
+    publish(event, len);
+  }
+}
+
+void stream_publish_picture(time_t now){
+  char event[48];
+  if(client_count() == 0){
+    return;
+  }
+  int cx = snprintf(event, sizeof(event), "event:picture\ndata:%lld\n\n", (long long)now);
+  publish(event, cx);
+}
@@ -0,0 +1,75 @@
+/**
+ *  kk_http_stream.h
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Server-Sent Events stream of live measurements (/data/stream)
+ *
+ */
+
+#include <time.h>
+#include <esp_http_server.h>
+
+#ifndef COMPONENTS_KK_HTTP_STREAM_
+#define COMPONENTS_KK_HTTP_STREAM_
+
+struct measurement;   //app.h
+
+/**
+ * Starts heartbeat of the streams. Called by start_webserver().
+ * @param server Server handle
+ */
+void stream_start(httpd_handle_t server);
+
+/**
+ * Stops publishing to the server, must be called before the server is stopped.
+ */
+void stream_stop(void);
+
+/**
+ * Handler of GET /data/stream
+ * Registers client as stream subscriber (up to STREAM_MAX_CLIENTS) and sends current measurements.
+ * The response is left open, further events are pushed by stream_publish_*().
+ *
+ * @param req Request pointer
+ * @return
+ *      ESP_OK if success (also when client is refused with 503)
+ *      ESP_FAIL if stream could not be started
+ */
+esp_err_t stream_get_handler(httpd_req_t *req);
+
+/**
+ * Drops stream subscriber of closed socket. Called by session close callback of the server.
+ *
+ * @param hd Server handle
+ * @param sockfd Socket being closed
+ */
+void stream_on_close(httpd_handle_t hd, int sockfd);
+
+/**
+ * Called by the server task only (as are changes of stream clients).
+ * @param sockfd Client socket
+ * @return true if the socket is a stream client
+ */
+bool stream_holds(int sockfd);
+
+/**
+ * Pushes measurements sample to all stream clients. Safe to call from any task,
+ * does nothing (no formatting) if there are no clients.
+ *
+ * @param now Time of the sample
+ * @param measures Measurements to push
+ */
+void stream_publish_measurements(time_t now, const measurement *measures);
+
+/**
+ * Tells stream clients that new current.jpg is stored. Safe to call from any task.
+ *
+ * @param now Time of the picture
+ */
+void stream_publish_picture(time_t now);
+
+#endif /* COMPONENTS_KK_HTTP_STREAM_ */
@@ -0,0 +1,348 @@
+/**
+ *  kk_http_worker.cpp
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Worker tasks sending bodies of large responses (file downloads)
+ *
+ *  esp_http_server runs all handlers in one task, so multi-MB log or picture download
+ *  would block every other request till it is sent. Handler sends headers and first
+ *  chunk as usual and hands over the rest (file path, position and length) to a pool
+ *  of WORKER_TASKS tasks, which read the file and pass remaining chunks one by one
+ *  to the server task for sending (see kk_http_sock.h, TLS session can not be shared
+ *  by tasks). Server task returns to other requests between chunks instead of waiting
+ *  for the card. Client waits for the end of the response before it sends next request
+ *  on the connection, so the session takes no requests meanwhile.
+ *
+ *  Every handler has its lane with own limit of waiting and running jobs, above it
+ *  the handler sends the file itself as before. Jobs are taken in submission order.
+ *  Waiting jobs hold no file handle (file is reopened by worker).
+ *
+ *  Every worker has its pair of DMA capable buffers from a pool. Reader task fills one
+ *  of them from SD card while the worker sends the other one, so card read and network
+ *  send overlap. Reads go straight to the file (no stdio buffer) and, apart from the
+ *  first one, start at WORKER_BUFSIZE boundary of the file, which makes them whole
+ *  sectors, read by FatFs directly into the buffer. Buffers are small (internal RAM
+ *  is scarce), overlap keeps the card busy anyway.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "kk_http_worker.h"
+#include "kk_http_server_setup.h"
+#include "kk_http_sock.h"
+
+
+static const char* TAG = "HTTP_WRK";
+
+typedef enum {
+  JOB_FREE = 0,
+  JOB_QUEUED,
+  JOB_RUNNING
+} job_state_t;
+
+typedef struct {
+  job_state_t state;
+  volatile bool aborted;  //socket closed or server stopping, running job stops before next chunk
+  uint32_t seq;           //order of submission
+  int fd;                 //client socket
+  worker_lane_t *lane;
+  long offset;            //position of first byte to send
+  size_t remaining;       //bytes to send, SIZE_MAX till end of file
+  char path[FILE_PATH_MAX];
+} worker_job_t;
+
+static worker_job_t s_jobs[WORKER_JOBS];
+static uint32_t s_job_seq = 0;
+static httpd_handle_t s_server = NULL;
+static SemaphoreHandle_t s_job_sem = NULL;    //given once per submitted job
+static portMUX_TYPE s_worker_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/// Room for chunk size line ("2000\r\n") in front of the data and CRLF behind it
+#define CHUNK_HDR_MAX  8
+#define CHUNK_BUF_SIZE  (CHUNK_HDR_MAX + WORKER_BUFSIZE + 2)
+
+typedef struct {
+  int file;
+  char *buf;
+  size_t len;
+  TaskHandle_t worker;    //notified with number of bytes read (negative on error)
+} read_req_t;
+
+static QueueHandle_t s_read_queue = NULL;
+static char *s_buf_pool[WORKER_TASKS][2];
+static int s_workers = 0;                     //tasks started (with buffers)
+
+static const char s_last_chunk[] = "0\r\n\r\n";
+
+
+/*******************************************************************************
+ *    Helpers
+ *******************************************************************************/
+
+/**
+ * Frees job slot, must be called in critical section
+ */
+static void release_job(worker_job_t *job){
+  job->lane->jobs--;
+  job->state = JOB_FREE;
+}
+
+/**
+ * Takes oldest waiting job
+ * @return job, NULL if it was aborted meanwhile
+ */
+static worker_job_t *take_job(void){
+  worker_job_t *job = NULL;
+  portENTER_CRITICAL(&s_worker_mux);
+  for(int i = 0; i < WORKER_JOBS; i++){
+    if(s_jobs[i].state == JOB_QUEUED && (job == NULL || (int32_t)(s_jobs[i].seq - job->seq) < 0)){
+      job = &s_jobs[i];
+    }
+  }
+  if(job != NULL){
+    job->state = JOB_RUNNING;
+  }
+  portEXIT_CRITICAL(&s_worker_mux);
+  return job;
+}
+
+static int running_jobs(void){
+  int n = 0;
+  portENTER_CRITICAL(&s_worker_mux);
+  for(int i = 0; i < WORKER_JOBS; i++){
+    n += (s_jobs[i].state == JOB_RUNNING);
+  }
+  portEXIT_CRITICAL(&s_worker_mux);
+  return n;
+}
+
+/**
+ * Reader task, serves reads of all workers one by one (they share the card anyway)
+ */
+static void vHttpReaderTask(void *arg){
+  read_req_t rd;
+  while(1){
+    xQueueReceive(s_read_queue, &rd, portMAX_DELAY);
+    ssize_t n = read(rd.file, rd.buf, rd.len);
+    xTaskNotify(rd.worker, (uint32_t)n, eSetValueWithOverwrite);
+  }
+}
+
+static void read_start(int file, char *buf, size_t len){
+  read_req_t rd = {file, buf, len, xTaskGetCurrentTaskHandle()};
+  xQueueSend(s_read_queue, &rd, portMAX_DELAY);
+}
+
+static ssize_t read_wait(void){
+  uint32_t n = 0;
+  xTaskNotifyWait(0, UINT32_MAX, &n, portMAX_DELAY);
+  return (ssize_t)(int32_t)n;
+}
+
+/**
+ * Sends the file as HTTP chunks. Data of a chunk is read behind room for its size line,
+ * next chunk is being read into the other buffer meanwhile.
+ */
+static bool send_file(sock_session_t *s, worker_job_t *job, char **bufs){
+  int file = open(job->path, O_RDONLY);
+  if(file < 0 || lseek(file, job->offset, SEEK_SET) != job->offset){
+    ESP_LOGE(TAG, "Failed to reopen file : %s", job->path);
+    if(file >= 0){
+      close(file);
+    }
+    return false;
+  }
+  char size_line[CHUNK_HDR_MAX + 1];
+  bool ok = true;
+  int cur = 0;
+  //first read ends at buffer size boundary of the file, next ones are aligned
+  read_start(file, bufs[cur] + CHUNK_HDR_MAX, MIN(job->remaining, WORKER_BUFSIZE - job->offset % WORKER_BUFSIZE));
+  while(1){
+    ssize_t len = read_wait();
+    if(len <= 0){
+      ok = (len == 0);
+      break;
+    }
+    job->remaining -= len;
+    bool more = job->remaining != 0;
+    if(more){
+      read_start(file, bufs[cur ^ 1] + CHUNK_HDR_MAX, MIN(job->remaining, WORKER_BUFSIZE));
+    }
+    char *data = bufs[cur] + CHUNK_HDR_MAX;
+    int hdr = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)len);
+    memcpy(data - hdr, size_line, hdr);
+    data[len] = '\r';
+    data[len + 1] = '\n';
+    ok = sock_send_all(s, data - hdr, hdr + len + 2);
+    if(!ok || !more){
+      if(more){
+        read_wait();      //buffer and file are in use by reader
+      }
+      break;
+    }
+    cur ^= 1;
+  }
+  close(file);
+  return ok && sock_send_all(s, s_last_chunk, sizeof(s_last_chunk) - 1);
+}
+
+static void vHttpWorkerTask(void *arg){
+  char **bufs = s_buf_pool[(uintptr_t)arg];
+  SemaphoreHandle_t done = xSemaphoreCreateBinary();    //sends done by server task
+  while(1){
+    xSemaphoreTake(s_job_sem, portMAX_DELAY);
+    worker_job_t *job = take_job();
+    if(job == NULL){
+      continue;     //aborted while waiting
+    }
+    sock_session_t s = {};
+    portENTER_CRITICAL(&s_worker_mux);
+    s.hd = s_server;
+    portEXIT_CRITICAL(&s_worker_mux);
+    s.fd = job->fd;
+    s.aborted = &job->aborted;
+    s.done = done;
+    bool ok = s.hd != NULL && send_file(&s, job, bufs);
+    if(ok){
+      ESP_LOGI(TAG, "File sending complete : %s", job->path);
+    }else if(!job->aborted){
+      ESP_LOGE(TAG, "File sending failed : %s", job->path);
+    }
+#ifdef CONFIG_KK_HTTPD_CONN_CLOSE_HEADER
+    ok = false;     //response had Connection: close
+#endif
+    if(!ok && s.hd != NULL){
+      sock_close(&s);
+    }
+    portENTER_CRITICAL(&s_worker_mux);
+    release_job(job);
+    portEXIT_CRITICAL(&s_worker_mux);
+  }
+}
+
+
+/*******************************************************************************
+ *    Worker API
+ *******************************************************************************/
+
+void worker_start(httpd_handle_t server){
+  if(s_job_sem == NULL){
+    s_job_sem = xSemaphoreCreateCounting(UINT16_MAX, 0);
+    s_read_queue = xQueueCreate(WORKER_TASKS, sizeof(read_req_t));
+    xTaskCreatePinnedToCore(vHttpReaderTask, "HTTPRD", WORKER_READER_STACK_SIZE, NULL, HTTP_WORKER_TASK_PRIO, NULL, tskNO_AFFINITY);
+    for(int i = 0; i < WORKER_TASKS; i++){
+      //SD host reads by DMA straight into internal RAM, PSRAM would need bounce buffer
+      s_buf_pool[i][0] = (char *)heap_caps_malloc(CHUNK_BUF_SIZE, MALLOC_CAP_DMA);
+      s_buf_pool[i][1] = (char *)heap_caps_malloc(CHUNK_BUF_SIZE, MALLOC_CAP_DMA);
+      if(!s_buf_pool[i][0] || !s_buf_pool[i][1]){
+        ESP_LOGE(TAG, "Failed to allocate memory for worker buffers");
+        free(s_buf_pool[i][0]);
+        free(s_buf_pool[i][1]);
+        break;
+      }
+      char name[configMAX_TASK_NAME_LEN];
+      snprintf(name, sizeof(name), "HTTPWRK%d", i);
+      xTaskCreatePinnedToCore(vHttpWorkerTask, name, WORKER_STACK_SIZE, (void *)(uintptr_t)i,
+                              HTTP_WORKER_TASK_PRIO, NULL, tskNO_AFFINITY);
+      s_workers++;
+    }
+  }
+  portENTER_CRITICAL(&s_worker_mux);
+  s_server = server;
+  portEXIT_CRITICAL(&s_worker_mux);
+  ESP_LOGI(TAG, "%d workers ready, free internal heap %u B (largest block %u B)", s_workers,
+           heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+}
+
+void worker_stop(void){
+  portENTER_CRITICAL(&s_worker_mux);
+  s_server = NULL;
+  for(int i = 0; i < WORKER_JOBS; i++){
+    s_jobs[i].aborted = true;
+    if(s_jobs[i].state == JOB_QUEUED){
+      release_job(&s_jobs[i]);
+    }
+  }
+  portEXIT_CRITICAL(&s_worker_mux);
+  //running jobs stop before next chunk, blocked send times out at worst
+  for(int t = 0; t < WORKER_STOP_WAIT_MS && running_jobs() > 0; t += 10){
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+esp_err_t worker_submit(httpd_req_t *req, worker_lane_t *lane, const char *path, FILE *f, size_t remaining){
+  long offset = ftell(f);
+  if(offset < 0 || strlen(path) >= FILE_PATH_MAX){
+    return ESP_ERR_NO_MEM;
+  }
+  worker_job_t *job = NULL;
+  esp_err_t err = ESP_ERR_NO_MEM;
+  int fd = httpd_req_to_sockfd(req);
+  portENTER_CRITICAL(&s_worker_mux);
+  if(s_server == NULL || s_workers == 0){
+    err = ESP_ERR_INVALID_STATE;
+  }else if(lane->jobs < lane->limit){
+    for(int i = 0; i < WORKER_JOBS && job == NULL; i++){
+      if(s_jobs[i].state == JOB_FREE){
+        job = &s_jobs[i];
+      }
+    }
+  }
+  if(job != NULL){
+    job->aborted = false;
+    job->seq = s_job_seq++;
+    job->fd = fd;
+    job->lane = lane;
+    job->offset = offset;
+    job->remaining = remaining;
+    strcpy(job->path, path);
+    lane->jobs++;
+    job->state = JOB_QUEUED;
+    err = ESP_OK;
+  }
+  portEXIT_CRITICAL(&s_worker_mux);
+  if(err != ESP_OK){
+    return err;
+  }
+  fclose(f);
+  xSemaphoreGive(s_job_sem);
+  ESP_LOGI(TAG, "Rest of %s queued for %s worker (socket %d)", path, lane->name, fd);
+  return ESP_OK;
+}
+
+bool worker_holds(int sockfd){
+  bool held = false;
+  portENTER_CRITICAL(&s_worker_mux);
+  for(int i = 0; i < WORKER_JOBS && !held; i++){
+    held = s_jobs[i].state != JOB_FREE && s_jobs[i].fd == sockfd;
+  }
+  portEXIT_CRITICAL(&s_worker_mux);
+  return held;
+}
+
+void worker_on_close(httpd_handle_t hd, int sockfd){
+  portENTER_CRITICAL(&s_worker_mux);
+  for(int i = 0; i < WORKER_JOBS; i++){
+    if(s_jobs[i].state != JOB_FREE && s_jobs[i].fd == sockfd){
+      s_jobs[i].aborted = true;
+      if(s_jobs[i].state == JOB_QUEUED){
+        release_job(&s_jobs[i]);
+      }
+    }
+  }
+  portEXIT_CRITICAL(&s_worker_mux);
+}
@@ -0,0 +1,72 @@
+/**
+ *  kk_http_worker.h
+ *
+ *  This file is part of ESP32 Weather Logger https://github.com/k-nowicki/esp32_weather_logger
+ *
+ *  Created on: 19 10 2026
+ *      Author: Karol Nowicki
+ *
+ *  Worker tasks sending bodies of large responses (file downloads)
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <esp_http_server.h>
+
+#ifndef COMPONENTS_KK_HTTP_WORKER_
+#define COMPONENTS_KK_HTTP_WORKER_
+
+/// Jobs of one handler, limits how many of them may wait or run at a time
+typedef struct {
+  const char *name;   ///< Name for logs
+  uint8_t limit;      ///< Max jobs of the handler (waiting and running)
+  uint8_t jobs;       ///< Current jobs of the handler
+} worker_lane_t;
+
+/**
+ * Creates worker tasks (first call only) and starts accepting jobs. Called by start_webserver().
+ * @param server Server handle
+ */
+void worker_start(httpd_handle_t server);
+
+/**
+ * Stops accepting jobs, aborts pending ones and waits for running ones to finish.
+ * Must be called before the server is stopped.
+ */
+void worker_stop(void);
+
+/**
+ * Hands over the rest of a chunked file response to a worker task.
+ * Response headers (and usually first chunk) must be already sent by the handler,
+ * the worker sends remaining chunks and the terminating one.
+ * File is closed on success, job is reopening it by path (SD card has few file handles),
+ * so waiting jobs do not hold them.
+ *
+ * @param req Request pointer
+ * @param lane Jobs of the handler
+ * @param path Full path of the file
+ * @param f Open file, positioned at first byte to send
+ * @param remaining Number of bytes to send, SIZE_MAX to send till end of file
+ * @return
+ *      ESP_OK if job is queued (handler should return ESP_OK)
+ *      ESP_ERR_NO_MEM if lane or worker queue is full, handler should send the rest itself
+ *      ESP_ERR_INVALID_STATE if workers are stopped (or could not start)
+ */
+esp_err_t worker_submit(httpd_req_t *req, worker_lane_t *lane, const char *path, FILE *f, size_t remaining);
+
+/**
+ * Aborts jobs of closed socket. Called by session close callback of the server.
+ *
+ * @param hd Server handle
+ * @param sockfd Socket being closed
+ */
+void worker_on_close(httpd_handle_t hd, int sockfd);
+
+/**
+ * @param sockfd Client socket
+ * @return true if a job of the socket is waiting or running
+ */
+bool worker_holds(int sockfd);
+
+#endif /* COMPONENTS_KK_HTTP_WORKER_ */
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "unity.h"
+
+#include "kk_http_util.h"
+#include "kk_http_file.h"
+#include "kk_http_app.h"
+#include "kk_http_server_setup.h"
+#include "kk_http_worker.h"
+
+// host_test only: file_get_handler() against the request mock of host_test/stubs/esp_http_server.h,
+// files are made in a directory of the build
+#ifndef TEST_WWW_ROOT
+#define TEST_WWW_ROOT "/sd/www"
+#endif
+
+// other parts of the server
+static int s_worker_submits = 0;
+
+void http_track_request(httpd_req_t *req)
+{
+}
+
+esp_err_t worker_submit(httpd_req_t *req, worker_lane_t *lane, const char *path, FILE *f, size_t remaining)
+{
+    s_worker_submits++;
+    return ESP_ERR_INVALID_STATE;     //workers stopped, handler sends the rest itself
+}
+
+esp_err_t index_html_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "301 Moved Permanently");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+static struct file_server_data s_server_data;
+
+static char s_log[100];
+static char s_big[SCRATCH_BUFSIZE * 2 + 500];
+static char s_js[600];
+static char s_js_gz[64];
+
+static void write_file(const char *name, const char *data, size_t len)
+{
+    char path[FILE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s%s", TEST_WWW_ROOT, name);
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    if (f) {
+        TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+        fclose(f);
+    }
+}
+
+static void make_files(void)
+{
+    static bool made = false;
+    if (made) {
+        return;
+    }
+    made = true;
+    mkdir(TEST_WWW_ROOT, 0777);
+    mkdir(TEST_WWW_ROOT "/logs", 0777);
+    mkdir(TEST_WWW_ROOT "/js", 0777);
+    for (size_t i = 0; i < sizeof(s_log); i++) {
+        s_log[i] = 'a' + i % 26;
+    }
+    for (size_t i = 0; i < sizeof(s_big); i++) {
+        s_big[i] = 'A' + i % 23;
+    }
+    for (size_t i = 0; i < sizeof(s_js); i++) {
+        s_js[i] = '0' + i % 10;
+    }
+    for (size_t i = 0; i < sizeof(s_js_gz); i++) {
+        s_js_gz[i] = (char)(0x80 + i);
+    }
+    write_file("/logs/day.csv", s_log, sizeof(s_log));
+    write_file("/logs/big.csv", s_big, sizeof(s_big));
+    write_file("/js/app.js", s_js, sizeof(s_js));
+    write_file("/js/app.js.gz", s_js_gz, sizeof(s_js_gz));
+    snprintf(s_server_data.base_path, sizeof(s_server_data.base_path), "%s", TEST_WWW_ROOT);
+}
+
+/**
+ * GET of uri with optional Range, If-Range and Accept-Encoding headers (NULL = not sent)
+ */
+static esp_err_t get(httpd_mock_t *m, const char *uri, const char *range, const char *if_range, const char *accept_encoding)
+{
+    httpd_req_t req;
+    make_files();
+    httpd_mock_init(&req, m, uri, &s_server_data);
+    if (range) {
+        httpd_mock_add_hdr(m, "Range", range);
+    }
+    if (if_range) {
+        httpd_mock_add_hdr(m, "If-Range", if_range);
+    }
+    if (accept_encoding) {
+        httpd_mock_add_hdr(m, "Accept-Encoding", accept_encoding);
+    }
+    esp_err_t ret = file_get_handler(&req);
+    TEST_ASSERT_TRUE(m->complete);
+    return ret;
+}
+
+TEST_CASE("File handler sends byte range with 206", "[kk_http_app]")
+{
+    httpd_mock_t m;
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/day.csv", "bytes=10-19", NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("206 Partial Content", m.sent_status);
+    TEST_ASSERT_EQUAL_STRING("bytes 10-19/100", httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_EQUAL_STRING("bytes", httpd_mock_sent_hdr(&m, "Accept-Ranges"));
+    TEST_ASSERT_EQUAL_STRING("no-cache", httpd_mock_sent_hdr(&m, "Cache-Control"));
+    TEST_ASSERT_EQUAL_STRING("application/CSV", m.sent_type);
+    TEST_ASSERT_EQUAL(10, m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_log + 10, m.body, 10));
+    httpd_mock_free(&m);
+
+    // last bytes of growing log
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/day.csv", "bytes=-5", NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("bytes 95-99/100", httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_EQUAL(5, m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_log + 95, m.body, 5));
+    httpd_mock_free(&m);
+
+    // range longer than scratch buffer is offered to workers, sent by handler when they do not take it
+    int submits = s_worker_submits;
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/big.csv", "bytes=100-10099", NULL, NULL));
+    TEST_ASSERT_EQUAL(submits + 1, s_worker_submits);
+    TEST_ASSERT_EQUAL_STRING("206 Partial Content", m.sent_status);
+    TEST_ASSERT_EQUAL(10000, m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_big + 100, m.body, 10000));
+    TEST_ASSERT_TRUE(m.chunks >= 2);
+    httpd_mock_free(&m);
+}
+
+TEST_CASE("File handler answers range outside of file with 416", "[kk_http_app]")
+{
+    httpd_mock_t m;
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/day.csv", "bytes=100-", NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("416 Range Not Satisfiable", m.sent_status);
+    TEST_ASSERT_EQUAL_STRING("bytes */100", httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_EQUAL(0, m.len);
+    httpd_mock_free(&m);
+}
+
+TEST_CASE("File handler sends whole file when If-Range does not match", "[kk_http_app]")
+{
+    httpd_mock_t m;
+    char etag[HTTP_ETAG_LEN + 8];
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/day.csv", NULL, NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("200 OK", m.sent_status);
+    TEST_ASSERT_NOT_NULL(httpd_mock_sent_hdr(&m, "ETag"));
+    snprintf(etag, sizeof(etag), "%s", httpd_mock_sent_hdr(&m, "ETag"));
+    httpd_mock_free(&m);
+
+    // file changed since the client got its part
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/day.csv", "bytes=50-", "\"1-1\"", NULL));
+    TEST_ASSERT_EQUAL_STRING("200 OK", m.sent_status);
+    TEST_ASSERT_NULL(httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_EQUAL(sizeof(s_log), m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_log, m.body, sizeof(s_log)));
+    httpd_mock_free(&m);
+
+    // unchanged file resumes
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/logs/day.csv", "bytes=50-", etag, NULL));
+    TEST_ASSERT_EQUAL_STRING("206 Partial Content", m.sent_status);
+    TEST_ASSERT_EQUAL_STRING("bytes 50-99/100", httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_EQUAL(50, m.len);
+    httpd_mock_free(&m);
+}
+
+TEST_CASE("File handler sends range of cached asset", "[kk_http_app]")
+{
+    httpd_mock_t m;
+    // first request reads the asset into the cache
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/js/app.js", NULL, NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("200 OK", m.sent_status);
+    TEST_ASSERT_EQUAL(sizeof(s_js), m.len);
+    httpd_mock_free(&m);
+
+    file_cache_stats_t before = get_www_cache_stats();
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/js/app.js", "bytes=500-", NULL, NULL));
+    file_cache_stats_t after = get_www_cache_stats();
+    TEST_ASSERT_EQUAL(before.hits + 1, after.hits);
+    TEST_ASSERT_EQUAL_STRING("206 Partial Content", m.sent_status);
+    TEST_ASSERT_EQUAL_STRING("bytes 500-599/600", httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_EQUAL_STRING("application/x-javascript", m.sent_type);
+    TEST_ASSERT_EQUAL(100, m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_js + 500, m.body, 100));
+    TEST_ASSERT_FALSE(m.chunked);
+    httpd_mock_free(&m);
+}
+
+TEST_CASE("File handler sends range of .gz sibling", "[kk_http_app]")
+{
+    httpd_mock_t m;
+    char plain_etag[HTTP_ETAG_LEN + 8];
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/js/app.js", NULL, NULL, NULL));
+    snprintf(plain_etag, sizeof(plain_etag), "%s", httpd_mock_sent_hdr(&m, "ETag"));
+    httpd_mock_free(&m);
+
+    // range applies to the compressed bytes, which have their own validators
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/js/app.js", "bytes=8-15", NULL, "gzip, deflate, br"));
+    TEST_ASSERT_EQUAL_STRING("206 Partial Content", m.sent_status);
+    TEST_ASSERT_EQUAL_STRING("gzip", httpd_mock_sent_hdr(&m, "Content-Encoding"));
+    TEST_ASSERT_EQUAL_STRING("Accept-Encoding", httpd_mock_sent_hdr(&m, "Vary"));
+    TEST_ASSERT_EQUAL_STRING("bytes 8-15/64", httpd_mock_sent_hdr(&m, "Content-Range"));
+    TEST_ASSERT_TRUE(strcmp(plain_etag, httpd_mock_sent_hdr(&m, "ETag")) != 0);
+    TEST_ASSERT_EQUAL(8, m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_js_gz + 8, m.body, 8));
+    httpd_mock_free(&m);
+
+    // If-Range with ETag of the uncompressed file does not match the .gz
+    TEST_ASSERT_EQUAL(ESP_OK, get(&m, "/js/app.js", "bytes=8-15", plain_etag, "gzip"));
+    TEST_ASSERT_EQUAL_STRING("200 OK", m.sent_status);
+    TEST_ASSERT_EQUAL(sizeof(s_js_gz), m.len);
+    TEST_ASSERT_EQUAL(0, memcmp(s_js_gz, m.body, sizeof(s_js_gz)));
+    httpd_mock_free(&m);
+}
@@ -100,6 +100,8 @@ TaskHandle_t g_vDHT11TaskHandle = NULL;
 TaskHandle_t g_vSensorsTaskHandle = NULL;
 TaskHandle_t g_vDisplayTaskHandle = NULL;
 TaskHandle_t g_vCameraTaskHandle = NULL;
+TaskHandle_t g_vCamWriterTaskHandle = NULL;
+TaskHandle_t g_vThumbTaskHandle = NULL;
 TaskHandle_t g_vSDCSVLGTaskHandle = NULL;
 TaskHandle_t g_vSDAVGLGTaskHandle = NULL;
 TaskHandle_t g_vSDJSLGTaskHandle = NULL;
@@ -130,6 +132,9 @@ void app_main(void){
   }else{
     ESP_LOGI(TAG, "Camera initialized.");
   }
+  if(init_camera_pipeline() != ESP_OK){
+    ESP_LOGE(TAG, "Camera pipeline initialization failed!");
+  }
 
   //Set I2C interface
   Wire1.begin(I2C_SDA, I2C_SCL);
@@ -223,6 +228,8 @@ void app_main(void){
   xTaskCreatePinnedToCore( vSensorsTask, "SENS", 2048, NULL, SENSORS_TASK_PRIO, &g_vSensorsTaskHandle, tskNO_AFFINITY );
   xTaskCreatePinnedToCore( vDisplayTask, "OLED", 2048, NULL, DISPLAY_TASK_PRIO, &g_vDisplayTaskHandle, tskNO_AFFINITY );
   xTaskCreatePinnedToCore( vCameraTask, "CAM", 48*1024, NULL, CAM_TASK_PRIO, &g_vCameraTaskHandle, tskNO_AFFINITY );
+  xTaskCreatePinnedToCore( vCamWriterTask, "CAMWR", 4096, NULL, CAMWR_TASK_PRIO, &g_vCamWriterTaskHandle, tskNO_AFFINITY );
+  xTaskCreatePinnedToCore( vThumbTask, "THUMB", 8*1024, NULL, THUMB_TASK_PRIO, &g_vThumbTaskHandle, tskNO_AFFINITY );
   //Loggers
   xTaskCreatePinnedToCore( vSDCSVLGTask, "SDCSVLG", 6*1024, NULL, SDCSVLG_TASK_PRIO, &g_vSDCSVLGTaskHandle, tskNO_AFFINITY );
 //  xTaskCreatePinnedToCore( vSDJSLGTask, "SDJSLG", 6*1024, NULL, SDJSLG_TASK_PRIO, &g_vSDJSLGTaskHandle, tskNO_AFFINITY );
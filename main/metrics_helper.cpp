@@ -0,0 +1,124 @@
+/*
+ * metrics_helper.cpp
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "setup.h"
+#include "metrics_helper.h"
+#include "stats_helper.h"
+
+const uint32_t g_latency_bounds_us[METRICS_HIST_MAX_BOUNDS] = {
+  1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000, 5000000
+};
+
+sensor_metrics g_sensor_metrics[METRIC_SENSORS_NO] = {
+  {LATENCY_HISTOGRAM_INIT, 0}, {LATENCY_HISTOGRAM_INIT, 0}, {LATENCY_HISTOGRAM_INIT, 0},
+  {LATENCY_HISTOGRAM_INIT, 0}, {LATENCY_HISTOGRAM_INIT, 0}
+};
+metric_counter_t g_logger_deadline_misses[METRIC_LOGGERS_NO];
+metric_histogram_t g_sd_op_latency[METRIC_SD_OPS_NO] = {LATENCY_HISTOGRAM_INIT, LATENCY_HISTOGRAM_INIT};
+
+static const char *s_sensor_labels[METRIC_SENSORS_NO] = {
+  "sensor=\"bh1750\"", "sensor=\"bmp280\"", "sensor=\"htu21\"", "sensor=\"dht11\"", "sensor=\"anemometer\""
+};
+static const char *s_logger_labels[METRIC_LOGGERS_NO] = {
+  "logger=\"csv\"", "logger=\"avg\"", "logger=\"json\""
+};
+static const char *s_sd_op_labels[METRIC_SD_OPS_NO] = {
+  "op=\"log_append\"", "op=\"picture_write\""
+};
+
+void metrics_sensor_read(metric_sensor sensor, int64_t start_us, bool ok){
+  metric_observe_us(&g_sensor_metrics[sensor].read, metrics_elapsed_us(start_us));
+  if(!ok){
+    metric_inc(&g_sensor_metrics[sensor].errors);
+  }
+}
+
+static void write_task_metrics(metrics_writer_t *w){
+  static system_stats stats;   //only http server task scrapes
+  char labels[32];
+  get_system_stats(&stats);
+
+  metrics_family(w, "kk_task_cpu_percent", "gauge", "CPU usage of the task over stats window, all cores are 100%.");
+  for(UBaseType_t i = 0; i < stats.tasks_no && stats.window_ms; i++){
+    snprintf(labels, sizeof(labels), "task=\"%s\"", stats.tasks[i].name);
+    metrics_value(w, "kk_task_cpu_percent", labels, stats.tasks[i].cpu_permille / 10.0);
+  }
+  metrics_family(w, "kk_cpu_load_percent", "gauge", "Load of the core over stats window.");
+  for(int core = 0; core < portNUM_PROCESSORS && stats.window_ms; core++){
+    snprintf(labels, sizeof(labels), "core=\"%d\"", core);
+    metrics_value(w, "kk_cpu_load_percent", labels, stats.core_load_permille[core] / 10.0);
+  }
+  metrics_family(w, "kk_task_stack_free_min_bytes", "gauge", "Stack high water mark of the task.");
+  for(UBaseType_t i = 0; i < stats.tasks_no; i++){
+    snprintf(labels, sizeof(labels), "task=\"%s\"", stats.tasks[i].name);
+    metrics_uint(w, "kk_task_stack_free_min_bytes", labels, stats.tasks[i].stack_free);
+  }
+}
+
+static void write_heap_metrics(metrics_writer_t *w){
+  static const char *labels[] = {"heap=\"internal\"", "heap=\"psram\""};
+  static const uint32_t caps[] = {MALLOC_CAP_INTERNAL, MALLOC_CAP_SPIRAM};
+
+  metrics_family(w, "kk_heap_free_bytes", "gauge", "Free heap.");
+  for(int i = 0; i < 2; i++){
+    metrics_uint(w, "kk_heap_free_bytes", labels[i], heap_caps_get_free_size(caps[i]));
+  }
+  metrics_family(w, "kk_heap_largest_free_block_bytes", "gauge", "Largest block which can be allocated.");
+  for(int i = 0; i < 2; i++){
+    metrics_uint(w, "kk_heap_largest_free_block_bytes", labels[i], heap_caps_get_largest_free_block(caps[i]));
+  }
+  metrics_family(w, "kk_heap_free_min_bytes", "gauge", "Lowest free heap since boot.");
+  for(int i = 0; i < 2; i++){
+    metrics_uint(w, "kk_heap_free_min_bytes", labels[i], heap_caps_get_minimum_free_size(caps[i]));
+  }
+}
+
+/**
+ * @brief Writes metrics of the system (tasks, heap, Wi-Fi) and of the application tasks
+ *        (sensors, loggers, SD card). Called by /metrics handler.
+ *
+ * Task stats are copied from the snapshot published by stats task (see stats_helper.h),
+ * so scrape does not wait nor walk the task list.
+ *
+ * @param w Writer
+ */
+void write_app_metrics(metrics_writer_t *w){
+  metrics_family(w, "kk_uptime_seconds", "gauge", "Time since boot.");
+  metrics_uint(w, "kk_uptime_seconds", NULL, esp_timer_get_time() / 1000000);
+  write_task_metrics(w);
+  write_heap_metrics(w);
+#ifdef CONFIG_KK_CONNECT_WIFI
+  wifi_ap_record_t ap;
+  if(esp_wifi_sta_get_ap_info(&ap) == ESP_OK){
+    metrics_family(w, "kk_wifi_rssi_dbm", "gauge", "Signal strength of the access point.");
+    metrics_value(w, "kk_wifi_rssi_dbm", NULL, ap.rssi);
+  }
+#endif // CONFIG_KK_CONNECT_WIFI
+
+  metrics_family(w, "kk_sensor_read_seconds", "histogram", "Time of sensor reads.");
+  for(int i = 0; i < METRIC_SENSORS_NO; i++){
+    metrics_histogram(w, "kk_sensor_read_seconds", s_sensor_labels[i], &g_sensor_metrics[i].read);
+  }
+  metrics_family(w, "kk_sensor_errors_total", "counter", "Failed sensor reads.");
+  for(int i = 0; i < METRIC_SENSORS_NO; i++){
+    metrics_uint(w, "kk_sensor_errors_total", s_sensor_labels[i], metric_get(&g_sensor_metrics[i].errors));
+  }
+  metrics_family(w, "kk_logger_deadline_misses_total", "counter", "Log periods overrun by the logger.");
+  for(int i = 0; i < METRIC_LOGGERS_NO; i++){
+    metrics_uint(w, "kk_logger_deadline_misses_total", s_logger_labels[i], metric_get(&g_logger_deadline_misses[i]));
+  }
+  metrics_family(w, "kk_sd_op_seconds", "histogram", "Time of SD card operations.");
+  for(int i = 0; i < METRIC_SD_OPS_NO; i++){
+    metrics_histogram(w, "kk_sd_op_seconds", s_sd_op_labels[i], &g_sd_op_latency[i]);
+  }
+}
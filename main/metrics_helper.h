@@ -0,0 +1,79 @@
+/*
+ * metrics_helper.h
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ *
+ *  Counters and latency histograms of tasks (sensors, loggers, SD card) exposed by /metrics.
+ *  Tasks update them lock-free (see kk_metrics.h), scrape formats them with system state.
+ */
+
+#ifndef MAIN_METRICS_HELPER_H_
+#define MAIN_METRICS_HELPER_H_
+
+#include <stdint.h>
+#include "esp_timer.h"
+#include "kk_metrics.h"
+
+//Sensors with read latency and error metrics
+enum metric_sensor{
+  METRIC_SENSOR_BH1750,
+  METRIC_SENSOR_BMP280,
+  METRIC_SENSOR_HTU21,
+  METRIC_SENSOR_DHT11,
+  METRIC_SENSOR_ANEMO,
+  METRIC_SENSORS_NO
+};
+
+//Loggers counting missed deadlines (log period overrun)
+enum metric_logger{
+  METRIC_LOGGER_CSV,
+  METRIC_LOGGER_AVG,
+  METRIC_LOGGER_JSON,
+  METRIC_LOGGERS_NO
+};
+
+//Timed SD card operations
+enum metric_sd_op{
+  METRIC_SD_LOG_APPEND,       //open, append line and close of a log file
+  METRIC_SD_PICTURE_WRITE,    //picture file with its index entry (or append to day pack)
+  METRIC_SD_OPS_NO
+};
+
+struct sensor_metrics{
+  metric_histogram_t read;    //time of one read
+  metric_counter_t errors;    //failed reads
+};
+
+//Bounds of latency histograms: 1 ms .. 5 s
+extern const uint32_t g_latency_bounds_us[METRICS_HIST_MAX_BOUNDS];
+#define LATENCY_HISTOGRAM_INIT METRIC_HISTOGRAM_INIT(g_latency_bounds_us)
+
+extern sensor_metrics g_sensor_metrics[METRIC_SENSORS_NO];
+extern metric_counter_t g_logger_deadline_misses[METRIC_LOGGERS_NO];
+extern metric_histogram_t g_sd_op_latency[METRIC_SD_OPS_NO];
+
+/**
+ * @param start_us esp_timer time of the start
+ * @return Microseconds since start
+ */
+static inline uint32_t metrics_elapsed_us(int64_t start_us){
+  return (uint32_t)(esp_timer_get_time() - start_us);
+}
+
+/**
+ * Counts read of a sensor
+ * @param sensor Sensor
+ * @param start_us esp_timer time the read started
+ * @param ok false if read failed
+ */
+void metrics_sensor_read(metric_sensor sensor, int64_t start_us, bool ok);
+
+/**
+ * Writes task, heap, Wi-Fi, sensor, logger and SD card metrics
+ * CPU usage of tasks is taken over the window of stats task.
+ * @param w Writer
+ */
+void write_app_metrics(metrics_writer_t *w);
+
+#endif /* MAIN_METRICS_HELPER_H_ */
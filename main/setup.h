@@ -74,8 +74,9 @@
  *  SD Card Setup
  */
 #define SD_MOUNT_POINT "/sd"
-#define SD_MAX_FILES 5
+#define SD_MAX_FILES 7   //loggers, camera writer, web server and its download workers
 #define SD_ALLOCATION_UNIT_SIZE 16 * 512   //tradeoff between heap demand and speed
+#define SD_FATFS_DRIVE "0:"   //FatFs logical drive of the card (for free space check)
 
 /*******************************************************************************
  *  Camera Setup
@@ -88,18 +89,24 @@
  */
 
 #define CAM_TASK_PRIO       20
+#define CAMWR_TASK_PRIO     18
 #define SDAVGLG_TASK_PRIO   18
 #define SDCSVLG_TASK_PRIO   18
 #define SDJSLG_TASK_PRIO    18
 #define DISPLAY_TASK_PRIO   15
 #define HTTP_TASK_PRIO      DISPLAY_TASK_PRIO
+#define HTTP_WORKER_TASK_PRIO  (HTTP_TASK_PRIO - 1)   //downloads yield to API requests
 #define SENSORS_TASK_PRIO   13
 #define DHT11_TASK_PRIO     12
 #define RTC_TASK_PRIO       10
 #define STATS_TASK_PRIO     9
+#define THUMB_TASK_PRIO     3
+#define HTTP_EXPORT_TASK_PRIO  2   //tar export yields to loggers, camera and thumbnails
 
-#define STATS_TICKS         pdMS_TO_TICKS(10*1000)
-#define ARRAY_SIZE_OFFSET   5   //Increase this if print_real_time_stats returns ESP_ERR_INVALID_SIZE
+#define STATS_TICKS         pdMS_TO_TICKS(10*1000)  //Period of stats report at UART
+#define STATS_SAMPLE_TICKS  pdMS_TO_TICKS(1000)     //Period of task run time sampling
+#define STATS_WINDOW_SAMPLES 10   //CPU usage is counted over this many sample periods
+#define STATS_MAX_TASKS     40    //Increase this if stats report skipped samples
 
 /*******************************************************************************
  *  App Setup
@@ -113,8 +120,30 @@
 //Picture settings
 #define PIC_FILE_DIR "/www/dcim"  //directory holding pictures without mount point (ex: "/www/logs" puts logs in SD_MOUNT_POINT/www/dcim/picture.jpg)
 #define CAM_FILE_PATH static_cast<const char *>(SD_MOUNT_POINT PIC_FILE_DIR)
-#define PICTURE_INTERVAL_M 5          //number of minutes between pictures
+#define PICTURE_INTERVAL_M 5          //number of minutes between pictures (when scene change can not be measured)
+#define PICTURE_MIN_INTERVAL_M 2      //minutes between pictures of fast changing scene (max 999 pictures a day!)
+#define PICTURE_MAX_INTERVAL_M 15     //minutes between pictures of static scene
+#define CHANGE_LOW  2.0               //mean gray level difference to last stored picture treated as noise
+#define CHANGE_HIGH 12.0              //mean gray level difference treated as fast change (MIN interval)
+#define CHANGE_SCALE JPG_SCALE_8X     //preview downscale for change detection
+#define CHANGE_BUF_SIZE ((1600/8)*(1200/8)) //grayscale preview buffer (UXGA at 1/8)
 #define FILENAME_LEN 25           //Length of camera picture filename NNN_DDMMYYY.jpg
 #define FILEPATH_LEN_MAX 40       //Maximum length of full path to picture (for buffer allocation- keep it short, but not shorter than necessary)
-#define PIC_LIST_BUFFER_SIZE  (1500/PICTURE_INTERVAL_M)*(2*FILENAME_LEN+28) +55 //(MINUTES_IN_DAY/PICTURE_INTERVAL_M)*(2*FILENAME_LEN + IL_TEXT_LEN) + HTML_WRAP_TEXT_LEN
+#define CAM_POOL_SLOTS 2          //Number of PSRAM buffers for pictures waiting to be written to SD card
+#define CAM_SLOT_WAIT_MS 100      //How long capture waits for free buffer before dropping the frame
+#define CAM_PREVIEW_FRAMESIZE FRAMESIZE_VGA //Frame size of current.jpg and change detection frames (archived ones use FRAMESIZE)
+#define JPEG_DAY_BUDGET_MB 64      //SD card space archived pictures may take per day
+#define JPEG_QUALITY_BEST 6        //Lowest jpeg_quality rate control may use (0-63 lower number means higher quality)
+#define JPEG_QUALITY_WORST 24      //Highest jpeg_quality rate control may use
+#define JPEG_QUALITY_STEP 2        //Max jpeg_quality change between archived pictures
+#define CAM_SETTLE_FRAMES_MAX 8   //Frames grabbed at most after exposure preset before archiving anyway
+#define CAM_GOOD_LUMA_MIN 60      //Mean preview luma of well exposed frame - lower bound
+#define CAM_GOOD_LUMA_MAX 190     //Mean preview luma of well exposed frame - upper bound
+#define CAM_SETTLE_LUMA_DELTA 3   //Max mean luma difference between frames when exposure is settled
+#define THUMB_QUEUE_LEN 8         //Number of stored pictures that may wait for thumbnail generation
+#define PIC_LIST_PAGE 100         //Default number of pictures in one /data/pictures response
+#define SERIES_POINTS 1000        //Default number of points per series in /data/series response
+#define SERIES_POINTS_MAX 4000    //Max number of points per series client may ask for
+#define SERIES_MAX_DAYS 31        //Max time range of /data/series query in days
+#define SERIES_RAW_MAX_DAYS 2     //Longer ranges are always read from avg logs (raw logs are ~4MB a day)
 #endif /* MAIN_SETUP_H_ */
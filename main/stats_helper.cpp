@@ -0,0 +1,144 @@
+/*
+ * stats_helper.cpp
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "stats_helper.h"
+
+//Ring keeps one sample more than the window, deltas are taken between its ends
+#define STATS_RING  (STATS_WINDOW_SAMPLES + 1)
+
+//Run time counters of a task in the last STATS_RING samples
+struct tracked_task{
+  TaskHandle_t handle;        //NULL for free slot
+  bool seen;                  //found in current sample
+  uint32_t run[STATS_RING];
+};
+
+//All below is touched by the stats task only, except published snapshot
+static TaskStatus_t s_status[STATS_MAX_TASKS];
+static tracked_task s_tracked[STATS_MAX_TASKS];
+static uint32_t s_total[STATS_RING];
+static TickType_t s_ticks[STATS_RING];
+static uint32_t s_head = 0;
+static uint32_t s_filled = 0;
+static uint32_t s_overflows = 0;
+static system_stats s_building;
+
+static system_stats s_published;
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Finds slot of the task or takes a free one. Runtime of the task before it was tracked
+ * is counted from zero, as the task was created during the last period (the very first
+ * sample has no period, so its counters are taken as they are).
+ * @return slot or NULL if all are taken
+ */
+static tracked_task *track(TaskHandle_t handle, uint32_t run_time){
+  tracked_task *free_slot = NULL;
+  for(int i = 0; i < STATS_MAX_TASKS; i++){
+    if(s_tracked[i].handle == handle){
+      //handle of deleted task reused by new one, counter started again
+      if(run_time < s_tracked[i].run[s_head]){
+        memset(s_tracked[i].run, 0, sizeof(s_tracked[i].run));
+      }
+      return &s_tracked[i];
+    }
+    if(s_tracked[i].handle == NULL && free_slot == NULL){
+      free_slot = &s_tracked[i];
+    }
+  }
+  if(free_slot != NULL){
+    free_slot->handle = handle;
+    for(int i = 0; i < STATS_RING; i++){
+      free_slot->run[i] = s_filled ? 0 : run_time;
+    }
+  }
+  return free_slot;
+}
+
+/**
+ * @brief Samples run time counters of all tasks and publishes stats over the window.
+ *
+ * Each call costs one uxTaskGetSystemState() and a pass over preallocated tables,
+ * CPU usage covers the last STATS_WINDOW_SAMPLES periods (fewer just after boot).
+ *
+ * @note When running in dual core mode, each core corresponds to 50% of the run time
+ *       of tasks. Load of a core is the time its idle task did not run.
+ */
+void stats_sample(void){
+  uint32_t total;
+  UBaseType_t tasks_no = uxTaskGetSystemState(s_status, STATS_MAX_TASKS, &total);
+  if(tasks_no == 0){
+    s_overflows++;
+    portENTER_CRITICAL(&s_stats_mux);
+    s_published.overflows = s_overflows;
+    portEXIT_CRITICAL(&s_stats_mux);
+    return;
+  }
+  uint32_t head = s_filled ? (s_head + 1) % STATS_RING : 0;
+  uint32_t filled = s_filled < STATS_RING ? s_filled + 1 : STATS_RING;
+  uint32_t oldest = (head + STATS_RING - (filled - 1)) % STATS_RING;
+  s_total[head] = total;
+  s_ticks[head] = xTaskGetTickCount();
+  uint32_t elapsed = total - s_total[oldest];
+
+  for(int i = 0; i < STATS_MAX_TASKS; i++){
+    s_tracked[i].seen = false;
+  }
+  s_building.tasks_no = 0;
+  for(UBaseType_t i = 0; i < tasks_no; i++){
+    tracked_task *task = track(s_status[i].xHandle, s_status[i].ulRunTimeCounter);
+    if(task == NULL){
+      continue;
+    }
+    task->seen = true;
+    task->run[head] = s_status[i].ulRunTimeCounter;
+    uint32_t busy = task->run[head] - task->run[oldest];
+
+    task_stats *out = &s_building.tasks[s_building.tasks_no++];
+    strlcpy(out->name, s_status[i].pcTaskName, sizeof(out->name));
+    out->cpu_permille = elapsed ? (uint16_t)((uint64_t)busy * 1000 / ((uint64_t)elapsed * portNUM_PROCESSORS)) : 0;
+    out->stack_free = s_status[i].usStackHighWaterMark;
+    out->priority = s_status[i].uxCurrentPriority;
+    for(int core = 0; core < portNUM_PROCESSORS; core++){
+      if(s_status[i].xHandle == xTaskGetIdleTaskHandleForCPU(core)){
+        uint32_t idle = busy < elapsed ? busy : elapsed;
+        s_building.core_load_permille[core] = elapsed ? (uint16_t)(1000 - (uint64_t)idle * 1000 / elapsed) : 0;
+      }
+    }
+  }
+  //tasks deleted since previous sample free their slots
+  for(int i = 0; i < STATS_MAX_TASKS; i++){
+    if(!s_tracked[i].seen){
+      s_tracked[i].handle = NULL;
+    }
+  }
+  s_head = head;
+  s_filled = filled;
+  s_building.window_ms = (s_ticks[head] - s_ticks[oldest]) * portTICK_PERIOD_MS;
+  s_building.overflows = s_overflows;
+
+  portENTER_CRITICAL(&s_stats_mux);
+  memcpy(&s_published, &s_building, sizeof(s_published));
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void get_system_stats(system_stats *stats){
+  portENTER_CRITICAL(&s_stats_mux);
+  memcpy(stats, &s_published, sizeof(*stats));
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+uint16_t get_core_load(BaseType_t core){
+  uint16_t load;
+  portENTER_CRITICAL(&s_stats_mux);
+  load = s_published.core_load_permille[core];
+  portEXIT_CRITICAL(&s_stats_mux);
+  return load;
+}
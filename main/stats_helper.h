@@ -0,0 +1,53 @@
+/*
+ * stats_helper.h
+ *
+ *  Created on: 19 paź 2026
+ *      Author: Karol Nowicki
+ *
+ *  Real time stats of tasks: CPU usage over a rolling window of samples, load of cores
+ *  and stack high water marks. Stats task samples, readers (HTTP, display, UART report)
+ *  copy the last published snapshot. No heap is used and nothing is printed.
+ */
+
+#ifndef MAIN_STATS_HELPER_H_
+#define MAIN_STATS_HELPER_H_
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "setup.h"
+
+struct task_stats{
+  char name[configMAX_TASK_NAME_LEN];
+  uint16_t cpu_permille;      //share of all cores over the window
+  uint32_t stack_free;        //stack high water mark
+  UBaseType_t priority;
+};
+
+struct system_stats{
+  uint32_t window_ms;         //time covered by CPU usage, 0 until second sample
+  uint16_t core_load_permille[portNUM_PROCESSORS];
+  uint32_t overflows;         //samples skipped because of more than STATS_MAX_TASKS tasks
+  UBaseType_t tasks_no;
+  task_stats tasks[STATS_MAX_TASKS];
+};
+
+/**
+ * Takes a sample of task run times and publishes new snapshot.
+ * Called by stats task every STATS_SAMPLE_TICKS only.
+ */
+void stats_sample(void);
+
+/**
+ * Copies last published snapshot
+ * @param stats output
+ */
+void get_system_stats(system_stats *stats);
+
+/**
+ * @param core Core number
+ * @return Load of the core over the window in permille
+ */
+uint16_t get_core_load(BaseType_t core);
+
+#endif /* MAIN_STATS_HELPER_H_ */
@@ -18,6 +18,8 @@ extern TaskHandle_t g_vDHT11TaskHandle;
 extern TaskHandle_t g_vSensorsTaskHandle;
 extern TaskHandle_t g_vDisplayTaskHandle;
 extern TaskHandle_t g_vCameraTaskHandle;
+extern TaskHandle_t g_vCamWriterTaskHandle;
+extern TaskHandle_t g_vThumbTaskHandle;
 extern TaskHandle_t g_vSDCSVLGTaskHandle;
 extern TaskHandle_t g_vSDAVGLGTaskHandle;
 extern TaskHandle_t g_vSDJSLGTaskHandle;
@@ -33,6 +35,8 @@ void vSDJSLGTask(void*);
 void vSDCSVLGTask(void*);
 void vSDAVGLGTask(void*);
 void vCameraTask(void*);
+void vCamWriterTask(void*);
+void vThumbTask(void*);
 
 
 
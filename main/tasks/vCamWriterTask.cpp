@@ -0,0 +1,89 @@
+/* KK Weather Station
+ * Camera Writer Task
+ *
+ * Platform: ESP32 (Tested on ESP32-CAM Development Board)
+ * See project documentation for more detailed description.
+ *
+ *  Copyright (c) <2022> <Karol Nowicki>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+*/
+
+//System
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "camera_helper.h"
+
+//App headers
+#include "tasks.h"
+#include "kk_http_app/src/kk_http_stream.h"
+
+static const char *TAG = "CAMWR";
+
+/*******************************************************************************/
+
+
+/**
+ * @brief Task responsible for storing pictures taken by vCameraTask on SD Card
+ * @details
+ *        Second stage of the camera pipeline. vCameraTask copies every frame
+ *        into a PSRAM slot and returns the driver frame buffer at once, so slow
+ *        card writes do not hold DMA buffers nor delay the capture loop.
+ *        This task waits for queued pictures, writes them and releases the slots.
+ *        Capture-to-disk latency and queue occupancy are logged for every picture.
+ *        Archived pictures are passed further to vThumbTask (or appended to
+ *        day pack with CONFIG_KK_PICTURE_PACK).
+ *
+ * @param arg
+ */
+void vCamWriterTask(void*){
+  cam_write_job job;
+  esp_err_t res;
+
+  while (1) {
+    res = camera_write_next(&job, portMAX_DELAY);
+    if(res == ESP_ERR_TIMEOUT){
+      continue;
+    }
+    cam_pipeline_stats stats = get_cam_pipeline_stats();
+    xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+    if(res != ESP_OK){
+      ESP_LOGE(TAG, "Can not store picture %s!", job.path);
+    }else{
+      ESP_LOGI(TAG, "Picture %s stored (%d B) in %u ms, queue: %u/%d",
+               job.path, job.len, stats.last_latency_ms, camera_pending_writes(), CAM_POOL_SLOTS);
+    }
+    xSemaphoreGive(g_uart_mutex);     //give back UART port
+    if(res != ESP_OK){
+      ensure_card_works();
+    }else if(!job.archive){
+      stream_publish_picture(time(NULL));   //live view reloads current.jpg
+    }else{
+#ifndef CONFIG_KK_PICTURE_PACK   //packed pictures are listed from pack index, without thumbnails
+      queue_thumbnail(job.path);
+#endif
+    }
+  }
+}
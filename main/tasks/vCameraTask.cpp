@@ -43,15 +43,26 @@
 #include <protocol_common.h>
 #include <k_math.h>
 #include "camera_helper.h"
+#include "kk_imgproc.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "ff.h"
 
 //App headers
 #include "tasks.h"
 
 #define PICTURE_INTERVAL_S (PICTURE_INTERVAL_M * 60)
+#define PICTURE_MIN_INTERVAL_S (PICTURE_MIN_INTERVAL_M * 60)
+#define PICTURE_MAX_INTERVAL_S (PICTURE_MAX_INTERVAL_M * 60)
 
-static bool is_time_to_get_picture(void);
+static bool is_time_to_get_picture(time_t interval_time);
+static time_t get_picture_interval(const uint8_t *preview, const uint8_t *archived, size_t pixels);
+static esp_err_t settle_exposure(cam_write_job *job, float lux, uint8_t *preview);
+static esp_err_t grab_archival_frame(cam_write_job *job, float lux, time_t interval, uint8_t *preview);
 char *get_next_file_full_path(char *path);
+#ifdef CONFIG_KK_PICTURE_PACK
+static char *get_today_pack_path(void);
+#endif
 static void ensure_todays_path_exist(char *path);
 static const char *TAG = "CAMERA";
 
@@ -65,9 +76,25 @@ static const char *TAG = "CAMERA";
  */
 void vCameraTask(void*){
   TickType_t xLastWakeTime;
-  size_t pictureSize;
   char *filename = NULL;
   char pic_filename[FILEPATH_LEN_MAX];
+  bool archive;
+  cam_write_job job;
+  uint16_t width, height;
+  size_t preview_pixels = 0;    //size of grayscale preview of current frame (0 if not available)
+  size_t archived_pixels = 0;   //size of grayscale preview of last stored picture (0 if none yet)
+
+  //downscaled grayscale pictures for change detection
+  uint8_t *preview = (uint8_t *)heap_caps_malloc(CHANGE_BUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  uint8_t *archived = (uint8_t *)heap_caps_malloc(CHANGE_BUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if(preview == NULL || archived == NULL){
+    ESP_LOGE(TAG, "Can not allocate preview buffers! Pictures will be taken every %d min.", PICTURE_INTERVAL_M);
+  }
+
+  //pictures are taken small, only archived ones at FRAMESIZE
+  if(esp_camera_set_framesize(CAM_PREVIEW_FRAMESIZE) != ESP_OK){
+    ESP_LOGW(TAG, "Can not set preview frame size, all pictures will be taken at %s", FRAMESIZE_STRING);
+  }
 
   //Wait until RTC sends notify that is synchronized with external RTC
   ulTaskNotifyTakeIndexed( CAMERA_TASK_NOTIFY_ARRAY_INDEX, pdTRUE, portMAX_DELAY );
@@ -78,17 +105,40 @@ void vCameraTask(void*){
   while (1) {
     /**
      * The task sequence is:
+     *   - take picture (CAM_PREVIEW_FRAMESIZE) into PSRAM slot and make its small grayscale preview
      *   - set filename to current.jpg
-     *   - if it is time to permanently save picture - determine the filename and change pic_filename
-     *   - take picture and save as pic_filename
+     *   - compare preview with the last stored picture to get interval between stored pictures
+     *   - if it is time to permanently save picture - determine the filename and change pic_filename,
+     *     switch camera to FRAMESIZE, seed exposure from lux reading and grab frames until exposure settles
+     *   - queue picture to be saved as pic_filename
      *   - the loop ends
      */
 
+    xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+    ESP_LOGI(TAG, "Taking picture!");
+    xSemaphoreGive(g_uart_mutex);     //give back UART port
+    if(camera_grab(&job) != ESP_OK){
+      xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+      ESP_LOGE(TAG, "Can not take picture!");
+      xSemaphoreGive(g_uart_mutex);     //give back UART port
+      xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(5000) );
+      continue;
+    }
+    preview_pixels = 0;
+    if(preview != NULL && archived != NULL && jpg2gray(job.buf, job.len, CHANGE_SCALE, preview, CHANGE_BUF_SIZE, &width, &height)){
+      preview_pixels = (size_t)width * height;
+    }
+
     //set filename to current.jpg
     sprintf(pic_filename, "%s/%s", CAM_FILE_PATH, "/0/current.jpg" );
+    archive = false;
 
     //if it is time to permanently save picture - determine the filename
-    if(is_time_to_get_picture() == true){
+    time_t interval = PICTURE_INTERVAL_S;
+    if(preview_pixels != 0 && preview_pixels == archived_pixels){
+      interval = get_picture_interval(preview, archived, preview_pixels);
+    }
+    if(is_time_to_get_picture(interval) == true){
       //Do not save pictures if it is completely dark
       measurement measurements;
       measurements = get_latest_measurements();
@@ -100,10 +150,28 @@ void vCameraTask(void*){
         xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
         ESP_LOGI(TAG, "Time to take picture!!");
         xSemaphoreGive(g_uart_mutex);     //give back UART port
+#ifdef CONFIG_KK_PICTURE_PACK
+        filename = get_today_pack_path();  //all pictures of the day go to one pack file
+#else
         filename = get_next_file_full_path((char *)CAM_FILE_PATH);  //warning- this allocates memory that needs to be freed
+#endif
         if(filename != NULL){
           strcpy(pic_filename, filename );
           free(filename);
+          archive = true;
+          //this preview becomes the reference for change detection
+          if(preview_pixels != 0){
+            memcpy(archived, preview, preview_pixels);
+          }
+          archived_pixels = preview_pixels;
+          //replace preview frame with a full size, well exposed one
+          if(grab_archival_frame(&job, measurements.lux, interval, preview != NULL && archived != NULL ? preview : NULL) != ESP_OK){
+            xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+            ESP_LOGE(TAG, "Can not take picture!");
+            xSemaphoreGive(g_uart_mutex);     //give back UART port
+            xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(5000) );
+            continue;
+          }
           xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
           ESP_LOGI(TAG, "Successfully created Filename: %s", pic_filename);
           xSemaphoreGive(g_uart_mutex);     //give back UART port
@@ -115,19 +183,13 @@ void vCameraTask(void*){
       }
     }
 
+    //picture is only queued here, vCamWriterTask stores it on SD Card
+    camera_queue_write(&job, pic_filename, archive);
     xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
-    ESP_LOGI(TAG, "Taking picture!");
+    ESP_LOGI(TAG, "Picture queued for SD Card (%d waiting)", camera_pending_writes());
     xSemaphoreGive(g_uart_mutex);     //give back UART port
-    if(camera_capture(pic_filename, &pictureSize) != ESP_OK){
-      xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
-      ESP_LOGE(TAG, "Can not take picture!");
-      xSemaphoreGive(g_uart_mutex);     //give back UART port
-    }else{
-      xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
-      ESP_LOGI(TAG, "Picture stored on SD Card!");
-      xSemaphoreGive(g_uart_mutex);     //give back UART port
-    }
-    // Wait for the next cycle exactly 1 second.
+
+    // Wait for the next cycle exactly 5 seconds.
     xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(5000) );
   }
 }
@@ -166,15 +228,34 @@ char *get_next_file_full_path(char *path) {
   return next_file;
 }
 
+#ifdef CONFIG_KK_PICTURE_PACK
+/**
+ * @return path of today's pack i.e. <CAM_FILE_PATH>/2023/02/28/20230228.pak
+ *         (file itself is created by the first append), NULL on error.
+ *         Allocated like get_next_file_full_path() result - must be freed.
+ */
+static char *get_today_pack_path(void){
+  char today_path[FILENAME_LEN];
+  char pak_path[FILEPATH_LEN_MAX];
+
+  ensure_todays_path_exist((char *)CAM_FILE_PATH);
+  get_today_path(today_path);
+  if(!pack_day_path(CAM_FILE_PATH, today_path, pak_path, sizeof(pak_path))){
+    return NULL;
+  }
+  return strdup(pak_path);
+}
+#endif
+
 /**
- * @return true if PICTURE_INTERVAL_S has passed since last true returned
+ * @param interval_time seconds required between stored pictures
+ * @return true if interval_time has passed since last true returned
  *         false otherwise
  */
-static bool is_time_to_get_picture(void) {
+static bool is_time_to_get_picture(time_t interval_time) {
     static time_t last_time = 0;
 
     time_t current_time = time(NULL);
-    time_t interval_time = PICTURE_INTERVAL_S;
 
     if (current_time - last_time >= interval_time) {
         last_time = current_time;
@@ -184,6 +265,117 @@ static bool is_time_to_get_picture(void) {
     }
 }
 
+/**
+ * @brief Measures how much the scene changed since the last stored picture
+ *        and calculates interval between stored pictures accordingly:
+ *        static scene - PICTURE_MAX_INTERVAL_S, fast changes - PICTURE_MIN_INTERVAL_S
+ *
+ * @param preview grayscale preview of current frame
+ * @param archived grayscale preview of the last stored picture
+ * @param pixels size of both previews
+ * @return interval in seconds
+ */
+static time_t get_picture_interval(const uint8_t *preview, const uint8_t *archived, size_t pixels){
+  uint32_t mad = gray_mad_q8(preview, archived, pixels);
+  uint32_t interval = change_to_interval(mad, CHANGE_Q8(CHANGE_LOW), CHANGE_Q8(CHANGE_HIGH),
+                                         PICTURE_MIN_INTERVAL_S, PICTURE_MAX_INTERVAL_S);
+  xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+  ESP_LOGI(TAG, "Scene change: %.2f, picture interval: %u s", mad / 256.0f, interval);
+  xSemaphoreGive(g_uart_mutex);     //give back UART port
+  return (time_t)interval;
+}
+
+/**
+ * @param preview grayscale picture
+ * @param pixels size of the picture
+ * @return mean gray level
+ */
+static uint32_t mean_luma(const uint8_t *preview, size_t pixels){
+  uint32_t sum = 0;
+  for(size_t i = 0; i < pixels; i++){
+    sum += preview[i];
+  }
+  return pixels ? sum / pixels : 0;
+}
+
+/**
+ * @brief Prepares archival frame: applies exposure preset of the lux band
+ *        and grabs frames until mean luma of their preview is in
+ *        CAM_GOOD_LUMA_MIN..CAM_GOOD_LUMA_MAX and stable within CAM_SETTLE_LUMA_DELTA,
+ *        but not more than CAM_SETTLE_FRAMES_MAX frames.
+ *        Frames and time needed go to pipeline statistics.
+ *
+ * @param job filled with the settled frame
+ * @param lux current BH1750 reading
+ * @param preview buffer of CHANGE_BUF_SIZE for grayscale previews,
+ *        NULL to take the first frame after preset
+ * @return ESP_OK if job holds a new frame, error of camera_grab() otherwise (job is not held)
+ */
+static esp_err_t settle_exposure(cam_write_job *job, float lux, uint8_t *preview){
+  int64_t start_us = esp_timer_get_time();
+  int band = camera_set_exposure_for_lux(lux);
+
+  uint32_t frames = 0;
+  int32_t last_luma = -1;
+  int32_t luma = -1;
+  uint16_t width, height;
+  while(1){
+    esp_err_t res = camera_grab(job);
+    if(frames == 0 && band >= 0){
+      camera_resume_auto_exposure();      //first frame is taken with the seed
+    }
+    if(res != ESP_OK){
+      return res;
+    }
+    frames++;
+    luma = -1;
+    if(preview != NULL && jpg2gray(job->buf, job->len, CHANGE_SCALE, preview, CHANGE_BUF_SIZE, &width, &height)){
+      luma = (int32_t)mean_luma(preview, (size_t)width * height);
+    }
+    bool good = luma >= CAM_GOOD_LUMA_MIN && luma <= CAM_GOOD_LUMA_MAX
+                && last_luma >= 0 && abs(luma - last_luma) < CAM_SETTLE_LUMA_DELTA;
+    if(good || preview == NULL || frames >= CAM_SETTLE_FRAMES_MAX){
+      break;
+    }
+    last_luma = luma;
+    camera_release(job);
+  }
+  uint32_t ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+  camera_record_settle(frames, ms);
+  xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+  ESP_LOGI(TAG, "Exposure preset %d: luma %d after %u frames, %u ms", band, (int)luma, frames, ms);
+  xSemaphoreGive(g_uart_mutex);     //give back UART port
+  return ESP_OK;
+}
+
+/**
+ * @brief Replaces preview frame with archival one: camera is switched to FRAMESIZE
+ *        for settle_exposure() and back to CAM_PREVIEW_FRAMESIZE afterwards.
+ *        JPEG quality is chosen by rate control before the first frame.
+ *        Frame buffers are not reallocated, stale preview frames are dropped by the driver.
+ *
+ * @param job preview frame, released here and replaced with the archival one
+ * @param lux current BH1750 reading
+ * @param interval current interval between archived pictures in seconds
+ * @param preview buffer for grayscale previews (see settle_exposure())
+ * @return ESP_OK if job holds a new frame, error of camera_grab() otherwise (job is not held)
+ */
+static esp_err_t grab_archival_frame(cam_write_job *job, float lux, time_t interval, uint8_t *preview){
+  camera_release(job);
+  esp_err_t size_res = esp_camera_set_framesize(FRAMESIZE);
+  camera_apply_rate_control(interval);
+  esp_err_t res = settle_exposure(job, lux, preview);
+  if(size_res == ESP_OK){
+    size_res = esp_camera_set_framesize(CAM_PREVIEW_FRAMESIZE);
+  }
+  if(size_res != ESP_OK){
+    xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+    ESP_LOGW(TAG, "Can not switch frame size: %s", esp_err_to_name(size_res));
+    xSemaphoreGive(g_uart_mutex);     //give back UART port
+  }
+  return res;
+}
+
 /**
  * @param path Path to root dcim directory for pictures
  * Function create directories needed to store pictures for current date
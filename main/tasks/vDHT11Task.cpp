@@ -43,6 +43,7 @@
 
 //App headers
 #include "tasks.h"
+#include "metrics_helper.h"
 
 
 
@@ -72,7 +73,9 @@ void vDHT11Task(void*){
 
     #ifdef EXTERNAL_SENSOR_DHT11
     dht11_reading dht_read;
+    int64_t start_us = esp_timer_get_time();
     dht_read = DHT11_read();
+    metrics_sensor_read(METRIC_SENSOR_DHT11, start_us, dht_read.status == DHT11_OK);
     //update status of last read
     tmp_measurements.dht_status = dht_read.status;
     //store DHT11 values only if status OK and temperature or humidity != 0
@@ -83,7 +86,9 @@ void vDHT11Task(void*){
     }
     #endif
     //read also wind speed
+    int64_t wind_start_us = esp_timer_get_time();
     wind = g_windMeter.readWind();
+    metrics_sensor_read(METRIC_SENSOR_ANEMO, wind_start_us, wind >= 0);
     tmp_measurements.wind = (wind < 0) ? 0.0 : wind;  //do not pass error as reading
     //store measurements in curr_measures
     xSemaphoreTake(g_current_measuers_mutex, portMAX_DELAY);
@@ -45,6 +45,7 @@
 
 //App headers
 #include "tasks.h"
+#include "stats_helper.h"
 
 
 
@@ -92,7 +93,8 @@ void vDisplayTask(void *arg){
     g_display.printf("Pressure: %4.2f hPa\n", tmp_measurements.pres);
     g_display.printf("Sun: %5.2F Lux\n", tmp_measurements.lux);
 //    g_display.printf("Altitude: %5.2Fm\n", tmp_measurements.alti);
-    g_display.printf("IP: " IPSTR, IP2STR(&ip.ip));
+    g_display.printf("IP: " IPSTR "\n", IP2STR(&ip.ip));
+    g_display.printf("CPU: %u%% %u%%", get_core_load(0) / 10, get_core_load(portNUM_PROCESSORS - 1) / 10);
     g_display.display();
   }
 }
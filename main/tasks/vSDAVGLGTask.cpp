@@ -53,6 +53,7 @@
 
 //App headers
 #include "tasks.h"
+#include "metrics_helper.h"
 
 static void replace_or_continue_current_avglg_file(void);
 static void rename_avglg_file(tm *);
@@ -148,6 +149,8 @@ void vSDAVGLGTask(void*){
       /**
        * Store new line in CURR_AVGLG_FNAME
        */
+      int64_t start_us = esp_timer_get_time();
+      log_append_begin();
       f = fopen(CURR_AVGLG_FNAME, "a+");
       if (f == NULL) {  //if can not open file
         fclose(f);
@@ -164,6 +167,7 @@ void vSDAVGLGTask(void*){
                       measurements.pres,
                       measurements.wind);
         fclose(f);
+        metric_observe_us(&g_sd_op_latency[METRIC_SD_LOG_APPEND], metrics_elapsed_us(start_us));
         // reset helper variables
         m_cnt = 0; avg_time = 0;
         measurements.eTemp = 0;
@@ -174,9 +178,12 @@ void vSDAVGLGTask(void*){
         measurements.wind = 0;
         measurements.time = 0;
       }
+      log_append_end();
     }
     // Wait for the next cycle exactly 1 second- it is critical to .
-    xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(LOGGING_INTERVAL_MS) );
+    if( xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(LOGGING_INTERVAL_MS) ) == pdFALSE ){
+      metric_inc(&g_logger_deadline_misses[METRIC_LOGGER_AVG]);   //period overrun, next entry is late
+    }
   }
 }
 
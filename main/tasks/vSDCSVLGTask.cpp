@@ -53,6 +53,9 @@
 
 //App headers
 #include "tasks.h"
+#include "metrics_helper.h"
+#include "kk_http_app/src/kk_http_stream.h"
+#include "kk_http_app/src/kk_http_app.h"
 
 static void replace_or_continue_current_csvlg_file(void);
 static void rename_csvlg_file(tm *);
@@ -115,14 +118,18 @@ void vSDCSVLGTask(void*){
      * Store new data entry to log file
      * Done once per period specified by LOGGING_INTERVAL
      */
+    now = time(NULL);
+    measurements = get_latest_measurements();
+    stream_publish_measurements(now, &measurements);  //live view gets the sample even if card fails
+    publish_current_measurements(now, &measurements);
+    int64_t start_us = esp_timer_get_time();
+    log_append_begin();
     f = fopen(CURR_CSVLG_FNAME, "a+");
     if (f == NULL) {  //if can not open file
       ESP_LOGE(TAG, "Failed to open log file!");
       ensure_card_works();
     }else{
       //Prepare and store log entry
-      now = time(NULL);
-      measurements = get_latest_measurements();
       fprintf(f, "%lld,%3.2F,%3.2F,%d,%5.2F,%4.2f,%3.3f\n",
                     static_cast<long long>(now),
                     measurements.iTemp,
@@ -132,10 +139,14 @@ void vSDCSVLGTask(void*){
                     measurements.pres,
                     measurements.wind);
       fclose(f);
+      metric_observe_us(&g_sd_op_latency[METRIC_SD_LOG_APPEND], metrics_elapsed_us(start_us));
     }
+    log_append_end();
 
     // Wait for the next cycle exactly 1 second- it is critical to .
-    xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(LOGGING_INTERVAL_MS) );
+    if( xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(LOGGING_INTERVAL_MS) ) == pdFALSE ){
+      metric_inc(&g_logger_deadline_misses[METRIC_LOGGER_CSV]);   //period overrun, next entry is late
+    }
   }
 }
 
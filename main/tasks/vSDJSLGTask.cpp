@@ -53,6 +53,7 @@
 
 //App headers
 #include "tasks.h"
+#include "metrics_helper.h"
 
 static void replace_or_continue_current_jslg_file(void);
 static void rename_jslg_file(tm *);
@@ -115,6 +116,8 @@ void vSDJSLGTask(void*){
      * Store new data entry to log file
      * Done once per period specified by LOGGING_INTERVAL
      */
+    int64_t start_us = esp_timer_get_time();
+    log_append_begin();
     f = fopen(CURR_JSLG_FNAME, "a+");
     if (f == NULL) {  //if can not open file
       ESP_LOGE(TAG, "Failed to open log file!");
@@ -132,10 +135,14 @@ void vSDJSLGTask(void*){
                     measurements.pres,
                     measurements.wind);
       fclose(f);
+      metric_observe_us(&g_sd_op_latency[METRIC_SD_LOG_APPEND], metrics_elapsed_us(start_us));
     }
+    log_append_end();
 
     // Wait for the next cycle exactly 1 second- it is critical to .
-    xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(LOGGING_INTERVAL_MS) );
+    if( xTaskDelayUntil( &xLastWakeTime, pdMS_TO_TICKS(LOGGING_INTERVAL_MS) ) == pdFALSE ){
+      metric_inc(&g_logger_deadline_misses[METRIC_LOGGER_JSON]);   //period overrun, next entry is late
+    }
   }
 }
 
@@ -45,6 +45,7 @@
 
 //App headers
 #include "tasks.h"
+#include "metrics_helper.h"
 
 
 
@@ -62,13 +63,19 @@ void vSensorsTask(void*){
     float itemp, etemp, humi, lux, pres, alti;
 
     // Read all fast sensors
+    int64_t start_us = esp_timer_get_time();
     lux = g_lightMeter.readLightLevel();
+    metrics_sensor_read(METRIC_SENSOR_BH1750, start_us, lux >= 0);
+    start_us = esp_timer_get_time();
     itemp = g_pressureMeter.readTemperature();
     pres = g_pressureMeter.readPressure();
     alti = g_pressureMeter.readAltitude(1013.25);
+    metrics_sensor_read(METRIC_SENSOR_BMP280, start_us, !isnan(itemp) && !isnan(pres));
     #ifdef EXTERNAL_SENSOR_HTU21
+    start_us = esp_timer_get_time();
     etemp = g_htu21.readTemperature();
     humi = g_htu21.readHumidity();
+    metrics_sensor_read(METRIC_SENSOR_HTU21, start_us, !isnan(etemp) && !isnan(humi));
     #endif
 
     tmp_measurements.eTemp = isnan(etemp) ? 0.0 : etemp;
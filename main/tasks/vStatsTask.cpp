@@ -46,31 +46,58 @@
 
 //App headers
 #include "tasks.h"
-
-static esp_err_t print_real_time_stats(TickType_t);
+#include "camera_helper.h"
+#include "stats_helper.h"
+#include "kk_http_app/src/kk_http_server_setup.h"
+#include "kk_http_app/src/kk_http_app.h"
 
 /**
- * @brief Task responsible for communicating at UART Debug port:
+ * @brief Task sampling real time stats of tasks (see stats_helper.h) every STATS_SAMPLE_TICKS
+ *        and communicating at UART Debug port every STATS_TICKS:
  *      - System Real Time Statistics
  *      - Current Measurements
  *      - Current system Time [not yet implemented]
  *      - Current system state  [not yet implemented]
- *      - Web Server requests?  [not yet implemented]
+ *      - Web Server connections and requests
  *
  * @param arg
  */
 void vStatsTask(void *arg){
   measurement tmp_measurements;
-  int stats_error;
-  //Print real time stats and measurements periodically
+  cam_pipeline_stats cam_stats;
+  cam_rate_stats rate_stats;
+  http_conn_stats conn_stats;
+  file_cache_stats_t www_stats;
+  static system_stats sys_stats;   //too big for the stack
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  uint32_t samples = 0;
+  //Sample real time stats, print them and measurements periodically
   while (1) {
-    stats_error = print_real_time_stats(STATS_TICKS); //this takes STATS_TICKS ms when it is counting
+    xTaskDelayUntil(&xLastWakeTime, STATS_SAMPLE_TICKS);
+    stats_sample();
+    if(++samples % (STATS_TICKS / STATS_SAMPLE_TICKS)){
+      continue;
+    }
+    get_system_stats(&sys_stats);
     tmp_measurements = get_latest_measurements();
+    cam_stats = get_cam_pipeline_stats();
+    rate_stats = get_cam_rate_stats();
+    conn_stats = get_http_conn_stats();
+    www_stats = get_www_cache_stats();
     xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
-    if (stats_error == ESP_OK) {
-      printf("Real time stats obtained\n");
-    } else {
-      printf("Error getting real time stats\n");
+    printf("Real time stats over %u ms\n", sys_stats.window_ms);
+    printf("-----------------------------------------\n");
+    printf("| Task | Percentage | Stack free\n");
+    for (UBaseType_t i = 0; i < sys_stats.tasks_no; i++) {
+      printf("| %s | %u.%u%% | %u\n", sys_stats.tasks[i].name, sys_stats.tasks[i].cpu_permille / 10,
+             sys_stats.tasks[i].cpu_permille % 10, sys_stats.tasks[i].stack_free);
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+      printf("Core %d load: %u.%u%%\n", core, sys_stats.core_load_permille[core] / 10,
+             sys_stats.core_load_permille[core] % 10);
+    }
+    if (sys_stats.overflows) {
+      printf("Skipped samples: %u, increase STATS_MAX_TASKS\n", sys_stats.overflows);
     }
     printf("-----------------------------------------\n");
     printf("Current measurements:\n");
@@ -82,127 +109,29 @@ void vStatsTask(void *arg){
     printf("BMP Atm. pressure: %4.2f hPa\n", tmp_measurements.pres);
     printf("BMP Altitude:      %5.2F m\n", tmp_measurements.alti);
     printf("Wind Speed:        %2.3F m/s\n", tmp_measurements.wind);
+    printf("-----------------------------------------\n");
+    printf("Camera pipeline:\n");
+    printf("Stored/failed/dropped: %u/%u/%u\n", cam_stats.written, cam_stats.failed, cam_stats.dropped);
+    printf("Capture-to-disk:   last %u ms, avg %u ms, max %u ms\n", cam_stats.last_latency_ms,
+           cam_stats.written ? (unsigned)(cam_stats.total_latency_ms / cam_stats.written) : 0, cam_stats.max_latency_ms);
+    printf("Write queue:       %u now, %u peak (of %d)\n", camera_pending_writes(), cam_stats.queue_peak, CAM_POOL_SLOTS);
+    printf("Exposure settle:   last %u frames/%u ms, max %u ms\n", cam_stats.settle_frames_last,
+           cam_stats.settle_ms_last, cam_stats.settle_ms_max);
+    printf("Day budget:        %u/%u kB, %u pictures, target %u kB, avg %u kB, quality %d\n",
+           rate_stats.day_bytes / 1024, JPEG_DAY_BUDGET_MB * 1024, rate_stats.day_pictures,
+           rate_stats.target_bytes / 1024, rate_stats.frame_bytes_avg / 1024, rate_stats.quality);
+    printf("SD card free:      %u MB, full in %d days\n", (unsigned)(rate_stats.card_free_bytes / (1024 * 1024)),
+           rate_stats.days_until_full);
+    printf("-----------------------------------------\n");
+    printf("HTTP connections:  %u (%u closed), %u requests, %u.%u per connection\n", conn_stats.connections,
+           conn_stats.closed, conn_stats.requests,
+           conn_stats.connections ? conn_stats.requests / conn_stats.connections : 0,
+           conn_stats.connections ? (conn_stats.requests * 10 / conn_stats.connections) % 10 : 0);
+    printf("WWW cache:         %u files, %u/%u kB, hit rate %u%% (%u/%u), %u kB saved\n", www_stats.entries,
+           (unsigned)(www_stats.used / 1024), (unsigned)(www_stats.capacity / 1024),
+           (www_stats.hits + www_stats.misses) ? (unsigned)(100ULL * www_stats.hits / (www_stats.hits + www_stats.misses)) : 0,
+           www_stats.hits, www_stats.hits + www_stats.misses, (unsigned)(www_stats.bytes_saved / 1024));
     printf("=========================================\n\n");
     xSemaphoreGive(g_uart_mutex);     //give back UART port
   }
 }
-
-
-/*******************************************************************************
- *  Application helper functions
- *
- */
-
-
-/**
- * @brief   Function to print the CPU usage of tasks over a given duration.
- *
- * This function will measure and print the CPU usage of tasks over a specified
- * number of ticks (i.e. real time stats). This is implemented by simply calling
- * uxTaskGetSystemState() twice separated by a delay, then calculating the
- * differences of task run times before and after the delay.
- *
- * @note    If any tasks are added or removed during the delay, the stats of
- *          those tasks will not be printed.
- * @note    This function should be called from a high priority task to minimize
- *          inaccuracies with delays.
- * @note    When running in dual core mode, each core will correspond to 50% of
- *          the run time.
- *
- * @param   xTicksToWait    Period of stats measurement
- *
- * @return
- *  - ESP_OK                Success
- *  - ESP_ERR_NO_MEM        Insufficient memory to allocated internal arrays
- *  - ESP_ERR_INVALID_SIZE  Insufficient array size for uxTaskGetSystemState. Trying increasing ARRAY_SIZE_OFFSET
- *  - ESP_ERR_INVALID_STATE Delay duration too short
- */
-static esp_err_t print_real_time_stats(TickType_t xTicksToWait){
-  TaskStatus_t *start_array = NULL, *end_array = NULL;
-  UBaseType_t start_array_size, end_array_size;
-  uint32_t start_run_time, end_run_time, total_elapsed_time;
-  esp_err_t ret;
-
-  //Allocate array to store current task states
-  start_array_size = uxTaskGetNumberOfTasks() + ARRAY_SIZE_OFFSET;
-  start_array = (TaskStatus_t*) malloc(sizeof(TaskStatus_t) * start_array_size);
-  if (start_array == NULL) {
-    ret = ESP_ERR_NO_MEM;
-    goto exit;
-  }
-  //Get current task states
-  start_array_size = uxTaskGetSystemState(start_array, start_array_size, &start_run_time);
-  if (start_array_size == 0) {
-    ret = ESP_ERR_INVALID_SIZE;
-    goto exit;
-  }
-
-  vTaskDelay(xTicksToWait);
-
-  //Allocate array to store tasks states post delay
-  end_array_size = uxTaskGetNumberOfTasks() + ARRAY_SIZE_OFFSET;
-  end_array = (TaskStatus_t*) malloc(sizeof(TaskStatus_t) * end_array_size);
-  if (end_array == NULL) {
-    ret = ESP_ERR_NO_MEM;
-    goto exit;
-  }
-  //Get post delay task states
-  end_array_size = uxTaskGetSystemState(end_array, end_array_size, &end_run_time);
-  if (end_array_size == 0) {
-    ret = ESP_ERR_INVALID_SIZE;
-    goto exit;
-  }
-
-  //Calculate total_elapsed_time in units of run time stats clock period.
-  total_elapsed_time = (end_run_time - start_run_time);
-  if (total_elapsed_time == 0) {
-    ret = ESP_ERR_INVALID_STATE;
-    goto exit;
-  }
-  //lock the UART to not interrupt printing
-  xSemaphoreTake(g_uart_mutex, portMAX_DELAY);
-  printf("Real time stats over %d ticks\n", xTicksToWait);
-  printf("-----------------------------------------\n");
-  printf("| Task | Run Time | Percentage\n");
-  xSemaphoreGive(g_uart_mutex);
-  //Match each task in start_array to those in the end_array
-  for (int i = 0; i < start_array_size; i++) {
-    int k = -1;
-    for (int j = 0; j < end_array_size; j++) {
-      if (start_array[i].xHandle == end_array[j].xHandle) {
-        k = j;
-        //Mark that task have been matched by overwriting their handles
-        start_array[i].xHandle = NULL;
-        end_array[j].xHandle = NULL;
-        break;
-      }
-    }
-    //Check if matching task found
-    if (k >= 0) {
-      uint32_t task_elapsed_time = end_array[k].ulRunTimeCounter - start_array[i].ulRunTimeCounter;
-      uint32_t percentage_time = (task_elapsed_time * 100UL) / (total_elapsed_time * portNUM_PROCESSORS);
-      xSemaphoreTake(g_uart_mutex, portMAX_DELAY);
-      printf("| %s | %d | %d%%\n", start_array[i].pcTaskName, task_elapsed_time, percentage_time);
-      xSemaphoreGive(g_uart_mutex);
-    }
-  }
-  xSemaphoreTake(g_uart_mutex, portMAX_DELAY);
-  //Print unmatched tasks
-  for (int i = 0; i < start_array_size; i++) {
-    if (start_array[i].xHandle != NULL) {
-        printf("| %s | Deleted\n", start_array[i].pcTaskName);
-    }
-  }
-  for (int i = 0; i < end_array_size; i++) {
-    if (end_array[i].xHandle != NULL) {
-      printf("| %s | Created\n", end_array[i].pcTaskName);
-    }
-  }
-  xSemaphoreGive(g_uart_mutex);
-  ret = ESP_OK;
-
-exit:    //Common return path
-  free(start_array);
-  free(end_array);
-  return ret;
-}
@@ -0,0 +1,97 @@
+/* KK Weather Station
+ * Thumbnail Task
+ *
+ * Platform: ESP32 (Tested on ESP32-CAM Development Board)
+ * See project documentation for more detailed description.
+ *
+ *  Copyright (c) <2022> <Karol Nowicki>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+*/
+
+//System
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "camera_helper.h"
+#include "kk_imgproc.h"
+
+//App headers
+#include "tasks.h"
+
+static const char *TAG = "THUMB";
+
+/*******************************************************************************/
+
+
+/**
+ * @brief Task responsible for creating thumbnails of archived pictures
+ * @details
+ *        Runs at low priority after vCamWriterTask stored the picture.
+ *        Picture is decoded straight from the SD Card at 1/8 scale (no full size
+ *        bitmap is ever built), encoded again and saved as <day dir>/th/NNN.jpg.
+ *        Gallery on history page links those thumbnails instead of full pictures.
+ *
+ * @param arg
+ */
+void vThumbTask(void*){
+  char pic_filename[FILEPATH_LEN_MAX];
+  char thumb_filename[FILEPATH_LEN_MAX];
+  esp_err_t res;
+
+  while (1) {
+    if(!next_thumbnail_request(pic_filename, portMAX_DELAY)){
+      continue;
+    }
+    if(!get_thumb_path(pic_filename, thumb_filename, sizeof(thumb_filename))){
+      xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+      ESP_LOGE(TAG, "Thumbnail path of %s is too long!", pic_filename);
+      xSemaphoreGive(g_uart_mutex);     //give back UART port
+      continue;
+    }
+    //ensure thumbnails directory exists (result ignored - it usually does)
+    char *dir_end = strrchr(thumb_filename, '/');
+    *dir_end = '\0';
+    mkdir(thumb_filename, 0777);
+    *dir_end = '/';
+
+    int64_t start = esp_timer_get_time();
+    res = make_thumbnail_file(pic_filename, thumb_filename);
+    int64_t took_ms = (esp_timer_get_time() - start) / 1000;
+    if(res == ESP_OK){
+      picture_index_set_thumb(pic_filename);
+    }
+
+    xSemaphoreTake(g_uart_mutex, portMAX_DELAY);      //take UART port
+    if(res != ESP_OK){
+      ESP_LOGE(TAG, "Can not create thumbnail of %s!", pic_filename);
+    }else{
+      ESP_LOGI(TAG, "Thumbnail %s created in %lld ms", thumb_filename, took_ms);
+    }
+    xSemaphoreGive(g_uart_mutex);     //give back UART port
+  }
+}
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+gzip_www.py
+
+Host tool producing pre-compressed variants of ESP32 Weather Logger web UI
+(see file_get_handler in main/kk_http_app/src/kk_http_app.cpp).
+
+For every static text asset (htm, html, js, css, ttf, svg) foo.js a sibling
+foo.js.gz is written. The server sends it with Content-Encoding: gzip to browsers
+accepting gzip, everyone else gets the original. Variants which do not save at
+least 10% are not kept, as SD card read time is the same either way.
+
+Usage:
+  gzip_www.py [www_dir]      default www_dir is data/www of the project
+  gzip_www.py clean [www_dir] remove all .gz variants
+
+Copy whole www directory (with .gz files) to SD card as before. Originals must
+stay on the card: they are served to clients without gzip support and their size
+and mtime are used to notice updated assets.
+"""
+
+import gzip
+import os
+import sys
+
+ASSETS = (".htm", ".html", ".js", ".css", ".ttf", ".svg")
+MIN_SAVING = 0.10
+DEFAULT_WWW = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "data", "www")
+
+
+def assets(www_dir):
+    for root, _, files in os.walk(www_dir):
+        for name in sorted(files):
+            if name.lower().endswith(ASSETS):
+                yield os.path.join(root, name)
+
+
+def compress(www_dir):
+    total = packed = 0
+    for path in assets(www_dir):
+        gz = path + ".gz"
+        if os.path.exists(gz) and os.path.getmtime(gz) >= os.path.getmtime(path):
+            continue    # up to date
+        with open(path, "rb") as f:
+            raw = f.read()
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        if len(data) > len(raw) * (1 - MIN_SAVING):
+            if os.path.exists(gz):
+                os.remove(gz)
+            print("%-48s %8d B  not worth it" % (os.path.relpath(path, www_dir), len(raw)))
+            continue
+        with open(gz, "wb") as f:
+            f.write(data)
+        total += len(raw)
+        packed += len(data)
+        print("%-48s %8d -> %8d B" % (os.path.relpath(path, www_dir), len(raw), len(data)))
+    if total:
+        print("%d B -> %d B (%.0f%%)" % (total, packed, 100.0 * packed / total))
+
+
+def clean(www_dir):
+    for path in assets(www_dir):
+        if os.path.exists(path + ".gz"):
+            os.remove(path + ".gz")
+
+
+def main(argv):
+    if len(argv) > 1 and argv[1] in ("-h", "--help"):
+        sys.exit(__doc__)
+    if len(argv) > 1 and argv[1] == "clean":
+        clean(argv[2] if len(argv) > 2 else DEFAULT_WWW)
+    else:
+        compress(argv[1] if len(argv) > 1 else DEFAULT_WWW)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+"""
+http_bench.py
+
+Host tool measuring page load cost of ESP32 Weather Logger web server:
+connections (TLS handshakes) per page load and time to first byte.
+
+A page load is the page itself, its local scripts, styles and images
+(CDN links are skipped) and /data/current_measurements.json, requested
+one after another the way a single browser connection would.
+
+Modes:
+  close       new connection for every request ("Connection: close")
+  keepalive   one persistent connection per page load
+  resume      persistent connection, TLS session of previous page load
+              is resumed from a ticket (https only)
+  download    sustained throughput of the url itself (large picture,
+              day log), every round on a new connection
+
+Usage:
+  http_bench.py <url> [loads] [mode...]
+
+  http_bench.py https://192.168.1.10/index.htm 10
+  http_bench.py http://weather.local/history.htm 5 close keepalive
+  http_bench.py http://weather.local/logs/2026/10/181026.CSV 3 download
+
+Server certificate is not verified (device uses self-signed one).
+"""
+
+import re
+import socket
+import ssl
+import sys
+import time
+from urllib.parse import urljoin, urlsplit
+
+TIMEOUT = 10
+ASSET_RE = re.compile(r'(?:src|href)\s*=\s*"([^"#?]+)', re.I)
+
+TLS_CONTEXT = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+TLS_CONTEXT.check_hostname = False
+TLS_CONTEXT.verify_mode = ssl.CERT_NONE
+TLS_CONTEXT.maximum_version = ssl.TLSVersion.TLSv1_2   # session resumption of mbedTLS server is TLS 1.2
+
+
+class Connection:
+    """Minimal HTTP/1.1 client connection which counts handshakes."""
+
+    def __init__(self, host, port, tls, session=None):
+        self.sock = socket.create_connection((host, port), TIMEOUT)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.resumed = False
+        if tls:
+            self.sock = TLS_CONTEXT.wrap_socket(self.sock, server_hostname=host, session=session)
+            self.resumed = self.sock.session_reused
+        self.buf = b""
+        self.open = True
+
+    def session(self):
+        return getattr(self.sock, "session", None)
+
+    def close(self):
+        self.open = False
+        self.sock.close()
+
+    def _fill(self):
+        data = self.sock.recv(16384)
+        if not data:
+            raise ConnectionError("connection closed by server")
+        self.buf += data
+
+    def _line(self):
+        while b"\r\n" not in self.buf:
+            self._fill()
+        line, self.buf = self.buf.split(b"\r\n", 1)
+        return line.decode("latin-1")
+
+    def _body(self, length):
+        while len(self.buf) < length:
+            self._fill()
+        self.buf = self.buf[length:]
+
+    def request(self, host, path, keepalive):
+        """Sends GET, returns (status, ttfb in s, body length)."""
+        req = "GET %s HTTP/1.1\r\nHost: %s\r\nAccept-Encoding: gzip\r\nConnection: %s\r\n\r\n" % (
+            path, host, "keep-alive" if keepalive else "close")
+        start = time.perf_counter()
+        self.sock.sendall(req.encode())
+        self._fill()
+        ttfb = time.perf_counter() - start
+        status = int(self._line().split()[1])
+        headers = {}
+        while True:
+            line = self._line()
+            if not line:
+                break
+            name, _, value = line.partition(":")
+            headers[name.strip().lower()] = value.strip()
+        size = 0
+        if headers.get("transfer-encoding", "").lower() == "chunked":
+            while True:
+                chunk = int(self._line().split(";")[0], 16)
+                self._body(chunk + 2)
+                size += chunk
+                if chunk == 0:
+                    break
+        elif "content-length" in headers:
+            size = int(headers["content-length"])
+            self._body(size)
+        else:
+            try:
+                while True:
+                    self._fill()
+            except ConnectionError:
+                size = len(self.buf)
+                self.buf = b""
+            self.close()
+        if headers.get("connection", "").lower() == "close" or not keepalive:
+            self.close()
+        return status, ttfb, size
+
+
+def page_assets(url):
+    """Returns paths of the page and its local assets."""
+    parts = urlsplit(url)
+    conn = Connection(parts.hostname, parts.port or (443 if parts.scheme == "https" else 80),
+                      parts.scheme == "https")
+    req = "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n" % (parts.path or "/", parts.hostname)
+    conn.sock.sendall(req.encode())
+    html = b""
+    try:
+        while True:
+            conn._fill()
+    except (ConnectionError, socket.timeout):
+        html = conn.buf
+    conn.close()
+    paths = [parts.path or "/"]
+    for ref in ASSET_RE.findall(html.decode("utf-8", "replace")):
+        full = urlsplit(urljoin(url, ref))
+        if full.hostname == parts.hostname and full.path not in paths:
+            paths.append(full.path)
+    paths.append("/data/current_measurements.json")
+    return paths
+
+
+def load(url, paths, mode, session):
+    """Loads page once, returns (connections, resumed, ttfbs, session)."""
+    parts = urlsplit(url)
+    tls = parts.scheme == "https"
+    port = parts.port or (443 if tls else 80)
+    keepalive = mode != "close"
+    conns = resumed = 0
+    ttfbs = []
+    conn = None
+    for path in paths:
+        start = time.perf_counter()
+        if conn is None or not conn.open:
+            conn = Connection(parts.hostname, port, tls, session if mode == "resume" else None)
+            conns += 1
+            resumed += conn.resumed
+            if tls and mode == "resume":
+                session = conn.session()
+        connect = time.perf_counter() - start
+        status, ttfb, _ = conn.request(parts.hostname, path, keepalive)
+        if status >= 400:
+            print("  %s: %d" % (path, status))
+        ttfbs.append(connect + ttfb)
+    if conn.open:
+        conn.close()
+    return conns, resumed, ttfbs, session
+
+
+def download(url, rounds):
+    parts = urlsplit(url)
+    tls = parts.scheme == "https"
+    print("%s: %d downloads" % (url, rounds))
+    print("    size    ttfb (ms)    time (ms)    throughput (kB/s)")
+    for _ in range(rounds):
+        conn = Connection(parts.hostname, parts.port or (443 if tls else 80), tls)
+        start = time.perf_counter()
+        status, ttfb, size = conn.request(parts.hostname, parts.path, False)
+        took = time.perf_counter() - start
+        if conn.open:
+            conn.close()
+        if status >= 400:
+            sys.exit("%s: %d" % (parts.path, status))
+        print("%8d %12.1f %12.1f %20.1f" % (size, 1000 * ttfb, 1000 * took, size / 1024 / took))
+
+
+def bench(url, loads, modes):
+    if "download" in modes:
+        download(url, loads)
+        modes = [m for m in modes if m != "download"]
+        if not modes:
+            return
+    paths = page_assets(url)
+    tls = url.startswith("https")
+    print("%s: %d requests per page load, %d loads" % (url, len(paths), loads))
+    print("mode        conn/load  resumed  ttfb avg  ttfb max  load avg (ms)")
+    for mode in modes:
+        if mode == "resume" and not tls:
+            continue
+        conns = resumed = 0
+        ttfbs, times = [], []
+        session = None
+        for _ in range(loads):
+            start = time.perf_counter()
+            c, r, t, session = load(url, paths, mode, session)
+            times.append(time.perf_counter() - start)
+            conns += c
+            resumed += r
+            ttfbs += t
+        print("%-10s %10.1f %8d %9.1f %9.1f %9.1f" % (
+            mode, conns / loads, resumed, 1000 * sum(ttfbs) / len(ttfbs), 1000 * max(ttfbs),
+            1000 * sum(times) / len(times)))
+
+
+def main(argv):
+    if len(argv) < 2 or not argv[1].startswith(("http://", "https://")):
+        sys.exit(__doc__)
+    loads = int(argv[2]) if len(argv) > 2 else 5
+    modes = argv[3:] or ["close", "keepalive", "resume"]
+    if any(m not in ("close", "keepalive", "resume", "download") for m in modes):
+        sys.exit(__doc__)
+    bench(argv[1], loads, modes)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
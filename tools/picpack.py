@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+picpack.py
+
+Host tool for day pack files of ESP32 Weather Logger pictures
+(see components/kk_imgproc/kk_pack.c, enabled with CONFIG_KK_PICTURE_PACK).
+
+  YYYYMMDD.pak  pictures of the day appended one after another
+  YYYYMMDD.idx  16 B record per picture: offset, length, unix time, reserved
+                (uint32, little endian)
+
+Usage:
+  picpack.py pack   <day_dir> [pak]     pack NNN.jpg files of a day directory
+  picpack.py unpack <pak> <out_dir>     restore NNN.jpg files (mtime = capture time)
+  picpack.py list   <pak>               print index
+  picpack.py bench  <day_dir> [rounds]  compare list/serve latency of files and pack
+
+Day directory is dcim/YYYY/MM/DD as stored on SD card; pack goes into the same
+directory by default, so the card can be converted in place.
+"""
+
+import os
+import random
+import struct
+import sys
+import time
+
+ENTRY = struct.Struct("<IIII")
+
+
+def idx_path(pak):
+    return pak[:-len(".pak")] + ".idx"
+
+
+def default_pak(day_dir):
+    parts = os.path.normpath(os.path.abspath(day_dir)).split(os.sep)
+    if len(parts) < 3 or not all(p.isdigit() for p in parts[-3:]):
+        sys.exit("day directory must be .../YYYY/MM/DD, give pack name explicitly")
+    return os.path.join(day_dir, "".join(parts[-3:]) + ".pak")
+
+
+def day_pictures(day_dir):
+    names = [n for n in os.listdir(day_dir) if n.lower().endswith(".jpg")]
+    return sorted(names)
+
+
+def read_index(pak):
+    with open(idx_path(pak), "rb") as f:
+        data = f.read()
+    size = os.path.getsize(pak)
+    entries = []
+    for i in range(len(data) // ENTRY.size):
+        offset, length, ts, _ = ENTRY.unpack_from(data, i * ENTRY.size)
+        if offset + length <= size:
+            entries.append((offset, length, ts))
+    return entries
+
+
+def pack(day_dir, pak=None):
+    pak = pak or default_pak(day_dir)
+    names = day_pictures(day_dir)
+    if os.path.exists(idx_path(pak)):
+        # drop torn record left by power loss, like pack_append() does
+        size = os.path.getsize(idx_path(pak))
+        os.truncate(idx_path(pak), size - size % ENTRY.size)
+    with open(pak, "ab") as fp, open(idx_path(pak), "ab") as fi:
+        offset = fp.seek(0, os.SEEK_END)
+        for name in names:
+            path = os.path.join(day_dir, name)
+            with open(path, "rb") as f:
+                data = f.read()
+            fp.write(data)
+            fi.write(ENTRY.pack(offset, len(data), int(os.path.getmtime(path)), 0))
+            offset += len(data)
+    print("%s: %d pictures, %d B" % (pak, len(names), os.path.getsize(pak)))
+    return pak
+
+
+def unpack(pak, out_dir):
+    os.makedirs(out_dir, exist_ok=True)
+    entries = read_index(pak)
+    with open(pak, "rb") as fp:
+        for n, (offset, length, ts) in enumerate(entries):
+            fp.seek(offset)
+            path = os.path.join(out_dir, "%03d.jpg" % (n + 1))
+            with open(path, "wb") as f:
+                f.write(fp.read(length))
+            os.utime(path, (ts, ts))
+    print("%s: %d pictures restored to %s" % (pak, len(entries), out_dir))
+
+
+def list_pack(pak):
+    for n, (offset, length, ts) in enumerate(read_index(pak)):
+        print("%4d  %10d  %8d  %s" % (n, offset, length, time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(ts))))
+
+
+def timed(fn, rounds):
+    best = None
+    for _ in range(rounds):
+        t = time.perf_counter()
+        fn()
+        t = time.perf_counter() - t
+        best = t if best is None or t < best else best
+    return best * 1000
+
+
+def bench(day_dir, rounds=5):
+    names = day_pictures(day_dir)
+    if not names:
+        sys.exit("no pictures in %s" % day_dir)
+    tmp = os.path.join(day_dir, "bench.pak")
+    for p in (tmp, idx_path(tmp)):
+        if os.path.exists(p):
+            os.remove(p)
+    pack(day_dir, tmp)
+    picks = [random.randrange(len(names)) for _ in range(32)]
+
+    def list_files():
+        # cold day listing (pic_index_build()): readdir + stat of every picture
+        for name in os.listdir(day_dir):
+            if name.lower().endswith(".jpg"):
+                os.stat(os.path.join(day_dir, name))
+
+    def list_pack():
+        read_index(tmp)
+
+    def serve_files():
+        for n in picks:
+            with open(os.path.join(day_dir, names[n]), "rb") as f:
+                while f.read(4096):
+                    pass
+
+    def serve_pack():
+        # what pak_get_handler() does: index record, seek, bounded read
+        for n in picks:
+            with open(idx_path(tmp), "rb") as fi:
+                fi.seek(n * ENTRY.size)
+                offset, length, _, _ = ENTRY.unpack(fi.read(ENTRY.size))
+            with open(tmp, "rb") as f:
+                f.seek(offset)
+                while length > 0:
+                    length -= len(f.read(min(4096, length)))
+
+    print("%d pictures, best of %d rounds (ms)" % (len(names), rounds))
+    print("          files     pack")
+    print("list   %8.2f %8.2f" % (timed(list_files, rounds), timed(list_pack, rounds)))
+    print("serve  %8.2f %8.2f   (%d pictures)" % (timed(serve_files, rounds), timed(serve_pack, rounds), len(picks)))
+    os.remove(tmp)
+    os.remove(idx_path(tmp))
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.exit(__doc__)
+    cmd = argv[1]
+    if cmd == "pack":
+        pack(argv[2], argv[3] if len(argv) > 3 else None)
+    elif cmd == "unpack" and len(argv) > 3:
+        unpack(argv[2], argv[3])
+    elif cmd == "list":
+        list_pack(argv[2])
+    elif cmd == "bench":
+        bench(argv[2], int(argv[3]) if len(argv) > 3 else 5)
+    else:
+        sys.exit(__doc__)
+
+
+if __name__ == "__main__":
+    main(sys.argv)